@@ -0,0 +1,40 @@
+#!/bin/bash
+
+# runs the avrtest programs as one batch on each execution engine
+# usage: run_batch.sh <simulavr> <processor> ...
+
+SIMULAVR=$1
+shift
+PROCESSORS="$*"
+
+ENGINES="decoder threaded block"
+if [ "`uname -s`" = "Linux" -a "`uname -m`" = "x86_64" ]; then
+  ENGINES="${ENGINES} jit"
+fi
+
+# one job for each program and processor, same options as in avrtest.cfg
+MANIFEST=batch.manifest
+echo "# generated by run_batch.sh" > ${MANIFEST}
+for p in ${PROCESSORS}; do
+  echo "maxruntime_$p $p maxruntime_$p.elf 1000000 0 --writetopipe=52,maxruntime_$p.batchout" >> ${MANIFEST}
+  echo "abort_$p $p abort_$p.elf 10000000 134 --writetopipe=52,abort_$p.batchout --writetoabort=49" >> ${MANIFEST}
+  echo "exit_$p $p exit_$p.elf 10000000 1 --writetopipe=52,exit_$p.batchout --writetoexit=4F" >> ${MANIFEST}
+done
+
+# several jobs on each thread, so that devices are created and deleted in parallel
+RES=0
+for e in ${ENGINES}; do
+  echo "${SIMULAVR} --batch ${MANIFEST} -j 4 -E $e"
+  ${SIMULAVR} --batch ${MANIFEST} --results batch_$e.results -j 4 -E $e
+  if [ ! "$?" = "0" ]; then
+    echo ""
+    echo "error: batch run with engine $e failed!"
+    echo ""
+    cat batch_$e.results
+    RES=1
+  fi
+done
+rm -f *.batchout
+exit $RES
+
+# EOF
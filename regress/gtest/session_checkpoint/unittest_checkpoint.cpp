@@ -0,0 +1,256 @@
+#include <iostream>
+#include <vector>
+#include <cstdio>
+using namespace std;
+
+#include "gtest.h"
+
+#include "systemclock.h"
+#include "simulationcontext.h"
+#include "avrdevice.h"
+#include "avrfactory.h"
+#include "checkpoint.h"
+#include "flash.h"
+
+static void WriteProgram(AvrDevice *dev, const vector<unsigned short> &prog) {
+    vector<unsigned char> bytes(prog.size() * 2);
+    for(unsigned i = 0; i < prog.size(); i++) {
+        bytes[2 * i] = prog[i] & 0xff;
+        bytes[2 * i + 1] = prog[i] >> 8;
+    }
+    dev->Flash->WriteMem(&bytes[0], 0, bytes.size());
+}
+
+// program for atmega32: timer 0 overflow interrupt counts in 0x100, main
+// loop counts in 0x101
+static void LoadTimerProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x16] = 0xc000 | (0x37 - 0x17);    // rjmp isr (TIMER0 OVF)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xbf09,                 // out TIMSK, r16
+        0x9478,                 // sei
+        0x9583,                 // loop: inc r24
+        0x9380, 0x0101,         // sts 0x101, r24
+        0x9583,                 // inc r24
+        0xcffb,                 // rjmp loop
+        0x930f,                 // isr: push r16
+        0xb70f,                 // in r16, SREG
+        0x930f,                 // push r16
+        0x9100, 0x0100,         // lds r16, 0x100
+        0x9503,                 // inc r16
+        0x9300, 0x0100,         // sts 0x100, r16
+        0x910f,                 // pop r16
+        0xbf0f,                 // out SREG, r16
+        0x910f,                 // pop r16
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+// program for attiny25: timer 1 clocked by pll (async mode), overflow
+// interrupt counts in 0x60, main loop counts in 0x61
+static void LoadTinyX5TimerProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x0f, 0xffff);
+    prog[0x00] = 0xc000 | (0x0f - 1);       // rjmp main
+    prog[0x04] = 0xc000 | (0x22 - 0x05);    // rjmp isr (TIMER1 OVF)
+    const unsigned short code[] = {
+        0xe000,                 // main: ldi r16, 0x00
+        0xbf0e,                 // out SPH, r16
+        0xed0f,                 // ldi r16, 0xdf
+        0xbf0d,                 // out SPL, r16
+        0x2411,                 // eor r1, r1
+        0x9210, 0x0060,         // sts 0x60, r1
+        0xe002,                 // ldi r16, 0x02
+        0xbd07,                 // out PLLCSR, r16 (PLLE)
+        0xe006,                 // ldi r16, 0x06
+        0xbd07,                 // out PLLCSR, r16 (PLLE, PCKE)
+        0xe004,                 // ldi r16, 0x04
+        0xbf09,                 // out TIMSK, r16 (TOIE1)
+        0xbf00,                 // out TCCR1, r16 (PCK/8)
+        0x9478,                 // sei
+        0x9583,                 // loop: inc r24
+        0x9380, 0x0061,         // sts 0x61, r24
+        0xcffc,                 // rjmp loop
+        0x930f,                 // isr: push r16
+        0xb70f,                 // in r16, SREG
+        0x930f,                 // push r16
+        0x9100, 0x0060,         // lds r16, 0x60
+        0x9503,                 // inc r16
+        0x9300, 0x0060,         // sts 0x60, r16
+        0x910f,                 // pop r16
+        0xbf0f,                 // out SREG, r16
+        0x910f,                 // pop r16
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+// program for atmega328: a pin change on PB0 raises PCINT0, but interrupts
+// are enabled only after a delay loop, the ISR writes 0x55 to 0x100
+static void LoadPinChangeProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x34, 0xffff);
+    prog[0x00] = 0xc000 | (0x34 - 1);       // rjmp main
+    prog[0x06] = 0xc000 | (0x48 - 0x07);    // rjmp isr (PCINT0)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xef0f,                 // ldi r16, 0xff
+        0xbf0d,                 // out SPL, r16
+        0x2411,                 // eor r1, r1
+        0x9210, 0x0100,         // sts 0x100, r1
+        0xe001,                 // ldi r16, 0x01
+        0x9300, 0x0068,         // sts PCICR, r16
+        0x9300, 0x006b,         // sts PCMSK0, r16
+        0x9a20,                 // sbi DDRB, 0
+        0x9a28,                 // sbi PORTB, 0
+        0x2788,                 // eor r24, r24
+        0x9583,                 // loop: inc r24
+        0x3c88,                 // cpi r24, 200
+        0xf7e9,                 // brne loop
+        0x9478,                 // sei
+        0xcfff,                 // rjmp .
+        0xe515,                 // isr: ldi r17, 0x55
+        0x9310, 0x0100,         // sts 0x100, r17
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+static AvrDevice *MakeDevice(SimulationContext &c,
+                             const char *type = "atmega32",
+                             void (*load)(AvrDevice *) = LoadTimerProgram) {
+    AvrDevice *dev = AvrFactory::instance().makeDevice(type, &c);
+    load(dev);
+    dev->SetClockFreq(125); // 8MHz
+    c.GetClock().Add(dev);
+    return dev;
+}
+
+// IO registers without side effects on read, default: TCNT0, TIFR, SP, SREG
+// on atmega32
+static const unsigned timerIO[] = { 0x52, 0x58, 0x5d, 0x5e, 0x5f };
+
+static void ExpectSameState(AvrDevice *a, AvrDevice *b,
+                            const unsigned *io = timerIO,
+                            size_t ioCount = sizeof(timerIO) / sizeof(timerIO[0]),
+                            unsigned data = 0x100) {
+    EXPECT_EQ(a->GetSystemClock().GetCurrentTime(), b->GetSystemClock().GetCurrentTime());
+    EXPECT_EQ(a->PC, b->PC);
+    EXPECT_EQ(a->GetClockCycles(), b->GetClockCycles());
+    EXPECT_EQ(a->GetRWMem(data), b->GetRWMem(data));
+    EXPECT_EQ(a->GetRWMem(data + 1), b->GetRWMem(data + 1));
+    for(unsigned i = 0; i < 32; i++)
+        EXPECT_EQ(a->GetRWMem(i), b->GetRWMem(i)) << "r" << i << endl;
+    for(unsigned i = 0; i < ioCount; i++)
+        EXPECT_EQ(a->GetRWMem(io[i]), b->GetRWMem(io[i])) << "address " << io[i] << endl;
+}
+
+// a restored device continues like the one, which is saved
+TEST( SESSION_CHECKPOINT, SAVE_RESTORE )
+{
+    SimulationContext ca, cb;
+    AvrDevice *a = MakeDevice(ca);
+    AvrDevice *b = MakeDevice(cb);
+
+    ca.GetClock().Run(1000000);
+    SystemClockOffset saved = ca.GetClock().GetCurrentTime();
+    EXPECT_LT(10u, a->GetRWMem(0x100)) << "no interrupts" << endl;
+    Checkpoint cp;
+    cp.Save(a);
+    EXPECT_LT(0x800u, cp.GetSize()); // at least SRAM
+
+    // through a file
+    const char *name = "unittest_checkpoint.cp";
+    cp.Write(name);
+    Checkpoint fromFile;
+    fromFile.Read(name);
+    remove(name);
+    EXPECT_EQ(cp.GetSize(), fromFile.GetSize());
+    fromFile.Restore(b);
+    ExpectSameState(a, b);
+
+    ca.GetClock().RunTimeRange(500000);
+    cb.GetClock().RunTimeRange(500000);
+    EXPECT_EQ(saved + 500000, cb.GetClock().GetCurrentTime());
+    ExpectSameState(a, b);
+
+    // same checkpoint can be restored again on a device, which has run on
+    unsigned long long cycles = b->GetClockCycles();
+    cp.Restore(b);
+    EXPECT_EQ(saved, cb.GetClock().GetCurrentTime());
+    EXPECT_GT(cycles, b->GetClockCycles());
+    cb.GetClock().RunTimeRange(500000);
+    ExpectSameState(a, b);
+
+    ca.GetClock().Remove(a);
+    cb.GetClock().Remove(b);
+    delete a;
+    delete b;
+}
+
+// a pending pin change interrupt, which isn't taken yet, survives restore
+TEST( SESSION_CHECKPOINT, PENDING_PIN_CHANGE )
+{
+    SimulationContext ca, cb;
+    AvrDevice *a = MakeDevice(ca, "atmega328", LoadPinChangeProgram);
+    AvrDevice *b = MakeDevice(cb, "atmega328", LoadPinChangeProgram);
+    // PCIFR, PCICR, PCMSK0, PINB, SP, SREG
+    const unsigned io[] = { 0x3b, 0x68, 0x6b, 0x23, 0x5d, 0x5e, 0x5f };
+    const size_t ioCount = sizeof(io) / sizeof(io[0]);
+
+    ca.GetClock().RunTimeRange(20000);
+    EXPECT_EQ(1, a->GetRWMem(0x3b)) << "pin change flag not set" << endl;
+    EXPECT_EQ(0, a->GetRWMem(0x100)) << "interrupt taken too early" << endl;
+    Checkpoint cp;
+    cp.Save(a);
+    cp.Restore(b);
+    ExpectSameState(a, b, io, ioCount);
+
+    ca.GetClock().RunTimeRange(200000);
+    cb.GetClock().RunTimeRange(200000);
+    EXPECT_EQ(0x55, b->GetRWMem(0x100)) << "pending interrupt lost" << endl;
+    EXPECT_EQ(0, b->GetRWMem(0x3b));
+    ExpectSameState(a, b, io, ioCount);
+
+    ca.GetClock().Remove(a);
+    cb.GetClock().Remove(b);
+    delete a;
+    delete b;
+}
+
+// timer 1 on ATtiny25 in async mode is scheduled on SystemClock by itself
+TEST( SESSION_CHECKPOINT, TINYX5_ASYNC_TIMER )
+{
+    SimulationContext ca, cb;
+    AvrDevice *a = MakeDevice(ca, "attiny25", LoadTinyX5TimerProgram);
+    AvrDevice *b = MakeDevice(cb, "attiny25", LoadTinyX5TimerProgram);
+    // TCNT1, TCCR1, PLLCSR, TIFR, SP, SREG
+    const unsigned io[] = { 0x4f, 0x50, 0x47, 0x58, 0x5d, 0x5e, 0x5f };
+    const size_t ioCount = sizeof(io) / sizeof(io[0]);
+
+    ca.GetClock().RunTimeRange(300000);
+    EXPECT_LT(5u, a->GetRWMem(0x60)) << "no interrupts" << endl;
+    Checkpoint cp;
+    cp.Save(a);
+    cp.Restore(b);
+    ExpectSameState(a, b, io, ioCount, 0x60);
+
+    ca.GetClock().RunTimeRange(100000);
+    cb.GetClock().RunTimeRange(100000);
+    ExpectSameState(a, b, io, ioCount, 0x60);
+
+    ca.GetClock().Remove(a);
+    cb.GetClock().Remove(b);
+    delete a;
+    delete b;
+}
@@ -0,0 +1,502 @@
+#include <iostream>
+#include <vector>
+#include <string>
+using namespace std;
+
+#include "gtest.h"
+
+#include "systemclock.h"
+#include "simulationcontext.h"
+#include "avrdevice.h"
+#include "avrfactory.h"
+#include "flash.h"
+#include "traceval.h"
+#include "net.h"
+
+// writes program words to flash, low byte first
+static void WriteProgram(AvrDevice *dev, const vector<unsigned short> &prog) {
+    vector<unsigned char> bytes(prog.size() * 2);
+    for(unsigned i = 0; i < prog.size(); i++) {
+        bytes[2 * i] = prog[i] & 0xff;
+        bytes[2 * i + 1] = prog[i] >> 8;
+    }
+    dev->Flash->WriteMem(&bytes[0], 0, bytes.size());
+}
+
+// program for atmega32: main loop with straight-line code, a countdown loop
+// and a call, timer 0 overflow interrupt every 256 cycles writes r24 to a
+// ring buffer from 0x60 to 0xef, so a late or early interrupt changes memory
+static void LoadEngineProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x16] = 0xc000 | (0x47 - 0x17);    // rjmp isr (TIMER0 OVF)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0xe6c0,                 // ldi r28, 0x60
+        0xe0d0,                 // ldi r29, 0x00
+        0x2788,                 // eor r24, r24
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xbf09,                 // out TIMSK, r16
+        0x9478,                 // sei
+        0x9583,                 // loop: inc r24
+        0x9583,                 // inc r24
+        0x9583,                 // inc r24
+        0x9583,                 // inc r24
+        0x9583,                 // inc r24
+        0x9583,                 // inc r24
+        0x9583,                 // inc r24
+        0x9583,                 // inc r24
+        0x0f98,                 // add r25, r24
+        0x2e29,                 // mov r2, r25
+        0x5093,                 // subi r25, 0x03
+        0xe045,                 // ldi r20, 0x05
+        0x954a,                 // delay: dec r20
+        0xf7f1,                 // brne delay
+        0xd001,                 // rcall sub
+        0xcff0,                 // rjmp loop
+        0x2638,                 // sub: eor r3, r24
+        0x9508,                 // ret
+        0x930f,                 // isr: push r16
+        0xb70f,                 // in r16, SREG
+        0x9389,                 // st Y+, r24
+        0x3fc0,                 // cpi r28, 0xf0
+        0xf409,                 // brne nowrap
+        0xe6c0,                 // ldi r28, 0x60
+        0xbf0f,                 // nowrap: out SREG, r16
+        0x910f,                 // pop r16
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+// program for atmega16 and atmega32: timer 0 overflow interrupt enabled,
+// selects sleep mode mcucr, enables interrupts, if sei is set, then sleeps,
+// r24 counts up after wakeup
+static void LoadSleepProgram(AvrDevice *dev, unsigned char mcucr, bool sei) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x12] = 0xc000 | (0x38 - 0x13);    // rjmp isr (TIMER0 OVF on atmega16)
+    prog[0x16] = 0xc000 | (0x38 - 0x17);    // rjmp isr (TIMER0 OVF on atmega32)
+    const unsigned short code[] = {
+        0xe004,                 // main: ldi r16, 0x04
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0x2788,                 // eor r24, r24
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xbf09,                 // out TIMSK, r16
+        (unsigned short)(0xe000 | ((mcucr & 0xf0) << 4) | (mcucr & 0x0f)), // ldi r16, mcucr
+        0xbf05,                 // out MCUCR, r16
+        (unsigned short)(sei ? 0x9478 : 0x0000), // sei or nop
+        0x9588,                 // sleep
+        0x9583,                 // loop: inc r24
+        0xcffe,                 // rjmp loop
+        0x9518                  // isr: reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+// program for atmega32: timer 1 in CTC mode with OCR1A=999 and CK/8, compare
+// interrupt writes TCNT0 and TCNT1L to a ring buffer from 0x60 to 0xef, timer 0
+// overflow interrupt counts in r5, main loop sums up TCNT1 and TCNT0 and sleeps
+static void LoadTimerProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x0e] = 0xc000 | (0x45 - 0x0f);    // rjmp isr1 (TIMER1 COMPA)
+    prog[0x16] = 0xc000 | (0x51 - 0x17);    // rjmp isr0 (TIMER0 OVF)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0xe6c0,                 // ldi r28, 0x60
+        0xe0d0,                 // ldi r29, 0x00
+        0xe003,                 // ldi r16, 0x03
+        0xbd0b,                 // out OCR1AH, r16
+        0xee07,                 // ldi r16, 0xe7
+        0xbd0a,                 // out OCR1AL, r16
+        0xe00a,                 // ldi r16, 0x0a
+        0xbd0e,                 // out TCCR1B, r16
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xe101,                 // ldi r16, 0x11
+        0xbf09,                 // out TIMSK, r16
+        0xe800,                 // ldi r16, 0x80
+        0xbf05,                 // out MCUCR, r16
+        0x9478,                 // sei
+        0xb52c,                 // loop: in r18, TCNT1L
+        0xb53d,                 // in r19, TCNT1H
+        0x0e22,                 // add r2, r18
+        0x1e33,                 // adc r3, r19
+        0xb722,                 // in r18, TCNT0
+        0x0e42,                 // add r4, r18
+        0x9588,                 // sleep
+        0xcff8,                 // rjmp loop
+        0x930f,                 // isr1: push r16
+        0xb70f,                 // in r16, SREG
+        0xb712,                 // in r17, TCNT0
+        0x9319,                 // st Y+, r17
+        0xb51c,                 // in r17, TCNT1L
+        0x9319,                 // st Y+, r17
+        0x3fc0,                 // cpi r28, 0xf0
+        0xf409,                 // brne nowrap
+        0xe6c0,                 // ldi r28, 0x60
+        0xbf0f,                 // nowrap: out SREG, r16
+        0x910f,                 // pop r16
+        0x9518,                 // reti
+        0x930f,                 // isr0: push r16
+        0xb70f,                 // in r16, SREG
+        0x9453,                 // inc r5
+        0xbf0f,                 // out SREG, r16
+        0x910f,                 // pop r16
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+// program for atmega32: USART with 38400 baud sends 20 bytes from 'A' on,
+// receive complete interrupt writes received byte and TCNT0 to SRAM from 0x60
+// on, core sleeps till a byte is received back over a loopback from TXD to RXD
+static void LoadUartProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x1a] = 0xc000 | (0x43 - 0x1b);    // rjmp isr (USART RXC)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0xe6c0,                 // ldi r28, 0x60
+        0xe0d0,                 // ldi r29, 0x00
+        0xe00c,                 // ldi r16, 0x0c
+        0xb909,                 // out UBRRL, r16
+        0xe908,                 // ldi r16, 0x98
+        0xb90a,                 // out UCSRB, r16
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xe800,                 // ldi r16, 0x80
+        0xbf05,                 // out MCUCR, r16
+        0x9478,                 // sei
+        0xe441,                 // ldi r20, 0x41
+        0x9b5d,                 // loop: sbis UCSRA, UDRE
+        0xcffe,                 // rjmp loop
+        0xb94c,                 // out UDR, r20
+        0x9543,                 // inc r20
+        0x9588,                 // sleep
+        0x3545,                 // cpi r20, 0x55
+        0xf7c9,                 // brne loop
+        0x9588,                 // done: sleep
+        0xcffe,                 // rjmp done
+        0x930f,                 // isr: push r16
+        0xb70f,                 // in r16, SREG
+        0xb11c,                 // in r17, UDR
+        0x9319,                 // st Y+, r17
+        0xb712,                 // in r17, TCNT0
+        0x9319,                 // st Y+, r17
+        0xbf0f,                 // out SREG, r16
+        0x910f,                 // pop r16
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+// program for atmega32: ADC converts ADC0 with changing prescaler, ADC
+// interrupt writes ADCL, ADCH and TCNT0 to SRAM from 0x60 on and starts next
+// conversion, timer 0 overflow interrupt toggles PB0, core sleeps
+static void LoadAdcProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x16] = 0xc000 | (0x51 - 0x17);    // rjmp isr0 (TIMER0 OVF)
+    prog[0x20] = 0xc000 | (0x3e - 0x21);    // rjmp isr (ADC)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0xe6c0,                 // ldi r28, 0x60
+        0xe0d0,                 // ldi r29, 0x00
+        0xe400,                 // ldi r16, 0x40
+        0xb907,                 // out ADMUX, r16
+        0x9ab8,                 // sbi DDRB, 0
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xbf09,                 // out TIMSK, r16
+        0xe800,                 // ldi r16, 0x80
+        0xbf05,                 // out MCUCR, r16
+        0xe040,                 // ldi r20, 0x00
+        0xec0d,                 // ldi r16, 0xcd
+        0xb906,                 // out ADCSRA, r16
+        0x9478,                 // sei
+        0x9588,                 // loop: sleep
+        0xcffe,                 // rjmp loop
+        0x930f,                 // isr: push r16
+        0xb70f,                 // in r16, SREG
+        0xb114,                 // in r17, ADCL
+        0x9319,                 // st Y+, r17
+        0xb115,                 // in r17, ADCH
+        0x9319,                 // st Y+, r17
+        0xb712,                 // in r17, TCNT0
+        0x9319,                 // st Y+, r17
+        0x3fc0,                 // cpi r28, 0xf0
+        0xf409,                 // brne nowrap
+        0xe6c0,                 // ldi r28, 0x60
+        0x2f14,                 // nowrap: mov r17, r20
+        0x7017,                 // andi r17, 0x07
+        0x6c18,                 // ori r17, 0xc8
+        0xb916,                 // out ADCSRA, r17
+        0x9543,                 // inc r20
+        0xbf0f,                 // out SREG, r16
+        0x910f,                 // pop r16
+        0x9518,                 // reti
+        0x9bc0,                 // isr0: sbis PORTB, 0
+        0xc002,                 // rjmp on
+        0x98c0,                 // cbi PORTB, 0
+        0x9518,                 // reti
+        0x9ac0,                 // on: sbi PORTB, 0
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    WriteProgram(dev, prog);
+}
+
+struct EngineResult {
+    unsigned pc;
+    unsigned long long cycles;
+    vector<unsigned char> mem; //!< register file, IO without side effects and SRAM
+};
+
+// runs program with given engine, returns false, if engine isn't available
+static bool RunEngine(const char *engine, bool runAhead, EngineResult &r) {
+    SimulationContext c;
+    AvrDevice *dev = AvrFactory::instance().makeDevice("atmega32", &c);
+    LoadEngineProgram(dev);
+    dev->SetClockFreq(125); // 8MHz
+    if(!dev->SetExecutionEngine(engine)) {
+        delete dev;
+        return false;
+    }
+    c.GetClock().Add(dev);
+    c.GetClock().SetRunAhead(runAhead);
+    c.GetClock().RunTimeRange(2000000);
+
+    r.pc = dev->PC;
+    r.cycles = dev->GetClockCycles();
+    r.mem.clear();
+    for(unsigned i = 0; i < 32; i++)
+        r.mem.push_back(dev->GetRWMem(i));
+    // TCNT0, TIFR, SP, SREG
+    const unsigned io[] = { 0x52, 0x58, 0x5d, 0x5e, 0x5f };
+    for(unsigned i = 0; i < sizeof(io) / sizeof(io[0]); i++)
+        r.mem.push_back(dev->GetRWMem(io[i]));
+    for(unsigned i = 0x60; i < 0x860; i++)
+        r.mem.push_back(dev->GetRWMem(i));
+
+    c.GetClock().Remove(dev);
+    delete dev;
+    return true;
+}
+
+// every engine has to end in the same state as the decoder, also with
+// run ahead, where the core may fast-forward
+TEST( SESSION_ENGINES, SAME_STATE )
+{
+    EngineResult ref;
+    ASSERT_TRUE(RunEngine("decoder", false, ref));
+    // SRAM starts behind 32 registers and 5 IO registers, 50 interrupts at least
+    EXPECT_NE(0xaa, ref.mem[32 + 5 + 50]) << "no interrupts" << endl;
+
+    const char *engines[] = { "decoder", "threaded", "block", "jit" };
+    for(unsigned e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        for(int runAhead = 0; runAhead < 2; runAhead++) {
+            EngineResult r;
+            if(!RunEngine(engines[e], runAhead != 0, r))
+                continue; // jit isn't available on every host
+            EXPECT_EQ(ref.pc, r.pc) << engines[e] << ", run ahead " << runAhead << endl;
+            EXPECT_EQ(ref.cycles, r.cycles) << engines[e] << ", run ahead " << runAhead << endl;
+            for(size_t i = 0; i < ref.mem.size(); i++)
+                if(ref.mem[i] != r.mem[i]) {
+                    ADD_FAILURE() << engines[e] << ", run ahead " << runAhead
+                                  << ": state differs at index " << i << endl;
+                    break;
+                }
+        }
+    }
+}
+
+// runs sleep program, returns r24, which counts up after wakeup
+static unsigned char RunSleep(const char *device, unsigned char mcucr, bool sei, bool runAhead) {
+    SimulationContext c;
+    AvrDevice *dev = AvrFactory::instance().makeDevice(device, &c);
+    LoadSleepProgram(dev, mcucr, sei);
+    dev->SetClockFreq(125); // 8MHz
+    c.GetClock().Add(dev);
+    c.GetClock().SetRunAhead(runAhead);
+    c.GetClock().RunTimeRange(100000);
+    unsigned char count = dev->GetRWMem(24);
+    c.GetClock().Remove(dev);
+    delete dev;
+    return count;
+}
+
+// timer 0 overflow wakes up core in idle mode, but not in power-down mode
+// and not with interrupts disabled, also if core fast-forwards while sleeping
+TEST( SESSION_ENGINES, SLEEP_WAKEUP )
+{
+    for(int runAhead = 0; runAhead < 2; runAhead++) {
+        EXPECT_NE(0, RunSleep("atmega32", 0x80, true, runAhead != 0)) << "idle, run ahead " << runAhead << endl;
+        EXPECT_EQ(0, RunSleep("atmega32", 0xa0, true, runAhead != 0)) << "power-down, run ahead " << runAhead << endl;
+        EXPECT_EQ(0, RunSleep("atmega32", 0x80, false, runAhead != 0)) << "cli, run ahead " << runAhead << endl;
+    }
+}
+
+// atmega16 has SE on bit 6 and SM2 on bit 7 of MCUCR, so SM2 alone
+// (standby without SE) doesn't sleep
+TEST( SESSION_ENGINES, SLEEP_WAKEUP_ATMEGA16 )
+{
+    EXPECT_NE(0, RunSleep("atmega16", 0x40, true, false)) << "idle" << endl;
+    EXPECT_EQ(0, RunSleep("atmega16", 0x60, true, false)) << "power-down" << endl;
+    EXPECT_EQ(0, RunSleep("atmega16", 0x40, false, false)) << "cli" << endl;
+    EXPECT_NE(0, RunSleep("atmega16", 0xa0, false, false)) << "standby without SE" << endl;
+}
+
+// dumper without traced values, an active dumper keeps timers on cycle list
+class NullDumper: public Dumper {
+    public:
+        bool enabled(const TraceValue *t) const { return false; }
+};
+
+// runs program for 20ms, with dumper hardware parts are ticked on each cycle,
+// a loopback connects pin loop[0] with pin loop[1], if loop isn't NULL, io
+// lists registers to save, returns count of CpuCycle calls on hardware parts
+static unsigned long long RunSuspend(void (*load)(AvrDevice *), const char *const *loop,
+                                     const vector<unsigned> &io, bool dump,
+                                     bool runAhead, EngineResult &r) {
+    SimulationContext c;
+    AvrDevice *dev = AvrFactory::instance().makeDevice("atmega32", &c);
+    load(dev);
+    dev->SetClockFreq(125); // 8MHz
+    Net net(c.GetClock());
+    if(loop != NULL) {
+        net.Add(dev->GetPin(loop[0]));
+        net.Add(dev->GetPin(loop[1]));
+    }
+    DumpManager *dm = c.GetDumpManager();
+    if(dump)
+        dm->addDumper(new NullDumper, TraceSet());
+    c.GetClock().Add(dev);
+    c.GetClock().SetRunAhead(runAhead);
+    dm->start();
+    c.GetClock().RunTimeRange(20000000);
+    dm->stopApplication();
+
+    r.pc = dev->PC;
+    r.cycles = dev->GetClockCycles();
+    r.mem.clear();
+    for(unsigned i = 0; i < 32; i++)
+        r.mem.push_back(dev->GetRWMem(i));
+    for(unsigned i = 0; i < io.size(); i++)
+        r.mem.push_back(dev->GetRWMem(io[i]));
+    for(unsigned i = 0x60; i < 0xf0; i++)
+        r.mem.push_back(dev->GetRWMem(i));
+    unsigned long long calls = dev->GetHwCycleCalls();
+
+    c.GetClock().Remove(dev);
+    delete dev;
+    return calls;
+}
+
+// compares runs without dumper, also with run ahead, against reference run
+static void CompareSuspend(void (*load)(AvrDevice *), const char *const *loop,
+                           const vector<unsigned> &io,
+                           const EngineResult &ref, unsigned long long refCalls) {
+    for(int runAhead = 0; runAhead < 2; runAhead++) {
+        EngineResult r;
+        unsigned long long calls = RunSuspend(load, loop, io, false, runAhead != 0, r);
+        EXPECT_EQ(ref.pc, r.pc) << "run ahead " << runAhead << endl;
+        EXPECT_EQ(ref.cycles, r.cycles) << "run ahead " << runAhead << endl;
+        for(size_t i = 0; i < ref.mem.size(); i++)
+            EXPECT_EQ((int)ref.mem[i], (int)r.mem[i]) << "run ahead " << runAhead << ", index " << i << endl;
+        // suspended parts need only a few calls
+        EXPECT_LT(calls * 10, refCalls) << "run ahead " << runAhead << endl;
+    }
+}
+
+// running timers leave cycle list till next count event, counter values read
+// by core and interrupts have to be the same as with counting on each cycle
+TEST( SESSION_ENGINES, TIMER_SUSPEND )
+{
+    // TCNT1L, TCNT1H, TCNT0, TIFR, SREG
+    const unsigned regs[] = { 0x4c, 0x4d, 0x52, 0x58, 0x5f };
+    vector<unsigned> io(regs, regs + sizeof(regs) / sizeof(regs[0]));
+    EngineResult ref;
+    unsigned long long refCalls = RunSuspend(LoadTimerProgram, NULL, io, true, false, ref);
+    // 20ms with 8MHz, registers start with 0xaa, r5 counts timer 0 overflows
+    EXPECT_EQ((0xaa + 624) & 0xff, ref.mem[5]) << "timer 0 overflows" << endl;
+    EXPECT_EQ(0x60 + 2 * 19, ref.mem[28]) << "timer 1 compare matches" << endl;
+    CompareSuspend(LoadTimerProgram, NULL, io, ref, refCalls);
+}
+
+// UART leaves cycle list between samples and shifts of bits and while it
+// waits for a start bit or UDR write, received bytes have to be the same
+TEST( SESSION_ENGINES, UART_SUSPEND )
+{
+    // UCSRA, UCSRB, SREG
+    const unsigned regs[] = { 0x2b, 0x2a, 0x5f };
+    const char *loop[] = { "D1", "D0" }; // TXD to RXD
+    vector<unsigned> io(regs, regs + sizeof(regs) / sizeof(regs[0]));
+    EngineResult ref;
+    unsigned long long refCalls = RunSuspend(LoadUartProgram, loop, io, true, false, ref);
+    // 20 bytes received, starting with 'A', TCNT0 shows time of RXC interrupt
+    EXPECT_EQ(0x60 + 2 * 20, ref.mem[28]) << "received bytes" << endl;
+    EXPECT_EQ('A', ref.mem[32 + 3]) << "first byte" << endl;
+    EXPECT_EQ('A' + 19, ref.mem[32 + 3 + 2 * 19]) << "last byte" << endl;
+    CompareSuspend(LoadUartProgram, loop, io, ref, refCalls);
+}
+
+// ADC leaves cycle list between sample and completion of a conversion and
+// while it waits for ADSC, samples and their time have to be the same
+TEST( SESSION_ENGINES, ADC_SUSPEND )
+{
+    // ADCSRA, ADMUX, SREG
+    const unsigned regs[] = { 0x26, 0x27, 0x5f };
+    const char *loop[] = { "B0", "A0" }; // toggled pin to ADC0
+    vector<unsigned> io(regs, regs + sizeof(regs) / sizeof(regs[0]));
+    EngineResult ref;
+    unsigned long long refCalls = RunSuspend(LoadAdcProgram, loop, io, true, false, ref);
+    // r20 counts conversions, ADCH of the last 48 samples shows, if PB0 was
+    // low or high on sample time, both have to be there
+    EXPECT_EQ(69, ref.mem[20]) << "conversions" << endl;
+    int high = 0;
+    for(int i = 0; i < 48; i++)
+        if(ref.mem[32 + 3 + 3 * i + 1] != 0)
+            high++;
+    EXPECT_LT(0, high) << "samples with PB0 high" << endl;
+    EXPECT_GT(48, high) << "samples with PB0 low" << endl;
+    CompareSuspend(LoadAdcProgram, loop, io, ref, refCalls);
+}
+
+// busy-wait loops are only fast-forwarded, if the polled IO register can be
+// read without side effects
+TEST( SESSION_ENGINES, PEEK_IO )
+{
+    SimulationContext c;
+    AvrDevice *dev = AvrFactory::instance().makeDevice("atmega32", &c);
+    unsigned char val;
+    EXPECT_TRUE(dev->PeekIOReg(0x16, val)) << "PINB" << endl;
+    EXPECT_TRUE(dev->PeekIOReg(0x38, val)) << "TIFR" << endl;
+    EXPECT_TRUE(dev->PeekIOReg(0x1c, val)) << "EECR" << endl;
+    EXPECT_TRUE(dev->PeekIOReg(0x0b, val)) << "UCSRA" << endl;
+    // reading SPSR arms clearing of SPIF, reading UDR pops receive buffer
+    EXPECT_FALSE(dev->PeekIOReg(0x0e, val)) << "SPSR" << endl;
+    EXPECT_FALSE(dev->PeekIOReg(0x0c, val)) << "UDR" << endl;
+    delete dev;
+}
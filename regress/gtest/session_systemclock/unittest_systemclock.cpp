@@ -0,0 +1,335 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <thread>
+using namespace std;
+
+#include "gtest.h"
+
+#include "systemclock.h"
+#include "simulationmember.h"
+#include "simulationcontext.h"
+#include "avrdevice.h"
+#include "avrfactory.h"
+#include "cosimulation.h"
+#include "net.h"
+#include "flash.h"
+
+// member, which records the time of its calls and leaves time table then
+class ClockProbe: public SimulationMember {
+    public:
+        ClockProbe(): calls(0), lastCall(-1) {}
+        int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns) {
+            calls++;
+            lastCall = SystemClock::Instance().GetCurrentTime();
+            if(timeToNextStepIn_ns != 0)
+                *timeToNextStepIn_ns = -1;
+            return 0;
+        }
+        int calls;
+        SystemClockOffset lastCall;
+};
+
+// member, which is called every period ns
+class TickProbe: public SimulationMember {
+    public:
+        TickProbe(SystemClockOffset p): period(p), calls(0), clock(NULL) {}
+        int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns) {
+            calls++;
+            clock = &SystemClock::Instance();
+            if(timeToNextStepIn_ns != 0)
+                *timeToNextStepIn_ns = period;
+            return 0;
+        }
+        SystemClockOffset period;
+        long calls;
+        SystemClock *clock; //!< clock of current context in Step
+};
+
+// returns the most positions in time table, which changed on one of count reschedules
+static unsigned MaxMovesPerReschedule(vector<ClockProbe> &probes, unsigned count) {
+    SystemClock &sc = SystemClock::Instance();
+    sc.ResetClock();
+    for(unsigned i = 0; i < probes.size(); i++)
+        sc.Add(&probes[i], (SystemClockOffset)(rand() % 1000000));
+    vector<unsigned> before(probes.size());
+    unsigned maxMoves = 0;
+    for(unsigned i = 0; i < count; i++) {
+        for(unsigned j = 0; j < probes.size(); j++)
+            before[j] = probes[j].heapIndex;
+        sc.Reschedule(&probes[rand() % probes.size()], (SystemClockOffset)(rand() % 1000000));
+        unsigned moves = 0;
+        for(unsigned j = 0; j < probes.size(); j++)
+            if(before[j] != probes[j].heapIndex)
+                moves++;
+        if(moves > maxMoves)
+            maxMoves = moves;
+    }
+    sc.ResetClock();
+    return maxMoves;
+}
+
+TEST( SESSION_SYSTEMCLOCK, ORDER )
+{
+    SystemClock &sc = SystemClock::Instance();
+    sc.ResetClock();
+    srand(1);
+
+    vector<ClockProbe> probes(500);
+    vector<SystemClockOffset> due(probes.size());
+    for(unsigned i = 0; i < probes.size(); i++) {
+        due[i] = 10 + rand() % 10000;
+        sc.Add(&probes[i], due[i]);
+    }
+    // move and cancel some of them, add some twice
+    for(unsigned i = 0; i < 2000; i++) {
+        unsigned n = rand() % probes.size();
+        switch(rand() % 3) {
+            case 0:
+                due[n] = 10 + rand() % 10000;
+                sc.Reschedule(&probes[n], due[n] - 1);
+                break;
+            case 1:
+                due[n] = -1;
+                sc.Remove(&probes[n]);
+                break;
+            case 2:
+                due[n] = 10 + rand() % 10000;
+                sc.Add(&probes[n], due[n]);
+                break;
+        }
+    }
+
+    unsigned steps = 0;
+    for(unsigned i = 0; i < probes.size(); i++)
+        if(due[i] >= 0)
+            steps++;
+    SystemClockOffset last = 0;
+    for(unsigned i = 0; i < steps; i++) {
+        bool untilCoreStepFinished = false;
+        sc.Step(untilCoreStepFinished);
+        EXPECT_LE(last, sc.GetCurrentTime()) << "time went backwards" << endl;
+        last = sc.GetCurrentTime();
+    }
+
+    for(unsigned i = 0; i < probes.size(); i++) {
+        EXPECT_EQ(due[i] < 0 ? 0 : 1, probes[i].calls) << "probe " << i << endl;
+        if(due[i] >= 0)
+            EXPECT_EQ(due[i], probes[i].lastCall) << "probe " << i << endl;
+        EXPECT_EQ(0u, probes[i].heapIndex) << "probe " << i << endl;
+    }
+    sc.ResetClock();
+}
+
+// Reschedule has to scale with log(n): only members on one path between
+// root and a leaf of the time table may change their position
+TEST( SESSION_SYSTEMCLOCK, RESCHEDULE_SCALING )
+{
+    srand(2);
+    unsigned sizes[4] = { 10, 100, 1000, 10000 };
+    for(unsigned s = 0; s < 4; s++) {
+        vector<ClockProbe> probes(sizes[s]);
+        unsigned depth = 0;
+        while((1u << depth) <= sizes[s])
+            depth++;
+        EXPECT_GE(depth, MaxMovesPerReschedule(probes, 2000)) << sizes[s] << " members" << endl;
+    }
+}
+
+// two simulations in one process, each one on its own thread
+TEST( SESSION_SYSTEMCLOCK, CONTEXTS )
+{
+    SimulationContext a, b;
+    EXPECT_NE(&a.GetClock(), &b.GetClock());
+    EXPECT_NE(&a.GetClock(), &SystemClock::Instance());
+    EXPECT_NE(a.GetDumpManager(), b.GetDumpManager());
+
+    AvrDevice *devA = AvrFactory::instance().makeDevice("atmega32", &a);
+    AvrDevice *devB = AvrFactory::instance().makeDevice("atmega32", &b);
+    EXPECT_EQ(&a, devA->GetContext());
+    EXPECT_EQ(&b, devB->GetContext());
+    EXPECT_EQ(a.GetDumpManager(), devA->dumpManager);
+    EXPECT_EQ(&b.GetClock(), &devB->GetSystemClock());
+    delete devA;
+    delete devB;
+
+    TickProbe probeA(10), probeB(7);
+    a.GetClock().Add(&probeA);
+    b.GetClock().Add(&probeB);
+    thread ta([&a]() { a.GetClock().Run(100000); });
+    thread tb([&b]() { b.GetClock().Run(70000); });
+    ta.join();
+    tb.join();
+
+    EXPECT_EQ(100000, a.GetClock().GetCurrentTime());
+    EXPECT_EQ(70000, b.GetClock().GetCurrentTime());
+    EXPECT_EQ(10001, probeA.calls);
+    EXPECT_EQ(10001, probeB.calls);
+    // while running, the context of the clock is the current one
+    EXPECT_EQ(&a.GetClock(), probeA.clock);
+    EXPECT_EQ(&b.GetClock(), probeB.clock);
+    EXPECT_EQ(&SimulationContext::Default(), &SimulationContext::Current());
+
+    // stop flag is per context
+    a.GetClock().Stop();
+    EXPECT_TRUE(a.IsStopped());
+    EXPECT_FALSE(b.IsStopped());
+}
+
+// program for atmega32: toggles PB3, counts changes on PIND to 0x100
+static void LoadRingProgram(AvrDevice *dev, unsigned char wait) {
+    const unsigned short prog[] = {
+        0xe008,                 // ldi r16, 0x08
+        0xbb07,                 // out DDRB, r16
+        0xe018,                 // ldi r17, 0x08
+        0xb360,                 // in r22, PIND
+        0xb328,                 // loop: in r18, PORTB
+        0x2721,                 // eor r18, r17
+        0xbb28,                 // out PORTB, r18
+        (unsigned short)(0xe030 | ((wait & 0xf0) << 4) | (wait & 0x0f)), // ldi r19, wait
+        0xb350,                 // wait: in r21, PIND
+        0x1756,                 // cp r21, r22
+        0xf021,                 // breq nochange
+        0x2f65,                 // mov r22, r21
+        0x9543,                 // inc r20
+        0x9340, 0x0100,         // sts 0x100, r20
+        0x953a,                 // nochange: dec r19
+        0xf7b9,                 // brne wait
+        0xcff2                  // rjmp loop
+    };
+    unsigned char bytes[sizeof(prog)];
+    for(unsigned i = 0; i < sizeof(prog) / 2; i++) {
+        bytes[2 * i] = prog[i] & 0xff;
+        bytes[2 * i + 1] = prog[i] >> 8;
+    }
+    dev->Flash->WriteMem(bytes, 0, sizeof(bytes));
+}
+
+struct RingResult {
+    vector<unsigned> changes;
+    vector<unsigned long long> cycles;
+    vector<unsigned> pc;
+};
+
+// ring of cores, PB3 linked to PD2 of next core, each core in its own
+// partition or, for the sequential reference, all in one partition run by
+// its SystemClock. The delays aren't a multiple of the clock periods, so no
+// change is due at the same time as a step of a core.
+static RingResult RunRing(unsigned cores, unsigned threads, bool sequential = false) {
+    RingResult r;
+    CoSimulation cs;
+    vector<AvrDevice *> devs;
+    SimulationContext *p = NULL;
+    for(unsigned i = 0; i < cores; i++) {
+        if(p == NULL || !sequential)
+            p = cs.AddPartition();
+        AvrDevice *dev = AvrFactory::instance().makeDevice("atmega32", p);
+        LoadRingProgram(dev, 10 + 7 * i);
+        dev->SetClockFreq(100 + 25 * (i % 3)); // 10MHz, 8MHz, 6.67MHz
+        p->GetClock().Add(dev);
+        devs.push_back(dev);
+    }
+    for(unsigned i = 0; i < cores; i++)
+        cs.AddLink(devs[i], "B3", devs[(i + 1) % cores], "D2", 503 + 100 * i);
+
+    // two runs, to check continuation
+    if(sequential) {
+        EXPECT_EQ(0, cs.GetLookahead());
+        p->GetClock().RunUntil(1000000);
+        p->GetClock().RunUntil(2000000);
+        EXPECT_EQ(2000000, p->GetClock().GetCurrentTime());
+    } else {
+        EXPECT_EQ(503, cs.GetLookahead());
+        cs.Run(1000000, threads);
+        cs.RunTimeRange(1000000, threads);
+        EXPECT_EQ(2000000, cs.GetCurrentTime());
+        EXPECT_EQ(2 * ((1000000 + 502) / 503), cs.GetWindowCount());
+    }
+
+    for(unsigned i = 0; i < cores; i++) {
+        r.changes.push_back(devs[i]->GetRWMem(0x100));
+        r.cycles.push_back(devs[i]->GetClockCycles());
+        r.pc.push_back(devs[i]->PC);
+        devs[i]->GetSystemClock().Remove(devs[i]);
+        delete devs[i];
+    }
+    return r;
+}
+
+// co-simulation has to give the same result as the sequential run on one
+// SystemClock, for any count of threads
+TEST( SESSION_SYSTEMCLOCK, COSIMULATION )
+{
+    RingResult seq = RunRing(4, 1, true);
+    for(unsigned i = 0; i < 4; i++) {
+        EXPECT_LT(0u, seq.changes[i]) << "core " << i << " doesn't see changes" << endl;
+        EXPECT_LT(0u, seq.cycles[i]) << "core " << i << " didn't run" << endl;
+    }
+    for(unsigned threads = 1; threads <= 4; threads++) {
+        RingResult par = RunRing(4, threads);
+        EXPECT_EQ(seq.changes, par.changes) << threads << " threads" << endl;
+        EXPECT_EQ(seq.cycles, par.cycles) << threads << " threads" << endl;
+        EXPECT_EQ(seq.pc, par.pc) << threads << " threads" << endl;
+    }
+}
+
+// two cores with different clocks in one time table, optional connected by nets
+static RingResult RunPair(SystemClockOffset quantum, bool connect, SystemClock **clock, SimulationContext &c) {
+    RingResult r;
+    Net net01(c.GetClock()), net10(c.GetClock());
+    AvrDevice *devs[2];
+    for(unsigned i = 0; i < 2; i++) {
+        devs[i] = AvrFactory::instance().makeDevice("atmega32", &c);
+        LoadRingProgram(devs[i], 10 + 7 * i);
+        devs[i]->SetClockFreq(100 + 25 * i);
+    }
+    if(connect) {
+        net01.Add(devs[0]->GetPin("B3"));
+        net01.Add(devs[1]->GetPin("D2"));
+        net10.Add(devs[1]->GetPin("B3"));
+        net10.Add(devs[0]->GetPin("D2"));
+    }
+    c.GetClock().SetQuantum(quantum);
+    for(unsigned i = 0; i < 2; i++)
+        c.GetClock().Add(devs[i]);
+    c.GetClock().Run(1000000);
+
+    for(unsigned i = 0; i < 2; i++) {
+        r.changes.push_back(devs[i]->GetRWMem(0x100));
+        r.cycles.push_back(devs[i]->GetClockCycles());
+        r.pc.push_back(devs[i]->PC);
+        c.GetClock().Remove(devs[i]);
+        delete devs[i];
+    }
+    *clock = &c.GetClock();
+    return r;
+}
+
+// cores may run ahead of each other by the quantum, but sync on a net change
+TEST( SESSION_SYSTEMCLOCK, QUANTUM )
+{
+    SystemClock *clock;
+
+    // without interaction the quantum doesn't change results, only order of
+    // cores, which are due at end of run, may differ
+    SimulationContext exact, decoupled;
+    RingResult ex = RunPair(0, false, &clock, exact);
+    EXPECT_EQ(0u, clock->GetQuantumSyncCount());
+    EXPECT_EQ(0u, clock->GetEarlySyncCount());
+    RingResult dc = RunPair(5000, false, &clock, decoupled);
+    for(unsigned i = 0; i < 2; i++)
+        EXPECT_NEAR((double)ex.cycles[i], (double)dc.cycles[i], 1.0) << "core " << i << endl;
+    EXPECT_EQ(ex.changes, dc.changes);
+    // a core runs ahead 40 or 50 steps at a time, till end of quantum
+    EXPECT_LT(1000000u / 5000, clock->GetQuantumSyncCount());
+    EXPECT_GT(1000000u / 5000 * 3, clock->GetQuantumSyncCount());
+
+    // toggled pins end the quantum early
+    SimulationContext linked;
+    RingResult ln = RunPair(5000, true, &clock, linked);
+    EXPECT_LT(0u, clock->GetEarlySyncCount());
+    EXPECT_LT(0u, ln.changes[0]);
+    EXPECT_LT(0u, ln.changes[1]);
+    for(unsigned i = 0; i < 2; i++)
+        EXPECT_NEAR((double)ex.cycles[i], (double)ln.cycles[i], 1.0) << "core " << i << endl;
+}
@@ -0,0 +1,565 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+using namespace std;
+
+#include "gtest.h"
+
+#include "config.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "systemclock.h"
+#include "simulationcontext.h"
+#include "avrdevice.h"
+#include "avrfactory.h"
+#include "flash.h"
+#include "traceval.h"
+#include "binarytrace.h"
+#include "memory.h"
+
+// program for atmega32: main loop writes a counter to PORTB, timer 0
+// overflow interrupt every 256 cycles counts r25
+static void LoadTraceProgram(AvrDevice *dev) {
+    vector<unsigned short> prog(0x2a, 0xffff);
+    prog[0x00] = 0xc000 | (0x2a - 1);       // rjmp main
+    prog[0x16] = 0xc000 | (0x37 - 0x17);    // rjmp isr (TIMER0 OVF)
+    const unsigned short code[] = {
+        0xe008,                 // main: ldi r16, 0x08
+        0xbf0e,                 // out SPH, r16
+        0xe50f,                 // ldi r16, 0x5f
+        0xbf0d,                 // out SPL, r16
+        0xef0f,                 // ldi r16, 0xff
+        0xbb07,                 // out DDRB, r16
+        0xe001,                 // ldi r16, 0x01
+        0xbf03,                 // out TCCR0, r16
+        0xbf09,                 // out TIMSK, r16
+        0x9478,                 // sei
+        0x9583,                 // loop: inc r24
+        0xbb88,                 // out PORTB, r24
+        0xcffd,                 // rjmp loop
+        0x9593,                 // isr: inc r25
+        0x9518                  // reti
+    };
+    prog.insert(prog.end(), code, code + sizeof(code) / sizeof(code[0]));
+    vector<unsigned char> bytes(prog.size() * 2);
+    for(unsigned i = 0; i < prog.size(); i++) {
+        bytes[2 * i] = prog[i] & 0xff;
+        bytes[2 * i + 1] = prog[i] >> 8;
+    }
+    dev->Flash->WriteMem(&bytes[0], 0, bytes.size());
+}
+
+static bool NameOrder(const TraceValue *a, const TraceValue *b) {
+    return a->name() < b->name();
+}
+
+// runs program for 200us, dumper traces all values
+static void RunDump(SimulationContext &c, Dumper *dumper) {
+    AvrDevice *dev = AvrFactory::instance().makeDevice("atmega32", &c);
+    LoadTraceProgram(dev);
+    dev->SetClockFreq(125); // 8MHz
+    DumpManager *dm = c.GetDumpManager();
+    // order of all() depends on memory layout, sort for same signal numbers in each run
+    TraceSet vals = dm->all();
+    sort(vals.begin(), vals.end(), NameOrder);
+    dm->addDumper(dumper, vals);
+    c.GetClock().Add(dev);
+    dm->start();
+    c.GetClock().RunTimeRange(200000);
+    dm->stopApplication();
+    c.GetClock().Remove(dev);
+    delete dev;
+}
+
+static string ReadFile(const char *name) {
+    ifstream f(name, ios::binary);
+    ostringstream s;
+    s << f.rdbuf();
+    return s.str();
+}
+
+#ifdef HAVE_ZLIB
+
+//! waveform of each signal by full name, list of time and value
+typedef map<string, vector<pair<SystemClockOffset, string> > > Waves;
+
+//! keeps only the last value of a time and only values, which differ from the one before
+static void NormalizeWaves(Waves &w) {
+    for(Waves::iterator i = w.begin(); i != w.end(); i++) {
+        vector<pair<SystemClockOffset, string> > n;
+        for(size_t k = 0; k < i->second.size(); k++) {
+            if(!n.empty() && n.back().first == i->second[k].first)
+                n.pop_back();
+            if(n.empty() || n.back().second != i->second[k].second)
+                n.push_back(i->second[k]);
+        }
+        i->second = n;
+    }
+}
+
+// reads VCD, as written by DumpVCD, returns false on format errors
+static bool ReadVCD(const string &data, Waves &w, SystemClockOffset &time) {
+    istringstream in(data);
+    string line, scope;
+    map<string, string> names; // id -> full name
+    time = 0;
+    bool header = true;
+    while(getline(in, line)) {
+        istringstream l(line);
+        string tok;
+        l >> tok;
+        if(header) {
+            if(tok == "$scope") {
+                string kind;
+                l >> kind >> scope;
+            } else if(tok == "$var") {
+                string kind, bits, id, name;
+                l >> kind >> bits >> id >> name;
+                names[id] = scope + "." + name;
+            } else if(tok == "$enddefinitions")
+                header = false;
+            continue;
+        }
+        if(tok.empty() || tok == "$dumpvars" || tok == "$end")
+            continue;
+        if(tok[0] == '#') {
+            time = strtoull(tok.c_str() + 1, NULL, 10);
+        } else if(tok[0] == 'b') {
+            string id;
+            l >> id;
+            if(names.find(id) == names.end())
+                return false;
+            w[names[id]].push_back(make_pair(time, tok.substr(1)));
+        } else {
+            string id = tok.substr(1);
+            if(names.find(id) == names.end())
+                return false;
+            w[names[id]].push_back(make_pair(time, tok.substr(0, 1)));
+        }
+    }
+    return !header;
+}
+
+//! cursor on FST data, with the integer formats of fstapi.c of GTKWave
+struct FstCursor {
+    const unsigned char *p;
+    const unsigned char *end;
+
+    FstCursor(const unsigned char *b, const unsigned char *e): p(b), end(e) {}
+    bool Ok(void) const { return p <= end; }
+    unsigned char Byte(void) { return (p < end) ? *p++ : (p++, 0); }
+    uint64_t Uint64(void) {
+        uint64_t v = 0;
+        for(int i = 0; i < 8; i++)
+            v = (v << 8) | Byte();
+        return v;
+    }
+    uint64_t Varint(void) {
+        uint64_t v = 0;
+        for(int shift = 0; p < end; shift += 7) {
+            unsigned char c = *p++;
+            v |= (uint64_t)(c & 0x7f) << shift;
+            if((c & 0x80) == 0)
+                return v;
+        }
+        p++; // not terminated, Ok() is false now
+        return v;
+    }
+    string String(void) {
+        string s;
+        while(p < end && *p)
+            s += (char)*p++;
+        p++;
+        return s;
+    }
+};
+
+static uint64_t FstUint64At(const unsigned char *p) {
+    FstCursor c(p, p + 8);
+    return c.Uint64();
+}
+
+// zlib data, if compressed size differs from uncompressed size, else plain
+static bool FstUnpack(const unsigned char *p, size_t clen, size_t uclen, string &out) {
+    if(clen == uclen) {
+        out.assign((const char *)p, clen);
+        return true;
+    }
+    out.resize(uclen);
+    uLongf len = uclen;
+    return uncompress((Bytef *)&out[0], &len, p, clen) == Z_OK && len == uclen;
+}
+
+// reads FST, block by block as described in fstapi.c, returns false on format errors
+static bool ReadFST(const string &data, Waves &w, SystemClockOffset &endTime) {
+    const unsigned char *d = (const unsigned char *)data.data();
+    const unsigned char *dend = d + data.size();
+    vector<size_t> bits; // by handle - 1
+    vector<string> names;
+    vector<const unsigned char *> vcBlocks;
+    uint64_t vcCount = 0;
+    const unsigned char *hier = NULL, *geom = NULL;
+
+    // block type, then section length, which includes the length itself
+    for(const unsigned char *b = d; b < dend; ) {
+        if(dend - b < 9)
+            return false;
+        uint64_t len = FstUint64At(b + 1);
+        if(len < 8 || len > (uint64_t)(dend - b - 1))
+            return false;
+        switch(*b) {
+            case 0: // header
+                if(b != d || len != 329)
+                    return false;
+                endTime = FstUint64At(b + 17);
+                vcCount = FstUint64At(b + 65);
+                break;
+            case 1: // value change data
+                vcBlocks.push_back(b);
+                break;
+            case 3: // geometry
+                geom = b;
+                break;
+            case 4: // hierarchy, gzip compressed
+                hier = b;
+                break;
+            default:
+                return false;
+        }
+        b += 1 + len;
+    }
+    if(geom == NULL || hier == NULL || vcBlocks.size() != vcCount)
+        return false;
+
+    // geometry: bits of each signal
+    {
+        uint64_t len = FstUint64At(geom + 1);
+        string g;
+        if(!FstUnpack(geom + 25, len - 24, FstUint64At(geom + 9), g))
+            return false;
+        FstCursor c((const unsigned char *)g.data(), (const unsigned char *)g.data() + g.size());
+        for(uint64_t i = FstUint64At(geom + 17); i > 0; i--)
+            bits.push_back(c.Varint());
+        if(!c.Ok())
+            return false;
+    }
+
+    // hierarchy: scopes and variables, variables get handles in order
+    {
+        uint64_t len = FstUint64At(hier + 1);
+        string h(FstUint64At(hier + 9), '\0');
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+        if(inflateInit2(&z, 15 + 16) != Z_OK)
+            return false;
+        z.next_in = (Bytef *)hier + 17;
+        z.avail_in = len - 16;
+        z.next_out = (Bytef *)&h[0];
+        z.avail_out = h.size();
+        int r = inflate(&z, Z_FINISH);
+        inflateEnd(&z);
+        if(r != Z_STREAM_END || z.total_out != h.size())
+            return false;
+        FstCursor c((const unsigned char *)h.data(), (const unsigned char *)h.data() + h.size());
+        vector<string> scopes;
+        while(c.p < c.end) {
+            unsigned char tag = c.Byte();
+            if(tag == 254) { // scope
+                c.Byte();
+                scopes.push_back(c.String());
+                c.String();
+            } else if(tag == 255) { // upscope
+                if(scopes.empty())
+                    return false;
+                scopes.pop_back();
+            } else { // variable
+                c.Byte(); // direction
+                string name = c.String();
+                c.Varint(); // length
+                if(c.Varint() != 0) // alias
+                    return false;
+                string full;
+                for(size_t i = 0; i < scopes.size(); i++)
+                    full += scopes[i] + ".";
+                names.push_back(full + name);
+            }
+        }
+        if(!c.Ok() || names.size() != bits.size())
+            return false;
+    }
+    vector<size_t> offset(bits.size() + 1, 0);
+    for(size_t i = 0; i < bits.size(); i++)
+        offset[i + 1] = offset[i] + bits[i];
+
+    for(size_t n = 0; n < vcBlocks.size(); n++) {
+        const unsigned char *b = vcBlocks[n];
+        const unsigned char *end = b + 1 + FstUint64At(b + 1);
+        FstCursor c(b + 33, end);
+
+        // values at block begin
+        size_t frameLen = c.Varint();
+        size_t frameCLen = c.Varint();
+        if(c.Varint() != bits.size() || (size_t)(end - c.p) < frameCLen)
+            return false;
+        string frame;
+        if(!FstUnpack(c.p, frameCLen, frameLen, frame) || frame.size() != offset.back())
+            return false;
+        c.p += frameCLen;
+        if(c.Varint() != bits.size())
+            return false;
+        const unsigned char *vcStart = c.p;
+        if(c.Byte() != 'Z')
+            return false;
+
+        // trailer from the end: time table and chain position table
+        if(end - vcStart < 32)
+            return false;
+        uint64_t timeCount = FstUint64At(end - 8);
+        uint64_t timeCLen = FstUint64At(end - 16);
+        uint64_t timeLen = FstUint64At(end - 24);
+        if(timeCLen > (uint64_t)(end - vcStart - 32))
+            return false;
+        const unsigned char *timePos = end - 24 - timeCLen;
+        uint64_t indexLen = FstUint64At(timePos - 8);
+        if(indexLen > (uint64_t)(timePos - 8 - vcStart))
+            return false;
+        const unsigned char *indexPos = timePos - 8 - indexLen;
+
+        string t;
+        if(!FstUnpack(timePos, timeCLen, timeLen, t))
+            return false;
+        vector<SystemClockOffset> times;
+        FstCursor tc((const unsigned char *)t.data(), (const unsigned char *)t.data() + t.size());
+        SystemClockOffset last = 0;
+        for(uint64_t i = 0; i < timeCount; i++) {
+            last += tc.Varint();
+            times.push_back(last);
+        }
+        if(!tc.Ok() || times.empty() || times.front() != FstUint64At(b + 9) || times.back() != FstUint64At(b + 17))
+            return false;
+
+        // chain positions relative to vcStart, 0 for signals without changes
+        vector<size_t> pos(bits.size(), 0);
+        FstCursor ic(indexPos, timePos - 8);
+        size_t idx = 0, pval = 0;
+        while(ic.p < ic.end) {
+            uint64_t v = ic.Varint();
+            if(v & 1) {
+                if(idx >= pos.size())
+                    return false;
+                pval += v >> 1;
+                pos[idx++] = pval;
+            } else
+                idx += v >> 1;
+        }
+        if(!ic.Ok() || idx != bits.size())
+            return false;
+
+        for(size_t i = 0; i < bits.size(); i++) {
+            vector<pair<SystemClockOffset, string> > &wave = w[names[i]];
+            wave.push_back(make_pair(times.front(), frame.substr(offset[i], bits[i])));
+            if(pos[i] == 0)
+                continue;
+            // chain ends at next chain or at position table
+            size_t next = indexPos - vcStart;
+            for(size_t k = i + 1; k < bits.size(); k++)
+                if(pos[k] != 0) {
+                    next = pos[k];
+                    break;
+                }
+            if(next <= pos[i])
+                return false;
+            FstCursor cc(vcStart + pos[i], vcStart + next);
+            uint64_t chainLen = cc.Varint();
+            string chain;
+            if(!FstUnpack(cc.p, cc.end - cc.p, chainLen ? chainLen : cc.end - cc.p, chain))
+                return false;
+
+            FstCursor vc((const unsigned char *)chain.data(), (const unsigned char *)chain.data() + chain.size());
+            size_t tidx = 0;
+            while(vc.p < vc.end) {
+                uint64_t v = vc.Varint();
+                string val;
+                if(bits[i] == 1) {
+                    if((v & 1) == 0) {
+                        tidx += v >> 2;
+                        val = ((v >> 1) & 1) ? "1" : "0";
+                    } else {
+                        tidx += v >> 4;
+                        val = string(1, "xzhuwl-?"[(v >> 1) & 7]);
+                    }
+                } else {
+                    tidx += v >> 1;
+                    if((v & 1) == 0) {
+                        // 8 bits in a byte, first bit is msb
+                        size_t bytes = (bits[i] + 7) / 8;
+                        if((size_t)(vc.end - vc.p) < bytes)
+                            return false;
+                        for(size_t k = 0; k < bits[i]; k++)
+                            val += (vc.p[k >> 3] & (0x80 >> (k & 7))) ? '1' : '0';
+                        vc.p += bytes;
+                    } else {
+                        for(size_t k = 0; k < bits[i]; k++)
+                            val += (char)vc.Byte();
+                    }
+                }
+                if(!vc.Ok() || tidx >= times.size())
+                    return false;
+                wave.push_back(make_pair(times[tidx], val));
+            }
+        }
+    }
+    return true;
+}
+
+#endif // HAVE_ZLIB
+
+// the writer thread formats the same records as the simulation thread
+// does in sync mode, so the files have to be the same
+TEST( SESSION_TRACE, VCD_ASYNC_SAME_AS_SYNC )
+{
+    const char *syncName = "unittest_trace_sync.vcd";
+    {
+        SimulationContext c;
+        RunDump(c, new DumpVCD(syncName, "ns", true, true, false));
+    }
+    const char *asyncName = "unittest_trace_async.vcd";
+    {
+        SimulationContext c;
+        RunDump(c, new DumpVCD(asyncName, "ns", true, true, true));
+    }
+    string sync = ReadFile(syncName);
+    string async = ReadFile(asyncName);
+    remove(syncName);
+    remove(asyncName);
+
+    EXPECT_NE(string::npos, sync.find("$enddefinitions")) << "no VCD header" << endl;
+    EXPECT_LT(10000U, sync.size()) << "too few changes" << endl;
+    EXPECT_TRUE(sync == async) << "async VCD differs from sync VCD" << endl;
+}
+
+#ifdef HAVE_ZLIB
+// FST output has to hold the same waveforms as VCD output, FST is decoded
+// by a reader in this file, which follows the block layout of GTKWave
+TEST( SESSION_TRACE, FST_SAME_AS_VCD )
+{
+    const char *vcdName = "unittest_trace.vcd";
+    {
+        SimulationContext c;
+        RunDump(c, new DumpVCD(vcdName, "ns", true, true, false));
+    }
+    const char *fstName = "unittest_trace.fst";
+    {
+        SimulationContext c;
+        RunDump(c, new DumpFST(fstName, true, true));
+    }
+    string vcd = ReadFile(vcdName);
+    string fst = ReadFile(fstName);
+    remove(vcdName);
+    remove(fstName);
+
+    Waves vcdWaves, fstWaves;
+    SystemClockOffset vcdEnd, fstEnd;
+    ASSERT_TRUE(ReadVCD(vcd, vcdWaves, vcdEnd)) << "can't read VCD" << endl;
+    ASSERT_TRUE(ReadFST(fst, fstWaves, fstEnd)) << "can't read FST" << endl;
+    NormalizeWaves(vcdWaves);
+    NormalizeWaves(fstWaves);
+
+    EXPECT_EQ(vcdEnd, fstEnd);
+    EXPECT_LT(fst.size() * 5, vcd.size()) << "FST isn't compressed" << endl;
+    ASSERT_EQ(vcdWaves.size(), fstWaves.size());
+    size_t changes = 0;
+    for(Waves::iterator i = vcdWaves.begin(); i != vcdWaves.end(); i++) {
+        changes += i->second.size();
+        EXPECT_TRUE(i->second == fstWaves[i->first]) << "waveform of " << i->first << " differs" << endl;
+    }
+    EXPECT_LT(1000U, changes) << "too few changes" << endl;
+}
+#endif // HAVE_ZLIB
+
+// runs program for 50us with text trace to text or binary trace to file name
+static void RunTrace(ostream *text, const char *name) {
+    SimulationContext c;
+    AvrDevice *dev = AvrFactory::instance().makeDevice("atmega32", &c);
+    LoadTraceProgram(dev);
+    dev->SetClockFreq(125); // 8MHz
+    BinaryTrace *bt = NULL;
+    if(text != NULL) {
+        c.GetConsole().SetTraceStream(text);
+        dev->trace_on = true;
+    } else {
+        bt = new BinaryTrace(name, dev);
+        dev->SetBinaryTrace(bt);
+    }
+    c.GetClock().Add(dev);
+    c.GetClock().RunTimeRange(50000);
+    c.GetConsole().StopTrace();
+    c.GetClock().Remove(dev);
+    delete bt;
+    delete dev;
+}
+
+// text trace without messages of IRQ system about pending and cleared
+// interrupts, which binary trace doesn't record
+static string InstructionLines(string trace) {
+    size_t pos;
+    while((pos = trace.find(" interrupt on index ")) != string::npos)
+        trace.erase(pos, trace.find('\n', pos) + 1 - pos);
+    return trace;
+}
+
+// a binary trace, converted back by BinaryTraceDecoder (as simulavr-tracedec
+// does), has to give the same instruction lines as the text trace
+TEST( SESSION_TRACE, BINARY_TRACE_ROUND_TRIP )
+{
+    ostringstream text;
+    RunTrace(&text, NULL);
+    const char *name = "unittest_trace.bin";
+    RunTrace(NULL, name);
+
+    ostringstream decoded;
+    {
+        SimulationContext c;
+        SimulationContext::Scope scope(c);
+        AvrDevice *core = AvrFactory::instance().makeDevice("atmega32", &c);
+        LoadTraceProgram(core);
+        core->Reset();
+        BinaryTraceReader reader(name);
+        BinaryTraceDecoder decoder(reader, core, &decoded);
+        decoder.Run();
+        delete core;
+    }
+    remove(name);
+
+    string expected = InstructionLines(text.str());
+    EXPECT_NE(string::npos, expected.find("IRQ DETECTED")) << "no interrupt" << endl;
+    EXPECT_LT(300U, count(expected.begin(), expected.end(), '\n')) << "too few lines" << endl;
+    EXPECT_TRUE(expected == decoded.str()) << "decoded binary trace differs from text trace" << endl;
+}
+
+// symbols are looked up by binary search after sorting, a symbol with known
+// size doesn't label addresses behind its end
+TEST( SESSION_TRACE, SYMBOL_SIZE )
+{
+    Data d;
+    d.AddSymbol(make_pair(0x10u, string("f")), 4);
+    d.AddSymbol(make_pair(0x0u, string("__vectors")));
+    d.AddSymbol(make_pair(0x10u, string("g")), 2);
+    d.AddSymbol(make_pair(0x20u, string("h")));
+    d.SortSymbols();
+
+    EXPECT_EQ("__vectors+0x5", d.GetSymbolAtAddress(0x5));
+    EXPECT_EQ("f,g", d.GetSymbolAtAddress(0x10));
+    EXPECT_EQ("f,g+0x3", d.GetSymbolAtAddress(0x13));
+    EXPECT_EQ("", d.GetSymbolAtAddress(0x14)) << "behind end of f" << endl;
+    EXPECT_EQ("h+0x100", d.GetSymbolAtAddress(0x120)) << "size of h is unknown" << endl;
+}
@@ -43,6 +43,9 @@ class TestCase(SimTestCase):
     self.assertEepromData(self.data_load)
     # write byte
     self.sim.setByteByName(self.dev, "complete", 2)
+    # write isn't finished too early
+    self.sim.doRun(self.sim.getCurrentTime() + self.WDELAY / 4)
+    self.assertEqual(self.sim.getByteByName(self.dev, "complete"), 0, "write in progress")
     self.sim.doRun(self.sim.getCurrentTime() + self.WDELAY)
     self.assertComplete()
     # check modified EEPROM content
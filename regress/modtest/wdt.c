@@ -0,0 +1,28 @@
+#include <avr/io.h>
+#include <avr/wdt.h>
+
+volatile unsigned char in_loop = 0;
+volatile unsigned char feed = 1;
+
+// not initialized on reset, so we can count watchdog resets
+unsigned char magic __attribute__((section(".noinit")));
+unsigned char resets __attribute__((section(".noinit")));
+
+int main(void) {
+
+    if(magic != 0xa5) {
+        magic = 0xa5;
+        resets = 0;
+    } else
+        resets++;
+
+    wdt_enable(WDTO_15MS); // simulavr uses 47ms for this prescaler setting
+
+    do {
+        in_loop = 1;
+        if(feed)
+            wdt_reset();
+    } while(1); // do forever
+}
+
+// EOF
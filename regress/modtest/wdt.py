@@ -0,0 +1,45 @@
+from simtestutil import SimTestCase, SimTestLoader
+import pysimulavr
+
+class TestCase(SimTestCase):
+
+  DELAY = 5000 # run 5 microseconds
+  FEED_DELAY = 100000000 # run 100 milliseconds
+  TIMEOUT_S = 30000000 # 30 milliseconds, before watchdog timeout
+  TIMEOUT_L = 20000000 # 20 milliseconds more, after watchdog timeout (47ms)
+
+  def assertResets(self, expected):
+    v = self.sim.getByteByName(self.dev, "resets")
+    self.assertEqual(v, expected, "watchdog resets: value=%d, expected=%d" % (v, expected))
+
+  def test_00(self):
+    """check watchdog reset"""
+    self.assertDevice()
+    self.assertStartTime()
+    # skip initialisation
+    self.assertInitDone()
+    # run till in idle loop
+    self.sim.doRun(self.sim.getCurrentTime() + self.DELAY)
+    self.assertEqual(self.sim.getByteByName(self.dev, "in_loop"), 1, "in idle loop")
+    self.assertResets(0)
+    # watchdog is fed, no reset
+    self.sim.doRun(self.sim.getCurrentTime() + self.FEED_DELAY)
+    self.assertResets(0)
+    # stop feeding, no reset before timeout
+    self.sim.setByteByName(self.dev, "feed", 0)
+    self.sim.doRun(self.sim.getCurrentTime() + self.TIMEOUT_S)
+    self.assertResets(0)
+    # but after timeout
+    self.sim.doRun(self.sim.getCurrentTime() + self.TIMEOUT_L)
+    self.assertResets(1)
+    # after reset program feeds watchdog again
+    self.sim.doRun(self.sim.getCurrentTime() + self.FEED_DELAY)
+    self.assertResets(1)
+
+if __name__ == '__main__':
+  
+  from unittest import TextTestRunner
+  tests = SimTestLoader("wdt_atmega16.elf").loadTestsFromTestCase(TestCase)
+  TextTestRunner(verbosity = 2).run(tests)
+
+# EOF
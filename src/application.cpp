@@ -23,6 +23,8 @@
  *  $Id$
  */
 
+#include <algorithm>
+
 #include "application.h"
 #include "printable.h"
 using namespace std;
@@ -33,10 +35,19 @@ Application* Application::GetInstance() {
 }
 
 void Application::RegisterPrintable(Printable *p) {
+    lock_guard<mutex> lock(printableLock);
     printable.push_back(p);
 }
 
+void Application::UnregisterPrintable(Printable *p) {
+    lock_guard<mutex> lock(printableLock);
+    vector<Printable *>::iterator ii = find(printable.begin(), printable.end(), p);
+    if(ii != printable.end())
+        printable.erase(ii);
+}
+
 void Application::PrintResults() {
+    lock_guard<mutex> lock(printableLock);
     vector<Printable *>::iterator ii;
     for (ii=printable.begin(); ii!=printable.end(); ii++) {
         (*(*ii))();
@@ -27,12 +27,17 @@
 #define APPLICATION
 
 #include <vector>
+#include <mutex>
 
 class Printable;
 
+//! Holds printable results of all simulations in the process
+/*! Devices can be created and deleted on several threads (see batch mode), so
+    the list of printables is locked. */
 class Application {
     protected:
         std::vector <Printable*> printable;
+        std::mutex printableLock;
 
     private:
         Application() {} // no way to create an object
@@ -40,6 +45,7 @@ class Application {
     public:
         static Application* GetInstance();
         void RegisterPrintable(Printable *x);
+        void UnregisterPrintable(Printable *x);
         void PrintResults();
 };
 
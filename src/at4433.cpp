@@ -89,6 +89,8 @@ AvrDevice_at90s4433::AvrDevice_at90s4433():
     gimsk_reg = new IOSpecialReg(&coreTraceGroup, "GIMSK");
     gifr_reg = new IOSpecialReg(&coreTraceGroup, "GIFR");
     mcucr_reg = new IOSpecialReg(&coreTraceGroup, "MCUCR");
+    sleepControl = new SleepControl(mcucr_reg, 0x20, 0x10); // SE and SM bit
+    sleepControl->SetWakeupVectors(0x10, SleepControl::Vectors(1, 2)); // power-down: INT0, INT1
     extirq = new ExternalIRQHandler(this, irqSystem, gimsk_reg, gifr_reg);
     extirq->registerIrq(1, 6, new ExternalIRQSingle(mcucr_reg, 0, 2, GetPin("D2")));
     extirq->registerIrq(2, 7, new ExternalIRQSingle(mcucr_reg, 2, 2, GetPin("D3")));
@@ -57,6 +57,7 @@ AvrDevice_at90canbase::~AvrDevice_at90canbase() {
     delete timer0;
     delete timerIrq0;
     delete extirq01;
+    delete smcr_reg;
     delete eifr_reg;
     delete eimsk_reg;
     delete eicrb_reg;
@@ -102,6 +103,18 @@ AvrDevice_at90canbase::AvrDevice_at90canbase(unsigned ram_bytes,
     eicrb_reg = new IOSpecialReg(&coreTraceGroup, "EICRB");
     eimsk_reg = new IOSpecialReg(&coreTraceGroup, "EIMSK");
     eifr_reg =  new IOSpecialReg(&coreTraceGroup, "EIFR");
+    smcr_reg = new IOSpecialReg(&coreTraceGroup, "SMCR");
+    sleepControl = new SleepControl(smcr_reg, 0x01, 0x0e); // SE and SM bits
+    // power-down, standby: INT0 - INT7, TWI
+    unsigned long long powerDown = SleepControl::Vectors(1, 8) | SleepControl::Vectors(35, 35);
+    // power-save, extended standby: additionally timer 2
+    unsigned long long powerSave = powerDown | SleepControl::Vectors(9, 10);
+    // ADC noise reduction: additionally ADC, EEPROM, SPM
+    sleepControl->SetWakeupVectors(0x02, powerSave | SleepControl::Vectors(25, 26) | SleepControl::Vectors(36, 36));
+    sleepControl->SetWakeupVectors(0x04, powerDown);
+    sleepControl->SetWakeupVectors(0x06, powerSave);
+    sleepControl->SetWakeupVectors(0x0c, powerDown);
+    sleepControl->SetWakeupVectors(0x0e, powerSave);
     extirq01 = new ExternalIRQHandler(this, irqSystem, eimsk_reg, eifr_reg);
     extirq01->registerIrq(1, 0, new ExternalIRQSingle(eicra_reg, 0, 2, GetPin("D0")));
     extirq01->registerIrq(2, 1, new ExternalIRQSingle(eicra_reg, 2, 2, GetPin("D1")));
@@ -311,7 +324,7 @@ AvrDevice_at90canbase::AvrDevice_at90canbase(unsigned ram_bytes,
     /* 0x56 Reserved */
     /* 0x55 MCUCR -- Memory control TODO */
     /* 0x54 MCUSR -- Memory control TODO */
-    /* 0x53 SMCR -- sleep register TODO */
+    rw[0x53]= smcr_reg;
     /* 0x52 Reserved */
     /* 0x51 OCDR */
     rw[0x50]= & acomp->acsr_reg;
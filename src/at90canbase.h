@@ -64,6 +64,7 @@ class AvrDevice_at90canbase: public AvrDevice {
         IOSpecialReg*       eicrb_reg;   //!< EICRA IO register
         IOSpecialReg*       eimsk_reg;   //!< EIMSK IO register
         IOSpecialReg*       eifr_reg;    //!< EIFR IO register
+        IOSpecialReg*       smcr_reg;    //!< SMCR IO register
         HWAdmux*            admux;       //!< adc multiplexer unit
         HWARef*             aref;        //!< adc reference unit
         HWAd*               ad;          //!< adc unit
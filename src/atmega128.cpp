@@ -55,6 +55,7 @@ AvrDevice_atmega128::~AvrDevice_atmega128() {
     delete prescaler0;
     delete assr_reg;
     delete extirq;
+    delete mcucr_reg;
     delete eifr_reg;
     delete eimsk_reg;
     delete eicrb_reg;
@@ -116,6 +117,18 @@ AvrDevice_atmega128::AvrDevice_atmega128():
     eicrb_reg = new IOSpecialReg(&coreTraceGroup, "EICRB");
     eimsk_reg = new IOSpecialReg(&coreTraceGroup, "EIMSK");
     eifr_reg = new IOSpecialReg(&coreTraceGroup, "EIFR");
+    mcucr_reg = new IOSpecialReg(&coreTraceGroup, "MCUCR");
+    sleepControl = new SleepControl(mcucr_reg, 0x20, 0x1c); // SE and SM bits
+    // power-down, standby: INT0 - INT7, TWI
+    unsigned long long powerDown = SleepControl::Vectors(1, 8) | SleepControl::Vectors(33, 33);
+    // power-save, extended standby: additionally timer 0
+    unsigned long long powerSave = powerDown | SleepControl::Vectors(15, 16);
+    // ADC noise reduction: additionally ADC, EEPROM, SPM
+    sleepControl->SetWakeupVectors(0x08, powerSave | SleepControl::Vectors(21, 22) | SleepControl::Vectors(34, 34));
+    sleepControl->SetWakeupVectors(0x10, powerDown);
+    sleepControl->SetWakeupVectors(0x18, powerSave);
+    sleepControl->SetWakeupVectors(0x14, powerDown);
+    sleepControl->SetWakeupVectors(0x1c, powerSave);
     extirq = new ExternalIRQHandler(this, irqSystem, eimsk_reg, eifr_reg);
     extirq->registerIrq(1, 0, new ExternalIRQSingle(eicra_reg, 0, 2, GetPin("D0")));
     extirq->registerIrq(2, 1, new ExternalIRQSingle(eicra_reg, 2, 2, GetPin("D1")));
@@ -252,6 +265,7 @@ AvrDevice_atmega128::AvrDevice_atmega128():
     rw[0x58]= eifr_reg;
     rw[0x57]= & timer012irq->timsk_reg;
     rw[0x56]= & timer012irq->tifr_reg;
+    rw[0x55]= mcucr_reg;
     
     rw[0x53]= & timer0->tccr_reg;
     rw[0x52]= & timer0->tcnt_reg;
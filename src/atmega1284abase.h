@@ -81,6 +81,7 @@ protected:
     GPIORegister*       gpior1_reg;  //!< general purpose IO register
     GPIORegister*       gpior2_reg;  //!< general purpose IO register
     CLKPRRegister*      clkpr_reg;   //!< CLKPR IO register
+    IOSpecialReg*       smcr_reg;    //!< SMCR IO register
     OSCCALRegister*     osccal_reg;  //!< OSCCAL IO register
 
 public:
@@ -113,6 +113,19 @@ AvrDevice_atmega16_32::AvrDevice_atmega16_32(unsigned ram_bytes,
     gicr_reg = new IOSpecialReg(&coreTraceGroup, "GICR");
     gifr_reg = new IOSpecialReg(&coreTraceGroup, "GIFR");
     mcucr_reg = new IOSpecialReg(&coreTraceGroup, "MCUCR");
+    // SE and SM bits, ATmega16 has SM2 on bit 7 and SE on bit 6
+    sleepControl = atmega16 ? new SleepControl(mcucr_reg, 0x40, 0xb0) : new SleepControl(mcucr_reg, 0x80, 0x70);
+    unsigned char standby = atmega16 ? 0xa0 : 0x60;
+    // power-down, standby: INT0, INT1, INT2, TWI
+    unsigned long long powerDown = atmega16 ? (SleepControl::Vectors(1, 2) | SleepControl::Vectors(17, 18)) : (SleepControl::Vectors(1, 3) | SleepControl::Vectors(19, 19));
+    // power-save, extended standby: additionally timer 2
+    unsigned long long powerSave = powerDown | (atmega16 ? SleepControl::Vectors(3, 4) : SleepControl::Vectors(4, 5));
+    // ADC noise reduction: additionally SPM, EEPROM, ADC
+    sleepControl->SetWakeupVectors(0x10, powerSave | SleepControl::Vectors(20, 20) | (atmega16 ? SleepControl::Vectors(14, 15) : SleepControl::Vectors(16, 17)));
+    sleepControl->SetWakeupVectors(0x20, powerDown);
+    sleepControl->SetWakeupVectors(0x30, powerSave);
+    sleepControl->SetWakeupVectors(standby, powerDown);
+    sleepControl->SetWakeupVectors(standby | 0x10, powerSave);
     mcucsr_reg = new IOSpecialReg(&coreTraceGroup, "MCUCSR");
     extirq = new ExternalIRQHandler(this, irqSystem, gicr_reg, gifr_reg);
     extirq->registerIrq(1, 6, new ExternalIRQSingle(mcucr_reg, 0, 2, GetPin("D2")));  // INT0
@@ -64,6 +64,7 @@ AvrDevice_atmega668base::~AvrDevice_atmega668base() {
     delete eimsk_reg;
     delete eicra_reg;
     delete osccal_reg;
+    delete smcr_reg;
     delete clkpr_reg;
     delete stack;
     delete eeprom;
@@ -103,6 +104,18 @@ AvrDevice_atmega668base::AvrDevice_atmega668base(unsigned ram_bytes,
     eeprom = new HWEeprom(this, irqSystem, ee_bytes, 22, HWEeprom::DEVMODE_EXTENDED);
     stack = new HWStackSram(this, 16);
     clkpr_reg = new CLKPRRegister(this, &coreTraceGroup);
+    smcr_reg = new IOSpecialReg(&coreTraceGroup, "SMCR");
+    sleepControl = new SleepControl(smcr_reg, 0x01, 0x0e); // SE and SM bits
+    // power-down, standby: INT, PCINT, watchdog, TWI
+    unsigned long long powerDown = SleepControl::Vectors(1, 6) | SleepControl::Vectors(24, 24);
+    // power-save, extended standby: additionally timer 2
+    unsigned long long powerSave = powerDown | SleepControl::Vectors(7, 9);
+    // ADC noise reduction: additionally ADC, EEPROM, SPM
+    sleepControl->SetWakeupVectors(0x02, powerSave | SleepControl::Vectors(21, 22) | SleepControl::Vectors(25, 25));
+    sleepControl->SetWakeupVectors(0x04, powerDown);
+    sleepControl->SetWakeupVectors(0x06, powerSave);
+    sleepControl->SetWakeupVectors(0x0c, powerDown);
+    sleepControl->SetWakeupVectors(0x0e, powerSave);
     osccal_reg = new OSCCALRegister(this, &coreTraceGroup, OSCCALRegister::OSCCAL_V5);
 
     RegisterPin("ADC6", &adc6);
@@ -284,7 +297,7 @@ AvrDevice_atmega668base::AvrDevice_atmega668base(unsigned ram_bytes,
     // 0x56 reserved
     rw[0x55]= new NotSimulatedRegister("MCU register MCUCR not simulated");
     rw[0x54]= new NotSimulatedRegister("MCU register MCUSR not simulated");
-    rw[0x53]= new NotSimulatedRegister("MCU register SMCR not simulated");
+    rw[0x53]= smcr_reg;
     // 0x52 reserved
     // 0x51 reserved
     rw[0x50]= & acomp->acsr_reg;
@@ -78,6 +78,7 @@ class AvrDevice_atmega668base: public AvrDevice {
         GPIORegister*       gpior1_reg;  //!< general purpose IO register
         GPIORegister*       gpior2_reg;  //!< general purpose IO register
         CLKPRRegister*      clkpr_reg;   //!< CLKPR IO register
+        IOSpecialReg*       smcr_reg;    //!< SMCR IO register
         OSCCALRegister*     osccal_reg;  //!< OSCCAL IO register
 
     public:
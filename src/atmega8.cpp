@@ -90,6 +90,14 @@ AvrDevice_atmega8::AvrDevice_atmega8() :
 
     mcucr_reg = new IOSpecialReg(&coreTraceGroup,
             "MCUCR");
+    sleepControl = new SleepControl(mcucr_reg, 0x80, 0x70); // SE and SM bits
+    // ADC noise reduction: INT0, INT1, timer 2, SPM, EEPROM, ADC, TWI
+    sleepControl->SetWakeupVectors(0x10, SleepControl::Vectors(1, 4) | SleepControl::Vectors(14, 15) | SleepControl::Vectors(17, 18));
+    // power-down, standby: INT0, INT1, TWI
+    sleepControl->SetWakeupVectors(0x20, SleepControl::Vectors(1, 2) | SleepControl::Vectors(17, 17));
+    sleepControl->SetWakeupVectors(0x60, SleepControl::Vectors(1, 2) | SleepControl::Vectors(17, 17));
+    // power-save: additionally timer 2
+    sleepControl->SetWakeupVectors(0x30, SleepControl::Vectors(1, 4) | SleepControl::Vectors(17, 17));
 
     mcucsr_reg = new IOSpecialReg(&coreTraceGroup,
             "MCUCSR");
@@ -95,6 +95,12 @@ AvrDevice_attiny2313::AvrDevice_attiny2313():
     gimsk_reg = new IOSpecialReg(&coreTraceGroup, "GIMSK");
     eifr_reg = new IOSpecialReg(&coreTraceGroup, "EIFR");
     mcucr_reg = new IOSpecialReg(&coreTraceGroup, "MCUCR");
+    sleepControl = new SleepControl(mcucr_reg, 0x20, 0x50); // SE, SM1 and SM0 bits
+    // power-down, standby: INT0, INT1, PCINT, USI start, watchdog
+    unsigned long long powerDown = SleepControl::Vectors(1, 2) | SleepControl::Vectors(11, 11) | SleepControl::Vectors(15, 15) | SleepControl::Vectors(18, 18);
+    sleepControl->SetWakeupVectors(0x10, powerDown);
+    sleepControl->SetWakeupVectors(0x40, powerDown);
+    sleepControl->SetWakeupVectors(0x50, powerDown);
     pcmsk_reg = new IOSpecialReg(&coreTraceGroup, "PCMSK");
     extirq = new ExternalIRQHandler(this, irqSystem, gimsk_reg, eifr_reg);
     extirq->registerIrq(1, 6, new ExternalIRQSingle(mcucr_reg, 0, 2, GetPin("D2")));
@@ -52,6 +52,7 @@ AvrDevice_attinyX5::~AvrDevice_attinyX5() {
     delete gpior1_reg;
     delete gpior0_reg;
     delete portb;
+    delete mcucr_reg;
     delete osccal_reg;
     delete clkpr_reg;
     delete stack;
@@ -75,6 +76,13 @@ AvrDevice_attinyX5::AvrDevice_attinyX5(unsigned ram_bytes,
     stack = new HWStackSram(this, 12);
     clkpr_reg = new CLKPRRegister(this, &coreTraceGroup);
     osccal_reg = new OSCCALRegister(this, &coreTraceGroup, OSCCALRegister::OSCCAL_V5);
+    mcucr_reg = new IOSpecialReg(&coreTraceGroup, "MCUCR");
+    sleepControl = new SleepControl(mcucr_reg, 0x20, 0x18); // SE and SM bits
+    // power-down: INT0, PCINT0, watchdog, USI start
+    unsigned long long powerDown = SleepControl::Vectors(1, 2) | SleepControl::Vectors(12, 13);
+    // ADC noise reduction: additionally EEPROM, ADC
+    sleepControl->SetWakeupVectors(0x08, powerDown | SleepControl::Vectors(6, 6) | SleepControl::Vectors(8, 8));
+    sleepControl->SetWakeupVectors(0x10, powerDown);
     
     portb = new HWPort(this, "B", true, 6);
 
@@ -135,7 +143,7 @@ AvrDevice_attinyX5::AvrDevice_attinyX5(unsigned ram_bytes,
     rw[0x58]= & timer01irq->tifr_reg;
     //rw[0x57] reserved
     //rw[0x56] reserved
-    //rw[0x55] reserved
+    rw[0x55]= mcucr_reg;
     //rw[0x54] reserved
     rw[0x53]= & timer0->tccrb_reg;
     rw[0x52]= & timer0->tcnt_reg;
@@ -32,9 +32,12 @@
 #include "helper.h"
 #include "irqsystem.h"  //GetNewPc
 #include "systemclock.h"
+#include "simulationcontext.h"
 #include "avrerror.h"
 #include "avrmalloc.h"
 #include "avrreadelf.h"
+#include "jit.h"
+#include "binarytrace.h"
 #include <assert.h>
 #include "ui/serialrx.h"
 #include "ui/serialtx.h"
@@ -51,21 +54,42 @@ void AvrDevice::AddToResetList(Hardware *hw) {
 }
 
 void AvrDevice::AddToCycleList(Hardware *hw) {
-    if(find(hwCycleList.begin(), hwCycleList.end(), hw) == hwCycleList.end())
+    if(find(hwCycleList.begin(), hwCycleList.end(), hw) != hwCycleList.end())
+        return;
+    // insert before the part, which is ticked now, to skip it on this clock
+    if(hwCycleIndex <= hwCycleList.size()) {
+        hwCycleList.insert(hwCycleList.begin() + hwCycleIndex, hw);
+        hwCycleIndex++;
+    } else
         hwCycleList.push_back(hw);
 }
         
 void AvrDevice::RemoveFromCycleList(Hardware *hw) {
     std::vector<Hardware*>::iterator element;
     element=find(hwCycleList.begin(), hwCycleList.end(), hw);
-    if(element != hwCycleList.end())
-        hwCycleList.erase(element);
+    if(element == hwCycleList.end())
+        return;
+    // keep the loop in Step on the next part, if we're called from there
+    if((unsigned)(element - hwCycleList.begin()) <= hwCycleIndex)
+        hwCycleIndex--;
+    hwCycleList.erase(element);
 }
 
 void AvrDevice::Load(const char* fname) {
     avr_debug("AvrDevice::Load(%s)", fname);
     actualFilename = fname;
     ELFLoad(this);
+    DumpLoadedSymbols();
+}
+
+void AvrDevice::Load(const ELFImage &image) {
+    avr_debug("AvrDevice::Load(%s)", image.filename.c_str());
+    actualFilename = image.filename;
+    ELFLoadImage(this, image);
+    DumpLoadedSymbols();
+}
+
+void AvrDevice::DumpLoadedSymbols(void) {
     if (avr_debug_enabled) {
         avr_debug("AvrDevice::Load(): Flash symbols");
         Flash->DumpSymbols();
@@ -84,7 +108,9 @@ SystemClockOffset AvrDevice::GetClockFreq() {
     return clockFreq;
 }
 void AvrDevice::RegisterSerials(std::vector<SerialCfg *> &serialRxCfgs,
-                                std::vector<SerialCfg *> &serialTxCfgs) {
+                                std::vector<SerialCfg *> &serialTxCfgs,
+                                std::vector<Net *> &nets,
+                                std::vector<SimulationMember *> &serials) {
     std::vector<SerialCfg *>::iterator ii;
     for(ii = serialRxCfgs.begin(); ii != serialRxCfgs.end(); ii++) {
         const char *filename = (*ii)->filename().c_str();
@@ -92,9 +118,11 @@ void AvrDevice::RegisterSerials(std::vector<SerialCfg *> &serialRxCfgs,
         unsigned long long baudrate = (*ii)->baudrate();
         avr_message("Virtual serial RX reading from pin %s and writing to file %s at %llu baud.",
                 pinName, filename, baudrate);
-        Net *net = new Net();
+        Net *net = new Net(GetSystemClock());
+        nets.push_back(net);
         SerialRxFile *serial =
-          new SerialRxFile(filename);
+          new SerialRxFile(GetSystemClock(), filename);
+        serials.push_back(serial);
         serial->SetBaudRate(baudrate);
         net->Add(GetPin(pinName));
         net->Add(serial->GetPin("rx"));
@@ -107,9 +135,11 @@ void AvrDevice::RegisterSerials(std::vector<SerialCfg *> &serialRxCfgs,
         long long delayNanos = (*ii)->delayNanos();
         avr_message("Virtual serial TX reading from file %s and writing to pin %s at %llu baud. Will be added after %lld ns",
                 filename, pinName, baudrate, delayNanos);
-        Net *net = new Net();
+        Net *net = new Net(GetSystemClock());
+        nets.push_back(net);
         SerialTxFile *serial =
-          new SerialTxFile(filename, delayNanos);
+          new SerialTxFile(GetSystemClock(), filename, delayNanos);
+        serials.push_back(serial);
         serial->SetBaudRate(baudrate);
         net->Add(GetPin(pinName));
         net->Add(serial->GetPin("tx"));
@@ -129,6 +159,10 @@ AvrDevice::~AvrDevice() {
         dumpManager->unregisterAvrDevice(this);
     }
     
+    // native code refers to registers, so delete it first
+    delete jit;
+    delete sleepControl;
+
     // delete invalid RW memory cells on shadow store + shadow store self
     unsigned size = totalIoSpace - registerSpaceSize - iRamSize - eRamSize;
     for(unsigned idx = 0; idx < size; idx++)
@@ -164,6 +198,7 @@ public:
         change(ref->value()*2);
         set_written();
     }
+    virtual bool polled() const { return true; }
 private:
     TraceValue *ref; // Reference value that will be doubled
 };
@@ -177,9 +212,18 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
     ioSpaceSize(_ioSpaceSize),
     iRamSize(IRamSize),
     eRamSize(ERamSize),
+    clockCycles(0),
+    hwCycleCalls(0),
+    hwCycleIndex(0),
     devSignature(std::numeric_limits<unsigned int>::max()),
+    context(&SimulationContext::Current()),
+    execEngine(ENGINE_DECODER),
+    jit(NULL),
+    binaryTrace(NULL),
     abortOnInvalidAccess(false),
     coreTraceGroup(this),
+    sleeping(false),
+    sleepControl(NULL),
     deferIrq(false),
     newIrqPc(0xffffffff),
     v_supply(5.0),  // assume 5V supply voltage
@@ -197,13 +241,15 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
     flagXMega(false),
     clockFreq(0)
 {
-    dumpManager = DumpManager::Instance();
+    dumpManager = context->GetDumpManager();
     dumpManager->registerAvrDevice(this);
     DebugRecentJumpsIndex = 0;
     
     TraceValue* pc_tracer=trace_direct(&coreTraceGroup, "PC", &cPC);
     coreTraceGroup.RegisterTraceValue(new TwiceTV(coreTraceGroup.GetTraceValuePrefix()+"PCb",  pc_tracer));
     trace_on = false;
+    singleStep = false;
+    timeDecoupled = true; // core may run ahead of other cores, if SystemClock has a quantum
     
     fuses = new AvrFuses;
     lockbits = new AvrLockBits;
@@ -288,8 +334,7 @@ AvrDevice::AvrDevice(unsigned int _ioSpaceSize,
 
 bool AvrDevice::opIsCli(unsigned opcode) {
     if (opcode == 0x94f8) {  // CLI
-        if(trace_on)
-            traceOut << "CLI detected during interrupt preparation ";
+        TraceMessage("CLI detected during interrupt preparation ");
         return true;
     }
 
@@ -298,8 +343,7 @@ bool AvrDevice::opIsCli(unsigned opcode) {
         if (rw[registerSpaceSize + addr] == statusRegister) {
             unsigned reg = (opcode >> 4) & 0x001f;
             if ((GetCoreReg(reg) & 0x80) == 0) {
-                if(trace_on)
-                    traceOut << "OUT(SREG, 0b0xxxxxxx) detected during interrupt preparation ";
+                TraceMessage("OUT(SREG, 0b0xxxxxxx) detected during interrupt preparation ");
                 return true;
             }
         }
@@ -308,15 +352,39 @@ bool AvrDevice::opIsCli(unsigned opcode) {
     return false;
 }
 
-void AvrDevice::TraceHeader() {
+void AvrDevice::TraceMessage(const std::string &msg) {
+    if(trace_on)
+        traceOut << msg;
+    if(binaryTrace != NULL)
+        binaryTrace->Text(msg);
+}
+
+SystemClock &AvrDevice::GetSystemClock(void) {
+    return context->GetClock();
+}
+
+void AvrDevice::TraceHeader(unsigned long long cycles, SystemClockOffset time) {
     const std::ios::fmtflags ff(traceOut.flags());
-    traceOut << std::setw(16) << totalCpuCycles << ' '
-        << std::setw(16) << SystemClock::Instance().GetCurrentTime() << ' '
+    traceOut << std::setw(16) << cycles << ' '
+        << std::setw(16) << time << ' '
         << HexShort(cPC << 1) << ": ";
     if (cPC != lastTracedSymbolPC) {
         lastTracedSymbolPC = cPC;
-        std::string sym(Flash->GetSymbolAtAddress(cPC));
-        traceOut << std::left << std::setw(40) << sym << std::setw(0) << ' ';
+        // symbol and offset like GetSymbolAtAddress, left aligned in 40 chars
+        unsigned int offset = 0;
+        const MemorySymbol *sym = Flash->FindSymbol(cPC, offset);
+        size_t len = 0;
+        if(sym != NULL) {
+            traceOut << sym->label;
+            len = sym->label.size();
+            if(offset != 0) {
+                traceOut << "+0x" << std::hex << offset;
+                len += 3;
+                for(unsigned int o = offset; o != 0; o >>= 4)
+                    len++;
+            }
+        }
+        traceOut << std::setw(len < 40 ? 41 - len : 1) << ' ';
     } else {
         traceOut << std::setw(30) << "" << std::setw(0) << ' ';
     }
@@ -327,25 +395,45 @@ void AvrDevice::TraceHeader() {
 int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns) {
     if (cpuCycles<=0) {
         cPC=PC;
-        TraceHeader();
+        if(trace_on)
+            TraceHeader(totalCpuCycles, context->GetClock().GetCurrentTime());
+        if(binaryTrace != NULL)
+            binaryTrace->Line(totalCpuCycles, context->GetClock().GetCurrentTime(), cPC);
     }
 
+    clockCycles++;
     bool hwWait = false;
-    for(unsigned i = 0; i < hwCycleList.size(); i++) {
-        Hardware * p = hwCycleList[i];
+    unsigned long long skipped = 0;
+    for(hwCycleIndex = 0; hwCycleIndex < hwCycleList.size(); hwCycleIndex++) {
+        Hardware * p = hwCycleList[hwCycleIndex];
+        hwCycleCalls++;
         if (p->CpuCycle() > 0)
             hwWait = true;
     }
 
     if(hwWait) {
+        TraceMessage("CPU-Hold by IO-Hardware ");
+    } else if(sleeping && !IsWakeupPending()) {
         if(trace_on)
-            traceOut << "CPU-Hold by IO-Hardware ";
+            traceOut << "CPU sleeping ";
+        else if(nextStepIn_ns != NULL) {
+            skipped = GetSkippableCycles();
+            SkipCycles(skipped);
+        }
+        if(binaryTrace != NULL)
+            binaryTrace->Sleep(skipped + 1);
+        totalCpuCycles++;
     } else if(cpuCycles <= 0) {
+            // wake up on pending interrupt
+            sleeping = false;
 
             //check for enabled breakpoints here
-            if(BP.end() != find(BP.begin(), BP.end(), PC)) {
-                if(trace_on)
-                    traceOut << "Breakpoint found at " << HexShort(PC) << std::endl;
+            if(BP.Contains(PC)) {
+                if(trace_on || binaryTrace != NULL) {
+                    std::ostringstream os;
+                    os << "Breakpoint found at " << HexShort(PC) << std::endl;
+                    TraceMessage(os.str());
+                }
                 if(nextStepIn_ns != 0)
                     *nextStepIn_ns=clockFreq;
                 untilCoreStepFinished = !(cpuCycles > 0);
@@ -353,9 +441,9 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
                 return BREAK_POINT;
             }
 
-            if(EP.end() != find(EP.begin(), EP.end(), PC)) {
+            if(EP.Contains(PC)) {
                 avr_message("Simulation finished!");
-                SystemClock::Instance().Stop();
+                context->GetClock().Stop();
                 dumpManager->cycle();
                 return 0;
             }
@@ -382,15 +470,20 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
                 //push needs 4 cycles! (on external RAM +2, this is handled from HWExtRam!)
                 SetCurrInstrCycles(4);
                 status->I = 0; //irq started so remove I-Flag from SREG
+                if(binaryTrace != NULL)
+                    binaryTrace->Irq(newIrqPc, actualIrqVector);
                 PC = newIrqPc - 1;   //we add a few lines later 1 so we sub here 1 :-)
 
-            } else if(status->I == 1 && !opIsCli(Flash->GetOpcode(PC))) {
+            } else if(status->I == 1 && irqSystem->IsIrqPending() && !opIsCli(Flash->GetOpcode(PC))) {
                 newIrqPc = irqSystem->GetNewPc(actualIrqVector);
 
                 if(newIrqPc != 0xffffffff) {
                    deferIrq = true; // do always one instruction before entering irq vect
-                   if(trace_on)
-                      traceOut << "IRQ prepared for addr " << HexShort(newIrqPc) << std::endl;
+                   if(trace_on || binaryTrace != NULL) {
+                      std::ostringstream os;
+                      os << "IRQ prepared for addr " << HexShort(newIrqPc) << std::endl;
+                      TraceMessage(os.str());
+                   }
                 }
             }
 
@@ -399,13 +492,12 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
                     std::ostringstream os;
                     os << actualFilename << " Simulation runs out of Flash Space at " << HexShort(PC << 1);
                     std::string s = os.str();
-                    if(trace_on)
-                        traceOut << s << std::endl;
+                    TraceMessage(s + "\n");
                     avr_error("%s", s.c_str());
                 }
 
-                DecodedInstruction *de = (Flash->GetInstruction(PC));
                 if(trace_on) {
+                    DecodedInstruction *de = (Flash->GetInstruction(PC));
                     const std::ios::fmtflags ff(traceOut.flags());
                     const std::streamsize width = traceOut.width();
                     traceOut.width(12);
@@ -413,11 +505,28 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
                     SetCurrInstrCycles(de->Trace());
                     traceOut.width(width);
                     traceOut.flags(ff);
+                } else if((execEngine == ENGINE_BLOCK || execEngine == ENGINE_JIT) &&
+                          nextStepIn_ns != NULL && binaryTrace == NULL && SkipLoop(skipped)) {
+                    // loop starts again on PC after PC++ below
+                    PC--;
+                    SetCurrInstrCycles(1);
+                } else if(execEngine == ENGINE_THREADED) {
+                    const ThreadedInstruction *ti = Flash->GetThreadedInstruction(PC);
+                    SetCurrInstrCycles(ti->handler(this, ti));
+                } else if(execEngine == ENGINE_BLOCK || execEngine == ENGINE_JIT) {
+                    ThreadedInstruction *ti = Flash->GetBlock(PC);
+                    if(ti->blockLength > 1 && IsBlockAllowed(ti))
+                        SetCurrInstrCycles(ExecuteBlock(ti));
+                    else
+                        SetCurrInstrCycles(ti->handler(this, ti));
                 } else {
+                    DecodedInstruction *de = (Flash->GetInstruction(PC));
                     SetCurrInstrCycles((*de)()); 
                 }
                 // report changes on status
                 statusRegister->trigger_change();
+                if(binaryTrace != NULL)
+                    binaryTrace->Execute();
             }
 
             PC++;
@@ -427,12 +536,14 @@ int AvrDevice::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_n
     }
 
     if(nextStepIn_ns != NULL)
-        *nextStepIn_ns = clockFreq;
+        *nextStepIn_ns = clockFreq * (skipped + 1);
 
     if(trace_on && cpuCycles <= 0) {
         traceOut << std::endl;
-        sysConHandler.TraceNextLine();
+        context->GetConsole().TraceNextLine();
     }
+    if(binaryTrace != NULL && cpuCycles <= 0)
+        binaryTrace->EndLine();
 
     untilCoreStepFinished = !((cpuCycles > 0) || hwWait);
     dumpManager->cycle();
@@ -457,10 +568,187 @@ void AvrDevice::Reset() {
     // init the old static vars from Step()
     SetCurrInstrCycles(0);
     totalCpuCycles = 0ull;
+    sleeping = false;
+}
+
+unsigned long long AvrDevice::GetSkippableCycles(void) {
+    // dumpers have to see every change of traced values
+    if(dumpManager->IsDumping())
+        return 0;
+    return GetIdleCycles(context->GetClock().GetSkipHorizon());
+}
+
+bool AvrDevice::IsWakeupPending(void) const {
+    // with I flag cleared no interrupt is able to wake up core
+    return status->I && irqSystem->IsIrqPending(sleepControl->GetWakeupVectors());
+}
+
+unsigned long long AvrDevice::GetIdleCycles(SystemClockOffset horizon) {
+    SystemClockOffset now = context->GetClock().GetCurrentTime();
+    if(horizon <= now + clockFreq)
+        return 0;
+    // steps before horizon are free of other members, step on horizon isn't
+    unsigned long long cycles = (horizon - now - 1) / clockFreq;
+    for(unsigned i = 0; i < hwCycleList.size(); i++) {
+        unsigned long long idle = hwCycleList[i]->IdleCycles();
+        if(idle < cycles)
+            cycles = idle;
+        if(cycles == 0)
+            return 0;
+    }
+    return cycles;
+}
+
+void AvrDevice::SkipCycles(unsigned long long cycles) {
+    clockCycles += cycles;
+    for(unsigned i = 0; i < hwCycleList.size(); i++)
+        hwCycleList[i]->SkipCycles(cycles);
+    totalCpuCycles += cycles;
+}
+
+bool AvrDevice::SkipLoop(unsigned long long &skipped) {
+    ThreadedInstruction *ti = Flash->GetLoop(PC);
+    if(ti->loopKind == ThreadedInstruction::LOOP_NONE)
+        return false;
+    // interrupt is entered after this instruction, gdb needs every instruction
+    if(deferIrq || singleStep)
+        return false;
+    for(dword addr = PC + 1; addr < PC + ti->loopLength; addr++) {
+        if(BP.Contains(addr) || EP.Contains(addr))
+            return false;
+    }
+
+    // iterations, which can be skipped, last iteration leaves the loop and isn't skipped
+    unsigned long long iterations;
+    unsigned char regs[4];
+    unsigned int bytes = 0;
+    unsigned long long value = 0;
+    if(ti->loopKind == ThreadedInstruction::LOOP_COUNTDOWN) {
+        for(unsigned int i = 0; i < ti->loopLength - 1U; i++) {
+            regs[bytes++] = ti[i].op1;
+            if(ti[i].kind == ThreadedInstruction::KIND_SBIW)
+                regs[bytes++] = ti[i].op1 + 1;
+        }
+        for(unsigned int b = 0; b < bytes; b++)
+            value |= (unsigned long long)GetCoreReg(regs[b]) << (8 * b);
+        iterations = ((value == 0) ? (1ULL << (8 * bytes)) : value) - 1;
+    } else {
+        unsigned int opcode = Flash->GetOpcode(PC);
+        unsigned char val;
+        // a read with side effects, like SPSR, would change the loop
+        if(!PeekIOReg((opcode >> 3) & 0x1f, val))
+            return false;
+        bool set = (val & (1 << (opcode & 7))) != 0;
+        if(set == (ti->loopKind == ThreadedInstruction::LOOP_WAIT_SET))
+            return false;
+        // IO bit can't change without an event, so loop runs till then
+        iterations = ~0ULL;
+    }
+
+    unsigned long long count = (GetSkippableCycles() + 1) / ti->loopCycles;
+    if(count > iterations)
+        count = iterations;
+    if(count == 0)
+        return false;
+
+    if(ti->loopKind == ThreadedInstruction::LOOP_COUNTDOWN) {
+        // set counter to state before last skipped iteration, the loop body
+        // then calculates counter and flags as usual
+        value -= count - 1;
+        for(unsigned int b = 0; b < bytes; b++)
+            SetCoreReg(regs[b], (value >> (8 * b)) & 0xff);
+        for(unsigned int i = 0; i < ti->loopLength - 1U; i++)
+            ti[i].handler(this, &ti[i]);
+    }
+    skipped = count * ti->loopCycles - 1;
+    SkipCycles(skipped);
+    return true;
+}
+
+bool AvrDevice::SetExecutionEngine(ExecutionEngine e) {
+    if(e == ENGINE_JIT) {
+        if(!AvrJit::IsAvailable())
+            return false;
+        if(jit == NULL)
+            jit = new AvrJit(this);
+    } else if(jit != NULL) {
+        delete jit;
+        jit = NULL;
+    }
+    execEngine = e;
+    return true;
+}
+
+bool AvrDevice::SetExecutionEngine(const std::string &name) {
+    if(name == "decoder")
+        return SetExecutionEngine(ENGINE_DECODER);
+    if(name == "threaded")
+        return SetExecutionEngine(ENGINE_THREADED);
+    if(name == "block")
+        return SetExecutionEngine(ENGINE_BLOCK);
+    if(name == "jit")
+        return SetExecutionEngine(ENGINE_JIT);
+    return false;
+}
+
+bool AvrDevice::IsBlockAllowed(const ThreadedInstruction *ti) {
+    // gdb single step, dumpers and binary trace need to see every instruction
+    if(singleStep || dumpManager->IsDumping() || binaryTrace != NULL)
+        return false;
+    // interrupt is entered after this instruction
+    if(deferIrq)
+        return false;
+    // break or exit points behind the first instruction split the block
+    if(BP.size() != 0 || EP.size() != 0) {
+        for(dword addr = PC + 1; addr < PC + ti->blockLength; addr++) {
+            if(BP.Contains(addr) || EP.Contains(addr))
+                return false;
+        }
+    }
+    // interrupts are checked only after the block, so no hardware and no
+    // other simulation member may act, till the last instruction has started
+    return GetIdleCycles(context->GetClock().GetEventHorizon()) >= ti->blockCycles;
+}
+
+int AvrDevice::ExecuteBlock(ThreadedInstruction *ti) {
+    unsigned int len = ti->blockLength;
+    unsigned int straight = (ti[len - 1].cycles == 0) ? len - 1 : len;
+    int clks = ti->blockCycles;
+
+    if(jit == NULL || !jit->Execute(ti)) {
+        for(unsigned int i = 0; i < straight; i++)
+            ti[i].handler(this, &ti[i]);
+    }
+    PC += len - 1;
+    // terminating branch calculates the target from its own address
+    if(straight < len)
+        clks += ti[straight].handler(this, &ti[straight]);
+    return clks;
 }
 
 void AvrDevice::DeleteAllBreakpoints() {
-    BP.erase(BP.begin(), BP.end());
+    BP.Clear();
+}
+
+void AddressList::Add(dword addr) {
+    push_back(addr);
+    if(addr >= flags.size())
+        flags.resize(addr + 1, false);
+    flags[addr] = true;
+}
+
+void AddressList::Remove(dword addr) {
+    iterator ii = find(begin(), end(), addr);
+    if(ii == end())
+        return;
+    erase(ii);
+    // address could be in list more than once
+    flags[addr] = (find(begin(), end(), addr) != end());
+}
+
+void AddressList::Clear(void) {
+    clear();
+    flags.clear();
 }
 
 void AvrDevice::SetDeviceNameAndSignature(const std::string &name, unsigned int signature) {
@@ -494,7 +782,7 @@ void AvrDevice::RegisterTerminationSymbol(const char *symbol) {
     assert(false);  // TODO: Implement loading symbols from ELF file
 #endif
     unsigned int epa = Flash->GetAddressAtSymbol(symbol);
-    EP.push_back(epa);
+    EP.Add(epa);
 }
 
 void AvrDevice::DebugOnJump()
@@ -535,6 +823,11 @@ unsigned char AvrDevice::GetIOReg(unsigned addr) {
     return *(rw[addr + registerSpaceSize]);
 }
 
+bool AvrDevice::PeekIOReg(unsigned addr, unsigned char &val) {
+    assert(addr < ioSpaceSize);  // callers do use 0x00 base, not 0x20
+    return rw[addr + registerSpaceSize]->Peek(val);
+}
+
 bool AvrDevice::SetIOReg(unsigned addr, unsigned char val) {
     assert(addr < ioSpaceSize);  // callers do use 0x00 base, not 0x20
     *(rw[addr + registerSpaceSize]) = val;
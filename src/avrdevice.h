@@ -45,8 +45,28 @@
 #define INVALID_OPCODE -1
 
 // transfered from breakpoint.h
-class Breakpoints: public std::vector<dword> { };
-class Exitpoints: public std::vector<dword> { };
+//! List of flash word addresses with lookup in constant time
+/*! Beside the list a flag per address is held, so that AvrDevice::Step
+  doesn't depend on the count of break or exit points. Use Add, Remove and
+  Clear to change the list, otherwise the flags are out of date! */
+class AddressList: public std::vector<dword> {
+    
+    public:
+        //! Adds address to list
+        void Add(dword addr);
+        //! Removes address from list, if it's there
+        void Remove(dword addr);
+        //! Removes all addresses
+        void Clear(void);
+        //! Returns true, if address is in list
+        bool Contains(dword addr) const { return addr < flags.size() && flags[addr]; }
+        
+    private:
+        std::vector<bool> flags; //!< flag per flash word address
+};
+
+class Breakpoints: public AddressList { };
+class Exitpoints: public AddressList { };
 
 // from hwsreg.h, but not included, because of circular include with this header
 class HWSreg;
@@ -62,6 +82,13 @@ class RWMemoryMember;
 class Hardware;
 class DumpManager;
 class AddressExtensionRegister;
+class ThreadedInstruction;
+class AvrJit;
+class SleepControl;
+class BinaryTrace;
+class SimulationContext;
+class SystemClock;
+struct ELFImage;
 
 //! Basic AVR device, contains the core functionality
 class AvrDevice: public SimulationMember, public TraceValueRegister {
@@ -74,18 +101,56 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         const unsigned int iRamSize;
         const unsigned int eRamSize;
         unsigned long long totalCpuCycles;
+        unsigned long long clockCycles; //!< clocks since creation, also clocks, on which CPU is held by hardware
+        unsigned long long hwCycleCalls; //!< count of CpuCycle calls on hardware in cycle list
+        unsigned int hwCycleIndex; //!< position of the hardware in cycle list, which is ticked now, size of list outside of Step
         unsigned int devSignature; //!< hold the device signature for this core
         std::string devName; //!< hold the device name, which this core simulate
 
+        SimulationContext *context; //!< simulation, to which this core belongs
+
         friend class DumpManager;
+        friend class Checkpoint;
         void detachDumpManager() { dumpManager = NULL; }
 
         bool opIsCli(unsigned opcode);
+        //! Writes a message to text trace and binary trace, if enabled
+        void TraceMessage(const std::string &msg);
+        //! Prints symbols after Load, if debug messages are enabled
+        void DumpLoadedSymbols(void);
 
         inline void NextCycle() { cpuCycles--, totalCpuCycles++; }
         inline void SetCurrInstrCycles(int cycles) { cpuCycles = cycles; }
 
         word lastTracedSymbolPC;
+    public:
+        //! Available engines to execute instructions, see SetExecutionEngine
+        enum ExecutionEngine {
+            ENGINE_DECODER,  //!< virtual call to DecodedInstruction::operator()(), default
+            ENGINE_THREADED, //!< direct call of handler from threaded code table in AvrFlash
+            ENGINE_BLOCK,    //!< as ENGINE_THREADED, but executes straight-line blocks in one core step, if no interrupt can get pending meanwhile, and fast-forwards busy-wait loops
+            ENGINE_JIT       //!< as ENGINE_BLOCK, but hot blocks are translated to native code
+        };
+    private:
+        ExecutionEngine execEngine; //!< selected engine to execute instructions
+        AvrJit *jit; //!< native code translator, only created for ENGINE_JIT
+        BinaryTrace *binaryTrace; //!< binary instruction trace, NULL if not enabled
+
+        //! Returns true, if a pending interrupt wakes up core from sleep mode
+        bool IsWakeupPending(void) const;
+        //! Returns true, if block starting at PC can be executed in one core step
+        bool IsBlockAllowed(const ThreadedInstruction *ti);
+        //! Executes a block of instructions, returns used clocks
+        int ExecuteBlock(ThreadedInstruction *ti);
+        //! Returns count of cycles after actual one, which can be skipped without missing an event
+        unsigned long long GetSkippableCycles(void);
+        //! Returns count of cycles after actual one, in which no hardware and no member before horizon acts
+        unsigned long long GetIdleCycles(SystemClockOffset horizon);
+        //! Credits skipped cycles to core and hardware
+        void SkipCycles(unsigned long long cycles);
+        //! Fast-forwards busy-wait loop starting at PC, returns false, if not possible
+        bool SkipLoop(unsigned long long &skipped);
+
     protected:
         SystemClockOffset clockFreq;  ///< Period of a tick (1/F_OSC) in [ns]
         std::map < std::string, Pin *> allPins;
@@ -96,6 +161,7 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
 
     public:
         bool trace_on;
+        bool singleStep; //!< if true, execute only one instruction per core step, set by gdb single step
         Breakpoints BP;
         Exitpoints EP;
 
@@ -117,6 +183,8 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         AddressExtensionRegister *eind; //!< EIND address extension register
         bool abortOnInvalidAccess; //!< Flag, that simulation abort if an invalid access occured, default is false
         TraceValueCoreRegister coreTraceGroup;
+        bool sleeping; //!< core executed SLEEP and waits for an interrupt
+        SleepControl *sleepControl; //!< SE bit, NULL if device doesn't support sleep, then SLEEP is a NOP
         bool deferIrq;  ///< Almost always false.
         unsigned int newIrqPc;
         unsigned int actualIrqVector; 
@@ -148,6 +216,11 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         std::vector<Hardware *> hwCycleList; 
 
         DumpManager *dumpManager;
+
+        //! Returns the simulation context, which was current on construction
+        SimulationContext *GetContext(void) { return context; }
+        //! Returns the time table of the simulation context
+        SystemClock &GetSystemClock(void);
     
         AvrDevice(unsigned int ioSpaceSize, unsigned int IRamSize, unsigned int ERamSize, unsigned int flashSize);
         virtual ~AvrDevice();
@@ -157,14 +230,18 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         void AddToResetList(Hardware *hw);
 
         /*! Adds to the list of parts to cycle per clock tick. If already in that list, does
-          nothing. */
+          nothing. A part, which is added while parts are ticked, gets its
+          first CpuCycle call on the next clock, so a part woken up by a pin
+          change can count the current clock itself. */
         void AddToCycleList(Hardware *hw);
 
         //! Removes from the cycle list, if possible.
-        /*! Does nothing if the part is not in the cycle list. */
+        /*! Does nothing if the part is not in the cycle list. It's allowed to
+          call this from CpuCycle, a part can leave the list, if it's idle. */
         void RemoveFromCycleList(Hardware *hw);
     
         void Load(const char* n); //!< Load flash, eeprom, signature, fuses from elf file, wrapper for LoadBFD or LoadSimpleELF
+        void Load(const ELFImage &image); //!< Load flash, eeprom, signature, fuses from an already read elf file
         void ReplaceIoRegister(unsigned int offset, RWMemoryMember *);
         bool ReplaceMemRegister(unsigned int offset, RWMemoryMember *);
         RWMemoryMember *GetMemRegisterInstance(unsigned int offset);
@@ -178,13 +255,37 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         void Reset();
         void SetClockFreq(SystemClockOffset f);
         SystemClockOffset GetClockFreq();
+        //! Returns count of clocks since creation of core, it isn't cleared on reset
+        unsigned long long GetClockCycles(void) const { return clockCycles; }
+        //! Returns count of CpuCycle calls on hardware parts, divide by GetClockCycles to get parts per clock
+        unsigned long long GetHwCycleCalls(void) const { return hwCycleCalls; }
+        //! Connects serial RX and TX files to pins
+        /*! The created nets and serial parts are appended to nets and serials,
+            the caller owns them and deletes them after the device. */
         void RegisterSerials(std::vector<SerialCfg *> &serialRxCfgs,
-                             std::vector<SerialCfg *> &serialTxCfgs);
+                             std::vector<SerialCfg *> &serialTxCfgs,
+                             std::vector<Net *> &nets,
+                             std::vector<SimulationMember *> &serials);
 
         void RegisterPin(const std::string &name, Pin *p) {
             allPins.insert(std::pair<std::string, Pin*>(name, p));
         }
 
+        //! Select the engine to execute instructions
+        /*! \return false, if engine isn't available on this host, engine isn't changed then */
+        bool SetExecutionEngine(ExecutionEngine e);
+        //! Select the engine to execute instructions by name ("decoder", "threaded", "block" or "jit")
+        /*! \return false, if name is unknown or engine isn't available, engine isn't changed then */
+        bool SetExecutionEngine(const std::string &name);
+        //! Return native code translator, NULL if engine isn't ENGINE_JIT
+        AvrJit *GetJit(void) { return jit; }
+        //! Return the selected engine to execute instructions
+        ExecutionEngine GetExecutionEngine(void) { return execEngine; }
+        //! Enables binary instruction trace, NULL disables it, the caller keeps ownership
+        /*! With binary trace the core executes instruction by instruction, busy-wait
+          loops aren't fast-forwarded, but sleep time is skipped as without trace. */
+        void SetBinaryTrace(BinaryTrace *bt) { binaryTrace = bt; }
+
         //! Clear all breakpoints in device
         void DeleteAllBreakpoints(void);
 
@@ -218,6 +319,9 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         bool SetCoreReg(unsigned addr, unsigned char val);
         //! Get a value from IO register (without offset of 0x20!)
         unsigned char GetIOReg(unsigned addr);
+        //! Get a value from IO register (without offset of 0x20!) without side effects
+        /*! \return false, if reading the register could change hardware state */
+        bool PeekIOReg(unsigned addr, unsigned char &val);
         //! Set a value to IO register (without offset of 0x20!)
         bool SetIOReg(unsigned addr, unsigned char val);
         //! Set a bit value to lower IO register (without offset of 0x20!)
@@ -237,8 +341,10 @@ class AvrDevice: public SimulationMember, public TraceValueRegister {
         void DebugOnJump();
 
         friend void ELFLoad(AvrDevice * core);
+        friend void ELFLoadImage(AvrDevice * core, const ELFImage &image);
 
-        void TraceHeader();
+        //! Writes begin of a text trace line: cycles, time, address and symbol of cPC
+        void TraceHeader(unsigned long long cycles, SystemClockOffset time);
 };
 
 #endif
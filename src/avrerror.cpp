@@ -250,7 +250,7 @@ int global_verbose_on = 0;
 int global_verbosity_level = 0;
 
 void trioaccess(const char *t, unsigned char val) {
-    sysConHandler.traceOutStream() << t << "=" << HexChar(val) << " ";
+    traceOut << t << "=" << HexChar(val) << " ";
 }
 
 // EOF
@@ -125,20 +125,23 @@ class SystemConsoleHandler {
         char *getFormatString(const char *prefix, const char *file, int line, const char *fmtstr);
 };
 
-//! The SystemConsoleHandler instance for common usage
+//! The SystemConsoleHandler instance for common usage, used by the default SimulationContext
 extern SystemConsoleHandler sysConHandler;
 
+//! The SystemConsoleHandler of the current SimulationContext
+SystemConsoleHandler &CurrentConsoleHandler(void);
+
 // redirect old definition ostream traceOut to SystemConsoleHandler.traceStream
-#define traceOut sysConHandler.traceOutStream()
+#define traceOut CurrentConsoleHandler().traceOutStream()
 
 //! Helper function for writing trace (trace IO access)
 void trioaccess(const char *t, unsigned char val);
 
-#define avr_debug_enabled (sysConHandler.IsLevelEnabled(2))
-#define avr_debug(...)   sysConHandler.vfdebug(2, __VA_ARGS__)
-#define avr_message(...) sysConHandler.vfmessage(__VA_ARGS__)
-#define avr_warning(...) sysConHandler.vfwarning(__FILE__, __LINE__, ## __VA_ARGS__)
-#define avr_failure(...) sysConHandler.vferror(__FILE__, __LINE__, ## __VA_ARGS__)
-#define avr_error(...)   sysConHandler.vffatal(__FILE__, __LINE__, ## __VA_ARGS__)
+#define avr_debug_enabled (2 <= global_verbosity_level)
+#define avr_debug(...)   CurrentConsoleHandler().vfdebug(2, __VA_ARGS__)
+#define avr_message(...) CurrentConsoleHandler().vfmessage(__VA_ARGS__)
+#define avr_warning(...) CurrentConsoleHandler().vfwarning(__FILE__, __LINE__, ## __VA_ARGS__)
+#define avr_failure(...) CurrentConsoleHandler().vferror(__FILE__, __LINE__, ## __VA_ARGS__)
+#define avr_error(...)   CurrentConsoleHandler().vffatal(__FILE__, __LINE__, ## __VA_ARGS__)
 
 #endif /* SIM_AVRERROR_H */
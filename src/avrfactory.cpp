@@ -29,6 +29,7 @@
 #include "config.h"
 #include "avrfactory.h"
 #include "avrerror.h"
+#include "simulationcontext.h"
 
 using namespace std;
 
@@ -47,7 +48,7 @@ void AvrFactory::reg(const std::string name,
         avr_error("Duplicate device specification: %s", devname.c_str());
 }
 
-AvrDevice* AvrFactory::makeDevice(const char *in) {
+AvrDevice* AvrFactory::makeDevice(const char *in, SimulationContext *context) {
     avr_debug("AvrFactory::makeDevice(in=%s)", in);
     string devname(in);
     for(unsigned int i = 0; i < devname.size(); i++)
@@ -60,6 +61,9 @@ AvrDevice* AvrFactory::makeDevice(const char *in) {
     if(i == devmap.end())
         avr_error("Invalid device specification: %s", in);
 
+    if(context == NULL)
+        return devmap[devname]();
+    SimulationContext::Scope scope(*context);
     return devmap[devname]();
 }
 
@@ -30,6 +30,7 @@
 #include <string>
 
 class AvrDevice;
+class SimulationContext;
 
 //! Produces AVR devices
 /*! Factory for producing AVR devices according to a configuration string.
@@ -44,8 +45,10 @@ class AvrFactory {
         /*! Produces an AVR device according to the configuration string.
           Right now, the configuration string is simply the full name of the AVR
           device, like AT90S4433 or ATMEGA128.
+          The device belongs to the given simulation context, if context is
+          NULL, to the current context of calling thread.
           */
-        AvrDevice* makeDevice(const char *config);
+        AvrDevice* makeDevice(const char *config, SimulationContext *context = NULL);
     
         //! Singleton class access. 
         static AvrFactory& instance();
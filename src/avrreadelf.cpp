@@ -92,20 +92,21 @@ typedef struct {
     Elf32_Word p_align;  /* memory/file alignment */
 } Elf32_Phdr;
 
-void ELFLoad(AvrDevice * core) {
-    FILE * f = fopen(core->GetFname().c_str(), "rb");
+void ELFReadImage(const char *filename, ELFImage &image) {
+    FILE * f = fopen(filename, "rb");
     if(f == NULL)
-        avr_error("Could not open file: %s", core->GetFname().c_str());
+        avr_error("Could not open file: %s", filename);
 
     Elf32_Ehdr header;
     fread(&header, sizeof(header), 1, f);
     if(header.e_ident[0] != 0x7F || header.e_ident[1] != 'E'
         || header.e_ident[2] != 'L' || header.e_ident[3] != 'F')
-        avr_error("File '%s' is not an ELF file", core->GetFname().c_str());
+        avr_error("File '%s' is not an ELF file", filename);
     // TODO: fix endianity in header
     if(header.e_machine != 83)
-        avr_error("ELF file '%s' is not for Atmel AVR architecture (%d)", core->GetFname().c_str(), header.e_machine);
+        avr_error("ELF file '%s' is not for Atmel AVR architecture (%d)", filename, header.e_machine);
 
+    image.filename = filename;
     for(int i = 0; i < header.e_phnum; i++) {
         fseek(f, header.e_phoff + i * header.e_phentsize, SEEK_SET);
         Elf32_Phdr progHeader;
@@ -119,14 +120,14 @@ void ELFLoad(AvrDevice * core) {
             continue;  // not into a Flash
         if(progHeader.p_filesz != progHeader.p_memsz) {
             avr_error("Segment sizes 0x%x and 0x%x in ELF file '%s' must be the same",
-                progHeader.p_filesz, progHeader.p_memsz, core->GetFname().c_str());
+                progHeader.p_filesz, progHeader.p_memsz, filename);
         }
-        unsigned char * tmp = new unsigned char[progHeader.p_filesz];
+        ELFImage::Segment seg;
+        seg.vma = seg.pma = progHeader.p_vaddr;
+        seg.data.resize(progHeader.p_filesz);
         fseek(f, progHeader.p_offset, SEEK_SET);
-        fread(tmp, progHeader.p_filesz, 1, f);
-
-        core->Flash->WriteMem(tmp, progHeader.p_vaddr, progHeader.p_filesz);
-        delete [] tmp;
+        fread(&seg.data[0], progHeader.p_filesz, 1, f);
+        image.segments.push_back(seg);
     }
 
     fclose(f);
@@ -139,18 +140,19 @@ unsigned int ELFGetDeviceNameAndSignature(const char *filename, char *devicename
 #endif
 
 #ifndef _MSC_VER
-void ELFLoad(AvrDevice * core) {
+void ELFReadImage(const char *filename, ELFImage &image) {
     ELFIO::elfio reader;
 
-    if(!reader.load(core->GetFname()))
-        avr_error("File '%s' not found or isn't a elf object",
-                  core->GetFname().c_str());
+    if(!reader.load(filename))
+        avr_error("File '%s' not found or isn't a elf object", filename);
 
     if(reader.get_machine() != EM_AVR)
         avr_error("ELF file '%s' is not for Atmel AVR architecture (%d)",
-                  core->GetFname().c_str(),
+                  filename,
                   reader.get_machine());
 
+    image.filename = filename;
+
     // over all symbols ...
     ELFIO::Elf_Half sec_num = reader.sections.size();
 
@@ -185,149 +187,37 @@ void ELFLoad(AvrDevice * core) {
                 if((bind == STB_LOCAL) && (type != STT_NOTYPE))
                     continue;
 
-                if(value < 0x800000) {
-                    // range of flash space (.text)
-                    std::pair<unsigned int, std::string> p(value >> 1, name);
-
-                    core->Flash->AddSymbol(p);
-                } else if(value < 0x810000) {
-                    // range of ram (.data)
-                    ELFIO::Elf64_Addr offset = value - 0x800000;
-                    std::pair<unsigned int, std::string> p(offset, name);
-
-                    core->data->AddSymbol(p);
-                } else if(value < 0x820000) {
-                    // range of eeprom (.eeprom)
-                    ELFIO::Elf64_Addr offset = value - 0x810000;
-                    std::pair<unsigned int, std::string> p(offset, name);
-
-                    core->eeprom->AddSymbol(p);
-                } else if(value < 0x820400) {
-                    /* fuses space starting from 0x820000, do nothing */;
-                } else if(value >= 0x830000 && value < 0x830400) {
-                    /* lock bits starting from 0x830000, do nothing */;
-                } else if(value >= 0x840000 && value < 0x840400) {
-                    /* signature space starting from 0x840000, do nothing */;
-                } else if(!strncmp("siminfo" , name.c_str(), 7)) {
-                    /* SIMINFO symbol, do nothing */
-                } else
-                    avr_warning("Unknown symbol address range found! (symbol='%s', address=0x%lx)",
-                                name.c_str(),
-                                value);
-
+                ELFImage::Symbol sym;
+                sym.name = name;
+                sym.value = value;
+                sym.size = size;
+                image.symbols.push_back(sym);
             }
         }
         if(psec->get_name() == ".siminfo") {
-            /*
-             * You wonder why SIMINFO is read here, ignoring symbols?
-             * Well, doing things this way is pretty independent from ELF
-             * internals, other than finding the .siminfo section start pointer.
-             * Accordingly, we can add pretty much anything, as long as the
-             * interpretation here matches what's given in simulavr_info.h.
-             */
-            ELFIO::Elf_Xword filesize = psec->get_size();
             const char *data = psec->get_data();
-            const char *data_ptr = data, *data_end = data + filesize;
-
-            while(data_ptr < data_end) {
-                char tag = *data_ptr;
-                char length = *(data_ptr + 1);
-                // Length check already done in ELFGetDeviceNameAndSignature().
-    
-                switch(tag) {
-                  case SIMINFO_TAG_DEVICE:
-                    // Device name. Handled in ELFGetDeviceNameAndSignature().
-                    break;
-                  case SIMINFO_TAG_CPUFREQUENCY:
-                    core->SetClockFreq((SystemClockOffset)1000000000 /
-                                       ((siminfo_long_t *)data_ptr)->value);
-                    break;
-                  case SIMINFO_TAG_SERIAL_IN:
-                    {
-                        long long safetyDelayNanos = 500000;
-                        avr_message("Connecting file %s as serial in to pin %s at %d baud."
-                                "Adding it to the simulation with a safety delay of %lld ns",
-                                ((siminfo_serial_t *)data_ptr)->filename,
-                                ((siminfo_serial_t *)data_ptr)->pin,
-                                ((siminfo_serial_t *)data_ptr)->baudrate,
-                                safetyDelayNanos);
-                        Net *net = new Net();
-                        SerialTxFile *serial =
-                          new SerialTxFile(((siminfo_serial_t *)data_ptr)->filename, safetyDelayNanos);
-                        serial->SetBaudRate(((siminfo_serial_t *)data_ptr)->baudrate);
-                        net->Add(core->GetPin(((siminfo_serial_t *)data_ptr)->pin));
-                        net->Add(serial->GetPin("tx"));
-                    }
-                    break;
-                  case SIMINFO_TAG_SERIAL_OUT:
-                    avr_message("Connecting pin %s as serial out to file %s at %d baud.",
-                                ((siminfo_serial_t *)data_ptr)->pin,
-                                ((siminfo_serial_t *)data_ptr)->filename,
-                                ((siminfo_serial_t *)data_ptr)->baudrate);
-                    {
-                        Net *net = new Net();
-                        SerialRxFile *serial =
-                          new SerialRxFile(((siminfo_serial_t *)data_ptr)->filename);
-                        serial->SetBaudRate(((siminfo_serial_t *)data_ptr)->baudrate);
-                        net->Add(core->GetPin(((siminfo_serial_t *)data_ptr)->pin));
-                        net->Add(serial->GetPin("rx"));
-                    }
-                    break;
-                  default:
-                    avr_warning("Unknown tag in ELF .siminfo section: %hu", tag);
-                }
-                data_ptr += length;
-            }
+            image.siminfo.assign(data, data + psec->get_size());
         }
     }
 
-    // load program, data and - if available - eeprom, fuses and signature
+    // program, data and - if available - eeprom, fuses and signature
     ELFIO::Elf_Half seg_num = reader.segments.size();
 
     for(ELFIO::Elf_Half i = 0; i < seg_num; i++) {
         ELFIO::segment* pseg = reader.segments[i];
 
         if(pseg->get_type() == PT_LOAD) {
-            ELFIO::Elf_Xword  filesize = pseg->get_file_size();
-            ELFIO::Elf64_Addr vma = pseg->get_virtual_address();
-            ELFIO::Elf64_Addr pma = pseg->get_physical_address();
+            ELFIO::Elf_Xword filesize = pseg->get_file_size();
 
             if(filesize == 0)
                 continue;
 
             const unsigned char* data = (const unsigned char*)pseg->get_data();
-
-            if(vma < 0x810000) {
-                // read program, space below 0x810000 (.text)
-                core->Flash->WriteMem(data, pma, filesize);
-            } else if(vma >= 0x810000 && vma < 0x820000) {
-                // read eeprom content, if available, space from 0x810000 to 0x820000 (.eeprom)
-                unsigned int offset = vma - 0x810000;
-
-                core->eeprom->WriteMem(data, offset, filesize);
-            } else if(vma >= 0x820000 && vma < 0x820400) {
-                // read fuses, if available, space from 0x820000 to 0x820400
-                if(!core->fuses->LoadFuses(data, filesize))
-                    avr_error("wrong byte size of fuses");
-            } else if(vma >= 0x830000 && vma < 0x830400) {
-                // read lock bits, if available, space from 0x830000 to 0x830400
-                if(!core->lockbits->LoadLockBits(data, filesize))
-                    avr_error("wrong byte size of lock bits");
-            } else if(vma >= 0x840000 && vma < 0x840400) {
-                // read and check signature, if available, space from 0x840000 to 0x840400
-                if(filesize != 3)
-                    avr_error("wrong device signature size in elf file, expected=3, given=%lu",
-                              filesize);
-                else {
-                    unsigned int sig = (((data[2] << 8) + data[1]) << 8) + data[0];
-
-                    if(core->GetDeviceSignature() != std::numeric_limits<unsigned int>::max() &&
-                       sig != core->GetDeviceSignature())
-                        avr_error("wrong device signature, expected=0x%x, given=0x%x",
-                                  core->GetDeviceSignature(),
-                                  sig);
-                }
-            }
+            ELFImage::Segment seg;
+            seg.vma = pseg->get_virtual_address();
+            seg.pma = pseg->get_physical_address();
+            seg.data.assign(data, data + filesize);
+            image.segments.push_back(seg);
         }
     }
 }
@@ -468,4 +358,155 @@ unsigned int ELFGetDeviceNameAndSignature(const char *filename, char *devicename
 
 #endif
 
+void ELFLoadImage(AvrDevice * core, const ELFImage &image) {
+    for(size_t j = 0; j < image.symbols.size(); j++) {
+        const std::string &name = image.symbols[j].name;
+        unsigned long long value = image.symbols[j].value;
+        unsigned long long size = image.symbols[j].size;
+
+        if(value < 0x800000) {
+            // range of flash space (.text)
+            std::pair<unsigned int, std::string> p(value >> 1, name);
+
+            core->Flash->AddSymbol(p, (size + 1) >> 1);
+        } else if(value < 0x810000) {
+            // range of ram (.data)
+            unsigned long long offset = value - 0x800000;
+            std::pair<unsigned int, std::string> p(offset, name);
+
+            core->data->AddSymbol(p, size);
+        } else if(value < 0x820000) {
+            // range of eeprom (.eeprom)
+            unsigned long long offset = value - 0x810000;
+            std::pair<unsigned int, std::string> p(offset, name);
+
+            core->eeprom->AddSymbol(p, size);
+        } else if(value < 0x820400) {
+            /* fuses space starting from 0x820000, do nothing */;
+        } else if(value >= 0x830000 && value < 0x830400) {
+            /* lock bits starting from 0x830000, do nothing */;
+        } else if(value >= 0x840000 && value < 0x840400) {
+            /* signature space starting from 0x840000, do nothing */;
+        } else if(!strncmp("siminfo" , name.c_str(), 7)) {
+            /* SIMINFO symbol, do nothing */
+        } else
+            avr_warning("Unknown symbol address range found! (symbol='%s', address=0x%lx)",
+                        name.c_str(),
+                        (unsigned long)value);
+    }
+    // sort once, inserting each symbol into a sorted index would be O(n^2)
+    core->Flash->SortSymbols();
+    core->data->SortSymbols();
+    if(core->eeprom != NULL)
+        core->eeprom->SortSymbols();
+
+    if(!image.siminfo.empty()) {
+        /*
+         * You wonder why SIMINFO is read here, ignoring symbols?
+         * Well, doing things this way is pretty independent from ELF
+         * internals, other than finding the .siminfo section start pointer.
+         * Accordingly, we can add pretty much anything, as long as the
+         * interpretation here matches what's given in simulavr_info.h.
+         */
+        const char *data_ptr = &image.siminfo[0];
+        const char *data_end = data_ptr + image.siminfo.size();
+
+        while(data_ptr < data_end) {
+            char tag = *data_ptr;
+            char length = *(data_ptr + 1);
+            // Length check already done in ELFGetDeviceNameAndSignature().
+    
+            switch(tag) {
+              case SIMINFO_TAG_DEVICE:
+                // Device name. Handled in ELFGetDeviceNameAndSignature().
+                break;
+              case SIMINFO_TAG_CPUFREQUENCY:
+                core->SetClockFreq((SystemClockOffset)1000000000 /
+                                   ((siminfo_long_t *)data_ptr)->value);
+                break;
+              case SIMINFO_TAG_SERIAL_IN:
+                {
+                    long long safetyDelayNanos = 500000;
+                    avr_message("Connecting file %s as serial in to pin %s at %d baud."
+                            "Adding it to the simulation with a safety delay of %lld ns",
+                            ((siminfo_serial_t *)data_ptr)->filename,
+                            ((siminfo_serial_t *)data_ptr)->pin,
+                            ((siminfo_serial_t *)data_ptr)->baudrate,
+                            safetyDelayNanos);
+                    Net *net = new Net(core->GetSystemClock());
+                    SerialTxFile *serial =
+                      new SerialTxFile(core->GetSystemClock(), ((siminfo_serial_t *)data_ptr)->filename, safetyDelayNanos);
+                    serial->SetBaudRate(((siminfo_serial_t *)data_ptr)->baudrate);
+                    net->Add(core->GetPin(((siminfo_serial_t *)data_ptr)->pin));
+                    net->Add(serial->GetPin("tx"));
+                }
+                break;
+              case SIMINFO_TAG_SERIAL_OUT:
+                avr_message("Connecting pin %s as serial out to file %s at %d baud.",
+                            ((siminfo_serial_t *)data_ptr)->pin,
+                            ((siminfo_serial_t *)data_ptr)->filename,
+                            ((siminfo_serial_t *)data_ptr)->baudrate);
+                {
+                    Net *net = new Net(core->GetSystemClock());
+                    SerialRxFile *serial =
+                      new SerialRxFile(core->GetSystemClock(), ((siminfo_serial_t *)data_ptr)->filename);
+                    serial->SetBaudRate(((siminfo_serial_t *)data_ptr)->baudrate);
+                    net->Add(core->GetPin(((siminfo_serial_t *)data_ptr)->pin));
+                    net->Add(serial->GetPin("rx"));
+                }
+                break;
+              default:
+                avr_warning("Unknown tag in ELF .siminfo section: %hu", tag);
+            }
+            data_ptr += length;
+        }
+    }
+
+    // load program, data and - if available - eeprom, fuses and signature
+    for(size_t i = 0; i < image.segments.size(); i++) {
+        unsigned long filesize = image.segments[i].data.size();
+        unsigned long long vma = image.segments[i].vma;
+        unsigned long long pma = image.segments[i].pma;
+        const unsigned char* data = &image.segments[i].data[0];
+
+        if(vma < 0x810000) {
+            // read program, space below 0x810000 (.text)
+            core->Flash->WriteMem(data, pma, filesize);
+        } else if(vma >= 0x810000 && vma < 0x820000) {
+            // read eeprom content, if available, space from 0x810000 to 0x820000 (.eeprom)
+            unsigned int offset = vma - 0x810000;
+
+            core->eeprom->WriteMem(data, offset, filesize);
+        } else if(vma >= 0x820000 && vma < 0x820400) {
+            // read fuses, if available, space from 0x820000 to 0x820400
+            if(!core->fuses->LoadFuses(data, filesize))
+                avr_error("wrong byte size of fuses");
+        } else if(vma >= 0x830000 && vma < 0x830400) {
+            // read lock bits, if available, space from 0x830000 to 0x830400
+            if(!core->lockbits->LoadLockBits(data, filesize))
+                avr_error("wrong byte size of lock bits");
+        } else if(vma >= 0x840000 && vma < 0x840400) {
+            // read and check signature, if available, space from 0x840000 to 0x840400
+            if(filesize != 3)
+                avr_error("wrong device signature size in elf file, expected=3, given=%lu",
+                          filesize);
+            else {
+                unsigned int sig = (((data[2] << 8) + data[1]) << 8) + data[0];
+
+                if(core->GetDeviceSignature() != std::numeric_limits<unsigned int>::max() &&
+                   sig != core->GetDeviceSignature())
+                    avr_error("wrong device signature, expected=0x%x, given=0x%x",
+                              core->GetDeviceSignature(),
+                              sig);
+            }
+        }
+    }
+}
+
+void ELFLoad(AvrDevice * core) {
+    ELFImage image;
+    ELFReadImage(core->GetFname().c_str(), image);
+    ELFLoadImage(core, image);
+}
+
 // EOF
@@ -26,9 +26,40 @@
 #ifndef AVRREADELF
 #define AVRREADELF
 
+#include <string>
+#include <vector>
+
 #include "avrdevice.h"
 
+/** Content of an ELF file, as needed to load it into a core.
+
+    An image can be read once and loaded into many cores, also from
+    different threads, it isn't changed by loading. */
+struct ELFImage {
+    //! Loadable segment
+    struct Segment {
+        unsigned long long vma; //!< virtual address, selects the memory space
+        unsigned long long pma; //!< physical address, address in flash
+        std::vector<unsigned char> data;
+    };
+    //! Global symbol
+    struct Symbol {
+        std::string name;
+        unsigned long long value;
+        unsigned long long size; //!< size in bytes, 0 if unknown
+    };
+
+    std::string filename;
+    std::vector<Segment> segments;
+    std::vector<Symbol> symbols;
+    std::vector<char> siminfo; //!< content of .siminfo section, see simulavr_info.h
+};
+
 unsigned int ELFGetDeviceNameAndSignature(const char *filename, char *devicename);
+//! Reads ELF file into image, without a core
+void ELFReadImage(const char *filename, ELFImage &image);
+//! Loads image into core: symbols, .siminfo settings and memory content
+void ELFLoadImage(AvrDevice * core, const ELFImage &image);
 void ELFLoad(AvrDevice * core);
 
 #endif
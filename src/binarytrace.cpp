@@ -0,0 +1,417 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <cstring>
+
+#include "binarytrace.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+#include "hwsreg.h"
+#include "hwstack.h"
+#include "rwmem.h"
+#include "decoder.h"
+#include "flash.h"
+#include "irqsystem.h"
+
+using namespace std;
+
+static const char btraceMagic[] = "simulavr btrace";
+static const unsigned char btraceVersion = 1;
+
+static const unsigned char BT_NEWLINE = 0x08; // LINE, END
+static const unsigned char BT_PC = 0x10;      // LINE
+static const unsigned char BT_TIME = 0x20;    // LINE
+static const unsigned char BT_SREG = 0x08;    // EXEC, IRQ
+static const unsigned char BT_SP = 0x10;      // EXEC, IRQ
+
+static const size_t btraceFlushSize = 1 << 16;
+
+BinaryTrace::BinaryTrace(const string &name, AvrDevice *c):
+    core(c),
+    lastCycles(0),
+    lastTime(0),
+    period(c->GetClockFreq()),
+    nextPc(c->PC),
+    lineEnded(false)
+{
+    out.open(name.c_str(), ios::out | ios::binary);
+    if(!out.is_open())
+        avr_error("Can't open '%s'", name.c_str());
+    buffer.reserve(btraceFlushSize + 256);
+
+    for(unsigned int i = 0; i < core->GetMemRegisterSize(); i++) {
+        RAM *r = dynamic_cast<RAM *>(core->rw[i]);
+        if(r == NULL)
+            avr_error("binary trace: core register r%u isn't a RAM cell", i);
+        regs.push_back(r->GetValueAddress());
+        lastRegs.push_back(*r->GetValueAddress());
+    }
+    lastSreg = *(core->status);
+    lastSp = core->stack->GetStackPointer();
+
+    buffer.insert(buffer.end(), btraceMagic, btraceMagic + sizeof(btraceMagic));
+    Put(btraceVersion);
+    PutString(core->GetDeviceName());
+    PutString(core->GetFname());
+    PutVarint(period);
+    PutVarint(lastRegs.size());
+    buffer.insert(buffer.end(), lastRegs.begin(), lastRegs.end());
+    Put(lastSreg);
+    PutVarint(lastSp);
+    PutVarint(nextPc);
+}
+
+BinaryTrace::~BinaryTrace() {
+    Put(BinaryTraceRecord::END | (lineEnded ? BT_NEWLINE : 0));
+    Flush();
+    out.close();
+}
+
+void BinaryTrace::PutVarint(unsigned long long v) {
+    while(v >= 0x80) {
+        Put((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    Put(v);
+}
+
+void BinaryTrace::PutSigned(long long v) {
+    PutVarint(((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+}
+
+void BinaryTrace::PutString(const string &s) {
+    PutVarint(s.size());
+    buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+void BinaryTrace::Flush(void) {
+    out.write((const char *)&buffer[0], buffer.size());
+    buffer.clear();
+}
+
+void BinaryTrace::Line(unsigned long long cycles, SystemClockOffset time, unsigned int pc) {
+    unsigned long long dc = cycles - lastCycles;
+    long long dt = time - (lastTime + (SystemClockOffset)dc * period);
+    unsigned char tag = BinaryTraceRecord::LINE;
+    if(lineEnded)
+        tag |= BT_NEWLINE;
+    if(pc != nextPc)
+        tag |= BT_PC;
+    if(dt != 0)
+        tag |= BT_TIME;
+    tag |= (dc < 3 ? dc : 3) << 6;
+    Put(tag);
+    if(dc >= 3)
+        PutVarint(dc);
+    if(pc != nextPc)
+        PutSigned((long long)pc - nextPc);
+    if(dt != 0)
+        PutSigned(dt);
+    lastCycles = cycles;
+    lastTime = time;
+    nextPc = pc + 1;
+    lineEnded = false;
+    if(buffer.size() >= btraceFlushSize)
+        Flush();
+}
+
+void BinaryTrace::PutChanges(unsigned char kind) {
+    unsigned char changed[64];
+    unsigned int count = 0;
+    for(unsigned int i = 0; i < regs.size(); i++) {
+        unsigned char v = *regs[i];
+        if(v != lastRegs[i]) {
+            lastRegs[i] = v;
+            changed[count++] = i;
+            changed[count++] = v;
+        }
+    }
+    count /= 2;
+    unsigned char sreg = *(core->status);
+    unsigned long sp = core->stack->GetStackPointer();
+
+    unsigned char tag = kind;
+    if(sreg != lastSreg)
+        tag |= BT_SREG;
+    if(sp != lastSp)
+        tag |= BT_SP;
+    tag |= (count < 7 ? count : 7) << 5;
+    Put(tag);
+    if(count >= 7)
+        PutVarint(count);
+    buffer.insert(buffer.end(), changed, changed + 2 * count);
+    if(sreg != lastSreg)
+        Put(sreg);
+    if(sp != lastSp)
+        PutSigned((long long)sp - (long long)lastSp);
+    lastSreg = sreg;
+    lastSp = sp;
+}
+
+void BinaryTrace::Execute(void) {
+    PutChanges(BinaryTraceRecord::EXEC);
+}
+
+void BinaryTrace::Irq(unsigned int addr, unsigned int vector) {
+    PutChanges(BinaryTraceRecord::IRQ);
+    PutVarint(addr);
+    PutVarint(vector);
+}
+
+void BinaryTrace::Text(const string &text) {
+    Put(BinaryTraceRecord::TEXT);
+    PutString(text);
+}
+
+void BinaryTrace::Sleep(unsigned long long count) {
+    Put(BinaryTraceRecord::SLEEP);
+    PutVarint(count);
+}
+
+BinaryTraceReader::BinaryTraceReader(const string &name):
+    lastCycles(0),
+    lastTime(0)
+{
+    in.open(name.c_str(), ios::in | ios::binary);
+    if(!in.is_open())
+        avr_error("Can't open '%s'", name.c_str());
+
+    char magic[sizeof(btraceMagic)];
+    in.read(magic, sizeof(magic));
+    if(!in || memcmp(magic, btraceMagic, sizeof(magic)) != 0)
+        avr_error("'%s' isn't a binary trace file", name.c_str());
+    if(Get() != btraceVersion)
+        avr_error("'%s': unsupported binary trace version", name.c_str());
+
+    deviceName = GetString();
+    programName = GetString();
+    period = GetVarint();
+    regs.resize(GetVarint());
+    for(size_t i = 0; i < regs.size(); i++)
+        regs[i] = Get();
+    sreg = Get();
+    sp = GetVarint();
+    lastSp = sp;
+    nextPc = GetVarint();
+}
+
+int BinaryTraceReader::Get(void) {
+    int c = in.get();
+    if(c == EOF)
+        avr_error("binary trace: unexpected end of file");
+    return c;
+}
+
+unsigned long long BinaryTraceReader::GetVarint(void) {
+    unsigned long long v = 0;
+    for(int shift = 0; ; shift += 7) {
+        int c = Get();
+        v |= (unsigned long long)(c & 0x7f) << shift;
+        if((c & 0x80) == 0)
+            return v;
+    }
+}
+
+long long BinaryTraceReader::GetSigned(void) {
+    unsigned long long v = GetVarint();
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+string BinaryTraceReader::GetString(void) {
+    string s(GetVarint(), ' ');
+    for(size_t i = 0; i < s.size(); i++)
+        s[i] = Get();
+    return s;
+}
+
+void BinaryTraceReader::GetChanges(int tag, BinaryTraceRecord &rec) {
+    unsigned long long count = (tag >> 5) & 7;
+    if(count == 7)
+        count = GetVarint();
+    rec.regs.resize(2 * count);
+    for(size_t i = 0; i < rec.regs.size(); i++)
+        rec.regs[i] = Get();
+    rec.hasSreg = (tag & BT_SREG) != 0;
+    if(rec.hasSreg)
+        rec.sreg = Get();
+    rec.hasSp = (tag & BT_SP) != 0;
+    if(rec.hasSp) {
+        lastSp += GetSigned();
+        rec.sp = lastSp;
+    }
+}
+
+bool BinaryTraceReader::Next(BinaryTraceRecord &rec) {
+    int tag = in.get();
+    if(tag == EOF)
+        return false;
+    rec.kind = tag & 7;
+    switch(rec.kind) {
+        case BinaryTraceRecord::LINE: {
+            unsigned long long dc = tag >> 6;
+            if(dc == 3)
+                dc = GetVarint();
+            rec.newLine = (tag & BT_NEWLINE) != 0;
+            rec.pc = nextPc;
+            if(tag & BT_PC)
+                rec.pc += GetSigned();
+            rec.cycles = lastCycles + dc;
+            rec.time = lastTime + (SystemClockOffset)dc * period;
+            if(tag & BT_TIME)
+                rec.time += GetSigned();
+            lastCycles = rec.cycles;
+            lastTime = rec.time;
+            nextPc = rec.pc + 1;
+            break;
+        }
+
+        case BinaryTraceRecord::EXEC:
+            GetChanges(tag, rec);
+            break;
+
+        case BinaryTraceRecord::IRQ:
+            GetChanges(tag, rec);
+            rec.pc = GetVarint();
+            rec.vector = GetVarint();
+            break;
+
+        case BinaryTraceRecord::TEXT:
+            rec.text = GetString();
+            break;
+
+        case BinaryTraceRecord::SLEEP:
+            rec.cycles = GetVarint();
+            break;
+
+        case BinaryTraceRecord::END:
+            rec.newLine = (tag & BT_NEWLINE) != 0;
+            break;
+
+        default:
+            avr_error("binary trace: unknown record 0x%x", tag);
+    }
+    return true;
+}
+
+BinaryTraceDecoder::BinaryTraceDecoder(BinaryTraceReader &r, AvrDevice *c, ostream *o):
+    reader(r),
+    core(c),
+    out(o),
+    nullout(NULL),
+    regs(r.regs),
+    sreg(r.sreg),
+    sp(r.sp)
+{
+    core->SetClockFreq(reader.period);
+    core->trace_on = true;
+}
+
+void BinaryTraceDecoder::Restore(void) {
+    for(unsigned int i = 0; i < regs.size(); i++)
+        core->SetCoreReg(i, regs[i]);
+    *(core->status) = sreg;
+    core->stack->SetStackPointer(sp);
+}
+
+void BinaryTraceDecoder::Apply(const BinaryTraceRecord &rec) {
+    for(size_t i = 0; i < rec.regs.size(); i += 2)
+        regs[rec.regs[i]] = rec.regs[i + 1];
+    if(rec.hasSreg)
+        sreg = rec.sreg;
+    if(rec.hasSp)
+        sp = rec.sp;
+}
+
+void BinaryTraceDecoder::Run(void) {
+    BinaryTraceRecord rec;
+    unsigned long long cycles = 0;
+    SystemClockOffset time = 0;
+    unsigned int pc = 0;
+    bool show = false;
+    while(reader.Next(rec)) {
+        switch(rec.kind) {
+            case BinaryTraceRecord::LINE:
+                if(rec.newLine && show)
+                    *out << endl;
+                cycles = rec.cycles;
+                time = rec.time;
+                pc = rec.pc;
+                show = Match(pc);
+                CurrentConsoleHandler().SetTraceStream(show ? out : &nullout);
+                core->cPC = pc;
+                core->TraceHeader(cycles, time);
+                break;
+
+            case BinaryTraceRecord::EXEC: {
+                Restore();
+                core->PC = pc;
+                DecodedInstruction *de = core->Flash->GetInstruction(pc);
+                const ios::fmtflags ff(traceOut.flags());
+                const streamsize width = traceOut.width();
+                traceOut.width(12);
+                traceOut.setf(ios::left);
+                de->Trace();
+                traceOut.width(width);
+                traceOut.flags(ff);
+                Apply(rec);
+                break;
+            }
+
+            case BinaryTraceRecord::IRQ: {
+                traceOut << "IRQ DETECTED: VectorAddr: " << rec.pc;
+                Restore();
+                core->PC = pc;
+                core->irqSystem->IrqHandlerStarted(rec.vector);
+                Funktor* fkt = new IrqFunktor(core->irqSystem, &HWIrqSystem::IrqHandlerFinished, rec.vector);
+                core->stack->SetReturnPoint(core->stack->GetStackPointer(), fkt);
+                core->stack->PushAddr(pc);
+                Apply(rec);
+                break;
+            }
+
+            case BinaryTraceRecord::TEXT:
+                traceOut << rec.text;
+                break;
+
+            case BinaryTraceRecord::SLEEP:
+                // one line for each sleeping cycle, like the text trace
+                traceOut << "CPU sleeping ";
+                for(unsigned long long i = 1; i < rec.cycles; i++) {
+                    traceOut << endl;
+                    core->TraceHeader(cycles + i, time + (SystemClockOffset)i * reader.period);
+                    traceOut << "CPU sleeping ";
+                }
+                break;
+
+            case BinaryTraceRecord::END:
+                if(rec.newLine && show)
+                    *out << endl;
+                break;
+        }
+    }
+    CurrentConsoleHandler().StopTrace();
+}
+
+// EOF
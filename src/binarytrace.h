@@ -0,0 +1,194 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef BINARYTRACE_H_INCLUDED
+#define BINARYTRACE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <ostream>
+
+#include "systemclocktypes.h"
+
+class AvrDevice;
+
+/** Records of a binary instruction trace, see BinaryTrace.
+
+    A record starts with a tag byte, bits 0-2 give the kind. For kind LINE
+    bit 3 tells, that the line before has ended, bit 4, that a PC offset
+    follows (otherwise PC is last PC + 1) and bit 5, that a time offset
+    follows (otherwise time is last time + cycles * clock period). Bits 6-7
+    hold the cycle delta, 3 means, that the delta follows as varint.
+
+    For kinds EXEC and IRQ bit 3 tells, that SREG follows, bit 4, that a SP
+    offset follows and bits 5-7 hold the count of changed core registers, 7
+    means, that the count follows as varint. Then follow the register number
+    and value pairs. All numbers are stored as LEB128 varint, signed ones
+    zigzag encoded. */
+struct BinaryTraceRecord {
+
+    enum Kind {
+        LINE,  //!< start of a trace line, see AvrDevice::TraceHeader
+        EXEC,  //!< instruction on line address executed, with changed registers
+        TEXT,  //!< text message, written to trace as it is
+        SLEEP, //!< count of cycles, the core was sleeping
+        IRQ,   //!< interrupt handler entered, with changed registers
+        END    //!< end of trace
+    };
+
+    int kind;
+    bool newLine; //!< LINE, END: line before has ended
+    unsigned long long cycles; //!< LINE: total core cycles, SLEEP: count of cycles
+    SystemClockOffset time; //!< LINE: simulation time
+    unsigned int pc; //!< LINE: instruction address (in words), IRQ: vector address
+    unsigned int vector; //!< IRQ: vector number
+    std::vector<unsigned char> regs; //!< EXEC, IRQ: pairs of register number and new value
+    bool hasSreg; //!< EXEC, IRQ: SREG has changed
+    unsigned char sreg; //!< EXEC, IRQ: new SREG
+    bool hasSp; //!< EXEC, IRQ: stack pointer has changed
+    unsigned long sp; //!< EXEC, IRQ: new stack pointer
+    std::string text; //!< TEXT: message
+};
+
+/** Writes a compact binary instruction trace, an alternative for the text
+    trace (option -t), which costs much less time and space. Use
+    simulavr-tracedec to convert it to text.
+
+    For each executed instruction only the cycle, time and PC deltas to the
+    instruction before and the changed core registers, SREG and stack pointer
+    are stored. The instruction text is made up again by the decoder from
+    the program and these register values. */
+class BinaryTrace {
+
+    public:
+        BinaryTrace(const std::string &name, AvrDevice *core);
+        ~BinaryTrace();
+
+        //! Starts a new trace line for instruction at pc
+        void Line(unsigned long long cycles, SystemClockOffset time, unsigned int pc);
+        //! Ends a trace line, like SystemConsoleHandler::TraceNextLine
+        void EndLine(void) { lineEnded = true; }
+        //! Records the register changes of the instruction on line address
+        void Execute(void);
+        //! Records entry to interrupt handler at addr with vector number
+        void Irq(unsigned int addr, unsigned int vector);
+        //! Records a text message
+        void Text(const std::string &text);
+        //! Records, that the core was sleeping for count cycles
+        void Sleep(unsigned long long count);
+
+    private:
+        std::ofstream out;
+        std::vector<unsigned char> buffer;
+        AvrDevice *core;
+        std::vector<unsigned char *> regs; //!< direct pointers to core register values
+        std::vector<unsigned char> lastRegs;
+        unsigned char lastSreg;
+        unsigned long lastSp;
+        unsigned long long lastCycles;
+        SystemClockOffset lastTime;
+        SystemClockOffset period;
+        unsigned int nextPc;
+        bool lineEnded;
+
+        void Put(unsigned char b) { buffer.push_back(b); }
+        void PutVarint(unsigned long long v);
+        void PutSigned(long long v);
+        void PutString(const std::string &s);
+        void PutChanges(unsigned char kind);
+        void Flush(void);
+};
+
+/** Reads a binary instruction trace, written by BinaryTrace */
+class BinaryTraceReader {
+
+    public:
+        //! Opens a trace file, aborts, if it isn't a binary trace
+        BinaryTraceReader(const std::string &name);
+
+        //! Reads the next record, returns false on end of file
+        bool Next(BinaryTraceRecord &rec);
+
+        std::string deviceName; //!< device name of traced core
+        std::string programName; //!< loaded ELF file of traced core
+        SystemClockOffset period; //!< clock period in ns
+        std::vector<unsigned char> regs; //!< core registers on trace start
+        unsigned char sreg; //!< SREG on trace start
+        unsigned long sp; //!< stack pointer on trace start
+
+    private:
+        std::ifstream in;
+        unsigned long long lastCycles;
+        SystemClockOffset lastTime;
+        unsigned long lastSp;
+        unsigned int nextPc;
+
+        int Get(void);
+        unsigned long long GetVarint(void);
+        long long GetSigned(void);
+        std::string GetString(void);
+        void GetChanges(int tag, BinaryTraceRecord &rec);
+};
+
+/** Converts a binary instruction trace to the text format of option -t
+
+    The instruction text is made by the Trace() methods of the decoder, like
+    on a text trace. They run on a second core, which has loaded the same
+    program. Before each instruction its core registers, SREG and stack
+    pointer are set to the recorded values, so that register values, memory
+    accesses and stack operations are shown as on the traced core. Messages
+    from peripherals, like "interrupt on index ... is pending", aren't part
+    of a binary trace. */
+class BinaryTraceDecoder {
+
+    public:
+        //! core has to hold the traced program, text is written to out
+        BinaryTraceDecoder(BinaryTraceReader &reader, AvrDevice *core, std::ostream *out);
+        virtual ~BinaryTraceDecoder() {}
+
+        //! Converts all records till end of trace, uses console of current SimulationContext
+        void Run(void);
+
+    protected:
+        //! Returns true, if the line for pc (in words) is to write, default is every line
+        virtual bool Match(unsigned int pc) { return true; }
+
+    private:
+        BinaryTraceReader &reader;
+        AvrDevice *core;
+        std::ostream *out;
+        std::ostream nullout;
+        std::vector<unsigned char> regs; //!< core registers of traced core
+        unsigned char sreg; //!< SREG of traced core
+        unsigned long sp; //!< stack pointer of traced core
+
+        //! Sets registers, SREG and stack pointer of traced core to core
+        void Restore(void);
+        //! Takes the changes of a EXEC or IRQ record
+        void Apply(const BinaryTraceRecord &rec);
+};
+
+#endif
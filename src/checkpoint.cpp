@@ -0,0 +1,286 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <typeinfo>
+
+#include "checkpoint.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+#include "flash.h"
+#include "hardware.h"
+#include "hweeprom.h"
+#include "hwport.h"
+#include "hwstack.h"
+#include "irqsystem.h"
+#include "rwmem.h"
+
+using namespace std;
+
+static const char checkpointMagic[] = "simulavr checkpoint";
+
+const unsigned char Checkpoint::version;
+
+Checkpoint::Checkpoint():
+    pos(0),
+    saving(false),
+    core(NULL)
+{}
+
+void Checkpoint::Save(AvrDevice *c) {
+    saving = true;
+    core = c;
+    data.assign(checkpointMagic, checkpointMagic + sizeof(checkpointMagic));
+    data.push_back(version);
+    Device();
+    core = NULL;
+}
+
+void Checkpoint::Restore(AvrDevice *c) {
+    if(data.empty())
+        avr_error("Checkpoint: nothing saved to restore");
+    if(data.size() <= sizeof(checkpointMagic) ||
+       memcmp(&data[0], checkpointMagic, sizeof(checkpointMagic)) != 0 ||
+       data[sizeof(checkpointMagic)] != version)
+        avr_error("Checkpoint: unsupported checkpoint version");
+    saving = false;
+    core = c;
+    pos = sizeof(checkpointMagic) + 1;
+    Device();
+    core = NULL;
+}
+
+void Checkpoint::Write(const string &filename) const {
+    ofstream out(filename.c_str(), ios::out | ios::binary);
+    if(!out.is_open())
+        avr_error("Can't open '%s'", filename.c_str());
+    out.write((const char *)&data[0], data.size());
+    if(!out)
+        avr_error("Can't write '%s'", filename.c_str());
+}
+
+void Checkpoint::Read(const string &filename) {
+    ifstream in(filename.c_str(), ios::in | ios::binary);
+    if(!in.is_open())
+        avr_error("Can't open '%s'", filename.c_str());
+    data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+    if(data.size() <= sizeof(checkpointMagic) ||
+       memcmp(&data[0], checkpointMagic, sizeof(checkpointMagic)) != 0)
+        avr_error("'%s' isn't a checkpoint file", filename.c_str());
+    if(data[sizeof(checkpointMagic)] != version)
+        avr_error("'%s': unsupported checkpoint version", filename.c_str());
+}
+
+unsigned char Checkpoint::GetByte(void) {
+    if(pos >= data.size())
+        avr_error("Checkpoint: unexpected end of data");
+    return data[pos++];
+}
+
+void Checkpoint::Integer(long long &v) {
+    if(saving) {
+        // zigzag, so that small negative values are short too
+        unsigned long long u = ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+        while(u >= 0x80) {
+            data.push_back((u & 0x7f) | 0x80);
+            u >>= 7;
+        }
+        data.push_back(u);
+    } else {
+        unsigned long long u = 0;
+        for(int shift = 0; ; shift += 7) {
+            unsigned char c = GetByte();
+            u |= (unsigned long long)(c & 0x7f) << shift;
+            if((c & 0x80) == 0)
+                break;
+        }
+        v = (long long)(u >> 1) ^ -(long long)(u & 1);
+    }
+}
+
+void Checkpoint::Real(double &v) {
+    unsigned long long u = 0;
+    if(saving) {
+        memcpy(&u, &v, sizeof(u));
+        for(int i = 0; i < 8; i++)
+            data.push_back((u >> (8 * i)) & 0xff);
+    } else {
+        for(int i = 0; i < 8; i++)
+            u |= (unsigned long long)GetByte() << (8 * i);
+        memcpy(&v, &u, sizeof(v));
+    }
+}
+
+void Checkpoint::String(string &s) {
+    unsigned long long size = s.size();
+    Value(size);
+    if(saving)
+        data.insert(data.end(), s.begin(), s.end());
+    else {
+        s.resize(size);
+        for(size_t i = 0; i < size; i++)
+            s[i] = GetByte();
+    }
+}
+
+void Checkpoint::Block(unsigned char *p, size_t size) {
+    unsigned long long saved = size;
+    Value(saved);
+    if(saving)
+        data.insert(data.end(), p, p + size);
+    else {
+        if(saved != size || data.size() - pos < size)
+            avr_error("Checkpoint: memory block has %llu bytes, expected %lu", saved, (unsigned long)size);
+        memcpy(p, &data[pos], size);
+        pos += size;
+    }
+}
+
+void Checkpoint::Tag(const char *name) {
+    string s(name);
+    String(s);
+    if(!saving && s != name)
+        avr_error("Checkpoint: '%s' found, but '%s' expected", s.c_str(), name);
+}
+
+void Checkpoint::Part(Hardware *&hw) {
+    long long index = -1;
+    if(saving && hw != NULL) {
+        vector<Hardware *>::iterator i = find(core->hwResetList.begin(), core->hwResetList.end(), hw);
+        if(i == core->hwResetList.end())
+            avr_error("Checkpoint: hardware part doesn't belong to device");
+        index = i - core->hwResetList.begin();
+    }
+    Value(index);
+    if(!saving) {
+        if(index >= (long long)core->hwResetList.size())
+            avr_error("Checkpoint: hardware part %lld doesn't exist", index);
+        hw = (index < 0) ? NULL : core->hwResetList[index];
+    }
+}
+
+void Checkpoint::Unsupported(const Hardware *hw) {
+    // a checkpoint without the state of a part would be restored silently wrong
+    if(saving)
+        avr_error("Checkpoint: state of hardware %s can't be saved", typeid(*hw).name());
+}
+
+void Checkpoint::Device(void) {
+    // device type, restore works only on same device
+    string name = core->GetDeviceName();
+    String(name);
+    if(!saving && name != core->GetDeviceName())
+        avr_error("Checkpoint: saved from device '%s', can't restore to '%s'",
+                  name.c_str(), core->GetDeviceName().c_str());
+    unsigned long long sizes[] = {
+        core->GetMemTotalSize(),
+        core->GetMemIRamSize(),
+        core->GetMemERamSize(),
+        core->Flash->GetSize(),
+        core->eeprom ? core->eeprom->GetSize() : 0,
+        core->hwResetList.size()
+    };
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        unsigned long long size = sizes[i];
+        Value(size);
+        if(size != sizes[i])
+            avr_error("Checkpoint: device '%s' is configured different from saved one", name.c_str());
+    }
+
+    // simulation time, all other times depend on it
+    Tag("clock");
+    SystemClock &clock = core->GetSystemClock();
+    SystemClockOffset now = clock.GetCurrentTime();
+    Value(now);
+    if(!saving)
+        clock.SetCurrentTime(now);
+
+    Tag("core");
+    Value(core->PC);
+    Value(core->cPC);
+    Value(core->PC_size);
+    Value(core->cpuCycles);
+    Value(core->totalCpuCycles);
+    Value(core->clockCycles);
+    Value(core->hwCycleCalls);
+    Value(core->clockFreq);
+    Value(core->sleeping);
+    Value(core->deferIrq);
+    Value(core->newIrqPc);
+    Value(core->actualIrqVector);
+    if(core->sleepControl != NULL)
+        core->sleepControl->CheckpointState(*this);
+    core->Flash->CheckpointState(*this);
+    core->fuses->CheckpointState(*this);
+    core->lockbits->CheckpointState(*this);
+
+    // register file, IO space and SRAM
+    Tag("memory");
+    for(unsigned int i = 0; i < core->GetMemTotalSize(); i++)
+        core->rw[i]->CheckpointState(*this);
+
+    // ports first: driving pins on restore can notify other parts, which
+    // state is restored afterwards
+    Tag("hardware");
+    for(size_t i = 0; i < core->hwResetList.size(); i++)
+        if(dynamic_cast<HWPort *>(core->hwResetList[i]) != NULL)
+            core->hwResetList[i]->CheckpointState(*this);
+    for(size_t i = 0; i < core->hwResetList.size(); i++)
+        if(dynamic_cast<HWPort *>(core->hwResetList[i]) == NULL)
+            core->hwResetList[i]->CheckpointState(*this);
+
+    Tag("cycle list");
+    unsigned long long count = core->hwCycleList.size();
+    Value(count);
+    if(!saving)
+        core->hwCycleList.resize(count);
+    for(size_t i = 0; i < count; i++)
+        Part(core->hwCycleList[i]);
+    if(!saving)
+        core->hwCycleIndex = count;
+
+    Tag("stack");
+    core->stack->CheckpointState(*this);
+
+    Tag("irq");
+    core->irqSystem->CheckpointState(*this);
+
+    // next step of core on time table
+    Tag("schedule");
+    SystemClockOffset due = clock.GetScheduledTime(core);
+    Value(due);
+    if(!saving) {
+        clock.Remove(core);
+        if(due >= 0)
+            clock.Add(core, due - now);
+    }
+
+    Tag("end");
+}
+
+// EOF
@@ -0,0 +1,145 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "systemclocktypes.h"
+#include "systemclock.h"
+
+class AvrDevice;
+class Hardware;
+
+/** Saved state of a running AvrDevice, to continue a simulation later or to
+    start many simulations from the same state, e.g. after a long boot.
+
+    Save takes the state of core, register file, IO and SRAM space, flash,
+    EEPROM, fuses, peripherals, interrupt system, stack with return points
+    and the scheduling of the device and its timers on SystemClock. Restore
+    sets this state on a device of the same type, for example a new one made
+    by AvrFactory, and sets the time of its SystemClock. Symbols, break and
+    exit points aren't part of the state, load the program before, if they
+    are needed. Restore of flash is cheap, if the device holds the same
+    program already, so a checkpoint in memory can be restored fast many
+    times.
+
+    The state outside the device (nets, serial ports, other members of
+    SystemClock) isn't saved. Save fails, if a part of the device doesn't
+    support checkpoints.
+
+    A checkpoint is stored by Write in a file with a version number. Values
+    are stored as varints (zigzag encoded, LEB128) and sections of the state
+    are marked by tags, so Restore detects a checkpoint of an other device
+    or of an other format version.
+
+    Each part of the device saves and restores its state with one method
+    CheckpointState(Checkpoint &cp), which calls cp.Value for every member,
+    that holds state. On Save the values are written, on Restore they are
+    overwritten. If a part has to do more on restore, e.g. to drive its
+    pins, it checks IsSaving. */
+class Checkpoint {
+
+    public:
+        //! Format version, incremented on every change of the format
+        static const unsigned char version = 1;
+
+        Checkpoint();
+
+        //! Saves state of core, replaces content of checkpoint
+        void Save(AvrDevice *core);
+        //! Sets state of core from checkpoint, core has to be of the same type
+        void Restore(AvrDevice *core);
+        //! Writes checkpoint to file
+        void Write(const std::string &filename) const;
+        //! Reads checkpoint from file, written by Write
+        void Read(const std::string &filename);
+        //! Returns size of checkpoint in bytes
+        size_t GetSize(void) const { return data.size(); }
+
+#ifndef SWIG
+        //! Returns true on Save, false on Restore
+        bool IsSaving(void) const { return saving; }
+
+        //! Saves or restores a value
+        void Value(bool &v) { long long i = v; Integer(i); v = (i != 0); }
+        void Value(char &v) { long long i = v; Integer(i); v = (char)i; }
+        void Value(signed char &v) { long long i = v; Integer(i); v = (signed char)i; }
+        void Value(unsigned char &v) { long long i = v; Integer(i); v = (unsigned char)i; }
+        void Value(short &v) { long long i = v; Integer(i); v = (short)i; }
+        void Value(unsigned short &v) { long long i = v; Integer(i); v = (unsigned short)i; }
+        void Value(int &v) { long long i = v; Integer(i); v = (int)i; }
+        void Value(unsigned int &v) { long long i = v; Integer(i); v = (unsigned int)i; }
+        void Value(long &v) { long long i = v; Integer(i); v = (long)i; }
+        void Value(unsigned long &v) { long long i = v; Integer(i); v = (unsigned long)i; }
+        void Value(long long &v) { Integer(v); }
+        void Value(unsigned long long &v) { long long i = (long long)v; Integer(i); v = (unsigned long long)i; }
+        void Value(float &v) { double d = v; Real(d); v = (float)d; }
+        void Value(double &v) { Real(v); }
+        //! Saves or restores a value of an enum type
+        template<class E> void Enum(E &e) { long long i = e; Integer(i); e = (E)i; }
+        //! Saves or restores values of an array
+        template<class T> void Array(T *p, size_t count) {
+            for(size_t i = 0; i < count; i++)
+                Value(p[i]);
+        }
+        //! Saves or restores a memory block, restore checks the size
+        void Block(unsigned char *p, size_t size);
+        //! Saves or restores a section tag, restore fails, if it doesn't match
+        void Tag(const char *name);
+        //! Saves or restores, whether and when a timer is scheduled
+        template<class P> void Timer(SystemClockTimer<P> &t) {
+            SystemClockOffset due = t.GetDueTime();
+            Value(due);
+            if(!saving) {
+                if(due < 0)
+                    t.Cancel();
+                else
+                    t.StartAt(due);
+            }
+        }
+        //! Saves or restores a pointer to a hardware part of core as index in reset list
+        void Part(Hardware *&hw);
+        //! Called by a hardware part, which doesn't support checkpoints, fails on Save
+        void Unsupported(const Hardware *hw);
+#endif
+
+    private:
+        std::vector<unsigned char> data;
+        size_t pos; //!< read position on restore
+        bool saving;
+        AvrDevice *core; //!< device on Save and Restore
+
+        void Integer(long long &v);
+        void Real(double &v);
+        void String(std::string &s);
+        unsigned char GetByte(void);
+        //! Saves or restores the complete state of core
+        void Device(void);
+};
+
+#endif
@@ -0,0 +1,391 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include <stdlib.h>
+
+#include "batch.h"
+
+#include "../avrdevice.h"
+#include "../avrfactory.h"
+#include "../avrreadelf.h"
+#include "../jit.h"
+#include "../avrsignature.h"
+#include "../simulationcontext.h"
+#include "../specialmem.h"
+#include "../string2.h"
+#include "../systemclock.h"
+#include "../ui/serialcfg.h"
+
+using namespace std;
+
+//! Exit code of a aborted job, the same as a shell reports for a process killed by SIGABRT
+static const int batchAbortCode = 134;
+
+//! One line of a batch manifest and its result
+struct BatchJob {
+    string name;
+    string device;
+    string elfname;
+    unsigned long long maxRunTime;
+    int expected;
+
+    vector<SerialCfg *> serialRxCfgs;
+    vector<SerialCfg *> serialTxCfgs;
+    unsigned long readFromPipeOffset;
+    unsigned long writeToPipeOffset;
+    string readFromPipeFileName;
+    string writeToPipeFileName;
+    unsigned long writeToAbort;
+    unsigned long writeToExit;
+    vector<string> terminationArgs;
+    unsigned long long fcpu;
+    string logname;
+
+    string status;   //!< timeout, stopped, interrupted, exit, abort or error
+    int exitCode;    //!< exit code, the job would have as simulavr process
+    unsigned long long cycles;
+    SystemClockOffset simTime;
+    double hostTime; //!< wall clock time for load and run in seconds
+    string message;  //!< error message
+
+    BatchJob(): maxRunTime(0), expected(0),
+                readFromPipeOffset(0x21), writeToPipeOffset(0x20),
+                writeToAbort(0), writeToExit(0), fcpu(0),
+                exitCode(0), cycles(0), simTime(0), hostTime(0) {}
+};
+
+//! ELF file, read once by the first job, which needs it
+struct BatchImage {
+    once_flag read;
+    ELFImage image;
+};
+
+//! Abort register, which remembers, that the job was aborted
+/*! A abort with code 0 throws the same exception as a exit with code 0. */
+class BatchAbort: public RWAbort {
+    public:
+        BatchAbort(TraceValueRegister *registry, bool &a):
+            RWAbort(registry, "ABORT"), aborted(a) {}
+    protected:
+        unsigned char get() const { aborted = true; return RWAbort::get(); }
+        void set(unsigned char c) { aborted = true; RWAbort::set(c); }
+    private:
+        bool &aborted;
+};
+
+static void ManifestError(const string &manifestname, int line, const string &msg) {
+    cerr << manifestname << ":" << line << ": " << msg << endl;
+    exit(1);
+}
+
+static bool ParseOffsetFile(const string &arg, unsigned long &offset, string &filename) {
+    char *end;
+    if(!StringToUnsignedLong(arg.c_str(), &offset, &end, 16) || *end != ',' || end[1] == 0)
+        return false;
+    filename = end + 1;
+    return true;
+}
+
+static SerialCfg *ParseSerial(const string &arg, bool tx) {
+    vector<char> buf(arg.begin(), arg.end());
+    buf.push_back(0);
+    return tx ? SerialCfg::parseTx(&buf[0]) : SerialCfg::parseRx(&buf[0]);
+}
+
+static void ParseJobOption(BatchJob &job, const string &opt, const string &manifestname, int line) {
+    string::size_type eq = opt.find('=');
+    if(opt.compare(0, 2, "--") != 0 || eq == string::npos || eq + 1 == opt.size())
+        ManifestError(manifestname, line, "option '" + opt + "' isn't --<option>=<value>");
+    string key = opt.substr(2, eq - 2);
+    string value = opt.substr(eq + 1);
+
+    if(key == "serialrx")
+        job.serialRxCfgs.push_back(ParseSerial(value, false));
+    else if(key == "serialtx")
+        job.serialTxCfgs.push_back(ParseSerial(value, true));
+    else if(key == "readfrompipe") {
+        if(!ParseOffsetFile(value, job.readFromPipeOffset, job.readFromPipeFileName))
+            ManifestError(manifestname, line, "readfrompipe has to be <offset>,<file>");
+    } else if(key == "writetopipe") {
+        if(!ParseOffsetFile(value, job.writeToPipeOffset, job.writeToPipeFileName))
+            ManifestError(manifestname, line, "writetopipe has to be <offset>,<file>");
+    } else if(key == "writetoabort") {
+        if(!StringToUnsignedLong(value.c_str(), &job.writeToAbort, NULL, 16))
+            ManifestError(manifestname, line, "writetoabort is not a number");
+    } else if(key == "writetoexit") {
+        if(!StringToUnsignedLong(value.c_str(), &job.writeToExit, NULL, 16))
+            ManifestError(manifestname, line, "writetoexit is not a number");
+    } else if(key == "terminate")
+        job.terminationArgs.push_back(value);
+    else if(key == "cpufrequency") {
+        if(!StringToUnsignedLongLong(value.c_str(), &job.fcpu, NULL, 10) || job.fcpu == 0)
+            ManifestError(manifestname, line, "cpufrequency is not a number or zero");
+    } else if(key == "log")
+        job.logname = value;
+    else
+        ManifestError(manifestname, line, "unknown option '" + opt + "'");
+}
+
+static void ReadManifest(const string &manifestname, vector<BatchJob> &jobs) {
+    ifstream in(manifestname.c_str());
+    if(!in.is_open()) {
+        cerr << "Can't open batch manifest '" << manifestname << "'" << endl;
+        exit(1);
+    }
+
+    string text;
+    for(int line = 1; getline(in, text); line++) {
+        istringstream fields(text);
+        BatchJob job;
+        string maxRunTime, expected;
+        if(!(fields >> job.name) || job.name[0] == '#')
+            continue;
+        if(!(fields >> job.device >> job.elfname >> maxRunTime >> expected))
+            ManifestError(manifestname, line,
+                          "expected <name> <device> <elf file> <max run time> <expected exit code>");
+        if(!AvrFactory::isSupported(job.device))
+            ManifestError(manifestname, line, "device " + job.device + " not supported");
+        if(!StringToUnsignedLongLong(maxRunTime.c_str(), &job.maxRunTime, NULL, 10))
+            ManifestError(manifestname, line, "max run time is not a number");
+        long code;
+        if(!StringToLong(expected.c_str(), &code, NULL, 10))
+            ManifestError(manifestname, line, "expected exit code is not a number");
+        job.expected = (int)code;
+
+        string opt;
+        while(fields >> opt)
+            ParseJobOption(job, opt, manifestname, line);
+        jobs.push_back(job);
+    }
+}
+
+//! Creates the device for a job, loads the program and runs it
+static void RunJob(BatchJob &job, BatchImage &elf, const string &enginename) {
+    ofstream log;
+    ostream nullout(NULL);
+    ostream *out = &nullout;
+    if(job.logname != "") {
+        log.open(job.logname.c_str());
+        if(log.is_open())
+            out = &log;
+    }
+
+    SimulationContext context;
+    SystemConsoleHandler &console = context.GetConsole();
+    console.SetUseExit(false);
+    console.SetDebugStream(out);
+    console.SetMessageStream(out);
+    console.SetWarningStream(out);
+    SimulationContext::Scope scope(context);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    AvrDevice *dev = NULL;
+    vector<Net *> serialNets;
+    vector<SimulationMember *> serialParts;
+    bool aborted = false;
+    try {
+        call_once(elf.read, ELFReadImage, job.elfname.c_str(), ref(elf.image));
+
+        dev = AvrFactory::instance().makeDevice(job.device.c_str(), &context);
+        map<string, unsigned int>::iterator sig = AvrNameToSignatureMap.find(job.device);
+        dev->SetDeviceNameAndSignature(job.device,
+                                       sig != AvrNameToSignatureMap.end() ?
+                                           sig->second :
+                                           numeric_limits<unsigned int>::max());
+        if(!dev->SetExecutionEngine(enginename))
+            avr_error("Unknown or unavailable execution engine '%s'", enginename.c_str());
+
+        if(job.readFromPipeFileName != "")
+            dev->ReplaceIoRegister(job.readFromPipeOffset,
+                new RWReadFromFile(dev, "FREAD", job.readFromPipeFileName.c_str()));
+        if(job.writeToPipeFileName != "")
+            dev->ReplaceIoRegister(job.writeToPipeOffset,
+                new RWWriteToFile(dev, "FWRITE", job.writeToPipeFileName.c_str()));
+        if(job.writeToAbort)
+            dev->ReplaceIoRegister(job.writeToAbort, new BatchAbort(dev, aborted));
+        if(job.writeToExit)
+            dev->ReplaceIoRegister(job.writeToExit, new RWExit(dev, "EXIT"));
+
+        dev->Load(elf.image);
+        dev->RegisterSerials(job.serialRxCfgs, job.serialTxCfgs, serialNets, serialParts);
+        dev->Reset(); // reset after load data from file to activate fuses and lockbits
+
+        for(size_t i = 0; i < job.terminationArgs.size(); i++)
+            dev->RegisterTerminationSymbol(job.terminationArgs[i].c_str());
+
+        if(job.fcpu != 0)
+            dev->SetClockFreq((SystemClockOffset)1000000000 / job.fcpu);
+        if(dev->GetClockFreq() == 0) {
+            avr_warning("Clock frequency not given, defaulting to 4000000");
+            dev->SetClockFreq((SystemClockOffset)1000000000 / 4000000);
+        }
+
+        SystemClock &clock = context.GetClock();
+        clock.Add(dev);
+        if(job.maxRunTime == 0)
+            clock.Endless();
+        else
+            clock.Run(job.maxRunTime);
+        if(SystemClock::BreakSignalCaught())
+            job.status = "interrupted";
+        else
+            job.status = context.IsStopped() ? "stopped" : "timeout";
+        job.exitCode = 0;
+    } catch(int code) {
+        if(aborted) {
+            job.status = "abort";
+            job.exitCode = batchAbortCode;
+        } else {
+            job.status = "exit";
+            job.exitCode = code;
+        }
+    } catch(const char *msg) {
+        job.status = "error";
+        job.exitCode = 1;
+        job.message = msg;
+    } catch(...) {
+        job.status = "error";
+        job.exitCode = 1;
+        job.message = "unknown exception";
+    }
+
+    if(dev != NULL) {
+        job.cycles = dev->GetClockCycles();
+        // JIT statistic belongs to the job, it's gone with the device
+        if(dev->GetJit() != NULL)
+            dev->GetJit()->PrintStatistic(*out);
+        delete dev;
+    }
+    // nets and serial parts hold pins of the device, files and a place in
+    // the time table of the context, so they go with the job
+    for(size_t i = 0; i < serialNets.size(); i++)
+        delete serialNets[i];
+    for(size_t i = 0; i < serialParts.size(); i++)
+        delete serialParts[i];
+    job.simTime = context.GetClock().GetCurrentTime();
+    job.hostTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//! Replaces tabs and line ends, so that text fits into a column
+static string Column(const string &s) {
+    string r(s);
+    for(size_t i = 0; i < r.size(); i++)
+        if(r[i] == '\t' || r[i] == '\n' || r[i] == '\r')
+            r[i] = ' ';
+    return r;
+}
+
+int RunBatch(const string &manifestname,
+             const string &resultsname,
+             unsigned int jobs,
+             const string &enginename) {
+    vector<BatchJob> batch;
+    ReadManifest(manifestname, batch);
+
+    // jobs with the same elf file share one image
+    map<string, BatchImage> images;
+    for(size_t i = 0; i < batch.size(); i++)
+        images[batch[i].elfname];
+
+    if(jobs == 0)
+        jobs = thread::hardware_concurrency();
+    if(jobs == 0)
+        jobs = 1;
+    if(jobs > batch.size())
+        jobs = batch.size();
+
+    // SIGINT or SIGTERM stops running jobs and the start of further jobs
+    SystemClock::CatchBreakSignals();
+
+    // each worker takes the next job, which isn't taken yet, until all are done
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for(unsigned int w = 0; w < jobs; w++)
+        workers.push_back(thread([&]() {
+            for(size_t i = next++; i < batch.size() && !SystemClock::BreakSignalCaught(); i = next++)
+                RunJob(batch[i], images.find(batch[i].elfname)->second, enginename);
+        }));
+    for(size_t w = 0; w < workers.size(); w++)
+        workers[w].join();
+
+    for(size_t i = 0; i < batch.size(); i++) {
+        BatchJob &job = batch[i];
+        for(size_t c = 0; c < job.serialRxCfgs.size(); c++)
+            delete job.serialRxCfgs[c];
+        for(size_t c = 0; c < job.serialTxCfgs.size(); c++)
+            delete job.serialTxCfgs[c];
+        if(job.status == "") {
+            job.status = "interrupted";
+            job.message = "not started";
+        }
+    }
+
+    ofstream resultsfile;
+    ostream *results = &cout;
+    if(resultsname != "") {
+        resultsfile.open(resultsname.c_str());
+        if(!resultsfile.is_open()) {
+            cerr << "Can't open results file '" << resultsname << "'" << endl;
+            exit(1);
+        }
+        results = &resultsfile;
+    }
+
+    size_t passed = 0;
+    *results << "name\tstatus\texitcode\texpected\tpass\tcycles\tsimtime_ns\thosttime_s\tmessage" << endl;
+    for(size_t i = 0; i < batch.size(); i++) {
+        const BatchJob &job = batch[i];
+        // a interrupted job didn't reach its end, so it can't pass
+        bool pass = job.status != "interrupted" && job.exitCode == job.expected;
+        if(pass)
+            passed++;
+        *results << Column(job.name) << '\t'
+                 << job.status << '\t'
+                 << job.exitCode << '\t'
+                 << job.expected << '\t'
+                 << (pass ? 1 : 0) << '\t'
+                 << job.cycles << '\t'
+                 << job.simTime << '\t'
+                 << job.hostTime << '\t'
+                 << Column(job.message) << endl;
+    }
+
+    if(resultsname != "")
+        avr_message("Batch: %lu of %lu jobs passed", (unsigned long)passed, (unsigned long)batch.size());
+    return passed == batch.size() ? 0 : 1;
+}
+
+// EOF
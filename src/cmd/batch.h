@@ -0,0 +1,54 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+
+//! Runs all jobs of a batch manifest on threads and writes the results
+/*! Each line of the manifest describes a job:
+
+    <name> <device> <elf file> <max run time in ns> <expected exit code> [options]
+
+    Options are --serialrx, --serialtx, --readfrompipe, --writetopipe,
+    --writetoabort, --writetoexit, --terminate and --cpufrequency, written as
+    --option=value, with the same values as the command line options of
+    simulavr. --log=<file> writes the messages of the job to <file>, otherwise
+    they are discarded. Empty lines and lines starting with # are ignored.
+
+    Every job runs in its own SimulationContext, jobs with the same elf file
+    share the read file. The results, one line for each job, are written as
+    tab separated columns to resultsname, or stdout, if resultsname is empty.
+    SIGINT or SIGTERM stops running jobs and the start of further jobs, these
+    jobs are reported as interrupted and failed.
+    Returns 0, if all jobs ended with the expected exit code, otherwise 1. */
+extern int RunBatch(const std::string &manifestname,
+                    const std::string &resultsname,
+                    unsigned int jobs,
+                    const std::string &enginename);
+
+#endif
+// EOF
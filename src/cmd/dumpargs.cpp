@@ -30,6 +30,7 @@
 #include <stdlib.h>
 
 #include "dumpargs.h"
+#include "config.h"
 #include "../helper.h"
 #include "../avrerror.h"
 #include "../flash.h"
@@ -52,17 +53,21 @@ void SetDumpTraceArgs(const vector<string> &traceopts, AvrDevice *dev) {
                 avr_error("Invalid number of options for 'warnread'.");
             ts = dman->all();
             d = new WarnUnknown(dev);
+#ifdef HAVE_ZLIB
+        } else if (ls[0] == "vcd" || ls[0] == "fst") {
+#else
         } else if (ls[0] == "vcd") {
-            cerr << "vcd'." << endl;
+#endif
+            cerr << ls[0] << "'." << endl;
             if(ls.size() < 3 || ls.size() > 4)
-                avr_error("Invalid number of options for 'vcd'.");
+                avr_error("Invalid number of options for '%s'.", ls[0].c_str());
             cerr << "Reading values to trace from '" << ls[1] << "'." << endl;
         
             ifstream is(ls[1].c_str());
             if(is.is_open() == 0)
                 avr_error("Can't open '%s'", ls[1].c_str());
         
-            cerr << "Output VCD file is '" << ls[2] << "'." << endl;
+            cerr << "Output " << (ls[0] == "vcd" ? "VCD" : "FST") << " file is '" << ls[2] << "'." << endl;
             ts = dman->load(is);
         
             bool rs = false, ws = false;
@@ -76,7 +81,12 @@ void SetDumpTraceArgs(const vector<string> &traceopts, AvrDevice *dev) {
                 } else
                     avr_error("Invalid read/write strobe specifier '%s'", ls[3].c_str());
             }
-            d = new DumpVCD(ls[2], "ns", rs, ws);
+#ifdef HAVE_ZLIB
+            if(ls[0] == "fst")
+                d = new DumpFST(ls[2], rs, ws);
+            else
+#endif
+                d = new DumpVCD(ls[2], "ns", rs, ws);
         } else
             avr_error("Unknown tracer '%s'", ls[0].c_str());
         dman->addDumper(d, ts);
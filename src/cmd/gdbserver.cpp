@@ -362,13 +362,12 @@ void GdbServer::avr_core_flash_write_lo8(int addr, byte val) {
 
 void GdbServer::avr_core_remove_breakpoint(dword pc) {
     avr_debug("GdbServer::avr_core_remove_breakpoint(pc=0x%.8x)", pc);
-    Breakpoints::iterator ii;
-    if ((ii= find(core->BP.begin(), core->BP.end(), pc)) != core->BP.end()) core->BP.erase(ii);
+    core->BP.Remove(pc);
 }
 
 void GdbServer::avr_core_insert_breakpoint(dword pc) {
     avr_debug("GdbServer::avr_core_insert_breakpoint(pc=0x%.8x)", pc);
-    core->BP.push_back(pc);
+    core->BP.Add(pc);
 }
 
 int GdbServer::signal_has_occurred(int signo) {return 0;}
@@ -1556,6 +1555,7 @@ int GdbServer::InternalStep(bool &untilCoreStepFinished, SystemClockOffset *time
 
     } //last core step finished
 
+    core->singleStep = (runMode == GDB_RET_SINGLE_STEP);
     int res=core->Step(untilCoreStepFinished, timeToNextStepIn_ns);
     lastCoreStepFinished=untilCoreStepFinished;
 
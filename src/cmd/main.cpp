@@ -53,6 +53,7 @@ using namespace std;
 #include "ui/lcd.h"
 #include "ui/keyboard.h"
 #include "traceval.h"
+#include "binarytrace.h"
 #include "ui/scope.h"
 #include "string2.h"
 #include "helper.h"
@@ -62,7 +63,18 @@ using namespace std;
 #include "ui/serialrx.h"
 #include "ui/serialtx.h"
 
+#include "checkpoint.h"
 #include "dumpargs.h"
+#include "batch.h"
+
+//! getopt values for long options without short form
+enum {
+    OPT_BATCH = 0x100,
+    OPT_RESULTS,
+    OPT_QUANTUM,
+    OPT_CHECKPOINT_SAVE,
+    OPT_CHECKPOINT_RESTORE
+};
 
 const char *SplitOffsetFile(const char *arg,
                             const char *name,
@@ -110,6 +122,9 @@ const char Usage[] =
     "-l --linestotrace <number>\n"
     "                      maximum number of lines in each trace file.\n"
     "                      0 means endless. Attention: if you use gdb & trace, please use always 0!\n"
+    "-b --binarytrace <file>\n"
+    "                      write a compact binary instruction trace to <file>, use\n"
+    "                      simulavr-tracedec to convert it to the text format of -t\n"
     "-n --nogdbwait        do not wait for gdb connection\n"
     "-F --cpufrequency     set the cpu frequency to <Hz> \n"
     "-s --irqstatistic     prints statistic informations about irq usage after simulation\n"
@@ -139,6 +154,19 @@ const char Usage[] =
     "                      add a special register at IO-offset\n"
     "                      which exits simulator run\n"
     "-C --core-dump <name> dump a core memory image <name> to file on exit\n"
+    "-E --engine <name>    select engine to execute instructions: decoder (default),\n"
+    "                      threaded, block or jit. block executes straight-line code in\n"
+    "                      one step, if no interrupt can get pending meanwhile, and\n"
+    "                      fast-forwards busy-wait loops on side effect free IO.\n"
+    "                      jit works like block, but translates hot blocks to native\n"
+    "                      code (Linux x86-64 only) and prints hit rates on exit\n"
+    "   --quantum <ns>     let a device run ahead of other devices up to <ns> ns\n"
+    "                      (temporal decoupling), 0 means exact interleaving (default)\n"
+    "   --checkpoint-restore <name>\n"
+    "                      restore device state from checkpoint file <name> before\n"
+    "                      run, -m counts from the restored time\n"
+    "   --checkpoint-save <name>\n"
+    "                      save device state to checkpoint file <name> on exit\n"
     "-v --verbose          output some hints to console. Multiple -v options increase verbosity.\n"
     "-T --terminate <label> or <address>\n"
     "                      stops simulation if PC runs on <label> or <address>\n"
@@ -149,6 +177,13 @@ const char Usage[] =
     "                      <tracer>[:further-options ...]\n"
     "-o <trace-value-file> Specifies a file into which all available trace value names\n"
     "                      will be written.\n"
+    "   --batch <manifest> run the jobs in <manifest> instead of a single simulation,\n"
+    "                      one line for each job: <name> <device> <elf-file>\n"
+    "                      <max run time ns> <expected exit code> [--<option>=<value> ...]\n"
+    "                      with options serialrx, serialtx, readfrompipe, writetopipe,\n"
+    "                      writetoabort, writetoexit, terminate, cpufrequency and log\n"
+    "   --results <file>   write batch results to <file> instead of stdout\n"
+    "-j --jobs <number>    run batch jobs on <number> threads, default is one per CPU\n"
     "-V --version          print out version and exit immediately\n"
     "-h --help             print this help\n";
 
@@ -159,6 +194,8 @@ int main(int argc, char *argv[]) {
     string filename("unknown");
     string devicename("unknown");
     string tracefilename("unknown");
+    string binarytracefilename("unknown");
+    string enginename("decoder");
     long global_gdbserver_port = 1212;
     int global_gdb_debug = 0;
     bool globalWaitForGdbConnection = true; //please wait for gdb connection
@@ -166,6 +203,9 @@ int main(int argc, char *argv[]) {
     unsigned long long fcpu = 0;
     unsigned long long maxRunTime = 0;
     unsigned long long linestotrace = 1000000;
+    unsigned long long quantum = 0;
+    string checkpointSaveName("");
+    string checkpointRestoreName("");
     UserInterface *ui;
     
     unsigned long writeToPipeOffset = 0x20;
@@ -183,6 +223,11 @@ int main(int argc, char *argv[]) {
     SerialCfg *serCfg;
     vector<SerialCfg *> serialRxCfgs;
     vector<SerialCfg *> serialTxCfgs;
+    vector<Net *> serialNets;
+    vector<SimulationMember *> serialParts;
+    string batchfilename("");
+    string resultsfilename("");
+    unsigned long batchjobs = 0;
     
     while (1) {
         //int this_option_optind = optind ? optind : 1;
@@ -197,6 +242,7 @@ int main(int argc, char *argv[]) {
             {"maxruntime", 1, 0, 'm'},
             {"nogdbwait", 0, 0, 'n'},
             {"trace", 1, 0, 't'},
+            {"binarytrace", 1, 0, 'b'},
             {"version", 0, 0, 'V'},
             {"cpufrequency", 1, 0, 'F'},
             {"serialrx", 1, 0, 'S'},
@@ -209,12 +255,19 @@ int main(int argc, char *argv[]) {
             {"terminate", 1, 0, 'T'},
             {"breakpoint", 1, 0, 'B'},
             {"core-dump", 1, 0, 'C'},
+            {"engine", 1, 0, 'E'},
             {"irqstatistic", 0, 0, 's'},
+            {"quantum", 1, 0, OPT_QUANTUM},
+            {"checkpoint-save", 1, 0, OPT_CHECKPOINT_SAVE},
+            {"checkpoint-restore", 1, 0, OPT_CHECKPOINT_RESTORE},
+            {"batch", 1, 0, OPT_BATCH},
+            {"results", 1, 0, OPT_RESULTS},
+            {"jobs", 1, 0, 'j'},
             {"help", 0, 0, 'h'},
             {0, 0, 0, 0}
         };
         
-        c = getopt_long(argc, argv, "a:e:f:d:gGm:p:t:uxyzhvnisF:S:U:R:W:VT:B:c:C:o:l:", long_options, &option_index);
+        c = getopt_long(argc, argv, "a:b:e:f:d:gGj:m:p:t:uxyzhvnisF:S:U:R:W:VT:B:c:C:o:l:E:", long_options, &option_index);
         if(c == -1)
             break;
         
@@ -349,6 +402,11 @@ int main(int argc, char *argv[]) {
                 sysConHandler.SetTraceFile(optarg, linestotrace);
                 break;
             
+            case 'b':
+                avr_message("Write binary trace to file: %s", optarg);
+                binarytracefilename = optarg;
+                break;
+            
             case 'V':
                 cout << "SimulAVR " << VERSION << endl
                      << "See documentation for copyright and distribution terms" << endl
@@ -378,12 +436,49 @@ int main(int argc, char *argv[]) {
                 coredumpfile = optarg;
                 break;
             
+            case 'E':
+                enginename = optarg;
+                break;
+            
+            case OPT_QUANTUM:
+                if(!StringToUnsignedLongLong(optarg, &quantum, NULL, 10)) {
+                    cerr << "quantum is not a number" << endl;
+                    exit(1);
+                }
+                break;
+            
+            case OPT_CHECKPOINT_SAVE:
+                checkpointSaveName = optarg;
+                break;
+            
+            case OPT_CHECKPOINT_RESTORE:
+                checkpointRestoreName = optarg;
+                break;
+            
+            case OPT_BATCH:
+                batchfilename = optarg;
+                break;
+            
+            case OPT_RESULTS:
+                resultsfilename = optarg;
+                break;
+            
+            case 'j':
+                if(!StringToUnsignedLong(optarg, &batchjobs, NULL, 10)) {
+                    cerr << "jobs is not a number" << endl;
+                    exit(1);
+                }
+                break;
+            
             default:
                 cout << Usage << endl;
                 exit(0);
         }
     }
     
+    if(batchfilename != "")
+        return RunBatch(batchfilename, resultsfilename, batchjobs, enginename);
+
     if(!gdbserver_flag && filename == "unknown") {
         cerr << "Specify either --file <executable> or --gdbserver (or --gdb-stdin)" << endl;
         exit(1);
@@ -406,6 +501,10 @@ int main(int argc, char *argv[]) {
     AvrDevice *dev1 = AvrFactory::instance().makeDevice(new_devicename);
     dev1->SetDeviceNameAndSignature(new_devicename, sig);
     free(new_devicename);
+    if(!dev1->SetExecutionEngine(enginename)) {
+        cerr << "Unknown or unavailable execution engine '" << enginename << "'" << endl;
+        exit(1);
+    }
     
     /* We had to wait with dumping the available tracing values
       until the device has been created! */
@@ -444,7 +543,7 @@ int main(int argc, char *argv[]) {
     
     if(filename != "unknown" ) {
         dev1->Load(filename.c_str());
-        dev1->RegisterSerials(serialRxCfgs, serialTxCfgs);
+        dev1->RegisterSerials(serialRxCfgs, serialTxCfgs, serialNets, serialParts);
         dev1->Reset(); // reset after load data from file to activate fuses and lockbits
     }
     
@@ -475,6 +574,17 @@ int main(int argc, char *argv[]) {
     if(sysConHandler.GetTraceState())
         dev1->trace_on = true;
     
+    BinaryTrace *binaryTrace = NULL;
+    if(binarytracefilename != "unknown") {
+        binaryTrace = new BinaryTrace(binarytracefilename, dev1);
+        dev1->SetBinaryTrace(binaryTrace);
+    }
+    
+    if(quantum != 0) {
+        avr_message("Temporal decoupling with a quantum of %llu ns", quantum);
+        SystemClock::Instance().SetQuantum(quantum);
+    }
+    
     dman->start(); // start dump session
     
     long steps = 0;
@@ -493,19 +603,44 @@ int main(int argc, char *argv[]) {
     } else { // no gdb
         avr_message("Starting simulation - debugging interface disabled");
         SystemClock::Instance().Add(dev1);
+        if(checkpointRestoreName != "") {
+            Checkpoint cp;
+            cp.Read(checkpointRestoreName);
+            cp.Restore(dev1);
+            avr_message("Restored checkpoint '%s' at %llu ns",
+                        checkpointRestoreName.c_str(),
+                        (unsigned long long)SystemClock::Instance().GetCurrentTime());
+        }
         if(maxRunTime == 0) {
             steps = SystemClock::Instance().Endless();
             avr_message("Simulation interrupted");
         } else { // limited
             avr_message("Running for at most %llu ns", maxRunTime);
-            steps = SystemClock::Instance().Run(maxRunTime);
+            steps = SystemClock::Instance().Run(SystemClock::Instance().GetCurrentTime() + maxRunTime);
             avr_message("Simulation reached time limit of %llu ns", maxRunTime);
         }
     }
 
     avr_message("CPU ran for %ld cycles", steps);
+    if(dev1->GetClockCycles() > 0)
+        avr_message("Hardware ticked %llu times, %.3f parts per clock",
+                    dev1->GetHwCycleCalls(),
+                    (double)dev1->GetHwCycleCalls() / dev1->GetClockCycles());
+    if(quantum != 0)
+        avr_message("Quanta run out: %llu, ended early by a sync: %llu",
+                    SystemClock::Instance().GetQuantumSyncCount(),
+                    SystemClock::Instance().GetEarlySyncCount());
     Application::GetInstance()->PrintResults();
     
+    if(checkpointSaveName != "") {
+        Checkpoint cp;
+        cp.Save(dev1);
+        cp.Write(checkpointSaveName);
+        avr_message("Saved checkpoint '%s' at %llu ns",
+                    checkpointSaveName.c_str(),
+                    (unsigned long long)SystemClock::Instance().GetCurrentTime());
+    }
+    
     dman->stopApplication(); // stop dump session. Close dump files, if necessary
     
     if(coredumpfile != "unknown") {
@@ -513,9 +648,15 @@ int main(int argc, char *argv[]) {
         WriteCoreDump(coredumpfile, dev1);
     }
 
-    // delete ui and device
+    // close binary trace, delete ui and device
+    dev1->SetBinaryTrace(NULL);
+    delete binaryTrace;
     delete ui;
     delete dev1;
+    for(size_t i = 0; i < serialNets.size(); i++)
+        delete serialNets[i];
+    for(size_t i = 0; i < serialParts.size(); i++)
+        delete serialParts[i];
     
     return 0;
 }
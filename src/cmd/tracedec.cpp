@@ -0,0 +1,222 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+/*
+ * simulavr-tracedec converts a binary instruction trace (simulavr option -b)
+ * to the text format of option -t, see BinaryTraceDecoder.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+using namespace std;
+
+#include <stdlib.h>
+#ifndef _MSC_VER
+#  include <getopt.h>
+#else
+#  include "../getopt/getopt.h"
+#  define VERSION "(git-snapshot)"
+#endif
+
+#include "config.h"
+
+#include "avrdevice.h"
+#include "avrfactory.h"
+#include "binarytrace.h"
+#include "flash.h"
+#include "string2.h"
+
+const char Usage[] =
+    "simulavr-tracedec Version " VERSION "\n"
+    "Converts a binary instruction trace, written by simulavr -b, to text.\n"
+    "usage: simulavr-tracedec [options] <binary trace file>\n"
+    "-f --file <name>      load elf-file <name>, default is the file of the traced core\n"
+    "-d --device <name>    device <name>, default is the device of the traced core\n"
+    "-o --output <file>    write text trace to <file>, default is stdout\n"
+    "-r --range <from>,<to>\n"
+    "                      write only lines with a (hex) byte address in <from> to <to>\n"
+    "-s --symbol <label>   write only lines, which address belongs to <label>, shown\n"
+    "                      as <label> or <label>+0x12. Can be given more than once\n"
+    "-V --version          print out version and exit immediately\n"
+    "-h --help             print this help\n";
+
+//! Filters trace lines by address range and symbol
+class LineFilter: public BinaryTraceDecoder {
+
+    public:
+        LineFilter(BinaryTraceReader &r, AvrDevice *c, ostream *o):
+            BinaryTraceDecoder(r, c, o), core(c), from(0), to(~0UL) {}
+
+        bool SetRange(const char *arg);
+        void AddSymbol(const string &s) { symbols.push_back(s); }
+
+    protected:
+        //! Returns true, if a line for pc (in words) is to write
+        bool Match(unsigned int pc);
+
+    private:
+        AvrDevice *core;
+        unsigned long from; //!< first byte address
+        unsigned long to; //!< last byte address
+        vector<string> symbols;
+        map<unsigned int, bool> symbolMatch; //!< cache, symbol lookup is slow
+
+        bool MatchSymbol(unsigned int pc);
+};
+
+bool LineFilter::SetRange(const char *arg) {
+    char *end;
+    if(!StringToUnsignedLong(arg, &from, &end, 16) || *end != ',')
+        return false;
+    return StringToUnsignedLong(end + 1, &to, NULL, 16) && from <= to;
+}
+
+bool LineFilter::MatchSymbol(unsigned int pc) {
+    unsigned int offset;
+    const MemorySymbol *sym = core->Flash->FindSymbol(pc, offset);
+    if(sym == NULL)
+        return false;
+    for(size_t n = 0; n < sym->names.size(); n++)
+        for(size_t i = 0; i < symbols.size(); i++)
+            if(sym->names[n] == symbols[i])
+                return true;
+    return false;
+}
+
+bool LineFilter::Match(unsigned int pc) {
+    unsigned long addr = (unsigned long)pc << 1;
+    if(addr < from || addr > to)
+        return false;
+    if(symbols.empty())
+        return true;
+    map<unsigned int, bool>::iterator i = symbolMatch.find(pc);
+    if(i != symbolMatch.end())
+        return i->second;
+    bool m = MatchSymbol(pc);
+    symbolMatch[pc] = m;
+    return m;
+}
+
+int main(int argc, char *argv[]) {
+    string filename("");
+    string devicename("");
+    string outputname("");
+    string rangearg("");
+    vector<string> symbols;
+
+    while(1) {
+        int option_index = 0;
+        static struct option long_options[] = {
+            {"file", 1, 0, 'f'},
+            {"device", 1, 0, 'd'},
+            {"output", 1, 0, 'o'},
+            {"range", 1, 0, 'r'},
+            {"symbol", 1, 0, 's'},
+            {"version", 0, 0, 'V'},
+            {"help", 0, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+
+        int c = getopt_long(argc, argv, "f:d:o:r:s:Vh", long_options, &option_index);
+        if(c == -1)
+            break;
+
+        switch(c) {
+            case 'f':
+                filename = optarg;
+                break;
+
+            case 'd':
+                devicename = optarg;
+                break;
+
+            case 'o':
+                outputname = optarg;
+                break;
+
+            case 'r':
+                rangearg = optarg;
+                break;
+
+            case 's':
+                symbols.push_back(optarg);
+                break;
+
+            case 'V':
+                cout << "simulavr-tracedec " << VERSION << endl;
+                exit(0);
+
+            default:
+                cout << Usage << endl;
+                exit(0);
+        }
+    }
+
+    if(optind != argc - 1) {
+        cerr << Usage << endl;
+        exit(1);
+    }
+
+    BinaryTraceReader reader(argv[optind]);
+    if(devicename == "")
+        devicename = reader.deviceName;
+    if(filename == "")
+        filename = reader.programName;
+    if(devicename == "" || filename == "") {
+        cerr << "Trace doesn't name device and program, use --device and --file" << endl;
+        exit(1);
+    }
+
+    ofstream outfile;
+    ostream *out = &cout;
+    if(outputname != "") {
+        outfile.open(outputname.c_str());
+        if(!outfile.is_open()) {
+            cerr << "Can't open '" << outputname << "'" << endl;
+            exit(1);
+        }
+        out = &outfile;
+    }
+
+    // second core, which produces the instruction text
+    AvrDevice *core = AvrFactory::instance().makeDevice(devicename.c_str());
+    core->Load(filename.c_str());
+    core->Reset();
+
+    LineFilter filter(reader, core, out);
+    if(rangearg != "" && !filter.SetRange(rangearg.c_str())) {
+        cerr << "range has to be <from>,<to> with hex byte addresses" << endl;
+        exit(1);
+    }
+    for(size_t i = 0; i < symbols.size(); i++)
+        filter.AddSymbol(symbols[i]);
+    filter.Run();
+
+    delete core;
+    return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "cosimulation.h"
+#include "avrdevice.h"
+#include "avrerror.h"
+#include "net.h"
+#include "simulationcontext.h"
+#include "systemclock.h"
+
+void PinLinkProbe::SetInState(const Pin &p) {
+    Pin::SetInState(p);
+    link->Send(p);
+}
+
+PinLink::PinLink(Pin *from, SystemClock &fc, Pin *to, SystemClock &tc, SystemClockOffset d):
+    fromClock(fc),
+    toClock(tc),
+    delay(d),
+    probe(this),
+    fromNet(NULL),
+    toNet(NULL),
+    lastState('t'),
+    lastAnalog(0.0)
+{
+    Net *n = to->GetNet();
+    if(n == NULL) {
+        n = toNet = new Net(toClock);
+        n->Add(to);
+    }
+    n->Add(&driver);
+
+    n = from->GetNet();
+    if(n == NULL) {
+        n = fromNet = new Net(fromClock);
+        n->Add(from);
+    }
+    n->Add(&probe);
+
+    // state on creation is taken over at once
+    if(!sent.empty() || !pending.empty()) {
+        Set(lastState, lastAnalog);
+        sent.clear();
+        pending.clear();
+        toClock.Remove(this);
+    }
+}
+
+PinLink::~PinLink() {
+    toClock.Remove(this);
+    delete fromNet;
+    delete toNet;
+}
+
+void PinLink::Send(const Pin &p) {
+    char state = p;
+    float analog = p.GetRawAnalog();
+    if(state == lastState && (state != 'a' || analog == lastAnalog))
+        return;
+    lastState = state;
+    lastAnalog = analog;
+
+    Change c;
+    c.time = fromClock.GetCurrentTime() + delay;
+    c.state = state;
+    c.analog = analog;
+    if(IsLocal()) {
+        // both pins on one clock: no window to wait for, schedule at once
+        pending.push_back(c);
+        if(pending.size() == 1)
+            toClock.Add(this, delay);
+    } else
+        sent.push_back(c);
+}
+
+void PinLink::Set(char state, float analog) {
+    if(state == 'a') {
+        driver.outState = Pin::ANALOG;
+        driver.SetAnalogValue(analog);
+    } else
+        driver = state;
+}
+
+void PinLink::Deliver(void) {
+    if(sent.empty())
+        return;
+    bool idle = pending.empty();
+    pending.insert(pending.end(), sent.begin(), sent.end());
+    sent.clear();
+    if(idle)
+        toClock.Add(this, pending.front().time - toClock.GetCurrentTime());
+}
+
+int PinLink::Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns) {
+    SystemClockOffset now = toClock.GetCurrentTime();
+    while(!pending.empty() && pending.front().time <= now) {
+        Set(pending.front().state, pending.front().analog);
+        pending.pop_front();
+    }
+    if(timeToNextStepIn_ns != 0)
+        *timeToNextStepIn_ns = pending.empty() ? -1 : pending.front().time - now;
+    return 0;
+}
+
+CoSimulation::CoSimulation():
+    currentTime(0),
+    windowEnd(0),
+    runEnd(0),
+    runDone(true),
+    windowCount(0),
+    threadCount(0),
+    arrived(0),
+    generation(0)
+{}
+
+CoSimulation::~CoSimulation() {
+    for(size_t i = 0; i < links.size(); i++)
+        delete links[i];
+    for(size_t i = 0; i < partitions.size(); i++)
+        delete partitions[i];
+}
+
+SimulationContext *CoSimulation::AddPartition(void) {
+    SimulationContext *c = new SimulationContext;
+    // a partition starts at time of the other ones
+    c->GetClock().SetCurrentTime(currentTime);
+    partitions.push_back(c);
+    return c;
+}
+
+PinLink *CoSimulation::AddLink(AvrDevice *from, const char *fromPin,
+                               AvrDevice *to, const char *toPin,
+                               SystemClockOffset delay) {
+    if(delay < 1)
+        avr_error("CoSimulation: delay of a link has to be at least 1ns");
+    if(std::find(partitions.begin(), partitions.end(), from->GetContext()) == partitions.end() ||
+       std::find(partitions.begin(), partitions.end(), to->GetContext()) == partitions.end())
+        avr_error("CoSimulation: linked device isn't in a partition of this simulation");
+
+    PinLink *l = new PinLink(from->GetPin(fromPin), from->GetSystemClock(),
+                             to->GetPin(toPin), to->GetSystemClock(),
+                             delay);
+    links.push_back(l);
+    return l;
+}
+
+SystemClockOffset CoSimulation::GetLookahead(void) const {
+    SystemClockOffset lookahead = 0;
+    for(size_t i = 0; i < links.size(); i++)
+        if(!links[i]->IsLocal() && (lookahead == 0 || links[i]->GetDelay() < lookahead))
+            lookahead = links[i]->GetDelay();
+    return lookahead;
+}
+
+SystemClockOffset CoSimulation::Run(SystemClockOffset endTime, unsigned int threads) {
+    if(partitions.empty() || endTime <= currentTime)
+        return currentTime;
+
+    for(size_t i = 0; i < partitions.size(); i++)
+        partitions[i]->ClearStop();
+    if(threads == 0 || threads > partitions.size())
+        threads = partitions.size();
+    threadCount = threads;
+    runEnd = endTime;
+    runDone = false;
+    failure = std::exception_ptr();
+    arrived.store(0);
+    NextWindow();
+
+    // this thread is worker 0
+    std::vector<std::thread> workers;
+    for(unsigned int i = 1; i < threads; i++)
+        workers.push_back(std::thread(&CoSimulation::Worker, this, i));
+    Worker(0);
+    for(size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    if(failure)
+        std::rethrow_exception(failure);
+    return currentTime;
+}
+
+void CoSimulation::Worker(unsigned int index) {
+    while(!runDone) {
+        for(size_t p = index; p < partitions.size(); p += threadCount) {
+            try {
+                partitions[p]->GetClock().RunUntil(windowEnd);
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(failureLock);
+                if(!failure)
+                    failure = std::current_exception();
+            }
+        }
+        WaitWindow();
+    }
+}
+
+void CoSimulation::WaitWindow(void) {
+    unsigned long gen = generation.load(std::memory_order_acquire);
+    if(arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == threadCount) {
+        // last one: all partitions are done with this window
+        arrived.store(0, std::memory_order_relaxed);
+        EndWindow();
+        generation.fetch_add(1, std::memory_order_release);
+    } else {
+        while(generation.load(std::memory_order_acquire) == gen)
+            std::this_thread::yield();
+    }
+}
+
+void CoSimulation::EndWindow(void) {
+    // in order of links, so that the destination clocks get the same
+    // sequence of events for every count of threads
+    for(size_t i = 0; i < links.size(); i++)
+        links[i]->Deliver();
+    currentTime = windowEnd;
+    windowCount++;
+
+    if(failure || currentTime >= runEnd)
+        runDone = true;
+    for(size_t i = 0; i < partitions.size(); i++)
+        if(partitions[i]->GetClock().StopRequested())
+            runDone = true;
+    if(!runDone)
+        NextWindow();
+}
+
+void CoSimulation::NextWindow(void) {
+    SystemClockOffset lookahead = GetLookahead();
+    if(lookahead == 0 || runEnd - currentTime <= lookahead)
+        windowEnd = runEnd;
+    else
+        windowEnd = currentTime + lookahead;
+}
+
+// EOF
@@ -0,0 +1,197 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef COSIMULATION_H_INCLUDED
+#define COSIMULATION_H_INCLUDED
+
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+#include "systemclocktypes.h"
+#include "simulationmember.h"
+#include "pin.h"
+
+class AvrDevice;
+class Net;
+class SystemClock;
+class SimulationContext;
+class PinLink;
+
+//! Pin of a PinLink, which is added to the net of the source pin
+class PinLinkProbe: public Pin {
+
+    public:
+        PinLinkProbe(PinLink *l): link(l) {}
+        //! Passes a changed state of the net to the link
+        void SetInState(const Pin &p);
+
+    private:
+        PinLink *link;
+};
+
+/** A one way connection from a pin of one device to a pin of another device
+    with a propagation delay.
+
+    The state of the net of the source pin is sent to the destination pin
+    delay ns later. Because a change can't affect the other device earlier,
+    the devices can run independently for this time, see CoSimulation. A
+    link is made by CoSimulation::AddLink.
+
+    If both devices run on the same SystemClock, a change is scheduled at
+    once, when it's sent. So a partition with linked devices runs the same
+    delayed connections sequentially. */
+class PinLink: public SimulationMember {
+
+    public:
+        PinLink(Pin *from, SystemClock &fromClock, Pin *to, SystemClock &toClock, SystemClockOffset delay);
+        ~PinLink();
+
+        //! Returns the propagation delay in ns
+        SystemClockOffset GetDelay(void) const { return delay; }
+        //! Returns true, if both pins are on the same clock, such a link doesn't limit the lookahead
+        bool IsLocal(void) const { return &fromClock == &toClock; }
+        //! Sets the changes on destination pin, which are due
+        int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns = 0);
+        //! Takes over sent changes and schedules them on destination clock
+        /*! Called between two windows of a CoSimulation, when no device runs. */
+        void Deliver(void);
+
+    private:
+        friend class PinLinkProbe;
+
+        //! State change of source net
+        struct Change {
+            SystemClockOffset time; //!< time, when it's due on destination pin
+            char state; //!< state of net as given by Pin::operator char
+            float analog; //!< value, if state is 'a' (analog)
+        };
+
+        SystemClock &fromClock;
+        SystemClock &toClock;
+        SystemClockOffset delay;
+        PinLinkProbe probe; //!< member of source net
+        Pin driver; //!< member of destination net, drives the sent state
+        Net *fromNet; //!< net of source pin, if made by this link
+        Net *toNet; //!< net of destination pin, if made by this link
+        char lastState; //!< last sent state
+        float lastAnalog;
+        std::vector<Change> sent; //!< changes of actual window, written by thread of source device
+        std::deque<Change> pending; //!< changes to set on destination pin, used by thread of destination device
+
+        //! Records a change of source net
+        void Send(const Pin &p);
+        //! Drives a state on destination net
+        void Set(char state, float analog);
+};
+
+/** Runs several partitions of a simulation, each one with its own
+    SimulationContext, in parallel on host threads.
+
+    Devices in different partitions are connected only by PinLinks with a
+    propagation delay. The partitions run in windows, which are not longer
+    than the smallest delay (the lookahead): a change sent during a window is
+    due on the other side after the end of the window, so no partition has to
+    wait for another one inside a window (conservative parallel discrete event
+    simulation with barrier windows). Between two windows the sent changes are
+    scheduled on the clocks of the destination partitions.
+
+    All partitions see the same events at the same time and in the same order,
+    independent of count of threads, so a run with one thread and a run with
+    many threads give the same result. A partition is processed by one thread
+    at a time, so a partition should hold all parts of a board, which are
+    connected without delay, e.g. by a Net.
+
+    The sequential reference is one partition, which holds all devices and
+    the same links, run by its SystemClock. It gives the same result as the
+    partitioned run, with one exception: if a change of a link is due at the
+    same time as a step of the destination device, their order isn't defined
+    on a SystemClock and may differ between both runs. Delays, which aren't
+    a multiple of the clock periods, avoid this. */
+class CoSimulation {
+
+    public:
+        CoSimulation();
+        //! Deletes links and partitions
+        /*! Devices have to be removed from their clocks and deleted before. */
+        ~CoSimulation();
+
+        //! Creates a new partition, create devices for it by AvrFactory::makeDevice
+        SimulationContext *AddPartition(void);
+        //! Connects pin fromPin of device from to pin toPin of device to, with delay ns
+        /*! Both devices have to be in partitions of this simulation, delay
+          has to be at least 1ns. The destination pin is connected to the
+          link only, if it isn't connected already. For a connection in both
+          directions use two links. */
+        PinLink *AddLink(AvrDevice *from, const char *fromPin,
+                         AvrDevice *to, const char *toPin,
+                         SystemClockOffset delay);
+        //! Returns the length of a window, the smallest delay of all links between partitions
+        SystemClockOffset GetLookahead(void) const;
+        //! Returns the time, till all partitions have run
+        SystemClockOffset GetCurrentTime(void) const { return currentTime; }
+        //! Returns count of windows run
+        unsigned long long GetWindowCount(void) const { return windowCount; }
+
+        //! Runs all partitions till endTime or till a partition stops, on up to threads host threads
+        /*! threads = 0 means one thread for each partition. Returns the
+          reached time. Stop of a partition ends the run after the window, in
+          which it stopped. */
+        SystemClockOffset Run(SystemClockOffset endTime, unsigned int threads = 0);
+        //! Like Run, but runs for the given time range
+        SystemClockOffset RunTimeRange(SystemClockOffset timeRange, unsigned int threads = 0) {
+            return Run(currentTime + timeRange, threads);
+        }
+
+    private:
+        std::vector<SimulationContext *> partitions;
+        std::vector<PinLink *> links;
+        SystemClockOffset currentTime;
+        SystemClockOffset windowEnd; //!< end of actual window
+        SystemClockOffset runEnd; //!< end of actual run
+        bool runDone; //!< set, if run has to end after actual window
+        unsigned long long windowCount;
+        unsigned int threadCount; //!< count of threads in actual run
+        std::atomic<unsigned int> arrived; //!< count of threads, which have done the actual window
+        std::atomic<unsigned long> generation; //!< count of windows ended in actual run
+        std::exception_ptr failure; //!< first exception of a partition in actual run
+        std::mutex failureLock;
+
+        //! Thread function, runs every threadCount'th partition starting with index
+        void Worker(unsigned int index);
+        //! Waits, till all threads are done with window, last one calls EndWindow
+        void WaitWindow(void);
+        //! Delivers link changes and sets up next window
+        void EndWindow(void);
+        //! Sets windowEnd and runDone for next window
+        void NextWindow(void);
+
+        CoSimulation(const CoSimulation &);
+        CoSimulation &operator=(const CoSimulation &);
+};
+
+#endif
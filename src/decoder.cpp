@@ -1475,27 +1475,9 @@ avr_op_SLEEP::avr_op_SLEEP(word opcode, AvrDevice *c):
     DecodedInstruction(c) {}
 
 int avr_op_SLEEP::operator()() {
-#if 0  //TODO
-    MCUCR *mcucr = (MCUCR *)avr_core_get_vdev_by_name( core, "MCUCR" );
-
-    if (mcucr == NULL)
-        avr_error( "MCUCR register not installed" );
-
-    /* See if sleep mode is enabled */
-    if ( mcucr_get_bit(mcucr, bit_SE) )
-    {
-        if ( mcucr_get_bit(mcucr, bit_SM) == 0 )
-        {
-            /* Idle Mode */
-            avr_core_set_sleep_mode( core, SLEEP_MODE_IDLE);
-        }
-        else
-        {
-            /* Power Down Mode */
-            avr_core_set_sleep_mode( core, SLEEP_MODE_PWR_DOWN);
-        }
-    }
-#endif
+    // core waits for an interrupt, which wakes it up in selected sleep mode
+    if(core->sleepControl != NULL && core->sleepControl->IsSet())
+        core->sleeping = true;
     return 1;
 }
 
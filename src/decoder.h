@@ -33,6 +33,59 @@
 #include "avrdevice.h"
 
 class AvrFlash;
+class DecodedInstruction;
+
+//! Entry of the threaded code table, see AvrFlash::GetThreadedInstruction
+/*! Holds a direct pointer to a handler function together with pre-decoded
+  operands, so that the execution loop can call it without a virtual dispatch
+  through DecodedInstruction. Handlers return the used clocks like
+  DecodedInstruction::operator()() does. */
+class ThreadedInstruction {
+
+    public:
+        typedef int (*Handler)(AvrDevice *core, const ThreadedInstruction *ti);
+        typedef void (*NativeCode)(void);
+
+        //! Instruction kinds, which can be translated to native code by AvrJit
+        enum Kind {
+            KIND_OTHER, KIND_ADC, KIND_ADD, KIND_ADIW, KIND_AND, KIND_ANDI,
+            KIND_COM, KIND_CP, KIND_CPC, KIND_CPI, KIND_DEC, KIND_EOR, KIND_INC,
+            KIND_LDI, KIND_LSR, KIND_MOV, KIND_MOVW, KIND_NOP, KIND_OR,
+            KIND_ORI, KIND_SBC, KIND_SBCI, KIND_SBIW, KIND_SUB, KIND_SUBI,
+            KIND_SWAP
+        };
+
+        //! Busy-wait loops, which AvrDevice can fast-forward, see AvrFlash::GetLoop
+        enum LoopKind {
+            LOOP_UNKNOWN,    //!< not analysed yet
+            LOOP_NONE,       //!< no busy-wait loop starts here
+            LOOP_COUNTDOWN,  //!< DEC, SBIW 1 or SUBI 1 with SBCI 0 chain and BRNE back
+            LOOP_WAIT_SET,   //!< SBIS and RJMP back, waits for a set IO bit
+            LOOP_WAIT_CLEAR  //!< SBIC and RJMP back, waits for a cleared IO bit
+        };
+
+        Handler handler; //!< function to execute this instruction
+        DecodedInstruction *instr; //!< the decoded instruction, used by the generic handler
+        unsigned char op1; //!< first operand, mostly destination register
+        unsigned char op2; //!< second operand, source register, constant or bit mask
+        bool twoWords; //!< copy of DecodedInstruction::IsInstruction2Words() for skip instructions
+        bool branch; //!< instruction is a branch or relative jump, which can terminate a block
+        unsigned char cycles; //!< clocks, if instruction uses only registers and could be part of a block, otherwise 0
+        unsigned char blockLength; //!< count of instructions in block starting here, 0 if not built yet
+        unsigned char blockCycles; //!< sum of clocks of the block without terminating branch
+        unsigned char kind; //!< one of Kind
+        int offset; //!< relative jump offset or 16bit constant
+        unsigned int hits; //!< executions of block starting here, used by AvrJit to find hot blocks
+        NativeCode native; //!< translated block starting here, NULL if not translated
+        unsigned char loopKind; //!< one of LoopKind
+        unsigned char loopLength; //!< count of instructions in busy-wait loop starting here
+        unsigned char loopCycles; //!< clocks of one loop iteration, which doesn't leave the loop
+
+        ThreadedInstruction():
+            handler(0), instr(0), op1(0), op2(0), twoWords(false), branch(false),
+            cycles(0), blockLength(0), blockCycles(0), kind(KIND_OTHER), offset(0),
+            hits(0), native(0), loopKind(LOOP_UNKNOWN), loopLength(0), loopCycles(0) {}
+};
 
 //! Base class of core instruction
 /*! All instruction are derived from this class */
@@ -55,6 +108,10 @@ class DecodedInstruction {
         virtual int operator()() = 0;
         //! Performs instruction and write out instruction mnemonic for trace
         virtual int Trace() = 0;
+        //! Fills a threaded code table entry for this instruction
+        /*! The default entry calls operator()(), frequently used instructions
+          provide a specialised handler, see decoder_threaded.cpp */
+        virtual void Translate(ThreadedInstruction *ti);
 		//! If this instruction modifies a R0-R31 register then return its number, otherwise -1.
 		virtual unsigned char GetModifiedR() const {return -1;}
 		//! If this instruction modifies a pair of R0-R31 registers then ...
@@ -84,6 +141,7 @@ class avr_op_ADC: public DecodedInstruction {
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace(); 
+        void Translate(ThreadedInstruction *ti);
 }; //end of class 
 
 class avr_op_ADD: public DecodedInstruction {
@@ -106,6 +164,7 @@ class avr_op_ADD: public DecodedInstruction {
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace(); 
+        void Translate(ThreadedInstruction *ti);
 }; //end of class 
 
 
@@ -135,6 +194,7 @@ class avr_op_ADIW: public DecodedInstruction
         virtual unsigned char GetModifiedRHi() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_AND: public DecodedInstruction
@@ -158,6 +218,7 @@ class avr_op_AND: public DecodedInstruction
         avr_op_AND(word opcode, AvrDevice *c); 
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_ANDI: public DecodedInstruction
@@ -181,6 +242,7 @@ class avr_op_ANDI: public DecodedInstruction
         avr_op_ANDI(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_ASR:public DecodedInstruction
@@ -276,6 +338,7 @@ class avr_op_BRBC: public DecodedInstruction
         avr_op_BRBC(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_BRBS: public DecodedInstruction
@@ -304,6 +367,7 @@ class avr_op_BRBS: public DecodedInstruction
         avr_op_BRBS(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_BSET: public DecodedInstruction
@@ -416,6 +480,7 @@ class avr_op_COM: public DecodedInstruction
         avr_op_COM(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_CP: public DecodedInstruction
@@ -439,6 +504,7 @@ class avr_op_CP: public DecodedInstruction
         avr_op_CP(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_CPC: public DecodedInstruction
@@ -462,6 +528,7 @@ class avr_op_CPC: public DecodedInstruction
         avr_op_CPC(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_CPI: public DecodedInstruction
@@ -485,6 +552,7 @@ class avr_op_CPI: public DecodedInstruction
         avr_op_CPI(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 
 };
 
@@ -509,6 +577,7 @@ class avr_op_CPSE: public DecodedInstruction
         avr_op_CPSE(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_DEC: public DecodedInstruction
@@ -531,6 +600,7 @@ class avr_op_DEC: public DecodedInstruction
         avr_op_DEC(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_EICALL: public DecodedInstruction
@@ -651,6 +721,7 @@ class avr_op_EOR: public DecodedInstruction
         avr_op_EOR(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_ESPM: public DecodedInstruction
@@ -797,6 +868,7 @@ class avr_op_IN: public DecodedInstruction
         avr_op_IN(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_INC: public DecodedInstruction
@@ -819,6 +891,7 @@ class avr_op_INC: public DecodedInstruction
         avr_op_INC(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_JMP: public DecodedInstruction
@@ -907,6 +980,7 @@ class avr_op_LDI: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_LDS: public DecodedInstruction
@@ -1160,6 +1234,7 @@ class avr_op_LSR: public DecodedInstruction
         avr_op_LSR(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_MOV: public DecodedInstruction
@@ -1181,6 +1256,7 @@ class avr_op_MOV: public DecodedInstruction
         avr_op_MOV(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_MOVW: public DecodedInstruction
@@ -1203,6 +1279,7 @@ class avr_op_MOVW: public DecodedInstruction
         avr_op_MOVW(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_MUL: public DecodedInstruction
@@ -1316,6 +1393,7 @@ class avr_op_NOP: public DecodedInstruction
         avr_op_NOP(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_OR:public DecodedInstruction
@@ -1339,6 +1417,7 @@ class avr_op_OR:public DecodedInstruction
         avr_op_OR(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_ORI: public DecodedInstruction
@@ -1362,6 +1441,7 @@ class avr_op_ORI: public DecodedInstruction
         avr_op_ORI(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_OUT: public DecodedInstruction
@@ -1384,6 +1464,7 @@ class avr_op_OUT: public DecodedInstruction
         avr_op_OUT(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 
     friend class AvrFlash;  // AvrFlash::LooksLikeContextSwitch() needs to read ioreg
 };
@@ -1509,6 +1590,7 @@ class avr_op_RJMP: public DecodedInstruction
         avr_op_RJMP(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_ROR: public DecodedInstruction
@@ -1531,6 +1613,7 @@ class avr_op_ROR: public DecodedInstruction
         avr_op_ROR(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SBC: public DecodedInstruction
@@ -1555,6 +1638,7 @@ class avr_op_SBC: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SBCI: public DecodedInstruction
@@ -1579,6 +1663,7 @@ class avr_op_SBCI: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SBI: public DecodedInstruction
@@ -1670,6 +1755,7 @@ class avr_op_SBIW: public DecodedInstruction
         virtual unsigned char GetModifiedRHi() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SBRC: public DecodedInstruction
@@ -1692,6 +1778,7 @@ class avr_op_SBRC: public DecodedInstruction
         avr_op_SBRC(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SBRS: public DecodedInstruction
@@ -1714,6 +1801,7 @@ class avr_op_SBRS: public DecodedInstruction
         avr_op_SBRS(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 /*! \todo SLEEP instruction not implemented */
@@ -1990,6 +2078,7 @@ class avr_op_SUB: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SUBI: public DecodedInstruction
@@ -2014,6 +2103,7 @@ class avr_op_SUBI: public DecodedInstruction
         virtual unsigned char GetModifiedR() const;
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_SWAP: public DecodedInstruction
@@ -2035,6 +2125,7 @@ class avr_op_SWAP: public DecodedInstruction
         avr_op_SWAP(word opcode, AvrDevice *c);
         int operator()();
         int Trace();
+        void Translate(ThreadedInstruction *ti);
 };
 
 class avr_op_WDR: public DecodedInstruction
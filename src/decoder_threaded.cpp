@@ -0,0 +1,771 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Theodore A. Roth, Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+/*
+ * Handlers for the threaded code engine (see AvrDevice::SetExecutionEngine).
+ * Each handler implements exactly the same semantic as operator()() of the
+ * corresponding instruction class in decoder.cpp, but works on the operands
+ * stored in ThreadedInstruction. So the execution loop can call the handler
+ * directly by a function pointer from the table in AvrFlash, without virtual
+ * dispatch. Instructions without own handler use threaded_Generic.
+ *
+ * Instructions, which access only core registers and SREG and have a fixed
+ * count of clocks, set ThreadedInstruction::cycles. A run of such
+ * instructions, optionally terminated by a branch or relative jump, can be
+ * executed as one block by the block engine (see AvrFlash::GetBlock).
+ */
+
+#include "types.h"
+#include "decoder.h"
+#include "avrdevice.h"
+
+#include "hwsreg.h"
+#include "flash.h"
+#include "rwmem.h"
+
+static inline int get_add_carry( byte res, byte rd, byte rr, int b )
+{
+    byte resb = res >> b & 0x1;
+    byte rdb  = rd  >> b & 0x1;
+    byte rrb  = rr  >> b & 0x1;
+    return (rdb & rrb) | (rrb & ~resb) | (~resb & rdb);
+}
+
+static inline int get_add_overflow( byte res, byte rd, byte rr )
+{
+    byte res7 = res >> 7 & 0x1;
+    byte rd7  = rd  >> 7 & 0x1;
+    byte rr7  = rr  >> 7 & 0x1;
+    return (rd7 & rr7 & ~res7) | (~rd7 & ~rr7 & res7);
+}
+
+static inline int get_sub_carry( byte res, byte rd, byte rr, int b )
+{
+    byte resb = res >> b & 0x1;
+    byte rdb  = rd  >> b & 0x1;
+    byte rrb  = rr  >> b & 0x1;
+    return (~rdb & rrb) | (rrb & resb) | (resb & ~rdb);
+}
+
+static inline int get_sub_overflow( byte res, byte rd, byte rr )
+{
+    byte res7 = res >> 7 & 0x1;
+    byte rd7  = rd  >> 7 & 0x1;
+    byte rr7  = rr  >> 7 & 0x1;
+    return (rd7 & ~rr7 & ~res7) | (~rd7 & rr7 & res7);
+}
+
+//! Read core register, same as AvrDevice::GetCoreReg without range check
+#define REG(n) (*(core->rw[n]))
+
+//! Skip the next instruction, used by CPSE, SBRC and SBRS
+static inline int threaded_skip(AvrDevice *core, const ThreadedInstruction *ti) {
+    int skip = ti[1].twoWords ? 3 : 2;
+    core->DebugOnJump();
+    core->PC += skip - 1;
+    return skip;
+}
+
+static int threaded_Generic(AvrDevice *core, const ThreadedInstruction *ti) {
+    return (*(ti->instr))();
+}
+
+static int threaded_ADC(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    unsigned char rd = REG(ti->op1);
+    unsigned char rr = REG(ti->op2);
+    unsigned char res = rd + rr + status->C;
+
+    status->H = get_add_carry(res, rd, rr, 3);
+    status->V = get_add_overflow(res, rd, rr);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+    status->C = get_add_carry(res, rd, rr, 7);
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_ADD(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    unsigned char rd = REG(ti->op1);
+    unsigned char rr = REG(ti->op2);
+    unsigned char res = rd + rr;
+
+    status->H = get_add_carry(res, rd, rr, 3);
+    status->V = get_add_overflow(res, rd, rr);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+    status->C = get_add_carry(res, rd, rr, 7);
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_ADIW(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    unsigned char rdh = REG(ti->op1 + 1);
+    word rd = (rdh << 8) + REG(ti->op1);
+    word res = rd + ti->offset;
+
+    status->V = ~(rdh >> 7 & 0x1) & (res >> 15 & 0x1);
+    status->N = (res >> 15) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xffff) == 0;
+    status->C = ~(res >> 15 & 0x1) & (rdh >> 7 & 0x1);
+
+    REG(ti->op1) = res & 0xff;
+    REG(ti->op1 + 1) = res >> 8;
+
+    return 2;
+}
+
+static int threaded_AND(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    unsigned char res = REG(ti->op1) & REG(ti->op2);
+
+    status->V = 0;
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_ANDI(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    unsigned char res = REG(ti->op1) & ti->op2;
+
+    status->V = 0;
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_BRBC(AvrDevice *core, const ThreadedInstruction *ti) {
+    if((ti->op2 & (*(core->status))) == 0) {
+        core->DebugOnJump();
+        core->PC += ti->offset;
+        return 2;
+    }
+    return 1;
+}
+
+static int threaded_BRBS(AvrDevice *core, const ThreadedInstruction *ti) {
+    if((ti->op2 & (*(core->status))) != 0) {
+        core->DebugOnJump();
+        core->PC += ti->offset;
+        return 2;
+    }
+    return 1;
+}
+
+static int threaded_COM(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte res = 0xff - REG(ti->op1);
+
+    status->N = (res >> 7) & 0x1;
+    status->C = 1;
+    status->V = 0;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_CP(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd  = REG(ti->op1);
+    byte rr  = REG(ti->op2);
+    byte res = rd - rr;
+
+    status->H = get_sub_carry(res, rd, rr, 3);
+    status->V = get_sub_overflow(res, rd, rr);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+    status->C = get_sub_carry(res, rd, rr, 7);
+
+    return 1;
+}
+
+static int threaded_CPC(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd  = REG(ti->op1);
+    byte rr  = REG(ti->op2);
+    byte res = rd - rr - status->C;
+
+    status->H = get_sub_carry(res, rd, rr, 3);
+    status->V = get_sub_overflow(res, rd, rr);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->C = get_sub_carry(res, rd, rr, 7);
+
+    /* Previous value remains unchanged when result is 0; cleared otherwise */
+    status->Z = ((res & 0xff) == 0) && status->Z;
+
+    return 1;
+}
+
+static int threaded_CPI(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd  = REG(ti->op1);
+    byte k   = ti->op2;
+    byte res = rd - k;
+
+    status->H = get_sub_carry(res, rd, k, 3);
+    status->V = get_sub_overflow(res, rd, k);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+    status->C = get_sub_carry(res, rd, k, 7);
+
+    return 1;
+}
+
+static int threaded_CPSE(AvrDevice *core, const ThreadedInstruction *ti) {
+    if(REG(ti->op1) == REG(ti->op2))
+        return threaded_skip(core, ti);
+    return 1;
+}
+
+static int threaded_DEC(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte res = REG(ti->op1) - 1;
+
+    status->N = (res >> 7) & 0x1;
+    status->V = res == 0x7f;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_EOR(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte res = REG(ti->op1) ^ REG(ti->op2);
+
+    status->V = 0;
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_IN(AvrDevice *core, const ThreadedInstruction *ti) {
+    core->SetCoreReg(ti->op1, core->GetIOReg(ti->op2));
+
+    return 1;
+}
+
+static int threaded_INC(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd  = REG(ti->op1);
+    byte res = rd + 1;
+
+    status->N = (res >> 7) & 0x1;
+    status->V = rd == 0x7f;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_LDI(AvrDevice *core, const ThreadedInstruction *ti) {
+    REG(ti->op1) = ti->op2;
+
+    return 1;
+}
+
+static int threaded_LSR(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd = REG(ti->op1);
+    byte res = (rd >> 1) & 0x7f;
+
+    status->C = rd & 0x1;
+    status->N = 0;
+    status->V = status->N ^ status->C;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_MOV(AvrDevice *core, const ThreadedInstruction *ti) {
+    REG(ti->op1) = (unsigned char)REG(ti->op2);
+
+    return 1;
+}
+
+static int threaded_MOVW(AvrDevice *core, const ThreadedInstruction *ti) {
+    REG(ti->op1) = (unsigned char)REG(ti->op2);
+    REG(ti->op1 + 1) = (unsigned char)REG(ti->op2 + 1);
+
+    return 1;
+}
+
+static int threaded_NOP(AvrDevice *core, const ThreadedInstruction *ti) {
+    return 1;
+}
+
+static int threaded_OR(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte res = REG(ti->op1) | REG(ti->op2);
+
+    status->V = 0;
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = res == 0x0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_ORI(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte res = REG(ti->op1) | ti->op2;
+
+    status->V = 0;
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = res == 0x0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_OUT(AvrDevice *core, const ThreadedInstruction *ti) {
+    core->SetIOReg(ti->op2, REG(ti->op1));
+
+    return 1;
+}
+
+static int threaded_RJMP(AvrDevice *core, const ThreadedInstruction *ti) {
+    core->DebugOnJump();
+    core->PC += ti->offset;
+    core->PC &= (core->Flash->GetSize() - 1) >> 1;
+
+    return 2;
+}
+
+static int threaded_ROR(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd = REG(ti->op1);
+    byte res = (rd >> 1) | ((status->C << 7) & 0x80);
+
+    status->C = rd & 0x1;
+    status->N = (res >> 7) & 0x1;
+    status->V = status->N ^ status->C;
+    status->S = status->N ^ status->V;
+    status->Z = res == 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_SBC(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd = REG(ti->op1);
+    byte rr = REG(ti->op2);
+    byte res = rd - rr - status->C;
+
+    status->H = get_sub_carry(res, rd, rr, 3);
+    status->V = get_sub_overflow(res, rd, rr);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->C = get_sub_carry(res, rd, rr, 7);
+
+    if((res & 0xff) != 0)
+        status->Z = 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_SBCI(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd = REG(ti->op1);
+    byte k  = ti->op2;
+    byte res = rd - k - status->C;
+
+    status->H = get_sub_carry(res, rd, k, 3);
+    status->V = get_sub_overflow(res, rd, k);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->C = get_sub_carry(res, rd, k, 7);
+
+    if((res & 0xff) != 0)
+        status->Z = 0;
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_SBIW(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rdl = REG(ti->op1);
+    byte rdh = REG(ti->op1 + 1);
+    word rd = (rdh << 8) + rdl;
+    word res = rd - ti->offset;
+
+    status->V = (rdh >> 7 & 0x1) & ~(res >> 15 & 0x1);
+    status->N = (res >> 15) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xffff) == 0;
+    status->C = (res >> 15 & 0x1) & ~(rdh >> 7 & 0x1);
+
+    REG(ti->op1) = res & 0xff;
+    REG(ti->op1 + 1) = (res >> 8) & 0xff;
+
+    return 2;
+}
+
+static int threaded_SBRC(AvrDevice *core, const ThreadedInstruction *ti) {
+    if((REG(ti->op1) & ti->op2) == 0)
+        return threaded_skip(core, ti);
+    return 1;
+}
+
+static int threaded_SBRS(AvrDevice *core, const ThreadedInstruction *ti) {
+    if((REG(ti->op1) & ti->op2) != 0)
+        return threaded_skip(core, ti);
+    return 1;
+}
+
+static int threaded_SUB(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd = REG(ti->op1);
+    byte rr = REG(ti->op2);
+    byte res = rd - rr;
+
+    status->H = get_sub_carry(res, rd, rr, 3);
+    status->V = get_sub_overflow(res, rd, rr);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+    status->C = get_sub_carry(res, rd, rr, 7);
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_SUBI(AvrDevice *core, const ThreadedInstruction *ti) {
+    HWSreg *status = core->status;
+    byte rd = REG(ti->op1);
+    byte k  = ti->op2;
+    byte res = rd - k;
+
+    status->H = get_sub_carry(res, rd, k, 3);
+    status->V = get_sub_overflow(res, rd, k);
+    status->N = (res >> 7) & 0x1;
+    status->S = status->N ^ status->V;
+    status->Z = (res & 0xff) == 0;
+    status->C = get_sub_carry(res, rd, k, 7);
+
+    REG(ti->op1) = res;
+
+    return 1;
+}
+
+static int threaded_SWAP(AvrDevice *core, const ThreadedInstruction *ti) {
+    byte rd = REG(ti->op1);
+
+    REG(ti->op1) = ((rd << 4) & 0xf0) | ((rd >> 4) & 0x0f);
+
+    return 1;
+}
+
+void DecodedInstruction::Translate(ThreadedInstruction *ti) {
+    ti->handler = threaded_Generic;
+    ti->instr = this;
+    ti->twoWords = size2Word;
+    ti->cycles = 0;
+    ti->branch = false;
+    ti->kind = ThreadedInstruction::KIND_OTHER;
+}
+
+//! Set up a threaded code entry with handler and operands
+static inline void threaded_Set(ThreadedInstruction *ti,
+                                ThreadedInstruction::Handler h,
+                                unsigned char op1,
+                                unsigned char op2 = 0,
+                                int offset = 0) {
+    ti->handler = h;
+    ti->op1 = op1;
+    ti->op2 = op2;
+    ti->offset = offset;
+}
+
+void avr_op_ADC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_ADC, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_ADC;
+    ti->cycles = 1;
+}
+
+void avr_op_ADD::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_ADD, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_ADD;
+    ti->cycles = 1;
+}
+
+void avr_op_ADIW::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_ADIW, Rl, 0, K);
+    ti->kind = ThreadedInstruction::KIND_ADIW;
+    ti->cycles = 2;
+}
+
+void avr_op_AND::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_AND, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_AND;
+    ti->cycles = 1;
+}
+
+void avr_op_ANDI::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_ANDI, R1, K);
+    ti->kind = ThreadedInstruction::KIND_ANDI;
+    ti->cycles = 1;
+}
+
+void avr_op_BRBC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_BRBC, 0, bitmask, offset);
+    ti->branch = true;
+}
+
+void avr_op_BRBS::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_BRBS, 0, bitmask, offset);
+    ti->branch = true;
+}
+
+void avr_op_COM::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_COM, R1);
+    ti->kind = ThreadedInstruction::KIND_COM;
+    ti->cycles = 1;
+}
+
+void avr_op_CP::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_CP, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_CP;
+    ti->cycles = 1;
+}
+
+void avr_op_CPC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_CPC, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_CPC;
+    ti->cycles = 1;
+}
+
+void avr_op_CPI::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_CPI, R1, K);
+    ti->kind = ThreadedInstruction::KIND_CPI;
+    ti->cycles = 1;
+}
+
+void avr_op_CPSE::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_CPSE, R1, R2);
+}
+
+void avr_op_DEC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_DEC, R1);
+    ti->kind = ThreadedInstruction::KIND_DEC;
+    ti->cycles = 1;
+}
+
+void avr_op_EOR::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_EOR, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_EOR;
+    ti->cycles = 1;
+}
+
+void avr_op_IN::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_IN, R1, ioreg);
+}
+
+void avr_op_INC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_INC, R1);
+    ti->kind = ThreadedInstruction::KIND_INC;
+    ti->cycles = 1;
+}
+
+void avr_op_LDI::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_LDI, R1, K);
+    ti->kind = ThreadedInstruction::KIND_LDI;
+    ti->cycles = 1;
+}
+
+void avr_op_LSR::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_LSR, Rd);
+    ti->kind = ThreadedInstruction::KIND_LSR;
+    ti->cycles = 1;
+}
+
+void avr_op_MOV::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_MOV, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_MOV;
+    ti->cycles = 1;
+}
+
+void avr_op_MOVW::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_MOVW, Rd, Rs);
+    ti->kind = ThreadedInstruction::KIND_MOVW;
+    ti->cycles = 1;
+}
+
+void avr_op_NOP::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_NOP, 0);
+    ti->kind = ThreadedInstruction::KIND_NOP;
+    ti->cycles = 1;
+}
+
+void avr_op_OR::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_OR, Rd, Rr);
+    ti->kind = ThreadedInstruction::KIND_OR;
+    ti->cycles = 1;
+}
+
+void avr_op_ORI::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_ORI, R1, K);
+    ti->kind = ThreadedInstruction::KIND_ORI;
+    ti->cycles = 1;
+}
+
+void avr_op_OUT::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_OUT, R1, ioreg);
+}
+
+void avr_op_RJMP::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_RJMP, 0, 0, K);
+    ti->branch = true;
+}
+
+void avr_op_ROR::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_ROR, R1);
+    ti->cycles = 1;
+}
+
+void avr_op_SBC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SBC, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_SBC;
+    ti->cycles = 1;
+}
+
+void avr_op_SBCI::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SBCI, R1, K);
+    ti->kind = ThreadedInstruction::KIND_SBCI;
+    ti->cycles = 1;
+}
+
+void avr_op_SBIW::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SBIW, R1, 0, K);
+    ti->kind = ThreadedInstruction::KIND_SBIW;
+    ti->cycles = 2;
+}
+
+void avr_op_SBRC::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SBRC, R1, 1 << Kbit);
+}
+
+void avr_op_SBRS::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SBRS, R1, 1 << Kbit);
+}
+
+void avr_op_SUB::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SUB, R1, R2);
+    ti->kind = ThreadedInstruction::KIND_SUB;
+    ti->cycles = 1;
+}
+
+void avr_op_SUBI::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SUBI, R1, K);
+    ti->kind = ThreadedInstruction::KIND_SUBI;
+    ti->cycles = 1;
+}
+
+void avr_op_SWAP::Translate(ThreadedInstruction *ti) {
+    DecodedInstruction::Translate(ti);
+    threaded_Set(ti, threaded_SWAP, R1);
+    ti->kind = ThreadedInstruction::KIND_SWAP;
+    ti->cycles = 1;
+}
+
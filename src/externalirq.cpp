@@ -25,6 +25,7 @@
 
 #include "externalirq.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 
 ExternalIRQHandler::ExternalIRQHandler(AvrDevice* c,
                                        HWIrqSystem* irqsys,
@@ -107,6 +108,13 @@ void ExternalIRQHandler::Reset(void) {
         extirqs[idx]->ResetMode();
 }
 
+void ExternalIRQHandler::CheckpointState(Checkpoint &cp) {
+    cp.Value(irq_mask);
+    cp.Value(irq_flag);
+    for(unsigned int idx = 0; idx < extirqs.size(); idx++)
+        extirqs[idx]->CheckpointState(cp);
+}
+
 unsigned char ExternalIRQHandler::set_from_reg(const IOSpecialReg* reg, unsigned char nv) {
     if(reg == mask_reg) {
         // mask register: trigger interrupt, if mask bit is new set and flag is true or fireAgain()
@@ -156,6 +164,8 @@ unsigned char ExternalIRQ::get_from_client(const IOSpecialReg* reg, unsigned cha
     return (v & ~mask) | (mode << bitshift);
 }
 
+void ExternalIRQ::CheckpointState(Checkpoint &cp) { cp.Value(mode); }
+
 ExternalIRQSingle::ExternalIRQSingle(IOSpecialReg *ctrl, int ctrlOffset, int ctrlBits, Pin *pin, bool _8515mode):
     ExternalIRQ(ctrl, ctrlOffset, ctrlBits)
 {
@@ -217,6 +227,11 @@ bool ExternalIRQSingle::mustSetFlagOnFire(void) {
     return mode != MODE_LEVEL_LOW;
 }
 
+void ExternalIRQSingle::CheckpointState(Checkpoint &cp) {
+    ExternalIRQ::CheckpointState(cp);
+    cp.Value(state);
+}
+
 ExternalIRQPort::ExternalIRQPort(IOSpecialReg *ctrl, HWPort *port):
     ExternalIRQ(ctrl, 0, port->GetPortSize())
 {
@@ -235,6 +250,11 @@ ExternalIRQPort::ExternalIRQPort(IOSpecialReg *ctrl, HWPort *port):
     ResetMode();
 }
 
+void ExternalIRQPort::CheckpointState(Checkpoint &cp) {
+    ExternalIRQ::CheckpointState(cp);
+    cp.Array(state, 8);
+}
+
 void ExternalIRQPort::PinStateHasChanged(Pin *pin) {
     // new state
     bool s = (bool)*pin;
@@ -66,6 +66,7 @@ class ExternalIRQHandler: public Hardware, public IOSpecialRegClient {
         virtual void Reset(void);
         virtual bool IsLevelInterrupt(unsigned int vector);
         virtual bool LevelInterruptPending(unsigned int vector);
+        virtual void CheckpointState(Checkpoint &cp);
         
         // from IOSpecialRegClient
         virtual unsigned char set_from_reg(const IOSpecialReg* reg, unsigned char nv);
@@ -95,6 +96,8 @@ class ExternalIRQ: public IOSpecialRegClient {
         virtual bool fireAgain(void) { return false; }
         //! does fire interrupt set the interrupt flag? (level interrupt does this not!)
         virtual bool mustSetFlagOnFire(void) { return true; }
+        //! Saves or restores mode and pin states for a checkpoint
+        virtual void CheckpointState(Checkpoint &cp);
         
         friend class ExternalIRQHandler;
         
@@ -128,6 +131,7 @@ class ExternalIRQSingle: public ExternalIRQ, public HasPinNotifyFunction {
         void ChangeMode(unsigned char m);
         bool fireAgain(void);
         bool mustSetFlagOnFire(void);
+        void CheckpointState(Checkpoint &cp);
         
         // from HasPinNotifyFunction
         void PinStateHasChanged(Pin *pin);
@@ -144,6 +148,9 @@ class ExternalIRQPort: public ExternalIRQ, public HasPinNotifyFunction {
     public:
         ExternalIRQPort(IOSpecialReg *ctrl, HWPort *port);
         
+        // from ExternalIRQ
+        void CheckpointState(Checkpoint &cp);
+        
         // from HasPinNotifyFunction
         void PinStateHasChanged(Pin *pin);
 };
@@ -34,6 +34,7 @@
 #include "helper.h"
 #include "memory.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 
 void AvrFlash::Decode(){
     for(unsigned int addr = 0; addr < size ; addr += 2)
@@ -44,6 +45,7 @@ AvrFlash::AvrFlash(AvrDevice *c, int _size):
     Memory(_size),
     core(c),
     DecodedMem(_size),
+    ThreadedMem(_size / 2 + 1),
     flashLoaded(false) {
     for(unsigned int tt = 0; tt < size; tt++)
         myMemory[tt] = 0xff;  // Safeguard, will be decoded as avr_op_ILLEGAL
@@ -83,6 +85,96 @@ DecodedInstruction* AvrFlash::GetInstruction(unsigned int pc) {
     return DecodedMem[pc];
 }
 
+const ThreadedInstruction* AvrFlash::GetThreadedInstruction(unsigned int pc) {
+    if(IsRWWLock(pc * 2))
+        avr_error("flash is locked (RWW lock)");
+    return &ThreadedMem[pc];
+}
+
+ThreadedInstruction* AvrFlash::GetBlock(unsigned int pc) {
+    if(IsRWWLock(pc * 2))
+        avr_error("flash is locked (RWW lock)");
+    if(ThreadedMem[pc].blockLength == 0)
+        BuildBlock(pc);
+    return &ThreadedMem[pc];
+}
+
+void AvrFlash::BuildBlock(unsigned int index) {
+    // the sentinel entry at the end of ThreadedMem stops the loop
+    unsigned int len = 0;
+    unsigned int cycles = 0;
+    while(len < maxBlockLength && ThreadedMem[index + len].cycles != 0) {
+        cycles += ThreadedMem[index + len].cycles;
+        len++;
+    }
+    // a branch or jump may terminate the block
+    if(len > 0 && len < maxBlockLength && ThreadedMem[index + len].branch)
+        len++;
+    ThreadedMem[index].blockLength = (len == 0) ? 1 : len;
+    ThreadedMem[index].blockCycles = cycles;
+}
+
+ThreadedInstruction* AvrFlash::GetLoop(unsigned int pc) {
+    if(IsRWWLock(pc * 2))
+        avr_error("flash is locked (RWW lock)");
+    if(ThreadedMem[pc].loopKind == ThreadedInstruction::LOOP_UNKNOWN)
+        AnalyseLoop(pc);
+    return &ThreadedMem[pc];
+}
+
+void AvrFlash::AnalyseLoop(unsigned int index) {
+    ThreadedInstruction *ti = &ThreadedMem[index];
+    unsigned int words = ThreadedMem.size() - 1;
+    ti->loopKind = ThreadedInstruction::LOOP_NONE;
+
+    // polling loop: "1: sbis/sbic ioreg, bit ; rjmp 1b"
+    word opcode = (myMemory[index * 2] << 8) + myMemory[index * 2 + 1];
+    if((opcode & 0xfd00) == 0x9900 && index + 1 < words) {
+        word next = (myMemory[index * 2 + 2] << 8) + myMemory[index * 2 + 3];
+        if(next == 0xcffe) {
+            ti->loopKind = (opcode & 0x0200) ? ThreadedInstruction::LOOP_WAIT_SET :
+                                               ThreadedInstruction::LOOP_WAIT_CLEAR;
+            ti->loopLength = 2;
+            ti->loopCycles = 1 + 2;
+        }
+        return;
+    }
+
+    // countdown loop: "1: dec r ; brne 1b", "1: sbiw r, 1 ; brne 1b" or
+    // "1: subi r, 1 ; sbci r+1, 0 ; ... ; brne 1b", see avr-libc delay functions
+    unsigned int len = 0;
+    if(ti->kind == ThreadedInstruction::KIND_DEC)
+        len = 1;
+    else if(ti->kind == ThreadedInstruction::KIND_SBIW && ti->offset == 1)
+        len = 1;
+    else if(ti->kind == ThreadedInstruction::KIND_SUBI && ti->op2 == 1) {
+        len = 1;
+        while(len < 4 && ThreadedMem[index + len].kind == ThreadedInstruction::KIND_SBCI &&
+              ThreadedMem[index + len].op2 == 0 &&
+              ThreadedMem[index + len].op1 == ti->op1 + len)
+            len++;
+    }
+    if(len == 0 || index + len >= words)
+        return;
+    opcode = (myMemory[(index + len) * 2] << 8) + myMemory[(index + len) * 2 + 1];
+    // brne back to start of loop
+    if((opcode & 0xfc07) == 0xf401 && ThreadedMem[index + len].offset == -(int)(len + 1)) {
+        unsigned int cycles = 2;
+        for(unsigned int i = 0; i < len; i++)
+            cycles += ThreadedMem[index + i].cycles;
+        ti->loopKind = ThreadedInstruction::LOOP_COUNTDOWN;
+        ti->loopLength = len + 1;
+        ti->loopCycles = cycles;
+    }
+}
+
+void AvrFlash::ClearNative(void) {
+    for(unsigned int i = 0; i < ThreadedMem.size(); i++) {
+        ThreadedMem[i].native = NULL;
+        ThreadedMem[i].hits = 0;
+    }
+}
+
 unsigned int AvrFlash::GetOpcode(unsigned int pc) {
     unsigned int addr = pc * 2;
     if(IsRWWLock(addr))
@@ -121,6 +213,15 @@ void AvrFlash::Decode(unsigned int addr) {
     if(DecodedMem[index] != NULL)
         delete DecodedMem[index];                     //delete old Instruction here 
     DecodedMem[index] = lookup_opcode(opcode, core);  //and set new one
+    DecodedMem[index]->Translate(&ThreadedMem[index]);
+    // invalidate all blocks and loops, which could contain this instruction
+    unsigned int first = (index < maxBlockLength) ? 0 : index - maxBlockLength + 1;
+    for(unsigned int i = first; i <= index; i++) {
+        ThreadedMem[i].loopKind = ThreadedInstruction::LOOP_UNKNOWN;
+        ThreadedMem[i].blockLength = 0;
+        ThreadedMem[i].native = NULL;
+        ThreadedMem[i].hits = 0;
+    }
 }
 
 /** Returns true if insn at address index*2 looks like switching thread stacks (heuristics).
@@ -162,3 +263,21 @@ bool AvrFlash::LooksLikeContextSwitch(unsigned int addr) const
 
     return true;
 }
+
+void AvrFlash::CheckpointState(Checkpoint &cp) {
+    cp.Value(rww_lock);
+    cp.Value(flashLoaded);
+    if(cp.IsSaving()) {
+        cp.Block(myMemory, size);
+        return;
+    }
+    std::vector<unsigned char> saved(size);
+    cp.Block(&saved[0], size);
+    for(unsigned int addr = 0; addr < size; addr += 2) {
+        if(myMemory[addr] != saved[addr] || myMemory[addr + 1] != saved[addr + 1]) {
+            myMemory[addr] = saved[addr];
+            myMemory[addr + 1] = saved[addr + 1];
+            Decode(addr);
+        }
+    }
+}
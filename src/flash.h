@@ -33,15 +33,26 @@
 #include "memory.h"
 
 class DecodedInstruction;
+class Checkpoint;
 
 //! Holds AVR flash content and symbol informations.
 class AvrFlash: public Memory {
   
+    public:
+        //! Max count of instructions in one block, see GetBlock
+        static const unsigned int maxBlockLength = 32;
+
     protected:
         AvrDevice *core;
         std::vector <DecodedInstruction*> DecodedMem;
+        std::vector <ThreadedInstruction> ThreadedMem; //!< threaded code table, one entry per word and one sentinel
         unsigned int rww_lock; //!< When Flash write is in progress then addresses below this are inaccesible, otherwise 0.
         bool flashLoaded; //!< Flag, true if there was a write to Flash after constructor call (program load)
+
+        //! Builds block, which starts at word index
+        void BuildBlock(unsigned int index);
+        //! Looks for a busy-wait loop, which starts at word index
+        void AnalyseLoop(unsigned int index);
         
         friend int avr_op_CPSE::operator()();
         friend int avr_op_SBIC::operator()();
@@ -85,6 +96,18 @@ class AvrFlash: public Memory {
         /*! Returns instruction at pointer PC. Aborts if Flash write is in progress. */
         DecodedInstruction* GetInstruction(unsigned int pc);
 
+        /*! Returns threaded code entry at pointer PC. Aborts if Flash write is in progress. */
+        const ThreadedInstruction* GetThreadedInstruction(unsigned int pc);
+
+        /*! Returns threaded code entry at pointer PC with a built block. Aborts if Flash write is in progress. */
+        ThreadedInstruction* GetBlock(unsigned int pc);
+
+        /*! Returns threaded code entry at pointer PC with analysed busy-wait loop. Aborts if Flash write is in progress. */
+        ThreadedInstruction* GetLoop(unsigned int pc);
+
+        /*! Forget all native code of blocks, see AvrJit */
+        void ClearNative(void);
+
         /*! Returns opcode at PC. Aborts if Flash write is in progress. */
         unsigned int GetOpcode(unsigned int pc);
         
@@ -101,6 +124,11 @@ class AvrFlash: public Memory {
         unsigned int ReadMemWord(unsigned int addr);
 
         bool LooksLikeContextSwitch(unsigned int addr) const;
+
+        /*! Saves or restores flash content for a checkpoint. On restore only
+          changed instructions are decoded again, so restore is cheap, if
+          the same program is loaded already. */
+        void CheckpointState(Checkpoint &cp);
 };
 
 #endif
@@ -28,6 +28,7 @@
 #include "systemclock.h"
 #include "avrmalloc.h"
 #include "flash.h"
+#include "checkpoint.h"
 
 //#include <iostream>
 //using namespace std;
@@ -78,9 +79,6 @@ FlashProgramming::FlashProgramming(AvrDevice *c,
     
     // reset processing engine
     Reset();
-    
-    // add to cycle list
-    core->AddToCycleList(this);
 }
 
 FlashProgramming::~FlashProgramming() {
@@ -96,19 +94,39 @@ unsigned int FlashProgramming::CpuCycle() {
     }
     // process CPU lock
     if(action == SPM_ACTION_LOCKCPU) {
-        if(SystemClock::Instance().GetCurrentTime() < timeout)
+        if(core->GetSystemClock().GetCurrentTime() < timeout)
             return 1;
         ClearOperationBits();
     }
+    // leave cycle list, till next operation is prepared
+    if(opr_enable_count == 0)
+        core->RemoveFromCycleList(this);
     return 0;
 }
 
+unsigned long long FlashProgramming::IdleCycles() {
+    // timeout or CPU lock is running
+    if(opr_enable_count > 0 || action == SPM_ACTION_LOCKCPU)
+        return 0;
+    return idleForever;
+}
+
 void FlashProgramming::Reset() {
     spmcr_val = 0;
     opr_enable_count = 0;
     action = SPM_ACTION_NOOP;
     spm_opr = SPM_OPS_NOOP;
     timeout = 0;
+    core->RemoveFromCycleList(this);
+}
+
+void FlashProgramming::CheckpointState(Checkpoint &cp) {
+    cp.Value(spmcr_val);
+    cp.Value(opr_enable_count);
+    cp.Enum(action);
+    cp.Enum(spm_opr);
+    cp.Value(timeout);
+    cp.Block(tempBuffer, pageSize * 2);
 }
 
 unsigned char FlashProgramming::LPM_action(unsigned int xaddr, unsigned int addr) {
@@ -153,7 +171,7 @@ int FlashProgramming::SPM_action(unsigned int data, unsigned int xaddr, unsigned
             // store temp buffer to flash
             core->Flash->WriteMem(tempBuffer, addr, pageSize * 2);
             // calculate system time, where operation is finished
-            timeout = SystemClock::Instance().GetCurrentTime() + FlashProgramming::SPM_TIMEOUT;
+            timeout = core->GetSystemClock().GetCurrentTime() + FlashProgramming::SPM_TIMEOUT;
             // lock cpu while writing flash
             action = SPM_ACTION_LOCKCPU;
             // lock RWW, if necessary
@@ -169,7 +187,7 @@ int FlashProgramming::SPM_action(unsigned int data, unsigned int xaddr, unsigned
                 tempBuffer[i] = 0xff;
             core->Flash->WriteMem(tempBuffer, addr, pageSize * 2);
             // calculate system time, where operation is finished
-            timeout = SystemClock::Instance().GetCurrentTime() + FlashProgramming::SPM_TIMEOUT;
+            timeout = core->GetSystemClock().GetCurrentTime() + FlashProgramming::SPM_TIMEOUT;
             // lock cpu while erasing flash
             action = SPM_ACTION_LOCKCPU;
             // lock RWW, if necessary
@@ -226,6 +244,9 @@ void FlashProgramming::SetSpmcr(unsigned char v) {
                 }
                 break;
         }
+        // count down operation enable timeout
+        if(action == SPM_ACTION_PREPARE)
+            core->AddToCycleList(this);
     }
     //cout << "spmcr=0x" << hex << (unsigned int)spmcr_val << "," << action << "," << spm_opr << endl;
 }
@@ -307,6 +328,12 @@ unsigned int AvrFuses::GetResetAddr(void) {
         return GetBLSStart();
 }
 
+void AvrFuses::CheckpointState(Checkpoint &cp) {
+    cp.Value(fuseBits);
+    cp.Value(flagBOOTRST);
+    cp.Value(valueBOOTSZ);
+}
+
 AvrLockBits::AvrLockBits(void):
     lockBitsSize(2),
     lockBits(0xff)
@@ -333,4 +360,6 @@ void AvrLockBits::SetLockBits(unsigned char bits) {
     lockBits = (lockBits & bits) | ~((1 << lockBitsSize) - 1);
 }
 
+void AvrLockBits::CheckpointState(Checkpoint &cp) { cp.Value(lockBits); }
+
 // EOF
@@ -31,6 +31,7 @@
 #include "systemclocktypes.h"
 
 class AvrDevice;
+class Checkpoint;
 
 //! Provides the programming engine for flash self programming
 /*! \todo not implemented yet: SPM interrupt. Support of LPM operation.
@@ -85,7 +86,9 @@ class FlashProgramming: public Hardware {
         ~FlashProgramming();
         
         unsigned int CpuCycle();
+        unsigned long long IdleCycles(void);
         void Reset();
+        void CheckpointState(Checkpoint &cp);
         
         unsigned char LPM_action(unsigned int xaddr, unsigned int addr);
         int SPM_action(unsigned int data, unsigned int xaddr, unsigned int addr);
@@ -131,6 +134,8 @@ class AvrFuses {
         unsigned int GetBLSStart(void);
         //! Get reset address
         unsigned int GetResetAddr(void);
+        //! Saves or restores fuse values for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 
 };
 
@@ -151,6 +156,8 @@ class AvrLockBits {
         unsigned char GetLockByte(void) { return lockBits; }
         //! Set lock bits (from a SPM instruction)
         void SetLockBits(unsigned char bits);
+        //! Saves or restores lock bits for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 
 };
 
@@ -25,7 +25,12 @@
 
 #include "hardware.h"
 #include "avrdevice.h"
+#include "checkpoint.h"
+
+const unsigned long long Hardware::idleForever;
 
 Hardware::Hardware(AvrDevice *core) { core->AddToResetList(this); }
 
+void Hardware::CheckpointState(Checkpoint &cp) { cp.Unsupported(this); }
+
 // EOF
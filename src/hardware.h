@@ -29,6 +29,7 @@
 #include "baseobj.h"
 
 class AvrDevice;
+class Checkpoint;
 
 /*! Hardware objects are the subsystems of an AVR device. They have a clock and
   reset input and in addition will define various memory registers through
@@ -47,6 +48,20 @@ class Hardware : public BaseObj {
           not be executed (e.g. a Flash write is in progress). */
         virtual unsigned int CpuCycle(void) { return 0; }
 
+        /*! Returns the count of following AVR cycles, on which CpuCycle would
+          do nothing else than counting, so that these cycles can be skipped
+          by SkipCycles. The default 0 means, that the hardware needs every
+          cycle. Return idleForever, if there is no limit. */
+        virtual unsigned long long IdleCycles(void) { return 0; }
+
+        /*! Fast-forwards the hardware by the given count of cycles, instead
+          of calling CpuCycle for each of them. Count is never more than
+          IdleCycles returned before. */
+        virtual void SkipCycles(unsigned long long cycles) {}
+
+        //! Value for IdleCycles, if hardware never needs a cycle
+        static const unsigned long long idleForever = ~0ULL;
+
         /*! Implement the hardware's reset functionality here. The default
           is no action on reset. */
         virtual void Reset(void) {};
@@ -60,6 +75,11 @@ class Hardware : public BaseObj {
         
         /*! Check a level interrupt on the time, where interrupt routine will be called */
         virtual bool LevelInterruptPending(unsigned int vector) { return false; }
+
+        /*! Saves or restores the state of the hardware for a checkpoint by
+          calls to Checkpoint::Value and so on, see Checkpoint. The default
+          reports, that the hardware doesn't support checkpoints. */
+        virtual void CheckpointState(Checkpoint &cp);
 };
 
 #endif
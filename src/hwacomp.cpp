@@ -28,6 +28,7 @@
 #include "irqsystem.h"
 #include "hwad.h"
 #include "hwtimer.h"
+#include "checkpoint.h"
 
 HWAcomp::HWAcomp(AvrDevice *core,
                  HWIrqSystem *irqsys,
@@ -186,6 +187,12 @@ void HWAcomp::ClearIrqFlag(unsigned int vector){
     }
 }
 
+void HWAcomp::CheckpointState(Checkpoint &cp) {
+    cp.Value(acme_sfior);
+    cp.Value(enabled);
+    cp.Value(acsr);
+}
+
 unsigned char HWAcomp::set_from_reg(const IOSpecialReg* reg, unsigned char nv) {
     // check, if ACME bit is set
     acme_sfior = (nv & 0x08) == 0x08;
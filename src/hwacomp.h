@@ -102,6 +102,8 @@ class HWAcomp: public Hardware,
         void Reset();
         //! Reflect irq processing, reset interrupt source
         void ClearIrqFlag(unsigned int vec);
+        //! Save or restore state for a checkpoint
+        void CheckpointState(Checkpoint &cp);
         //! Get informed about input pin change
         void PinStateHasChanged(Pin *);
         //! Get analog value for comparator input 0
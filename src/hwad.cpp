@@ -26,6 +26,7 @@
 #include "hwad.h"
 #include "irqsystem.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 
 HWARefPin::HWARefPin(AvrDevice *_core):
     HWARef(_core),
@@ -105,6 +106,8 @@ void HWAdmux::PinStateHasChanged(Pin* p) {
         notifyClient->NotifySignalChanged();
 }
 
+void HWAdmux::CheckpointState(Checkpoint &cp) { cp.Value(muxSelect); }
+
 HWAdmux6::HWAdmux6(AvrDevice* c, Pin*  _ad0,
                                  Pin*  _ad1,
                                  Pin*  _ad2,
@@ -308,6 +311,9 @@ HWAd::HWAd(AvrDevice *c, int _typ, HWIrqSystem *i, unsigned int iv, HWAdmux *a,
     irqSystem(i),
     irqVec(iv),
     notifyClient(NULL),
+    suspended(false),
+    suspendedAt(0),
+    wakeupTimer(c->GetSystemClock(), this, &HWAd::Resume),
     adch_reg(this, "ADCH",  this, &HWAd::GetAdch, 0),
     adcl_reg(this, "ADCL",  this, &HWAd::GetAdcl, 0),
     adcsra_reg(this, "ADCSRA", this, &HWAd::GetAdcsrA, &HWAd::SetAdcsrA),
@@ -315,7 +321,6 @@ HWAd::HWAd(AvrDevice *c, int _typ, HWIrqSystem *i, unsigned int iv, HWAdmux *a,
     admux_reg(this, "ADMUX", this, &HWAd::GetAdmux, &HWAd::SetAdmux) {
     mux->RegisterNotifyClient(this);
     irqSystem->DebugVerifyInterruptVector(irqVec, this);
-    core->AddToCycleList(this);
 
     Reset();
 }
@@ -331,6 +336,10 @@ void HWAd::Reset(void) {
     conversionState = 0;
     firstConversion = true;
     adchLocked = false;
+    // counters are reset, so nothing to count after suspend
+    suspended = false;
+    wakeupTimer.Cancel();
+    core->RemoveFromCycleList(this);
 }
 
 void HWAd::NotifySignalChanged(void) {
@@ -349,6 +358,8 @@ unsigned char HWAd::GetAdcl(void) {
 }
 
 void HWAd::SetAdcsrA(unsigned char val) {
+    // count missed clocks with old prescaler, CpuCycle suspends again, if idle
+    Resume();
     bool enabled = (adcsra & ADEN) == ADEN;
     // clear IRQ Flag if set in val, otherwise do not overwrite ADIF
     if((val & ADIF) == ADIF)
@@ -368,6 +379,15 @@ void HWAd::SetAdcsrA(unsigned char val) {
     if(!enabled && ((adcsra & ADEN) == ADEN))
         firstConversion = true;
 
+    // disabled ADC holds prescaler in reset and doesn't need core cycles,
+    // an enabled one checks on next cycle, how long it can suspend
+    if((adcsra & ADEN) == ADEN)
+        core->AddToCycleList(this);
+    else {
+        prescaler = 0;
+        core->RemoveFromCycleList(this);
+    }
+
     // handle interrupt, if fresh enabled
     if((adcsra & (ADIE | ADIF)) == (ADIE | ADIF))
         irqSystem->SetIrqFlag(this, irqVec);
@@ -407,6 +427,26 @@ void HWAd::ClearIrqFlag(unsigned int vector){
     }
 }
 
+void HWAd::CheckpointState(Checkpoint &cp) {
+    cp.Value(adch);
+    cp.Value(adcl);
+    cp.Value(adcsra);
+    cp.Value(adcsrb);
+    cp.Value(admux);
+    cp.Value(adchLocked);
+    cp.Value(adSample);
+    cp.Value(adMuxConfig);
+    cp.Value(prescaler);
+    cp.Value(prescalerSelect);
+    cp.Value(conversionState);
+    cp.Value(firstConversion);
+    cp.Enum(state);
+    cp.Value(suspended);
+    cp.Value(suspendedAt);
+    cp.Timer(wakeupTimer);
+    mux->CheckpointState(cp);
+}
+
 /* ATTENTION: prescaler clock here runs 2 times faster then clock cycle in spec.
    we need the half clock for getting the analog values
    by cycle 1.5 as noted in AVR spec., this means cycle 3 in this model! */
@@ -450,6 +490,47 @@ bool HWAd::IsPrescalerClock(void) {
     return false;
 }
 
+unsigned long long HWAd::IdleCycles(void) {
+    // disabled ADC holds prescaler in reset
+    if((adcsra & ADEN) == 0)
+        return idleForever;
+
+    // prescaler clocks till CpuCycle does more than counting
+    int clocks;
+    if(state == IDLE) {
+        // waits for ADSC, which can't be set without an event
+        if(conversionState == 0 && (adcsra & ADSC) == 0)
+            return idleForever;
+        clocks = 1;
+    } else if(state == INIT)
+        clocks = (13 * 2) - conversionState;
+    else if(conversionState < ((1 * 2) + 1))
+        clocks = ((1 * 2) + 1) - conversionState; // sample time
+    else if(conversionState < (13 * 2))
+        clocks = (13 * 2) - conversionState; // result
+    else
+        clocks = (14 * 2) - conversionState; // end of conversion
+    if(clocks < 1)
+        return 0;
+
+    // next prescaler clock comes after this cycles, the following every div cycles
+    int div = GetPrescalerDivider();
+    unsigned long long first = div - prescaler % div;
+    return first + (unsigned long long)(clocks - 1) * div - 1;
+}
+
+void HWAd::SkipCycles(unsigned long long cycles) {
+    if((adcsra & ADEN) == 0) {
+        prescaler = 0;
+        return;
+    }
+    int div = GetPrescalerDivider();
+    unsigned long long clocks = (prescaler % div + cycles) / div;
+    prescaler = (prescaler + cycles) % 64;
+    if(state != IDLE)
+        conversionState += clocks;
+}
+
 int HWAd::GetTriggerSource(void) {
     return adcsrb & ADTS;
 }
@@ -587,9 +668,34 @@ unsigned int HWAd::CpuCycle() {
         } // end of switch state
     }
 
+    Suspend();
     return 0;
 }
 
+void HWAd::Suspend(void) {
+    // with active dumpers core doesn't skip cycles, so an enabled ADC doesn't too
+    if(core->dumpManager != NULL && core->dumpManager->IsDumping())
+        return;
+    unsigned long long idle = IdleCycles();
+    if(idle == 0)
+        return;
+    suspended = true;
+    suspendedAt = core->GetClockCycles();
+    core->RemoveFromCycleList(this);
+    // waiting for ADSC doesn't need a timer, it's set by a write to ADCSRA
+    if(idle != idleForever)
+        wakeupTimer.Start((SystemClockOffset)(idle + 1) * core->GetClockFreq() - 1);
+}
+
+void HWAd::Resume(void) {
+    if(!suspended)
+        return;
+    suspended = false;
+    wakeupTimer.Cancel();
+    SkipCycles(core->GetClockCycles() - suspendedAt);
+    core->AddToCycleList(this);
+}
+
 HWAd_SFIOR::HWAd_SFIOR(AvrDevice *c, int _typ, HWIrqSystem *i, unsigned int iv, HWAdmux *a, HWARef *r, IOSpecialReg *s):
     HWAd(c, _typ, i, iv, a, r),
     sfior_reg(s) {
@@ -602,4 +708,9 @@ unsigned char HWAd_SFIOR::set_from_reg(const IOSpecialReg* reg, unsigned char nv
     return nv;
 }
 
+void HWAd_SFIOR::CheckpointState(Checkpoint &cp) {
+    HWAd::CheckpointState(cp);
+    cp.Value(adts);
+}
+
 // EOF
@@ -30,6 +30,7 @@
 #include "avrdevice.h"
 #include "rwmem.h"
 #include "traceval.h"
+#include "systemclock.h"
 
 //! Reference source for ADC (base class)
 class HWARef {
@@ -112,6 +113,8 @@ class HWAdmux: public HasPinNotifyFunction {
         void PinStateHasChanged(Pin*);
         void RegisterNotifyClient(AnalogSignalChange *client) { notifyClient = client; }
         void UnregisterNotifyClient(void) { notifyClient = 0; }
+        //! Saves or restores selected channel for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 class HWAdmux6: public HWAdmux {
@@ -176,7 +179,12 @@ class HWAdmuxT25: public HWAdmuxM8 {
         virtual bool IsDifferenceChannel(int select);
 };
 
-/** Analog-digital converter (ADC) */
+/** Analog-digital converter (ADC)
+
+  Between the steps of a conversion and while it waits for ADSC, the ADC
+  leaves the cycle list. A SystemClockTimer brings it back shortly before the
+  ADC clock, on which the input is sampled or the conversion is completed. A
+  write to ADCSRA wakes it up too. */
 class HWAd: public Hardware, public TraceValueRegister, public AnalogSignalChange {
 
     protected:
@@ -200,6 +208,9 @@ class HWAd: public Hardware, public TraceValueRegister, public AnalogSignalChang
         int conversionState;
         bool firstConversion;
         AnalogSignalChange *notifyClient;
+        bool suspended;         //!< True, if removed from cycle list, because ADC only counts clocks
+        unsigned long long suspendedAt; //!< Core clock count, on which ADC was removed from cycle list
+        SystemClockTimer<HWAd> wakeupTimer; //!< Brings ADC back to cycle list before next conversion step
 
         enum T_State {
             IDLE,
@@ -223,10 +234,16 @@ class HWAd: public Hardware, public TraceValueRegister, public AnalogSignalChang
         };
 
         bool IsPrescalerClock(void);
+        //! Returns count of cpu cycles per prescaler clock
+        int GetPrescalerDivider(void) { return (prescalerSelect < 2) ? 1 : (1 << (prescalerSelect - 1)); }
         bool IsFreeRunning(void);
         virtual int GetTriggerSource(void);
         int ConversionBipolar(float value, float ref);
         int ConversionUnipolar(float value, float ref);
+        //! Leaves cycle list till next step of conversion
+        void Suspend(void);
+        //! Rejoins cycle list after suspend and counts the clocks, which are missed
+        void Resume(void);
 
     public:
         enum {
@@ -250,6 +267,10 @@ class HWAd: public Hardware, public TraceValueRegister, public AnalogSignalChang
         virtual ~HWAd() { mux->UnregisterNotifyClient(); }
 
         unsigned int CpuCycle();
+        //! Returns cycles till next step of conversion, see Hardware
+        unsigned long long IdleCycles(void);
+        //! Counts prescaler and conversion clocks of skipped cycles at once, see Hardware
+        void SkipCycles(unsigned long long cycles);
 
         unsigned char GetAdch(void);
         unsigned char GetAdcl(void);
@@ -261,6 +282,7 @@ class HWAd: public Hardware, public TraceValueRegister, public AnalogSignalChang
         void SetAdmux(unsigned char val);
         void Reset(void);
         void ClearIrqFlag(unsigned int vec);
+        void CheckpointState(Checkpoint &cp);
 
         // interface for notify signal change in multiplexer
         void NotifySignalChanged(void);
@@ -289,6 +311,7 @@ class HWAd_SFIOR: public HWAd, public IOSpecialRegClient {
         HWAd_SFIOR(AvrDevice *c, int _typ, HWIrqSystem *i, unsigned int iv, HWAdmux *a, HWARef *r, IOSpecialReg *s);
 
         void Reset(void) { HWAd::Reset(); adts = 0; }
+        void CheckpointState(Checkpoint &cp);
 
         unsigned char set_from_reg(const IOSpecialReg* reg, unsigned char nv);
         unsigned char get_from_client(const IOSpecialReg* reg, unsigned char v) { return v; }
@@ -28,6 +28,7 @@
 #include "systemclock.h"
 #include "irqsystem.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 #include <assert.h>
 
 using namespace std;
@@ -43,6 +44,7 @@ HWEeprom::HWEeprom(AvrDevice *_core,
     core(_core),
     irqSystem(_irqSystem),
     irqVectorNo(irqVec),
+    writeDoneTimer(_core->GetSystemClock(), this, &HWEeprom::WriteDone),
     eearh_reg(this, "EEARH",
               this, &HWEeprom::GetEearh, &HWEeprom::SetEearh),
     eearl_reg(this, "EEARL",
@@ -52,6 +54,7 @@ HWEeprom::HWEeprom(AvrDevice *_core,
     eecr_reg(this, "EECR",
              this, &HWEeprom::GetEecr, &HWEeprom::SetEecr)
 {
+    eecr_reg.SetSideEffectFree();
     if(irqSystem)
         irqSystem->DebugVerifyInterruptVector(irqVectorNo, this);
 
@@ -196,7 +199,11 @@ void HWEeprom::SetEecr(unsigned char newval) {
                         t = writeDelayTime;
                         break;
                 }
-                writeDoneTime = SystemClock::Instance().GetCurrentTime() + t;
+                writeDoneTime = core->GetSystemClock().GetCurrentTime() + t;
+                // engine leaves cycle list till shortly before writeDoneTime,
+                // so that it is back in list on the first cycle after
+                if(t > 1)
+                    writeDoneTimer.Start(t - 1);
                 if(core->trace_on)
                     traceOut << " EEPROM: Write start";
             }
@@ -206,6 +213,7 @@ void HWEeprom::SetEecr(unsigned char newval) {
             // enable write mode, mode change will not happen!
             if((eecr & CTRL_ENABLE) == CTRL_ENABLE) {
                 opEnableCycles = 4;
+                core->AddToCycleList(this);
             }
             // read is ignored here
             eecr &= ~CTRL_READ;
@@ -232,7 +240,7 @@ unsigned int HWEeprom::CpuCycle() {
     
     // handle write state
     if(opState == OPSTATE_WRITE) {
-        if(SystemClock::Instance().GetCurrentTime() >= writeDoneTime) {
+        if(core->GetSystemClock().GetCurrentTime() >= writeDoneTime) {
             // go to ready state
             opState = OPSTATE_READY;
             // reset write enable bit
@@ -259,8 +267,9 @@ unsigned int HWEeprom::CpuCycle() {
         }
     }
     
-    // deactivate engine, if not used
-    if((opState == OPSTATE_READY) && (cpuHoldCycles == 0) && (opEnableCycles == 0))
+    // deactivate engine, if not used or waiting for end of write operation
+    if(((opState == OPSTATE_READY) || ((opState == OPSTATE_WRITE) && writeDoneTimer.IsScheduled())) &&
+       (cpuHoldCycles == 0) && (opEnableCycles == 0))
         core->RemoveFromCycleList(this);
     
     // handle cpu hold state
@@ -277,6 +286,20 @@ void HWEeprom::ClearIrqFlag(unsigned int vector) {
         irqSystem->ClearIrqFlag(irqVectorNo);
 }
 
+void HWEeprom::CheckpointState(Checkpoint &cp) {
+    cp.Block(myMemory, size);
+    cp.Value(eear);
+    cp.Value(eecr);
+    cp.Value(eedr);
+    cp.Value(opEnableCycles);
+    cp.Value(cpuHoldCycles);
+    cp.Value(opState);
+    cp.Value(opMode);
+    cp.Value(opAddr);
+    cp.Value(writeDoneTime);
+    cp.Timer(writeDoneTimer);
+}
+
 void HWEeprom::WriteAtAddress(unsigned int addr, unsigned char val) {
     myMemory[addr] = val;
 }
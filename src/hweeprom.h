@@ -31,6 +31,7 @@
 #include "memory.h"
 #include "traceval.h"
 #include "irqsystem.h"
+#include "systemclock.h"
 
 class HWEeprom: public Hardware, public Memory, public TraceValueRegister {
     protected:
@@ -51,6 +52,10 @@ class HWEeprom: public Hardware, public Memory, public TraceValueRegister {
         SystemClockOffset eraseDelayTime;
         SystemClockOffset writeDelayTime;
         SystemClockOffset writeDoneTime;
+        SystemClockTimer<HWEeprom> writeDoneTimer; //!< wakes up engine at end of write operation
+
+        //! Called by writeDoneTimer, engine needs cpu cycles again
+        void WriteDone(void) { core->AddToCycleList(this); }
         
     public:
         enum {
@@ -82,6 +87,7 @@ class HWEeprom: public Hardware, public Memory, public TraceValueRegister {
         virtual unsigned int CpuCycle();
         void Reset();
         void ClearIrqFlag(unsigned int vector);
+        void CheckpointState(Checkpoint &cp);
 
         void WriteMem(const unsigned char *, unsigned int offset, unsigned int size);
         void WriteAtAddress(unsigned int, unsigned char);
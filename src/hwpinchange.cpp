@@ -2,6 +2,7 @@
 #include <iostream>
 #include "hwpinchange.h"
 #include "irqsystem.h"
+#include "checkpoint.h"
 
 using namespace std;
 
@@ -159,6 +160,12 @@ void HWPcir::Reset(){
 	_pcifr	= 0;
 	}
 
+void HWPcir::CheckpointState(Checkpoint &cp){
+	// pending irqs are saved by irq system
+	cp.Value(_pcicr);
+	cp.Value(_pcifr);
+	}
+
 void HWPcir::ClearIrqFlag(unsigned int vector){
 	if(vector == _vector0){
 		_pcifr	&= ~(1<<0);
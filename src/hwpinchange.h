@@ -102,6 +102,7 @@ class HWPcir : public HWPcifrApi , public HWPcirMaskApi , public Hardware {
 	private:	// Hardware
         void Reset();
         void ClearIrqFlag(unsigned int vector);
+        void CheckpointState(Checkpoint &cp);
 
 	
 	};
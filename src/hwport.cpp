@@ -29,6 +29,7 @@ using namespace std;
 #include "hwport.h"
 #include "avrdevice.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 #include <assert.h>
 
 HWPort::HWPort(AvrDevice *core, const string &name, bool portToggle, int size):
@@ -43,6 +44,9 @@ HWPort::HWPort(AvrDevice *core, const string &name, bool portToggle, int size):
     ddr_reg(this, "DDR",
             this, &HWPort::GetDdr, &HWPort::SetDdr)
 {
+    port_reg.SetSideEffectFree();
+    pin_reg.SetSideEffectFree();
+    ddr_reg.SetSideEffectFree();
     if(size > 8 || size < 1)
         size = 8;
     portSize = size;
@@ -88,6 +92,18 @@ void HWPort::Reset(void) {
     CalcOutputs();
 }
 
+void HWPort::CheckpointState(Checkpoint &cp) {
+    cp.Value(port);
+    cp.Value(ddr);
+    cp.Value(alternateDdr);
+    cp.Value(useAlternateDdr);
+    cp.Value(alternatePort);
+    cp.Value(useAlternatePort);
+    cp.Value(useAlternatePortIfDdrSet);
+    if(!cp.IsSaving())
+        CalcOutputs();
+}
+
 Pin& HWPort::GetPin(unsigned char pinNo) {
     return p[pinNo];
 }
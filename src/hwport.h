@@ -75,6 +75,7 @@ class HWPort: public Hardware, public TraceValueRegister {
         void CalcOutputs(void);  //!< Calculate the new output value to be transmitted to the environment
         std::string GetPortString(void); //!< returns a string representation of output states
         void Reset(void);
+        void CheckpointState(Checkpoint &cp); //!< saves or restores registers, restore drives pins again
         std::string GetName(void) { return myName; } //!< returns the port name as given in constructor
         Pin& GetPin(unsigned char pinNo); //!< returns a pin reference of pin with pin number
         int GetPortSize(void) { return portSize; } //!< returns, how much bits this port controls
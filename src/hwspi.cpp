@@ -32,6 +32,7 @@
 #include "traceval.h"
 #include "irqsystem.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 
 //configuration
 #define SPIE 0x80
@@ -197,6 +198,21 @@ void HWSpi::Reset() {
     data_write=data_read=shift_in=0;
 }
 
+void HWSpi::CheckpointState(Checkpoint &cp) {
+    cp.Value(shift_in);
+    cp.Value(data_read);
+    cp.Value(data_write);
+    cp.Value(spsr);
+    cp.Value(spcr);
+    cp.Value(clkdiv);
+    cp.Value(spsr_read);
+    cp.Value(oldsck);
+    cp.Value(bitcnt);
+    cp.Value(clkcnt);
+    cp.Value(spi_cycles);
+    cp.Value(finished);
+}
+
 void HWSpi::ClearIrqFlag(unsigned int vector) {
     if (vector==irq_vector) {
         spsr&=~SPIF;
@@ -110,6 +110,7 @@ class HWSpi: public Hardware, public TraceValueRegister {
         
         unsigned int CpuCycle();
         void Reset();
+        void CheckpointState(Checkpoint &cp);
     
         void SetSPDR(unsigned char val);
         void SetSPSR(unsigned char val); // it is read only! but we need it for rwmem-> only tell that we have an error 
@@ -24,6 +24,7 @@
  */
 
 #include "hwsreg.h"
+#include "checkpoint.h"
 
 #include <iostream>
 using namespace std;
@@ -81,4 +82,11 @@ void RWSreg::set(unsigned char val) {
     *status = val;
 }
 
+void RWSreg::CheckpointState(Checkpoint &cp) {
+    unsigned char val = (int)*status;
+    cp.Value(val);
+    if(!cp.IsSaving())
+        *status = val;
+}
+
 // EOF
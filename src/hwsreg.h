@@ -68,6 +68,8 @@ class RWSreg: public RWMemoryMember {
         RWSreg(TraceValueRegister *registry, HWSreg *s): RWMemoryMember(registry, "SREG"), status(s) {}
         //! reflect a change, which comes from CPU core
         void trigger_change(void) { tv->change((int)*status); }
+        //! saves or restores the status flags for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 
     protected:
         HWSreg *status;
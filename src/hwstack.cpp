@@ -27,6 +27,8 @@
 #include "avrerror.h"
 #include "avrmalloc.h"
 #include "flash.h"
+#include "irqsystem.h"
+#include "checkpoint.h"
 #include <assert.h>
 #include <cstdio>  // NULL
 
@@ -60,6 +62,42 @@ void HWStack::SetReturnPoint(unsigned long stackPointer, Funktor *f) {
     returnPointList.insert(make_pair(stackPointer, f));
 }
 
+void HWStack::CheckpointState(Checkpoint &cp) {
+    typedef multimap<unsigned long, Funktor *>::iterator I;
+    cp.Value(stackPointer);
+    cp.Value(lowestStackPointer);
+
+    if(cp.IsSaving()) {
+        vector<pair<unsigned long, unsigned int> > points;
+        for(I i = returnPointList.begin(); i != returnPointList.end(); i++) {
+            IrqFunktor *f = dynamic_cast<IrqFunktor *>(i->second);
+            if(f == NULL)
+                avr_warning("Checkpoint: return point on stack address 0x%lx isn't saved", i->first);
+            else
+                points.push_back(make_pair(i->first, f->GetVector()));
+        }
+        unsigned int count = points.size();
+        cp.Value(count);
+        for(unsigned int i = 0; i < count; i++) {
+            cp.Value(points[i].first);
+            cp.Value(points[i].second);
+        }
+    } else {
+        for(I i = returnPointList.begin(); i != returnPointList.end(); i++)
+            delete i->second;
+        returnPointList.clear();
+        unsigned int count = 0;
+        cp.Value(count);
+        for(unsigned int i = 0; i < count; i++) {
+            unsigned long sp = 0;
+            unsigned int vector = 0;
+            cp.Value(sp);
+            cp.Value(vector);
+            SetReturnPoint(sp, new IrqFunktor(core->irqSystem, &HWIrqSystem::IrqHandlerFinished, vector));
+        }
+    }
+}
+
 HWStackSram::HWStackSram(AvrDevice *c, int bs, bool initRE):
     HWStack(c),
     TraceValueRegister(c, "STACK"),
@@ -223,6 +261,11 @@ void ThreeLevelStack::PushAddr(unsigned long addr) {
         avr_warning("stack overflow");
 }
 
+void ThreeLevelStack::CheckpointState(Checkpoint &cp) {
+    HWStack::CheckpointState(cp);
+    cp.Array(stackArea, 3);
+}
+
 unsigned long ThreeLevelStack::PopAddr() {
     unsigned long val = stackArea[0];
     stackArea[0] = stackArea[1];
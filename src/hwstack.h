@@ -125,6 +125,11 @@ class HWStack {
         void ResetLowestStackpointer(void) { lowestStackPointer = stackPointer; }
         //! Gets back the lowest stack pointer (for measuring stack usage)
         unsigned long GetLowestStackpointer(void) { return lowestStackPointer; }
+
+        //! Saves or restores stack pointer and return points for a checkpoint
+        /*! Return points are saved, if they are set for the end of an
+            interrupt handler (IrqFunktor), like AvrDevice does. */
+        virtual void CheckpointState(Checkpoint &cp);
 };
 
 //! Implements a stack with stack register using RAM as stackarea
@@ -171,6 +176,7 @@ class ThreeLevelStack: public HWStack, public TraceValueRegister {
         virtual unsigned long PopAddr();
 
         virtual void Reset();
+        virtual void CheckpointState(Checkpoint &cp);
 };
 
 #endif
@@ -29,6 +29,7 @@
 #include "hwtimer.h"
 #include "../helper.h"
 #include "systemclock.h"
+#include "checkpoint.h"
 
 #include <cstdlib>
 #include <time.h>
@@ -44,6 +45,9 @@ BasicTimerUnit::BasicTimerUnit(AvrDevice *core,
                                int countersize):
     Hardware(core),
     TraceValueRegister(core, "TIMER" + int2str(unit)),
+    suspended(false),
+    suspendCycle(0),
+    wakeupTimer(core->GetSystemClock(), this, &BasicTimerUnit::Wakeup),
     core(core),
     premx(p),
     timerOverflow(tov),
@@ -82,6 +86,11 @@ BasicTimerUnit::BasicTimerUnit(AvrDevice *core,
     icapNCcounter = 0;
     icapNCstate = false;
     
+    // prescaler reset and changes on capture pin have to wake up unit
+    premx->RegisterTimer(this);
+    if(icapSource != NULL)
+        icapSource->RegisterPinCallback(this);
+    
     // reset internal values
     Reset();
     
@@ -161,6 +170,109 @@ void BasicTimerUnit::CountTimer() {
     }
 }
 
+unsigned long BasicTimerUnit::CountsTillEvent(void) {
+    // counter values, on which CountTimer emits an event at next count
+    unsigned long events[OCRIDX_maxUnits + 3];
+    int n = 0;
+    events[n++] = limit_bottom;
+    events[n++] = limit_top;
+    if(!updown_counting)
+        events[n++] = limit_max;
+    for(int i = 0; i < OCRIDX_maxUnits; i++) {
+        if(compareEnable[i])
+            events[n++] = compare[i];
+    }
+    
+    bool down = updown_counting && count_down;
+    unsigned long counts = ~0UL;
+    for(int i = 0; i < n; i++) {
+        if(down ? events[i] > vtcnt : events[i] < vtcnt)
+            continue;
+        unsigned long c = down ? vtcnt - events[i] : events[i] - vtcnt;
+        if(c < counts)
+            counts = c;
+    }
+    // no event ahead: counter is out of range, count step by step
+    return (counts == ~0UL) ? 0 : counts;
+}
+
+void BasicTimerUnit::SkipCounts(unsigned long counts) {
+    if(counts == 0)
+        return;
+    if(updown_counting && count_down) {
+        vtcnt -= counts;
+        vlast_tcnt = vtcnt + 1;
+        if(vtcnt == limit_bottom)
+            count_down = false; // now count up
+    } else {
+        vtcnt += counts;
+        vlast_tcnt = vtcnt - 1;
+        if(updown_counting && vtcnt == limit_top)
+            count_down = true; // now count down
+    }
+    counterTrace->change(vtcnt);
+}
+
+unsigned long long BasicTimerUnit::IdleCycles(void) {
+    // input capture unit needs cycles, till it has seen a source change
+    if(icapSource != NULL && !WGMuseICR()) {
+        bool state = icapSource->GetSourceState();
+        if(state != captureInputState)
+            return 0;
+        if(icapNoiseCanceler && (state != icapNCstate || icapNCcounter < 4))
+            return 0;
+    }
+    unsigned int div = premx->GetDivider(cs);
+    if(div == 0)
+        return 0;
+    // next clock event comes after this cycles, the following every div cycles
+    unsigned long long first = div - premx->GetPrescalerValue() % div;
+    return first + (unsigned long long)CountsTillEvent() * div - 1;
+}
+
+void BasicTimerUnit::SkipCycles(unsigned long long cycles) {
+    unsigned int div = premx->GetDivider(cs);
+    if(cycles == 0 || div == 0)
+        return;
+    // prescaler value contains the skipped cycles already, see
+    // AvrDevice::SkipCycles, so calculate back to the value before
+    unsigned int before = (premx->GetPrescalerValue() % div + div - cycles % div) % div;
+    SkipCounts((before + cycles) / div);
+}
+
+void BasicTimerUnit::UpdateCounter(void) {
+    if(!suspended)
+        return;
+    unsigned long long now = core->GetClockCycles();
+    SkipCycles(now - suspendCycle);
+    suspendCycle = now;
+}
+
+void BasicTimerUnit::Suspend(void) {
+    // dumpers have to see every count, analog comparator doesn't notify
+    if(core->dumpManager != NULL && core->dumpManager->IsDumping())
+        return;
+    if(icapSource != NULL && icapSource->IsACompSource() && !WGMuseICR())
+        return;
+    unsigned long long idle = IdleCycles();
+    if(idle == 0)
+        return;
+    suspended = true;
+    suspendCycle = core->GetClockCycles();
+    core->RemoveFromCycleList(this);
+    // back in list shortly before the cycle with next count event
+    wakeupTimer.Start((SystemClockOffset)(idle + 1) * core->GetClockFreq() - 1);
+}
+
+void BasicTimerUnit::Wakeup(void) {
+    if(!suspended)
+        return;
+    UpdateCounter();
+    suspended = false;
+    wakeupTimer.Cancel();
+    core->AddToCycleList(this);
+}
+
 void BasicTimerUnit::InputCapture(void) {
     if(icapSource != NULL && !WGMuseICR()) {
         // get the current state
@@ -195,6 +307,7 @@ void BasicTimerUnit::InputCapture(void) {
 }
 
 void BasicTimerUnit::SetClockMode(int mode) {
+    Wakeup();
     cs = mode;
     if(cs != 0) {
         core->AddToCycleList(this);
@@ -204,6 +317,7 @@ void BasicTimerUnit::SetClockMode(int mode) {
 }
 
 void BasicTimerUnit::SetCounter(unsigned long val) {
+    Wakeup();
     vtcnt = val;
     vlast_tcnt = 0x10000; // set to a invalid value!
     counterTrace->change(val);
@@ -544,6 +658,8 @@ void BasicTimerUnit::WGMfunc_pfcpwm(CEtype event) {
 }
 
 void BasicTimerUnit::Reset() {
+    suspended = false;
+    wakeupTimer.Cancel();
     vtcnt = 0;
     limit_bottom = 0;
     limit_top = limit_max;
@@ -562,10 +678,42 @@ void BasicTimerUnit::Reset() {
     icapNoiseCanceler = false;
 }
 
+void BasicTimerUnit::CheckpointState(Checkpoint &cp) {
+    cp.Value(cs);
+    cp.Value(captureInputState);
+    cp.Value(icapNCcounter);
+    cp.Value(icapNCstate);
+    cp.Value(suspended);
+    cp.Value(suspendCycle);
+    cp.Timer(wakeupTimer);
+    cp.Value(vtcnt);
+    cp.Value(vlast_tcnt);
+    cp.Value(updown_counting);
+    cp.Value(count_down);
+    cp.Value(limit_bottom);
+    cp.Value(limit_top);
+    cp.Value(limit_max);
+    cp.Value(icapRegister);
+    cp.Value(icapRisingEdge);
+    cp.Value(icapNoiseCanceler);
+    cp.Enum(wgm);
+    for(int i = 0; i < OCRIDX_maxUnits; i++) {
+        cp.Value(compare[i]);
+        cp.Value(compare_dbl[i]);
+        cp.Value(compareEnable[i]);
+        cp.Enum(com[i]);
+        cp.Value(compare_output_state[i]);
+    }
+    premx->CheckpointState(cp);
+    if(icapSource != NULL)
+        icapSource->CheckpointState(cp);
+}
+
 unsigned int BasicTimerUnit::CpuCycle() {
     if(premx->isClock(cs))
         CountTimer();
     InputCapture();
+    Suspend();
     return 0;
 }
 
@@ -619,6 +767,7 @@ void HWTimer8::Reset(void) {
 }
 
 void HWTimer8::ChangeWGM(WGMtype mode) {
+    Wakeup();
     wgm = mode;
     switch(wgm) {
         case WGM_PCPWM_9BIT:
@@ -660,6 +809,7 @@ void HWTimer8::ChangeWGM(WGMtype mode) {
 }
 
 void HWTimer8::SetCompareRegister(int idx, unsigned char val) {
+    Wakeup();
     if(WGMisPWM())
         compare_dbl[idx] = val;
     else {
@@ -766,11 +916,17 @@ void HWTimer16::Reset(void) {
     accessTempRegister = 0;
 }
 
+void HWTimer16::CheckpointState(Checkpoint &cp) {
+    BasicTimerUnit::CheckpointState(cp);
+    cp.Value(accessTempRegister);
+}
+
 void HWTimer16::SetCompareRegister(int idx, bool high, unsigned char val) {
     unsigned long temp;
     if(high) {
         accessTempRegister = val;
     } else {
+        Wakeup();
         temp = (accessTempRegister << 8) + val;
         if(WGMisPWM())
             compare_dbl[idx] = temp;
@@ -806,6 +962,7 @@ void HWTimer16::SetComplexRegister(bool is_icr, bool high, unsigned char val) {
     } else {
         if(is_icr) {
             if(WGMuseICR()) {
+                Wakeup();
                 icapRegister = (accessTempRegister << 8) + val;
                 if(wgm == WGM_FASTPWM_ICR)
                     limit_top = icapRegister;
@@ -824,13 +981,15 @@ unsigned char HWTimer16::GetComplexRegister(bool is_icr, bool high) {
             accessTempRegister =  (icapRegister >> 8) & 0xff;
             return icapRegister & 0xff;
         } else {
-            accessTempRegister =  (vtcnt >> 8) & 0xff;
-            return vtcnt & 0xff;
+            unsigned long cnt = GetCounter();
+            accessTempRegister =  (cnt >> 8) & 0xff;
+            return cnt & 0xff;
         }
     }
 }
 
 void HWTimer16::ChangeWGM(WGMtype mode) {
+    Wakeup();
     wgm = mode;
     switch(wgm) {
         case WGM_RESERVED:
@@ -932,6 +1091,11 @@ void HWTimer8_0C::Reset() {
     tccr_val = 0;
 }
 
+void HWTimer8_0C::CheckpointState(Checkpoint &cp) {
+    HWTimer8::CheckpointState(cp);
+    cp.Value(tccr_val);
+}
+
 HWTimer8_1C::HWTimer8_1C(AvrDevice *core,
                          PrescalerMultiplexer *p,
                          int unit,
@@ -967,6 +1131,11 @@ void HWTimer8_1C::Reset() {
     tccr_val = 0;
 }
 
+void HWTimer8_1C::CheckpointState(Checkpoint &cp) {
+    HWTimer8::CheckpointState(cp);
+    cp.Value(tccr_val);
+}
+
 HWTimer8_2C::HWTimer8_2C(AvrDevice *core,
                          PrescalerMultiplexer *p,
                          int unit,
@@ -1037,6 +1206,13 @@ void HWTimer8_2C::Reset() {
     wgm_raw = 0;
 }
 
+void HWTimer8_2C::CheckpointState(Checkpoint &cp) {
+    HWTimer8::CheckpointState(cp);
+    cp.Value(tccra_val);
+    cp.Value(tccrb_val);
+    cp.Value(wgm_raw);
+}
+
 HWTimer16_1C::HWTimer16_1C(AvrDevice *core,
                            PrescalerMultiplexer *p,
                            int unit,
@@ -1100,6 +1276,13 @@ void HWTimer16_1C::Reset() {
     wgm_raw = 0;
 }
 
+void HWTimer16_1C::CheckpointState(Checkpoint &cp) {
+    HWTimer16::CheckpointState(cp);
+    cp.Value(tccra_val);
+    cp.Value(tccrb_val);
+    cp.Value(wgm_raw);
+}
+
 HWTimer16_2C2::HWTimer16_2C2(AvrDevice *core,
                              PrescalerMultiplexer *p,
                              int unit,
@@ -1181,6 +1364,13 @@ void HWTimer16_2C2::Reset() {
     wgm_raw = 0;
 }
 
+void HWTimer16_2C2::CheckpointState(Checkpoint &cp) {
+    HWTimer16::CheckpointState(cp);
+    cp.Value(tccra_val);
+    cp.Value(tccrb_val);
+    cp.Value(wgm_raw);
+}
+
 HWTimer16_2C3::HWTimer16_2C3(AvrDevice *core,
                              PrescalerMultiplexer *p,
                              int unit,
@@ -1241,6 +1431,12 @@ void HWTimer16_2C3::Reset() {
     tccrb_val = 0;
 }
 
+void HWTimer16_2C3::CheckpointState(Checkpoint &cp) {
+    HWTimer16::CheckpointState(cp);
+    cp.Value(tccra_val);
+    cp.Value(tccrb_val);
+}
+
 HWTimer16_3C::HWTimer16_3C(AvrDevice *core,
                            PrescalerMultiplexer *p,
                            int unit,
@@ -1307,6 +1503,12 @@ void HWTimer16_3C::Reset() {
     tccrb_val = 0;
 }
 
+void HWTimer16_3C::CheckpointState(Checkpoint &cp) {
+    HWTimer16::CheckpointState(cp);
+    cp.Value(tccra_val);
+    cp.Value(tccrb_val);
+}
+
 //! Step time in ns for async clock by pll
 /*! Because system clock steps are counted in ns, we have to calculate so many steps to get
  * over all steps a time in ns without fraction. For 64MHz, e.g. 15,625 ns period, this step
@@ -1412,6 +1614,56 @@ void HWTimerTinyX5::Reset() {
     SetPrescalerClock(false); // reset prescaler to sync. clock mode, if necessary!
 }
 
+void HWTimerTinyX5::CheckpointState(Checkpoint &cp) {
+    cp.Value(counter);
+    cp.Value(prescaler);
+    cp.Value(dtprescaler);
+    tccr_inout_val.CheckpointState(cp);
+    ocra_inout_val.CheckpointState(cp);
+    ocrb_inout_val.CheckpointState(cp);
+    ocrc_inout_val.CheckpointState(cp);
+    gtccr_in_val.CheckpointState(cp);
+    cp.Value(dtps1_inout_val);
+    dt1a_inout_val.CheckpointState(cp);
+    dt1b_inout_val.CheckpointState(cp);
+    cp.Value(tcnt_out_val);
+    cp.Value(tcnt_out_async_tmp);
+    cp.Value(tcnt_in_val);
+    cp.Value(tcnt_set_flag);
+    cp.Value(tov_internal_flag);
+    cp.Value(tocra_internal_flag);
+    cp.Value(tocrb_internal_flag);
+    cp.Value(ocra_internal_val);
+    cp.Value(ocra_compare);
+    ocra_unit.CheckpointState(cp);
+    cp.Value(ocrb_internal_val);
+    cp.Value(ocrb_compare);
+    ocrb_unit.CheckpointState(cp);
+    cp.Value(cfg_prescaler);
+    cp.Value(cfg_dtprescaler);
+    cp.Value(cfg_mode);
+    cp.Value(cfg_ctc);
+    cp.Value(cfg_com_a);
+    cp.Value(cfg_com_b);
+    cp.Value(asyncClock_step);
+    cp.Value(asyncClock_async);
+    cp.Value(asyncClock_lsm);
+    cp.Value(asyncClock_pll);
+    cp.Value(asyncClock_plllock);
+    cp.Value(asyncClock_locktime);
+
+    // in async mode (or till switch back to sync mode is done by Step) timer
+    // is clocked by SystemClock
+    SystemClock &clock = core->GetSystemClock();
+    SystemClockOffset due = clock.GetScheduledTime(this);
+    cp.Value(due);
+    if(!cp.IsSaving()) {
+        clock.Remove(this);
+        if(due >= 0)
+            clock.Add(this, due - clock.GetCurrentTime());
+    }
+}
+
 int HWTimerTinyX5::Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns) {
     if(asyncClock_async) {
         *nextStepIn_ns = HWTimerTinyX5_nextdelay[asyncClock_step];
@@ -1448,7 +1700,7 @@ unsigned int HWTimerTinyX5::CpuCycle() {
 
     // control pll state
     if(asyncClock_pll) {
-        if(!asyncClock_plllock && (SystemClock::Instance().GetCurrentTime() >= asyncClock_locktime))
+        if(!asyncClock_plllock && (core->GetSystemClock().GetCurrentTime() >= asyncClock_locktime))
             asyncClock_plllock = true;
     }
     return 0;
@@ -1613,7 +1865,7 @@ unsigned char HWTimerTinyX5::set_from_reg(const IOSpecialReg *reg, unsigned char
                 // is a assumption and to prove!)
                 srand(time(NULL));
                 unsigned long delay = 100000 + rand() % 2000 - 1000;
-                asyncClock_locktime = SystemClock::Instance().GetCurrentTime() + delay;
+                asyncClock_locktime = core->GetSystemClock().GetCurrentTime() + delay;
             }
         }
         // get clock source for timer 1 [bit7 = LSM, bit2 = PCKE]
@@ -1642,7 +1894,7 @@ void HWTimerTinyX5::SetPrescalerClock(bool pcke) {
         if(!asyncClock_async) {
             asyncClock_async = true;
             asyncClock_step = 0; // this disabled also timer calculation in CpuCycle() to be secure
-            SystemClock::Instance().Add(this); // now the async clock is activated
+            core->GetSystemClock().Add(this); // now the async clock is activated
         } else {
             if(asyncClock_lsm) asyncClock_step &= ~1; // on lsm async mode we take every second step
         }
@@ -1762,6 +2014,20 @@ void TimerTinyX5_OCR::Reset() {
     dtCounter = 0;
 }
 
+void TimerTinyX5_OCR::CheckpointState(Checkpoint &cp) {
+    cp.Value(ocrComMode);
+    cp.Value(ocrPWM);
+    cp.Value(ocrOut);
+    cp.Value(dtHigh);
+    cp.Value(dtLow);
+    cp.Value(dtCounter);
+}
+
+void HWTimerTinyX5_SyncReg::CheckpointState(Checkpoint &cp) {
+    cp.Value(inValue);
+    cp.Value(regValue);
+}
+
 void TimerTinyX5_OCR::DTClockCycle() {
     if(dtCounter > 0) {
         dtCounter--;
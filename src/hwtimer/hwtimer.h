@@ -33,12 +33,20 @@
 #include "timerirq.h"
 #include "traceval.h"
 #include "icapturesrc.h"
+#include "pinnotify.h"
+#include "systemclock.h"
 
 //! Basic timer unit
 /*! Provides basic timer/counter functionality. Counting clock will be taken
   from a prescaler unit. It provides further at max 3 compare values and
-  one input capture unit. */
-class BasicTimerUnit: public Hardware, public TraceValueRegister {
+  one input capture unit.
+
+  While counting with a cpu clock based prescaler, the unit leaves the cycle
+  list till the next count event. The counter is then calculated from clock
+  count of core on access and a SystemClockTimer brings the unit back to cycle
+  list shortly before the cycle, on which the event occurs. A change on input
+  capture pin wakes up the unit too. */
+class BasicTimerUnit: public Hardware, public TraceValueRegister, public HasPinNotifyFunction {
     
     private:
         int cs; //!< select value for prescaler multiplexer
@@ -46,6 +54,14 @@ class BasicTimerUnit: public Hardware, public TraceValueRegister {
         bool captureInputState; //!< saved state for input capture
         int icapNCcounter; //!< counter for input capture noise canceler
         bool icapNCstate; //!< state for input capture noise canceler
+        bool suspended; //!< unit is off cycle list, counter isn't up to date
+        unsigned long long suspendCycle; //!< clock count of core, till which counter is up to date
+        SystemClockTimer<BasicTimerUnit> wakeupTimer; //!< brings unit back to cycle list before next count event
+        
+        //! Counts clocks, which are passed while unit was off cycle list
+        void UpdateCounter(void);
+        //! Leaves cycle list till next count event, if no cpu cycle is needed before
+        void Suspend(void);
         
     protected:
         //! types of waveform generation modes
@@ -126,6 +142,10 @@ class BasicTimerUnit: public Hardware, public TraceValueRegister {
         
         //! Supports the count operation, emits count events to HandleEvent method
         void CountTimer(void);
+        //! Returns count operations till next event, which CountTimer would emit
+        unsigned long CountsTillEvent(void);
+        //! Counts without emitting events, count is never more than CountsTillEvent
+        void SkipCounts(unsigned long counts);
         //! Supports the input capture function
         virtual void InputCapture(void);
         //! Receives count events
@@ -136,6 +156,8 @@ class BasicTimerUnit: public Hardware, public TraceValueRegister {
         void HandleEvent(CEtype event) { (this->*wgmfunc[wgm])(event); }
         //! Set clock mode
         void SetClockMode(int _cs);
+        //! Returns the counter value, see UpdateCounter
+        unsigned long GetCounter(void) { UpdateCounter(); return vtcnt; }
         //! Set the counter itself
         void SetCounter(unsigned long val);
         //! Set compare output mode
@@ -174,15 +196,27 @@ class BasicTimerUnit: public Hardware, public TraceValueRegister {
         ~BasicTimerUnit();
         //! Perform a reset of this unit
         void Reset();
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
         
         //! Process timer/counter unit operations by CPU cycle
         virtual unsigned int CpuCycle();
+        //! Returns cycles till next count event or input capture, see Hardware
+        virtual unsigned long long IdleCycles(void);
+        //! Counts clocks of skipped cycles at once, see Hardware
+        virtual void SkipCycles(unsigned long long cycles);
+        //! Brings a suspended unit back to cycle list with an up to date counter
+        /*! Has to be called before anything changes, which moves the next
+          count event: counter, compare values, modes or prescaler state. */
+        void Wakeup(void);
+        //! Input capture pin has changed, wakes up unit, see HasPinNotifyFunction
+        void PinStateHasChanged(Pin *p) { Wakeup(); }
 
         //! register analog comparator unit for input capture source
         void RegisterACompForICapture(HWAcomp *acomp);
 
         //! reflect ACIC flag to input capture source
-        void SetACIC(bool acic) { if(icapSource != NULL) icapSource->SetACIC(acic); }
+        void SetACIC(bool acic) { Wakeup(); if(icapSource != NULL) icapSource->SetACIC(acic); }
 };
 
 //! Extends BasicTimerUnit to provide common support to all types of 8Bit timer units
@@ -200,7 +234,7 @@ class HWTimer8: public BasicTimerUnit {
         //! Register access to set counter register high byte
         void Set_TCNT(unsigned char val) { SetCounter(val); }
         //! Register access to read counter register high byte
-        unsigned char Get_TCNT() { return vtcnt & 0xff; }
+        unsigned char Get_TCNT() { return GetCounter() & 0xff; }
 
         //! Register access to set output compare register A
         void Set_OCRA(unsigned char val) { SetCompareRegister(0, val); }
@@ -319,6 +353,8 @@ class HWTimer16: public BasicTimerUnit {
                   ICaptureSource* icapsrc);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 8Bit counter and no output compare unit
@@ -350,6 +386,8 @@ class HWTimer8_0C: public HWTimer8 {
                     IRQLine* tov);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 8Bit counter and one output compare unit
@@ -382,6 +420,8 @@ class HWTimer8_1C: public HWTimer8 {
                     PinAtPort* outA);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 8Bit counter and 2 output compare unit
@@ -436,6 +476,8 @@ class HWTimer8_2C: public HWTimer8 {
                     PinAtPort* outB);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 16Bit counter and one output compare unit
@@ -490,6 +532,8 @@ class HWTimer16_1C: public HWTimer16 {
                      ICaptureSource* icapsrc);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 16Bit counter and 2 output compare units and 2 config registers
@@ -552,6 +596,8 @@ class HWTimer16_2C2: public HWTimer16 {
                       bool is_at8515);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 16Bit counter and 2 output compare units, but 3 config registers
@@ -615,6 +661,8 @@ class HWTimer16_2C3: public HWTimer16 {
                       ICaptureSource* icapsrc);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Timer unit with 16Bit counter and 3 output compare units
@@ -680,6 +728,8 @@ class HWTimer16_3C: public HWTimer16 {
                      ICaptureSource* icapsrc);
         //! Perform a reset of this unit
         void Reset(void);
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! PWM output unit for timer 1 on ATtiny25/45/85
@@ -724,6 +774,9 @@ class TimerTinyX5_OCR {
 
         //! Configure OCR mode
         void SetOCRMode(bool isPWM, int comMode);
+
+        //! Save or restore state of this unit for a checkpoint, pins are saved by port
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Helper class to simulate transfer of register values from bus area to timer async area
@@ -755,6 +808,9 @@ class HWTimerTinyX5_SyncReg {
 
         //! Mask out a value inside sync area and do not force a change event
         void MaskOutSync(unsigned char mask) { inValue &= ~mask; regValue = inValue; }
+
+        //! Save or restore both register values for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! timer unit for timer 1 on ATtiny25/45/85
@@ -922,6 +978,8 @@ class HWTimerTinyX5: public Hardware,
         int Step(bool &untilCoreStepFinished, SystemClockOffset *nextStepIn_ns);
         //! Perform a reset of this unit
         void Reset();
+        //! Save or restore state of this unit for a checkpoint
+        void CheckpointState(Checkpoint &cp);
         //! Process timer/counter unit operations by CPU cycle
         unsigned int CpuCycle();
         virtual std::string getType() { return std::string("AvrDevice"); };
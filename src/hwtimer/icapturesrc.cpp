@@ -25,6 +25,8 @@
 
 #include "icapturesrc.h"
 #include "hwacomp.h"
+#include "pin.h"
+#include "checkpoint.h"
 
 ICaptureSource::ICaptureSource(PinAtPort cp):
     capturePin(cp),
@@ -37,4 +39,14 @@ bool ICaptureSource::GetSourceState(void) {
     else
         return (bool)capturePin;
 }
+
+bool ICaptureSource::IsACompSource(void) {
+    return acic && acomp != NULL;
+}
+
+void ICaptureSource::RegisterPinCallback(HasPinNotifyFunction *h) {
+    capturePin.GetPin().RegisterCallback(h);
+}
+
+void ICaptureSource::CheckpointState(Checkpoint &cp) { cp.Value(acic); }
         
@@ -27,8 +27,10 @@
 #define ICAPTURESRC
 
 #include "../pinatport.h"
+#include "../pinnotify.h"
 
 class HWAcomp;
+class Checkpoint;
 
 //! Class, which provides input capture source for 16bit timers
 class ICaptureSource {
@@ -50,6 +52,15 @@ class ICaptureSource {
 
         //! Reflect ACIC flag state
         void SetACIC(bool _acic) { acic = _acic; }
+
+        //! Returns true, if source is analog comparator, which doesn't notify on change
+        bool IsACompSource(void);
+
+        //! Registers a listener for changes on input capture pin
+        void RegisterPinCallback(HasPinNotifyFunction *h);
+
+        //! Saves or restores ACIC flag state for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 #endif
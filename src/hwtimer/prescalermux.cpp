@@ -25,6 +25,7 @@
 
 #include "prescalermux.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 
 PrescalerMultiplexer::PrescalerMultiplexer(HWPrescaler *ps):
     prescaler(ps) {}
@@ -62,6 +63,17 @@ bool PrescalerMultiplexer::isClock(unsigned int cs) {
     }
 }
 
+unsigned int PrescalerMultiplexer::GetDivider(unsigned int cs) {
+    static const unsigned int dividers[8] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+    
+    if(cs >= 8)
+        avr_error("wrong prescaler multiplex value: %d", cs);
+    // a stopped prescaler value doesn't give regular clock events
+    if(cs > 1 && !prescaler->CountsCpuClock())
+        return 0;
+    return dividers[cs];
+}
+
 PrescalerMultiplexerExt::PrescalerMultiplexerExt(HWPrescaler *ps, PinAtPort pi):
     PrescalerMultiplexer(ps),
     clkpin(pi) {
@@ -105,6 +117,18 @@ bool PrescalerMultiplexerExt::isClock(unsigned int cs) {
     }
 }
 
+unsigned int PrescalerMultiplexerExt::GetDivider(unsigned int cs) {
+    static const unsigned int dividers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+    
+    if(cs >= 8)
+        avr_error("wrong prescaler multiplex value: %d", cs);
+    if(cs > 1 && !prescaler->CountsCpuClock())
+        return 0;
+    return dividers[cs];
+}
+
+void PrescalerMultiplexerExt::CheckpointState(Checkpoint &cp) { cp.Value(clkpin_old); }
+
 PrescalerMultiplexerT15::PrescalerMultiplexerT15(HWPrescaler *ps):
     PrescalerMultiplexer(ps) {}
 
@@ -44,6 +44,16 @@ class PrescalerMultiplexer {
         //! @param cs multiplexer select value
         //! @return true, if a clock event occured
         virtual bool isClock(unsigned int cs);
+        //! Returns the count of cpu clocks per clock event depending on cs
+        //! @param cs multiplexer select value
+        //! @return divider, 0 if clock events can't be predicted (no clock or external clock)
+        virtual unsigned int GetDivider(unsigned int cs);
+        //! Get method for current prescaler counter value
+        unsigned short GetPrescalerValue() { return prescaler->GetValue(); }
+        //! Registers a timer on prescaler, see HWPrescaler::RegisterTimer
+        void RegisterTimer(BasicTimerUnit *t) { prescaler->RegisterTimer(t); }
+        //! Saves or restores state for a checkpoint, nothing to do without count pin
+        virtual void CheckpointState(Checkpoint &cp) {}
     
 };
 
@@ -61,6 +71,9 @@ class PrescalerMultiplexerExt: public PrescalerMultiplexer {
         //! Creates a multiplexer instance with a count input pin, connected with prescaler
         PrescalerMultiplexerExt(HWPrescaler *ps, PinAtPort pi);
         virtual bool isClock(unsigned int cs);
+        virtual unsigned int GetDivider(unsigned int cs);
+        //! Saves or restores last state of count pin for a checkpoint
+        virtual void CheckpointState(Checkpoint &cp);
     
 };
 
@@ -72,6 +85,7 @@ class PrescalerMultiplexerT15: public PrescalerMultiplexer {
         //! Creates a multiplexer instance for timer 1 on ATTiny15, connected with prescaler
         PrescalerMultiplexerT15(HWPrescaler *ps);
         virtual bool isClock(unsigned int cs);
+        virtual unsigned int GetDivider(unsigned int cs) { return 0; }
     
 };
 
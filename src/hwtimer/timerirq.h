@@ -79,6 +79,7 @@ class TimerIRQRegister: public Hardware, public IOSpecialRegClient, public Trace
         
         virtual void ClearIrqFlag(unsigned int vector);
         virtual void Reset(void);
+        virtual void CheckpointState(Checkpoint &cp);
         
         virtual unsigned char set_from_reg(const IOSpecialReg* reg, unsigned char nv);
         virtual unsigned char get_from_client(const IOSpecialReg* reg, unsigned char v);
@@ -24,17 +24,42 @@
  */
 
 #include "timerprescaler.h"
+#include "hwtimer.h"
 #include "traceval.h"
+#include "checkpoint.h"
+
+//! Trace value for prescaler counter, which is calculated on demand
+class PrescalerTraceValue: public TraceValue {
+    
+    private:
+        HWPrescaler *prescaler;
+        
+    public:
+        PrescalerTraceValue(HWPrescaler *p, const std::string &name):
+            TraceValue(16, name), prescaler(p) {}
+        
+        virtual void cycle() {
+            unsigned v = prescaler->GetValue();
+            if(!written() || v != value()) {
+                change(v);
+                set_written();
+            }
+        }
+
+        virtual bool polled() const { return true; }
+};
 
 HWPrescaler::HWPrescaler(AvrDevice *core, const std::string &tracename):
     Hardware(core),
     _resetBit(-1),
     _resetSyncBit(-1),
+    cpuClocked(true),
+    core(core),
     countEnable(true)
 {
-    core->AddToCycleList(this);
-    trace_direct(&(core->coreTraceGroup), "PRESCALER" + tracename, &preScaleValue);
+    TraceCounter(tracename);
     resetRegister = NULL;
+    Reset();
 }
 
 HWPrescaler::HWPrescaler(AvrDevice *core,
@@ -44,12 +69,14 @@ HWPrescaler::HWPrescaler(AvrDevice *core,
     Hardware(core),
     _resetBit(resetBit),
     _resetSyncBit(-1),
+    cpuClocked(true),
+    core(core),
     countEnable(true)
 {
-    core->AddToCycleList(this);
-    trace_direct(&(core->coreTraceGroup), "PRESCALER" + tracename, &preScaleValue);
+    TraceCounter(tracename);
     resetRegister = ioreg;
     ioreg->connectSRegClient(this);
+    Reset();
 }
 
 HWPrescaler::HWPrescaler(AvrDevice *core,
@@ -60,12 +87,42 @@ HWPrescaler::HWPrescaler(AvrDevice *core,
     Hardware(core),
     _resetBit(resetBit),
     _resetSyncBit(resetSyncBit),
+    cpuClocked(true),
+    core(core),
     countEnable(true)
 {
-    core->AddToCycleList(this);
-    trace_direct(&(core->coreTraceGroup), "PRESCALER" + tracename, &preScaleValue);
+    TraceCounter(tracename);
     resetRegister = ioreg;
     ioreg->connectSRegClient(this);
+    Reset();
+}
+
+void HWPrescaler::TraceCounter(const std::string &tracename) {
+    TraceValueRegister *r = &(core->coreTraceGroup);
+    r->RegisterTraceValue(new PrescalerTraceValue(this, r->GetTraceValuePrefix() + "PRESCALER" + tracename));
+}
+
+void HWPrescaler::SetCpuClocked(bool on) {
+    if(on == cpuClocked)
+        return;
+    if(on)
+        cycleBase = core->GetClockCycles() - preScaleValue;
+    else
+        preScaleValue = GetValue();
+    cpuClocked = on;
+}
+
+void HWPrescaler::WakeupTimers(void) {
+    for(size_t i = 0; i < timers.size(); i++)
+        timers[i]->Wakeup();
+}
+
+void HWPrescaler::CheckpointState(Checkpoint &cp) {
+    // cycleBase is related to clock count of core, which is restored too
+    cp.Value(cpuClocked);
+    cp.Value(cycleBase);
+    cp.Value(preScaleValue);
+    cp.Value(countEnable);
 }
 
 unsigned char HWPrescaler::set_from_reg(const IOSpecialReg *reg, unsigned char nv) {
@@ -79,13 +136,15 @@ unsigned char HWPrescaler::set_from_reg(const IOSpecialReg *reg, unsigned char n
         sync = (1 << _resetSyncBit) & nv;
     
     if(reset) {
+        WakeupTimers(); // count events are moved
         Reset();  // reset requested
         if(sync)
             countEnable = false; // sync asserted, stop counting
-        else {
+        else
             countEnable = true;  // let the counter run
+        SetCpuClocked(CountsCpuClock());
+        if(!sync)
             return ~(1 << _resetBit) & nv; // reset the reset bit immediately, if no sync asserted
-        }
     }
     return nv;  // return value unchanged
 }
@@ -126,12 +185,9 @@ HWPrescalerAsync::HWPrescalerAsync(AvrDevice *core,
 }
 
 unsigned int HWPrescalerAsync::CpuCycle() {
-    bool e = true;
-    if(clockselect) {
-      bool ps = tosc_pin.GetPin();
-      if(pinstate || !ps) e = false; // count on positive edge!
-      pinstate = ps;
-    }
+    bool ps = tosc_pin.GetPin();
+    bool e = !pinstate && ps; // count on positive edge!
+    pinstate = ps;
     if(e && countEnable) {
       preScaleValue++;
       if(preScaleValue > 1023) preScaleValue = 0;
@@ -139,16 +195,28 @@ unsigned int HWPrescalerAsync::CpuCycle() {
     return 0;
 }
 
+void HWPrescalerAsync::CheckpointState(Checkpoint &cp) {
+    HWPrescaler::CheckpointState(cp);
+    cp.Value(pinstate);
+    cp.Value(clockselect);
+}
+
 unsigned char HWPrescalerAsync::set_from_reg(const IOSpecialReg *reg, unsigned char nv) {
     unsigned char v = HWPrescaler::set_from_reg(reg, nv);
     if(reg != asyncRegister) return v;
+    WakeupTimers();
     if((1 << clockSelectBit) & v) {
+        if(!clockselect)
+            core->AddToCycleList(this); // sample external clock
         clockselect = true;
         //tosc_pin.SetAlternatePort(true);
     } else {
+        if(clockselect)
+            core->RemoveFromCycleList(this);
         clockselect = false;
         //tosc_pin.SetAlternatePort(false);
     }
+    SetCpuClocked(CountsCpuClock());
     return v;
 }
 
@@ -31,23 +31,40 @@
 #include "../rwmem.h"
 #include "../pinatport.h"
 
+class BasicTimerUnit;
+
 //! Prescaler unit for support timers with clock
 /*! This is a prescaler unit without external clock input, features reset and
-  reset sync bit. Size of prescaler is 10 bit.*/
+  reset sync bit. Size of prescaler is 10 bit.
+
+  While counting cpu clocks, the prescaler doesn't need a clock itself: the
+  counter value is calculated from the clock count of core. Only if counting
+  is stopped (reset sync) or switched to an external clock, value is held in
+  preScaleValue. */
 class HWPrescaler: public Hardware, public IOSpecialRegClient {
     
     private:
         int _resetBit;     //!< holds bit position for reset bit on IO register
-        int _resetSyncBit; //!< holds sync bit position for prescaler reset synchronisation
+        int _resetSyncBit; //!< holds bit position for prescaler reset synchronisation
+        bool cpuClocked;   //!< true, if counter value is calculated from clock count of core
+        unsigned long long cycleBase; //!< clock count of core, on which counter was 0
+        std::vector<BasicTimerUnit*> timers; //!< timers clocked by this prescaler
         
     protected:
+        AvrDevice *core; //!< pointer to device core
         IOSpecialReg* resetRegister; //!< instance of IO register with reset bits
-        unsigned short preScaleValue; //!< prescaler counter value
+        unsigned short preScaleValue; //!< prescaler counter value, if not cpu clocked
         bool countEnable;  //!< enables counting of prescaler (for reset sync)
         //! IO register interface set method, see IOSpecialRegClient
         unsigned char set_from_reg(const IOSpecialReg *reg, unsigned char nv);
         //! IO register interface get method, see IOSpecialRegClient
         unsigned char get_from_client(const IOSpecialReg *reg, unsigned char v) { return v; }
+        //! Switches between calculated and held counter value, keeps counter value
+        void SetCpuClocked(bool on);
+        //! Registers trace value for counter
+        void TraceCounter(const std::string &tracename);
+        //! Wakes up timers, before counter value or clock source changes
+        void WakeupTimers(void);
         
     public:
         //! Creates HWPrescaler instance without reset feature
@@ -63,18 +80,20 @@ class HWPrescaler: public Hardware, public IOSpecialRegClient {
                     IOSpecialReg *ioreg,
                     int resetBit,
                     int resetSyncBit);
-        //! Count functionality for prescaler
-        virtual unsigned int CpuCycle() {
-            if(countEnable) {
-              preScaleValue++;
-              if(preScaleValue > 1023) preScaleValue = 0;
-            }
-            return 0;
-        }
         //! Get method for current prescaler counter value
-        unsigned short GetValue() { return preScaleValue; }
+        unsigned short GetValue() {
+            if(cpuClocked)
+                return (core->GetClockCycles() - cycleBase) % 1024;
+            return preScaleValue;
+        }
+        //! Returns true, if prescaler counts every cpu clock
+        virtual bool CountsCpuClock() { return countEnable; }
+        //! Registers a timer, which has to be woken up on prescaler reset, see BasicTimerUnit::Wakeup
+        void RegisterTimer(BasicTimerUnit *t) { timers.push_back(t); }
         //! Reset method, sets prescaler counter to 0
-        void Reset(){ preScaleValue = 0; }
+        void Reset() { preScaleValue = 0; cycleBase = core->GetClockCycles(); }
+        //! Saves or restores counter state for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 //! Extends HWPrescaler with a external clock oszillator pin
@@ -100,8 +119,12 @@ class HWPrescalerAsync: public HWPrescaler {
                          IOSpecialReg *resreg,
                          int resetBit,
                          int resetSyncBit);
-        //! Count functionality for prescaler
+        //! Count functionality for prescaler, only used with external clock
         virtual unsigned int CpuCycle();
+        //! Returns true, if prescaler counts every cpu clock
+        virtual bool CountsCpuClock() { return countEnable && !clockselect; }
+        //! Saves or restores counter and external clock state for a checkpoint
+        void CheckpointState(Checkpoint &cp);
         
     protected:
         //! IO register interface set method, see IOSpecialRegClient
@@ -25,6 +25,7 @@
 
 #include "hwuart.h"
 #include "helper.h"
+#include "checkpoint.h"
 
 //usr & ucsra
 #define RXC 0x80
@@ -60,6 +61,8 @@
 #define UCPOL 0x01
 
 void HWUart::SetUdr(unsigned char val) { 
+    // transmitter starts on next bit clock
+    Resume();
     udrWrite=val;
     if ( usr&UDRE) { //the data register was empty
         usr &=0xff-UDRE; //so we are not able to send another value now 
@@ -71,6 +74,7 @@ void HWUart::SetUdr(unsigned char val) {
 } 
 
 void HWUart::SetUsr(unsigned char val) { 
+    Resume();
     unsigned char usrold=usr;
     usr = val;
 
@@ -90,6 +94,7 @@ void HWUart::SetUsr(unsigned char val) {
 } 
 
 void HWUart::SetUbrr(unsigned char val) {
+    Resume();
     ubrr = (ubrr & 0xff00) | val;
     /*
      * The down-counter, running at system clock (f osc ),
@@ -113,6 +118,8 @@ void HWUart::SetUbrr(unsigned char val) {
 }
 
 void HWUart::SetUbrrhi(unsigned char val) {
+    // period of baud rate counter changes, so count missed clocks before
+    Resume();
     ubrr = (ubrr & 0xff) | ((val & 0xf) << 8);
 }
 
@@ -143,6 +150,8 @@ void HWUart::SetFrameLengthFromRegister() {
 }
 
 void HWUart::SetUcr(unsigned char val) { 
+    // count missed clocks with old settings, CpuCycle suspends again, if idle
+    Resume();
     unsigned char ucrold=ucr;
     ucr=val;
     SetFrameLengthFromRegister();
@@ -164,16 +173,6 @@ void HWUart::SetUcr(unsigned char val) {
         pinRx.SetAlternateDdr(0);       // input 
     }
 
-    //prepared for later remove from hwuart from every cpu cycle (only on demand)
-#if 0
-    //Check if one of Rx or Tx is enabled NEW!
-    if ( ucr & ( RXEN|TXEN) ) {//now one of rx or tx is on
-        if ( !(ucrold & (RXEN|TXEN)) ) { //but there was nothing on before
-            core->AddToCycleList(this); //enable the cpu cycle list!
-        }
-    }
-#endif
-
     unsigned char irqold= ucrold&usr;
     unsigned char irqnew= ucr&usr;
 
@@ -197,10 +196,120 @@ unsigned int HWUart::CpuCycle() {
     // controling read sequence down counter
     if(regSeq > 0)
         regSeq--;
+
+    if(regSeq == 0)
+        Suspend();
       
     return 0;
 }
 
+void HWUart::Suspend() {
+    // only the counters are running till next sample or shift, leave the
+    // cycle list and count the missed clocks on Resume
+    // with active dumpers core doesn't skip cycles, so an enabled UART doesn't too
+    if((ucr & (RXEN | TXEN)) && core->dumpManager != NULL && core->dumpManager->IsDumping())
+        return;
+    unsigned long long idle = IdleCycles();
+    if(idle == 0)
+        return;
+    suspended = true;
+    suspendedAt = core->GetClockCycles();
+    core->RemoveFromCycleList(this);
+    // waiting for rx pin change or UDR write doesn't need a timer
+    if(idle != idleForever)
+        wakeupTimer.Start((SystemClockOffset)(idle + 1) * core->GetClockFreq() - 1);
+}
+
+void HWUart::Resume() {
+    if(!suspended)
+        return;
+    suspended = false;
+    wakeupTimer.Cancel();
+    SkipCycles(core->GetClockCycles() - suspendedAt);
+    core->AddToCycleList(this);
+}
+
+bool HWUart::IsRxIdle() {
+    if((ucr & RXEN) == 0)
+        return true;
+    // receiver waits for a level on rx pin, which doesn't change without an event
+    switch(rxState) {
+        case RX_WAIT_FOR_HIGH:
+            return pinRx == 0;
+        case RX_WAIT_FOR_LOWEDGE:
+            return pinRx == 1 && cntRxSamples == 0 && rxLowCnt == 0 && rxHighCnt == 0;
+        case RX_DISABLED:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool HWUart::IsTxIdle() {
+    if((ucr & TXEN) == 0)
+        return true;
+    // transmitter waits for a UDR write
+    return (usr & UDRE) &&
+        (txState == TX_FIRST_RUN || txState == TX_FINISH || txState == TX_DISABLED);
+}
+
+unsigned int HWUart::RxCountingClocks() {
+    // sample counter is incremented before it's compared
+    int next = cntRxSamples + 1;
+    switch(rxState) {
+        case RX_READ_STARTBIT:
+        case RX_READ_DATABIT:
+        case RX_READ_PARITY:
+            if(next < cntRxFirstSample)
+                return cntRxFirstSample - next;
+            if(next > cntRxLastSample && next < cntRxTotalSamples)
+                return cntRxTotalSamples - next;
+            return 0;
+        case RX_READ_STOPBIT:
+        case RX_READ_STOPBIT2:
+            return (next < cntRxFirstSample) ? cntRxFirstSample - next : 0;
+        default:
+            return 0;
+    }
+}
+
+unsigned long long HWUart::IdleCycles() {
+    // cycles before next baud rate clock
+    unsigned long long cycles = ((baudCnt < 1) ? 1 : baudCnt) - 1;
+    unsigned long long idle = idleForever;
+    // receiver samples rx pin on some baud rate clocks of a bit
+    if(!IsRxIdle())
+        idle = cycles + (unsigned long long)RxCountingClocks() * (ubrr + 1);
+    // transmitter shifts out a bit on every baudCntDiv baud rate clocks
+    if(!IsTxIdle()) {
+        unsigned long long tx = cycles + (unsigned long long)(((baudCntDiv < 1) ? 1 : baudCntDiv) - 1) * (ubrr + 1);
+        if(tx < idle)
+            idle = tx;
+    }
+    return idle;
+}
+
+//! Counts down cnt (reloaded with period, if it reaches 0) by cycles, returns count of reloads
+static unsigned long long CountDown(int &cnt, int period, unsigned long long cycles) {
+    unsigned long long c = (cnt < 1) ? 1 : cnt;
+    if(cycles < c) {
+        cnt = c - cycles;
+        return 0;
+    }
+    cycles -= c;
+    cnt = period - (int)(cycles % period);
+    return 1 + cycles / period;
+}
+
+void HWUart::SkipCycles(unsigned long long cycles) {
+    unsigned long long baudClocks = CountDown(baudCnt, ubrr + 1, cycles);
+    CountDown(baudCntDiv, baudCntDivReset, baudClocks);
+    // receiver only counts samples on skipped clocks, see RxCountingClocks
+    if((ucr & RXEN) && rxState >= RX_READ_STARTBIT)
+        cntRxSamples += baudClocks;
+    regSeq = ((unsigned long long)regSeq > cycles) ? regSeq - cycles : 0;
+}
+
 unsigned int HWUart::CpuCycleRx() {
     // receiver part
     //
@@ -552,6 +661,10 @@ HWUart::HWUart(AvrDevice *core,
     Hardware(core),
     TraceValueRegister(core, "UART" + int2str(instance_id)),
     irqSystem(s),
+    core(core),
+    suspended(false),
+    suspendedAt(0),
+    wakeupTimer(core->GetSystemClock(), this, &HWUart::Resume),
     pinTx(tx),
     pinRx(rx),
     vectorRx(rx_interrupt),
@@ -575,8 +688,8 @@ HWUart::HWUart(AvrDevice *core,
     irqSystem->DebugVerifyInterruptVector(vectorRx, this);
     irqSystem->DebugVerifyInterruptVector(vectorUdre, this);
     irqSystem->DebugVerifyInterruptVector(vectorTx, this);
-
-    core->AddToCycleList(this);
+    usr_reg.SetSideEffectFree();
+    ucsra_reg.SetSideEffectFree();
 
     trace_direct(this, "UDR_write", &udrWrite);
     trace_direct(this, "UDR_read", &udrRead);
@@ -584,6 +697,9 @@ HWUart::HWUart(AvrDevice *core,
     trace_direct(this, "sUCR", &ucr);
     trace_direct(this, "sUBR", &ubrr);
 
+    // a start bit wakes up a suspended receiver
+    pinRx.GetPin().RegisterCallback(this);
+
     Reset();
 }
 
@@ -640,13 +756,52 @@ void HWUart::Reset() {
     
     rxState = RX_WAIT_FOR_LOWEDGE;
     txState = TX_FIRST_RUN;
+    readParity = false;
+    writeParity = false;
 
     SetFrameLengthFromRegister(); 
+
+    // counters are reset, so nothing to count after suspend
+    suspended = false;
+    wakeupTimer.Cancel();
+    core->AddToCycleList(this);
+}
+
+void HWUart::CheckpointState(Checkpoint &cp) {
+    cp.Value(udrWrite);
+    cp.Value(udrRead);
+    cp.Value(usr);
+    cp.Value(ucr);
+    cp.Value(ucsrc);
+    cp.Value(ubrr);
+    cp.Value(readParity);
+    cp.Value(writeParity);
+    cp.Value(frameLength);
+    cp.Value(suspended);
+    cp.Value(suspendedAt);
+    cp.Timer(wakeupTimer);
+    cp.Value(regSeq);
+    cp.Value(baudCnt);
+    cp.Enum(rxState);
+    cp.Enum(txState);
+    cp.Value(cntRxSamples);
+    cp.Value(rxLowCnt);
+    cp.Value(rxHighCnt);
+    cp.Value(rxDataTmp);
+    cp.Value(rxBitCnt);
+    cp.Value(baudCntDivReset);
+    cp.Value(baudCntDiv);
+    cp.Value(txDataTmp);
+    cp.Value(txBitCnt);
+    cp.Value(cntRxFirstSample);
+    cp.Value(cntRxLastSample);
+    cp.Value(cntRxTotalSamples);
 }
 
 // implementation of HWUsart
 
 void HWUsart::SetUcsrc(unsigned char val) {
+    Resume();
     ucsrc=val;
     SetFrameLengthFromRegister();
 }
@@ -662,6 +817,8 @@ void HWUsart::SetUcsrcUbrrh(unsigned char val) {
 unsigned char HWUsart::GetUcsrc() { return ucsrc; }
 
 unsigned char HWUsart::GetUcsrcUbrrh() {
+    // read sequence counter needs cpu cycles
+    Resume();
     if(regSeq == 0) {
         regSeq = 2;
         return GetUbrrhi();
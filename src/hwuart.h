@@ -32,10 +32,16 @@
 #include "pinatport.h"
 #include "rwmem.h"
 #include "traceval.h"
+#include "pinnotify.h"
+#include "systemclock.h"
 
 //! Implements the I/O hardware necessary to do UART transfers.
-/*! \todo Needs rewrite! Only one async mode implemented! */
-class HWUart: public Hardware, public TraceValueRegister {
+/*! While receiver and transmitter wait or only count baud rate clocks, the
+  UART leaves the cycle list. A SystemClockTimer brings it back shortly before
+  the baud rate clock, on which a bit is sampled or shifted out. A change on
+  rx pin or a write to UDR wakes it up too.
+  \todo Needs rewrite! Only one async mode implemented! */
+class HWUart: public Hardware, public TraceValueRegister, public HasPinNotifyFunction {
     
     protected:
         unsigned char udrWrite; //!< Write stage of UDR register value
@@ -51,6 +57,11 @@ class HWUart: public Hardware, public TraceValueRegister {
         int frameLength;        //!< Hold length of UART frame
 
         HWIrqSystem *irqSystem; //!< Connection to interrupt system
+        AvrDevice *core;        //!< Connection to core, to leave cycle list
+
+        bool suspended;         //!< True, if removed from cycle list, because receiver and transmitter are idle
+        unsigned long long suspendedAt; //!< Core clock count, on which UART was removed from cycle list
+        SystemClockTimer<HWUart> wakeupTimer; //!< Brings UART back to cycle list before next sample or shift
 
         PinAtPort pinTx;        //!< TX pin
         PinAtPort pinRx;        //!< RX pin
@@ -104,6 +115,17 @@ class HWUart: public Hardware, public TraceValueRegister {
         int txBitCnt;
         int cntRxFirstSample, cntRxLastSample, cntRxTotalSamples;
 
+        //! Returns true, if receiver does nothing on next baud rate clocks
+        bool IsRxIdle();
+        //! Returns true, if transmitter does nothing on next bit clocks
+        bool IsTxIdle();
+        //! Returns count of next baud rate clocks, on which receiver only counts samples
+        unsigned int RxCountingClocks();
+        //! Leaves cycle list till next sample or shift of a bit
+        void Suspend();
+        //! Rejoins cycle list after suspend and counts the clocks, which are missed
+        void Resume();
+
     public:
         //! Creates a instance of HWUart class
         HWUart(AvrDevice *core,
@@ -115,8 +137,16 @@ class HWUart: public Hardware, public TraceValueRegister {
                unsigned int tx_interrupt,
                int instance_id = 0);
         virtual unsigned int CpuCycle();
+        //! Returns cycles till next sample or shift of a bit, see Hardware
+        virtual unsigned long long IdleCycles();
+        //! Counts baud rate clocks of skipped cycles at once, see Hardware
+        virtual void SkipCycles(unsigned long long cycles);
+        //! Rx pin has changed, wakes up UART, see HasPinNotifyFunction
+        void PinStateHasChanged(Pin *p) { Resume(); }
 
         void Reset();
+        //! Saves or restores registers and state of receiver and transmitter for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 
         void SetUdr(unsigned char val);  
         void SetUsr(unsigned char val);  
@@ -26,6 +26,7 @@
 #include "hwwado.h"
 #include "avrdevice.h"
 #include "systemclock.h"
+#include "checkpoint.h"
 
 #define WDTOE 0x10
 #define WDE 0x08
@@ -47,8 +48,30 @@ void HWWado::SetWdtcr(unsigned char val) {
 		cntWde=4;
 	}
 
+	// core cycles are needed while WDTOE is running, timeout is scheduled
+	if (cntWde > 0)
+		core->AddToCycleList(this);
+	if ((wdtcr & WDE) != 0)
+		ScheduleTimeOut();
+	else
+		timeOutTimer.Cancel();
 } 
 
+void HWWado::ScheduleTimeOut() {
+	SystemClockOffset currentTime= core->GetSystemClock().GetCurrentTime();
+	if (timeOutAt > currentTime) {
+		timeOutTimer.Start(timeOutAt - currentTime);
+	} else {
+		timeOutTimer.Cancel();
+		core->AddToCycleList(this);
+	}
+}
+
+void HWWado::TimeOut() {
+	// reset will happen on the first cpu cycle after timeOutAt
+	core->AddToCycleList(this);
+}
+
 unsigned int HWWado::CpuCycle() {
 	if ( cntWde > 0) {
 		cntWde--;
@@ -57,32 +80,55 @@ unsigned int HWWado::CpuCycle() {
 
 	if (cntWde==0) wdtcr&=(0xff-WDTOE); //clear WDTOE after 4 cpu cycles
 
-	if ((( wdtcr& WDE )!= 0 ) && (timeOutAt < SystemClock::Instance().GetCurrentTime() )) {
+	if ((( wdtcr& WDE )!= 0 ) && (timeOutAt < core->GetSystemClock().GetCurrentTime() )) {
 		core->Reset();
 	}
 
+	if ((cntWde == 0) && (((wdtcr & WDE) == 0) || timeOutTimer.IsScheduled()))
+		core->RemoveFromCycleList(this);
 
 	return 0;
 }
 
+unsigned long long HWWado::IdleCycles() {
+	if (cntWde > 0)
+		return 0;
+	if ((wdtcr & WDE) == 0)
+		return idleForever;
+	// cycles, till watchdog timeout is reached
+	SystemClockOffset now = core->GetSystemClock().GetCurrentTime();
+	if (timeOutAt <= now)
+		return 0;
+	return (timeOutAt - now) / core->GetClockFreq();
+}
+
 HWWado::HWWado(AvrDevice *c):
     Hardware(c),
     TraceValueRegister(c, "WADO"),
     core(c),
+    timeOutTimer(c->GetSystemClock(), this, &HWWado::TimeOut),
     wdtcr_reg(this, "WDTCR",
               this, &HWWado::GetWdtcr, &HWWado::SetWdtcr) {
-	core->AddToCycleList(this);
 	Reset();
 }
 
 void HWWado::Reset() {
 	timeOutAt=0;
 	wdtcr=0;
+	cntWde=0;
+	timeOutTimer.Cancel();
+	core->RemoveFromCycleList(this);
 }
 
+void HWWado::CheckpointState(Checkpoint &cp) {
+	cp.Value(wdtcr);
+	cp.Value(cntWde);
+	cp.Value(timeOutAt);
+	cp.Timer(timeOutTimer);
+}
 
 void HWWado::Wdr() {
-	SystemClockOffset currentTime= SystemClock::Instance().GetCurrentTime(); 
+	SystemClockOffset currentTime= core->GetSystemClock().GetCurrentTime(); 
 	switch ( wdtcr& 0x7) {
 		case 0:
 			timeOutAt= currentTime+ 47000000; //47ms
@@ -117,4 +163,7 @@ void HWWado::Wdr() {
 			break;
 
 	}
+
+	if ((wdtcr & WDE) != 0)
+		ScheduleTimeOut();
 }
@@ -29,6 +29,7 @@
 #include "hardware.h"
 #include "rwmem.h"
 #include "systemclocktypes.h"
+#include "systemclock.h"
 #include "traceval.h"
 
 class AvrDevice;
@@ -41,15 +42,21 @@ class HWWado: public Hardware, public TraceValueRegister {
 	unsigned char cntWde; //4 cycles counter for unsetting the wde
 	SystemClockOffset timeOutAt; 
 	AvrDevice *core;
+	SystemClockTimer<HWWado> timeOutTimer; //!< wakes up wado, when timeOutAt is reached
+
+	void ScheduleTimeOut(); //start timer for timeOutAt or join cycle list, if over
+	void TimeOut(); //called by timeOutTimer
 
 	public:
 		HWWado(AvrDevice *); // { irqSystem= s;}
 		virtual unsigned int CpuCycle();
+		virtual unsigned long long IdleCycles();
 
 		void SetWdtcr(unsigned char val);  
 		unsigned char GetWdtcr() { return wdtcr; }
 		void Wdr(); //reset the wado counter
 		void Reset();
+		void CheckpointState(Checkpoint &cp);
 
         IOReg<HWWado> wdtcr_reg;
 };
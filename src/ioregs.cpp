@@ -24,6 +24,7 @@
  */
 
 #include "ioregs.h"
+#include "checkpoint.h"
 
 AddressExtensionRegister::AddressExtensionRegister(AvrDevice *core,
                                                    const std::string &regname,
@@ -37,4 +38,6 @@ AddressExtensionRegister::AddressExtensionRegister(AvrDevice *core,
     Reset();
 }
 
+void AddressExtensionRegister::CheckpointState(Checkpoint &cp) { cp.Value(reg_val); }
+
 // EOF
@@ -41,6 +41,7 @@ class AddressExtensionRegister: public Hardware, public TraceValueRegister {
         void Reset() { reg_val = 0; }
         unsigned char GetRegVal() { return reg_val; }
         void SetRegVal(unsigned char val) { reg_val = val & reg_mask; }
+        void CheckpointState(Checkpoint &cp);
 
         IOReg<AddressExtensionRegister> ext_reg;
 };
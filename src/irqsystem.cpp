@@ -29,6 +29,7 @@
 #include "systemclock.h"
 #include "helper.h"
 #include "avrerror.h"
+#include "checkpoint.h"
 
 #include "application.h"
 
@@ -188,10 +189,14 @@ HWIrqSystem::HWIrqSystem(AvrDevice* _core, int bytes, int tblsize):
     bytesPerVector(bytes),
     vectorTableSize(tblsize),
     irqTrace(tblsize),
+    irqPartnerList(tblsize, (Hardware*)NULL),
+    pendingMask(0),
     core(_core),
     irqStatistic(_core),
     debugInterruptTable(tblsize, (Hardware*)NULL)
 {
+    if(vectorTableSize > 64)
+        avr_error("Interrupt vector table with %d entries is too large", tblsize);
     for(unsigned int i = 0; i < vectorTableSize; i++) {
         TraceValue* tv = new TraceValue(1, GetTraceValuePrefix() + "VECTOR" + int2str(i));
         tv->set_written(0);
@@ -200,18 +205,32 @@ HWIrqSystem::HWIrqSystem(AvrDevice* _core, int bytes, int tblsize):
     }
 }
 
+/// Index of lowest set bit in mask, mask must not be 0
+static inline unsigned int LowestBit(unsigned long long mask) {
+#ifdef __GNUC__
+    return __builtin_ctzll(mask);
+#else
+    unsigned int index = 0;
+    while((mask & 1) == 0) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
 unsigned int HWIrqSystem::GetNewPc(unsigned int &actualVector) {
     unsigned int newPC = 0xffffffff;
 
-    static map<unsigned int, Hardware *>::iterator ii;
-    static map<unsigned int, Hardware *>::iterator end;
-    end = irqPartnerList.end();
-
-    //a map is always sorted, so the priority of the irq vector is known and handled correctly
-    for(ii = irqPartnerList.begin(); ii != end; ii++) {
-        Hardware* second = ii->second;
-        unsigned int index = ii->first;
-        assert(index < vectorTableSize);
+    //lowest vector has highest priority, so we look from lowest bit
+    unsigned long long mask = pendingMask;
+    while(mask != 0) {
+        unsigned int index = LowestBit(mask);
+        mask &= mask - 1;
+        //flag could be cleared meanwhile by clearing a level interrupt
+        if((pendingMask & (1ULL << index)) == 0)
+            continue;
+        Hardware* second = irqPartnerList[index];
 
         if(second->IsLevelInterrupt(index)) {
             second->ClearIrqFlag(index);
@@ -234,23 +253,25 @@ unsigned int HWIrqSystem::GetNewPc(unsigned int &actualVector) {
 void HWIrqSystem::SetIrqFlag(Hardware *hwp, unsigned int vector) {
     assert(vector < vectorTableSize);
     irqPartnerList[vector]=hwp;
+    pendingMask |= 1ULL << vector;
     if (core->trace_on) {
         traceOut << core->GetFname() << " interrupt on index " << vector << " is pending" << endl;
     }
 
     if ( irqStatistic.entries[vector].actual.flagSet==0) { //the actual entry was not used before... fine!
-        irqStatistic.entries[vector].actual.flagSet=SystemClock::Instance().GetCurrentTime();
+        irqStatistic.entries[vector].actual.flagSet=core->GetSystemClock().GetCurrentTime();
     } 
 }
 
 void HWIrqSystem::ClearIrqFlag(unsigned int vector) {
-    irqPartnerList.erase(vector);
+    assert(vector < vectorTableSize);
+    pendingMask &= ~(1ULL << vector);
     if (core->trace_on) {
         traceOut << core->GetFname() << " interrupt on index " << vector << "cleared" << endl;
     }
 
     if (irqStatistic.entries[vector].actual.flagCleared==0) {
-        irqStatistic.entries[vector].actual.flagCleared=SystemClock::Instance().GetCurrentTime();
+        irqStatistic.entries[vector].actual.flagCleared=core->GetSystemClock().GetCurrentTime();
     }
 
     irqStatistic.entries[vector].CheckComplete();
@@ -263,7 +284,7 @@ void HWIrqSystem::IrqHandlerStarted(unsigned int vector) {
     }
 
     if (irqStatistic.entries[vector].actual.handlerStarted==0) {
-        irqStatistic.entries[vector].actual.handlerStarted=SystemClock::Instance().GetCurrentTime();
+        irqStatistic.entries[vector].actual.handlerStarted=core->GetSystemClock().GetCurrentTime();
     }
     irqStatistic.entries[vector].CheckComplete();
 }
@@ -275,11 +296,17 @@ void HWIrqSystem::IrqHandlerFinished(unsigned int vector) {
     }
 
     if (irqStatistic.entries[vector].actual.handlerFinished==0) {
-        irqStatistic.entries[vector].actual.handlerFinished=SystemClock::Instance().GetCurrentTime();
+        irqStatistic.entries[vector].actual.handlerFinished=core->GetSystemClock().GetCurrentTime();
     }
     irqStatistic.entries[vector].CheckComplete();
 }
 
+void HWIrqSystem::CheckpointState(Checkpoint &cp) {
+    cp.Value(pendingMask);
+    for(unsigned int i = 0; i < vectorTableSize; i++)
+        cp.Part(irqPartnerList[i]);
+}
+
 void HWIrqSystem::DebugVerifyInterruptVector(unsigned int vector, const Hardware* source) {
     assert(vector < vectorTableSize);
     const Hardware* existing = debugInterruptTable[vector];
@@ -307,6 +334,10 @@ IrqStatistic::IrqStatistic (AvrDevice *c):Printable(cout), core(c) {
     Application::GetInstance()->RegisterPrintable(this);
 }
 
+IrqStatistic::~IrqStatistic() {
+    Application::GetInstance()->UnregisterPrintable(this);
+}
+
 //the standard function object for a printable is printing to "out", so we do this here 
 void IrqStatistic::operator()() {
     if(enableIRQStatistic)
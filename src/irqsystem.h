@@ -106,7 +106,7 @@ class IrqStatistic: public Printable {
         IrqStatistic(AvrDevice *);
         void operator()();
 
-        virtual ~IrqStatistic() {}
+        virtual ~IrqStatistic();
 
         friend std::ostream& operator<<(std::ostream &, const IrqStatistic&);
 };
@@ -123,8 +123,10 @@ class HWIrqSystem: public TraceValueRegister {
         HWSreg *status;
         std::vector<TraceValue*> irqTrace;
         
-        /// priority queue of pending interrupts (i.e. waiting to be processed)
-        std::map<unsigned int, Hardware *> irqPartnerList;
+        /// hardware, which has set the pending interrupt, indexed by vector
+        std::vector<Hardware *> irqPartnerList;
+        /// bit per vector, set if interrupt is pending (i.e. waiting to be processed)
+        unsigned long long pendingMask;
         AvrDevice *core;
         IrqStatistic irqStatistic;
         std::vector<const Hardware*> debugInterruptTable;
@@ -134,6 +136,10 @@ class HWIrqSystem: public TraceValueRegister {
 
         /// returns a new PC pointer if interrupt occurred, -1 otherwise.
         unsigned int GetNewPc(unsigned int &vector_index);
+        /// returns true, if any interrupt is pending, costs only a word test
+        bool IsIrqPending(void) const { return pendingMask != 0; }
+        /// returns true, if one of vectors (bit n for vector n) is pending
+        bool IsIrqPending(unsigned long long vectors) const { return (pendingMask & vectors) != 0; }
         void SetIrqFlag(Hardware *, unsigned int vector_index);
         void ClearIrqFlag(unsigned int vector_index);
         void IrqHandlerStarted(unsigned int vector_index);
@@ -141,6 +147,8 @@ class HWIrqSystem: public TraceValueRegister {
         /// In datasheets RESET vector is index 1 but we use 0! And not a byte address.
         void DebugVerifyInterruptVector(unsigned int vector_index, const Hardware* source);
         void DebugDumpTable();
+        /// saves or restores pending interrupts for a checkpoint
+        void CheckpointState(Checkpoint &cp);
 };
 
 #ifndef SWIG
@@ -159,6 +167,8 @@ class IrqFunktor: public Funktor {
             vectorNo(_vector) {}
         void operator()() { (irqSystem->*fp)(vectorNo); }
         Funktor* clone() { return new IrqFunktor(*this); }
+        /// returns the vector, which is handled
+        unsigned int GetVector(void) const { return vectorNo; }
 };
 
 #endif // ifndef SWIG
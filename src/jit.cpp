@@ -0,0 +1,390 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#include <string.h>
+#include <iomanip>
+
+#include "jit.h"
+#include "avrdevice.h"
+#include "decoder.h"
+#include "flash.h"
+#include "hwsreg.h"
+#include "rwmem.h"
+#include "application.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+//! Size of executable code buffer, if full, all translations are dropped
+static const unsigned int codeBufferSize = 4 * 1024 * 1024;
+
+// x86 register encodings in ModRM byte for [rdx] addressing
+enum {
+    JIT_AL = 0x02,
+    JIT_CL = 0x0a,
+    JIT_AH = 0x22
+};
+
+// condition codes for setcc (second opcode byte)
+enum {
+    JIT_SETO = 0x90,
+    JIT_SETC = 0x92,
+    JIT_SETZ = 0x94,
+    JIT_SETS = 0x98,
+    JIT_SETL = 0x9c
+};
+
+#ifdef JIT_X86_64
+//! Checks once, if the host allows writable and executable memory
+static bool ProbeExecutableMemory(void) {
+    // hardened kernels may refuse writable and executable memory
+    void *p = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(p == MAP_FAILED)
+        return false;
+    munmap(p, 4096);
+    return true;
+}
+#endif
+
+bool AvrJit::IsAvailable(void) {
+#ifdef JIT_X86_64
+    // initialization of a local static is done once, also with several threads
+    static const bool available = ProbeExecutableMemory();
+    return available;
+#else
+    return false;
+#endif
+}
+
+AvrJit::AvrJit(AvrDevice *c):
+    Printable(cout),
+    nativeRuns(0),
+    interpretedRuns(0),
+    translations(0),
+    flushes(0),
+    core(c),
+    codeBuffer(NULL),
+    codeUsed(0)
+{
+#ifdef JIT_X86_64
+    void *p = mmap(NULL, codeBufferSize, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(p != MAP_FAILED)
+        codeBuffer = (unsigned char *)p;
+#endif
+    Application::GetInstance()->RegisterPrintable(this);
+}
+
+AvrJit::~AvrJit() {
+    Application::GetInstance()->UnregisterPrintable(this);
+    core->Flash->ClearNative();
+#ifdef JIT_X86_64
+    if(codeBuffer != NULL)
+        munmap(codeBuffer, codeBufferSize);
+#endif
+}
+
+bool AvrJit::Execute(ThreadedInstruction *ti) {
+    if(ti->native == NULL) {
+        if(++ti->hits < hotThreshold) {
+            interpretedRuns++;
+            return false;
+        }
+        ti->native = (ThreadedInstruction::NativeCode)Translate(ti);
+        if(ti->native == NULL) {
+            ti->hits = 0;
+            interpretedRuns++;
+            return false;
+        }
+    }
+    ti->native();
+    nativeRuns++;
+    return true;
+}
+
+void AvrJit::Flush(void) {
+    core->Flash->ClearNative();
+    codeUsed = 0;
+    flushes++;
+}
+
+void AvrJit::operator()() {
+    PrintStatistic(out);
+}
+
+void AvrJit::PrintStatistic(ostream &os) const {
+    unsigned long long runs = nativeRuns + interpretedRuns;
+    os << "JIT statistic:" << endl
+        << "  translated blocks: " << translations
+        << ", code buffer flushes: " << flushes << endl
+        << "  block runs: " << runs
+        << ", native: " << nativeRuns
+        << ", interpreted: " << interpretedRuns << endl
+        << "  hit rate: " << fixed << setprecision(1)
+        << (runs ? 100.0 * nativeRuns / runs : 0.0) << "%" << endl;
+}
+
+void AvrJit::Emit64(const void *p) {
+    unsigned long long v = (unsigned long long)p;
+    for(int i = 0; i < 8; i++, v >>= 8)
+        Emit(v & 0xff);
+}
+
+unsigned char *AvrJit::RegAddress(unsigned int reg) {
+    RAM *r = dynamic_cast<RAM *>(core->rw[reg]);
+    return (r == NULL) ? NULL : r->GetValueAddress();
+}
+
+void *AvrJit::Translate(const ThreadedInstruction *ti) {
+    if(codeBuffer == NULL)
+        return NULL;
+
+    code.clear();
+    Emit(0x53);                                     // push rbx, aligns stack for calls
+    for(unsigned int i = 0; i < ti->blockLength && ti[i].cycles != 0; i++) {
+        if(TranslateInstruction(&ti[i]))
+            continue;
+        // call threaded code handler
+        Emit(0x48, 0xbf); Emit64(core);             // mov rdi, core
+        Emit(0x48, 0xbe); Emit64(&ti[i]);           // mov rsi, ti
+        Emit(0x48, 0xb8); Emit64((const void *)ti[i].handler); // mov rax, handler
+        Emit(0xff, 0xd0);                           // call rax
+    }
+    Emit(0x5b);                                     // pop rbx
+    Emit(0xc3);                                     // ret
+
+    if(codeUsed + code.size() > codeBufferSize)
+        Flush();
+    unsigned char *p = codeBuffer + codeUsed;
+    memcpy(p, &code[0], code.size());
+    codeUsed = (codeUsed + code.size() + 15) & ~15u;
+    translations++;
+    return p;
+}
+
+bool AvrJit::TranslateInstruction(const ThreadedInstruction *ti) {
+    HWSreg *sreg = core->status;
+    unsigned char *rd = RegAddress(ti->op1);
+    unsigned char *rdh = NULL;
+    unsigned char *rr = NULL;
+    unsigned char *rrh = NULL;
+    bool regPair = false;
+    bool keepZ = false;
+    bool carryIn = false;
+    unsigned char op;
+
+    switch(ti->kind) {
+        case ThreadedInstruction::KIND_ADC:
+        case ThreadedInstruction::KIND_ADD:
+        case ThreadedInstruction::KIND_AND:
+        case ThreadedInstruction::KIND_CP:
+        case ThreadedInstruction::KIND_CPC:
+        case ThreadedInstruction::KIND_EOR:
+        case ThreadedInstruction::KIND_MOV:
+        case ThreadedInstruction::KIND_OR:
+        case ThreadedInstruction::KIND_SBC:
+        case ThreadedInstruction::KIND_SUB:
+            rr = RegAddress(ti->op2);
+            if(rr == NULL)
+                return false;
+            break;
+        case ThreadedInstruction::KIND_MOVW:
+            rr = RegAddress(ti->op2);
+            rrh = RegAddress(ti->op2 + 1);
+            if(rr == NULL || rrh == NULL)
+                return false;
+            // fall through
+        case ThreadedInstruction::KIND_ADIW:
+        case ThreadedInstruction::KIND_SBIW:
+            rdh = RegAddress(ti->op1 + 1);
+            if(rdh == NULL)
+                return false;
+            regPair = true;
+            break;
+        case ThreadedInstruction::KIND_OTHER:
+            return false;
+        default:
+            break;
+    }
+    if(rd == NULL)
+        return false;
+
+    switch(ti->kind) {
+        case ThreadedInstruction::KIND_NOP:
+            return true;
+
+        case ThreadedInstruction::KIND_LDI:
+            EmitAddress(rd); Emit(0xc6, 0x02, ti->op2);     // mov byte [rdx], K
+            return true;
+
+        case ThreadedInstruction::KIND_MOV:
+        case ThreadedInstruction::KIND_MOVW:
+            EmitAddress(rr); Emit(0x8a, JIT_AL);            // mov al, [rr]
+            EmitAddress(rd); Emit(0x88, JIT_AL);            // mov [rd], al
+            if(regPair) {
+                EmitAddress(rrh); Emit(0x8a, JIT_AL);
+                EmitAddress(rdh); Emit(0x88, JIT_AL);
+            }
+            return true;
+
+        case ThreadedInstruction::KIND_SWAP:
+            EmitAddress(rd); Emit(0x8a, JIT_AL);
+            Emit(0xc0, 0xc0, 0x04);                         // rol al, 4
+            Emit(0x88, JIT_AL);
+            return true;
+
+        case ThreadedInstruction::KIND_ADIW:
+        case ThreadedInstruction::KIND_SBIW:
+            EmitAddress(rd); Emit(0x8a, JIT_AL);
+            EmitAddress(rdh); Emit(0x8a, JIT_AH);
+            // add/sub ax, K
+            Emit(0x66, (ti->kind == ThreadedInstruction::KIND_ADIW) ? 0x05 : 0x2d);
+            Emit(ti->offset & 0xff, (ti->offset >> 8) & 0xff);
+            Emit(0x88, JIT_AH);                             // mov [rdh], ah
+            EmitAddress(rd); Emit(0x88, JIT_AL);
+            EmitSetFlag(JIT_SETC, &sreg->C);
+            EmitSetFlag(JIT_SETZ, &sreg->Z);
+            EmitSetFlag(JIT_SETS, &sreg->N);
+            EmitSetFlag(JIT_SETO, &sreg->V);
+            EmitSetFlag(JIT_SETL, &sreg->S);
+            return true;
+
+        case ThreadedInstruction::KIND_AND:  op = 0x20; break;
+        case ThreadedInstruction::KIND_EOR:  op = 0x30; break;
+        case ThreadedInstruction::KIND_OR:   op = 0x08; break;
+        case ThreadedInstruction::KIND_ANDI: op = 0x24; break;
+        case ThreadedInstruction::KIND_ORI:  op = 0x0c; break;
+        case ThreadedInstruction::KIND_ADD:  op = 0x00; break;
+        case ThreadedInstruction::KIND_ADC:  op = 0x10; carryIn = true; break;
+        case ThreadedInstruction::KIND_SUB:  op = 0x28; break;
+        case ThreadedInstruction::KIND_SBC:  op = 0x18; carryIn = keepZ = true; break;
+        case ThreadedInstruction::KIND_CP:   op = 0x38; break;
+        case ThreadedInstruction::KIND_CPC:  op = 0x18; carryIn = keepZ = true; break;
+        case ThreadedInstruction::KIND_CPI:  op = 0x3c; break;
+        case ThreadedInstruction::KIND_SUBI: op = 0x2c; break;
+        case ThreadedInstruction::KIND_SBCI: op = 0x1c; carryIn = keepZ = true; break;
+        case ThreadedInstruction::KIND_COM:
+        case ThreadedInstruction::KIND_DEC:
+        case ThreadedInstruction::KIND_INC:
+        case ThreadedInstruction::KIND_LSR:
+            op = 0; break;
+        default:
+            return false;
+    }
+
+    // load operands, flags of x86 are not changed by mov
+    if(rr != NULL) {
+        EmitAddress(rr); Emit(0x8a, JIT_CL);                // mov cl, [rr]
+    }
+    EmitAddress(rd); Emit(0x8a, JIT_AL);                    // mov al, [rd]
+    if(carryIn) {
+        EmitAddress(&sreg->C); Emit(0x8a, JIT_AH);          // mov ah, [C]
+        Emit(0xd0, 0xec);                                   // shr ah, 1 -> CF = C
+    }
+
+    switch(ti->kind) {
+        case ThreadedInstruction::KIND_COM:
+            Emit(0x34, 0xff);                               // xor al, 0xff
+            break;
+        case ThreadedInstruction::KIND_DEC:
+            Emit(0xfe, 0xc8);                               // dec al
+            break;
+        case ThreadedInstruction::KIND_INC:
+            Emit(0xfe, 0xc0);                               // inc al
+            break;
+        case ThreadedInstruction::KIND_LSR:
+            Emit(0xd0, 0xe8);                               // shr al, 1
+            break;
+        default:
+            if(rr != NULL)
+                Emit(op, 0xc8);                             // op al, cl
+            else
+                Emit(op, ti->op2);                          // op al, K
+            break;
+    }
+
+    // write back result, if it's not a compare
+    if(ti->kind != ThreadedInstruction::KIND_CP &&
+       ti->kind != ThreadedInstruction::KIND_CPC &&
+       ti->kind != ThreadedInstruction::KIND_CPI) {
+        EmitAddress(rd); Emit(0x88, JIT_AL);                // mov [rd], al
+    }
+
+    switch(ti->kind) {
+        case ThreadedInstruction::KIND_LSR:
+            // C = V = S = bit 0 of operand, N = 0
+            EmitSetFlag(JIT_SETC, &sreg->C);
+            EmitSetFlag(JIT_SETC, &sreg->V);
+            EmitSetFlag(JIT_SETC, &sreg->S);
+            EmitSetFlag(JIT_SETZ, &sreg->Z);
+            EmitAddress(&sreg->N); Emit(0xc6, 0x02, 0x00);
+            return true;
+
+        case ThreadedInstruction::KIND_AND:
+        case ThreadedInstruction::KIND_ANDI:
+        case ThreadedInstruction::KIND_OR:
+        case ThreadedInstruction::KIND_ORI:
+        case ThreadedInstruction::KIND_EOR:
+        case ThreadedInstruction::KIND_COM:
+        case ThreadedInstruction::KIND_INC:
+        case ThreadedInstruction::KIND_DEC:
+            EmitSetFlag(JIT_SETZ, &sreg->Z);
+            EmitSetFlag(JIT_SETS, &sreg->N);
+            EmitSetFlag(JIT_SETO, &sreg->V);
+            EmitSetFlag(JIT_SETL, &sreg->S);
+            if(ti->kind == ThreadedInstruction::KIND_COM) {
+                EmitAddress(&sreg->C); Emit(0xc6, 0x02, 0x01);
+            }
+            return true;
+
+        default:
+            break;
+    }
+
+    // add, subtract and compare
+    EmitSetFlag(JIT_SETC, &sreg->C);
+    if(keepZ) {
+        // Z remains unchanged, if result is 0, cleared otherwise
+        EmitAddress(&sreg->Z);
+        Emit(0x74, 0x03);                                   // jz +3
+        Emit(0xc6, 0x02, 0x00);                             // mov byte [rdx], 0
+    } else
+        EmitSetFlag(JIT_SETZ, &sreg->Z);
+    EmitSetFlag(JIT_SETS, &sreg->N);
+    EmitSetFlag(JIT_SETO, &sreg->V);
+    EmitSetFlag(JIT_SETL, &sreg->S);
+    // H is the x86 auxiliary carry, only available by lahf
+    Emit(0x9f);                                             // lahf
+    Emit(0xc0, 0xec, 0x04);                                 // shr ah, 4
+    Emit(0x80, 0xe4, 0x01);                                 // and ah, 1
+    EmitAddress(&sreg->H); Emit(0x88, JIT_AH);              // mov [H], ah
+    return true;
+}
+
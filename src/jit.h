@@ -0,0 +1,97 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003   Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef JIT_H_INCLUDED
+#define JIT_H_INCLUDED
+
+#include <vector>
+
+#include "printable.h"
+
+class AvrDevice;
+class ThreadedInstruction;
+
+//! Translates hot blocks of AVR instructions to native x86-64 code
+/*! Works on blocks built by AvrFlash::GetBlock. The straight-line part of a
+  block is translated, the terminating branch is executed by AvrDevice as
+  before. So the clocks of a block are the same as with the block engine.
+  Register only instructions are translated to native instructions, which
+  access the core registers and SREG flags direct, all other instructions
+  of a block are called by their threaded code handler. Translation is only
+  available on Linux x86-64 hosts, see IsAvailable. */
+class AvrJit: public Printable {
+
+    public:
+        //! Count of block executions, before a block is translated
+        static const unsigned int hotThreshold = 16;
+
+        AvrJit(AvrDevice *core);
+        ~AvrJit();
+
+        //! Returns true, if native code can be created on this host
+        static bool IsAvailable(void);
+
+        //! Executes straight-line part of a block by native code
+        /*! Translates the block, if it is hot. Returns false, if the block
+          isn't translated, then caller has to execute the block itself. */
+        bool Execute(ThreadedInstruction *ti);
+
+        //! Forget all translated blocks and reuse code buffer
+        void Flush(void);
+
+        //! Prints statistic, see Application::PrintResults
+        void operator()();
+        //! Writes statistic to os
+        void PrintStatistic(std::ostream &os) const;
+
+        unsigned long long nativeRuns; //!< block executions by native code
+        unsigned long long interpretedRuns; //!< block executions, where block wasn't translated
+        unsigned long long translations; //!< count of translated blocks
+        unsigned long long flushes; //!< count of code buffer flushes
+
+    protected:
+        AvrDevice *core;
+        unsigned char *codeBuffer; //!< executable memory for native code
+        unsigned int codeUsed; //!< used bytes in codeBuffer
+        std::vector<unsigned char> code; //!< native code of block in translation
+
+        //! Translates a block, returns NULL, if not possible
+        void *Translate(const ThreadedInstruction *ti);
+        //! Creates native code for one instruction in code
+        bool TranslateInstruction(const ThreadedInstruction *ti);
+        //! Address of core register value, NULL if it isn't a RAM cell
+        unsigned char *RegAddress(unsigned int reg);
+
+        void Emit(unsigned char b) { code.push_back(b); }
+        void Emit(unsigned char b1, unsigned char b2) { Emit(b1); Emit(b2); }
+        void Emit(unsigned char b1, unsigned char b2, unsigned char b3) { Emit(b1, b2); Emit(b3); }
+        void Emit64(const void *p);
+        //! mov rdx, address
+        void EmitAddress(const void *p) { Emit(0x48, 0xba); Emit64(p); }
+        //! set flag at address from condition code of setcc instruction
+        void EmitSetFlag(unsigned char cc, bool *flag) { EmitAddress(flag); Emit(0x0f, cc, 0x02); }
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include <string.h> //strcpy()
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #include "memory.h"
 #include "avrerror.h"
@@ -72,45 +73,68 @@ void Memory::DumpSymbols() {
     }
 }
 
-string Memory::GetSymbolAtAddress(unsigned int add){
-    string lastName;
-    unsigned int lastAddr = 0;
-    multimap<unsigned int, string>::iterator ii;
-    multimap<unsigned int, string>::iterator last_ii;
-
-    ii = sym.begin();
-    last_ii = ii;
-    if(ii == sym.end())
-        return ""; // we have no symbols at all
-    do {
-        if(lastAddr != ii->first) {
-            last_ii = ii;
-            lastName = ii->second;
-        }
-        lastAddr = ii->first;
-
-        if(ii->first == add)
-            break; // found symbol
-        ii++;
-        if((ii != sym.end()) && (ii->first > add))
-            break; // behind the right symbol
-    } while(ii != sym.end());
-    
-    ostringstream os;
+static bool SymbolAddrLess(unsigned int add, const MemorySymbol &e) {
+    return add < e.addr;
+}
+
+static bool SymbolLess(const MemorySymbol &a, const MemorySymbol &b) {
+    return a.addr < b.addr;
+}
+
+void Memory::AddSymbol(pair<unsigned int, string> p, unsigned int size) {
+    sym.insert(p);
 
-    os << lastName;
-    ii = last_ii;
-    while((++ii) != sym.end()) { 
-        if(lastAddr != ii->first)
-            break;
-        os << "," << ii->second;
-    };
-
-    unsigned int offset = add - lastAddr;
-    if((offset) != 0) {
-        os << "+0x" << hex << offset;
+    MemorySymbol e;
+    e.addr = p.first;
+    e.size = size;
+    e.label = p.second;
+    e.names.push_back(p.second);
+    symIndex.push_back(e);
+}
+
+void Memory::SortSymbols(void) {
+    // names on same address in order of insertion
+    stable_sort(symIndex.begin(), symIndex.end(), SymbolLess);
+    vector<MemorySymbol>::iterator last = symIndex.begin();
+    for(vector<MemorySymbol>::iterator i = symIndex.begin(); i != symIndex.end(); i++) {
+        if(i == last)
+            continue;
+        if(i->addr == last->addr) {
+            last->label += "," + i->label;
+            last->names.insert(last->names.end(), i->names.begin(), i->names.end());
+            last->size = max(last->size, i->size);
+        } else if(++last != i)
+            *last = *i;
     }
+    if(!symIndex.empty())
+        symIndex.erase(last + 1, symIndex.end());
+}
+
+const MemorySymbol *Memory::FindSymbol(unsigned int add, unsigned int &offset) const {
+    if(symIndex.empty())
+        return NULL; // we have no symbols at all
+
+    vector<MemorySymbol>::const_iterator i =
+        upper_bound(symIndex.begin(), symIndex.end(), add, SymbolAddrLess);
+    // before first symbol, take the first one (offset wraps around)
+    if(i != symIndex.begin())
+        i--;
+    offset = add - i->addr;
+    if(i->size != 0 && offset >= i->size)
+        return NULL; // behind end of symbol
+    return &(*i);
+}
+
+string Memory::GetSymbolAtAddress(unsigned int add){
+    unsigned int offset;
+    const MemorySymbol *e = FindSymbol(add, offset);
+    if(e == NULL)
+        return "";
 
+    if(offset == 0)
+        return e->label;
+    ostringstream os;
+    os << e->label << "+0x" << hex << offset;
     return os.str();
 }
 
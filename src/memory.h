@@ -28,10 +28,19 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include "decoder.h"
 #include "avrmalloc.h"
 
+//! All symbols of one address, entry of the symbol index of Memory
+struct MemorySymbol {
+    unsigned int addr; //!< symbol address
+    unsigned int size; //!< biggest symbol size at addr, 0 if unknown (up to next symbol)
+    std::vector<std::string> names; //!< names of all symbols at addr
+    std::string label; //!< names concatenated by ','
+};
+
 //! Hold a memory block and symbol informations.
 /*!  Memory class to hold memory content and symbol informations to map symbols
   to addresses and vice versa. */
@@ -64,6 +73,17 @@ class Memory {
           @param add the given address
           @return a string with all found symbols, concatenated by ',' */
         std::string GetSymbolAtAddress(unsigned int add);
+
+        /*! Find the symbol entry for address
+
+          Same as GetSymbolAtAddress, but without building a string. Does a
+          binary search on the symbol index, which is built by SortSymbols,
+          so it can be called from several threads.
+          @param add the given address
+          @param offset set to the offset of add to the symbol address
+          @return entry of the symbol at or before add, NULL, if there are no
+          symbols or add is behind the end of a symbol with known size */
+        const MemorySymbol *FindSymbol(unsigned int add, unsigned int &offset) const;
         
         /*! Returns the address for a symbol
         
@@ -78,8 +98,15 @@ class Memory {
         
         /*! Add the (address, symbol) pair
         
-          @param p a std::pair with address and symbol string */
-        void AddSymbol(std::pair<unsigned int, std::string> p) { sym.insert(p); }
+          The symbol is found by FindSymbol after the next SortSymbols.
+          @param p a std::pair with address and symbol string
+          @param size size of symbol in units of this memory, 0 if unknown */
+        void AddSymbol(std::pair<unsigned int, std::string> p, unsigned int size = 0);
+
+        /*! Sorts the symbols added by AddSymbol into the index of FindSymbol
+
+          Called once after all symbols are added, e.g. after ELF load. */
+        void SortSymbols(void);
         
         void DumpSymbols();
 
@@ -88,6 +115,9 @@ class Memory {
         
         /*! Write memory data to memory */
         virtual void WriteMem(const unsigned char*, unsigned int offset, unsigned int size) = 0;
+
+    private:
+        std::vector<MemorySymbol> symIndex; //!< sorted by address by SortSymbols, see FindSymbol
 };
 
 //! Hold data memory block and symbol informations.
@@ -25,6 +25,11 @@
 
 #include "net.h"
 #include "pin.h"
+#include "systemclock.h"
+
+Net::Net(): clock(SystemClock::Instance()) {}
+
+Net::Net(SystemClock &c): clock(c) {}
 
 void Net::Add(Pin *p) {
     push_back(p);
@@ -48,6 +53,9 @@ Net::~Net() {
 }
 
 bool Net::CalcNet() {
+    // other devices on the net have to see the change soon, see SystemClock::SetQuantum
+    clock.RequestSync();
+
     Pin result(Pin::TRISTATE);
     iterator ii;
     for(ii = begin(); ii != end(); ii++)
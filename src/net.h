@@ -30,6 +30,8 @@
 
 #include "pin.h"
 
+class SystemClock;
+
 //! Connect Pins to each other and transfers a output change from a pin to input values for all pins
 class Net
 #ifndef SWIG
@@ -37,7 +39,10 @@ class Net
 #endif
 {
     public:
-        //Net() {} //!< Common Constructor, initially it'a a "empty net" and useless!
+        //! Creates a empty net, which syncs the time table of the current SimulationContext
+        Net();
+        //! Creates a empty net, which syncs time table c on a change
+        Net(SystemClock &c);
         virtual ~Net(); //!< Destructor, disconnects save all pins, which are connected
         void Add(Pin *p); //!< Add a pin to net, e.g. connect a pin to others
         virtual void Delete(Pin *p); //!< Remove a pin from net
@@ -46,6 +51,7 @@ class Net
         
     private:
         friend void Pin::RegisterNet(Net*);
+        SystemClock &clock; //!< time table of the connected devices
 };
 
 #endif
@@ -159,6 +159,7 @@ class Pin {
 
         bool isPortPin(void) { return pinOfPort != NULL; } //!< True, if it's a port pin
         bool isConnected(void) { return connectedTo != NULL; } //!< True, if it's connected to other pins
+        Net *GetNet(void) { return connectedTo; } //!< Returns the connection to other pins, NULL if not connected
         bool hasListener(void) { return notifyList.size() != 0; } //!< True, if there change listeners
 
         friend class HWPort;
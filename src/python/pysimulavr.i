@@ -5,12 +5,15 @@
   #include "systemclocktypes.h"
   #include "avrdevice.h"
   #include "systemclock.h"
+  #include "simulationcontext.h"
   #include "hardware.h"
   #include "externaltype.h"
   #include "irqsystem.h"
   #include "pin.h"
   #include "pinatport.h"
   #include "net.h"
+  #include "cosimulation.h"
+  #include "checkpoint.h"
   #include "rwmem.h"
   #include "hwsreg.h"
   #include "avrfactory.h"
@@ -97,6 +100,13 @@ namespace std {
     DumpVCD *d = new DumpVCD(vcdname, timebase, rstrobe, wstrobe);
     $self->addDumper(d, $self->load(istr));
   }
+  void addDumpFST(const std::string &fstname,
+                  const std::string &istr,
+                  const bool rstrobe,
+                  const bool wstrobe) {
+    DumpFST *d = new DumpFST(fstname, rstrobe, wstrobe);
+    $self->addDumper(d, $self->load(istr));
+  }
 }
 
 %extend AvrDevice {
@@ -114,6 +124,8 @@ namespace std {
   }
 }
 
+%include "simulationcontext.h"
+
 %feature("director") Hardware;
 %include "hardware.h"
 %include "hwport.h"
@@ -134,6 +146,8 @@ namespace std {
 
 %include "pinatport.h"
 %include "net.h"
+%include "cosimulation.h"
+%include "checkpoint.h"
 
 %feature("director") RWMemoryMember;
 %include "rwmem.h"
@@ -171,11 +185,10 @@ namespace std {
 
 %extend Breakpoints {
   void RemoveBreakpoint(unsigned bp) {
-    Breakpoints::iterator ii;
-    if ((ii = find($self->begin(), $self->end(), bp)) != $self->end()) $self->erase(ii);
+    $self->Remove(bp);
   }
   void AddBreakpoint(unsigned bp) {
-    $self->push_back(bp);
+    $self->Add(bp);
   }
 }
 
@@ -0,0 +1,103 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+#ifndef RINGBUFFER_H_INCLUDED
+#define RINGBUFFER_H_INCLUDED
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/** A lock free ring buffer for exactly one producer and one consumer thread.
+    Put() must only be called by the producer, Get() only by the consumer.
+    The capacity is rounded up to a power of 2. */
+template<typename T>
+class RingBuffer {
+
+    public:
+        RingBuffer(size_t capacity);
+
+        //! Append item, gives false and does nothing, if buffer is full
+        bool Put(const T &item);
+
+        //! Take oldest item, gives false, if buffer is empty
+        bool Get(T &item);
+
+        //! Number of items in buffer, only a snapshot, if called from producer
+        size_t Fill(void) const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+        //! Max. number of items in buffer
+        size_t Capacity(void) const { return items.size(); }
+
+    private:
+        std::vector<T> items;
+        size_t mask;
+        std::atomic<size_t> head; //!< next write position, changed by producer
+        std::atomic<size_t> tail; //!< next read position, changed by consumer
+        size_t tailCache; //!< last seen tail, only used by producer
+        size_t headCache; //!< last seen head, only used by consumer
+};
+
+template<typename T>
+RingBuffer<T>::RingBuffer(size_t capacity):
+    head(0),
+    tail(0),
+    tailCache(0),
+    headCache(0)
+{
+    size_t size = 1;
+    while(size < capacity)
+        size <<= 1;
+    items.resize(size);
+    mask = size - 1;
+}
+
+template<typename T>
+bool RingBuffer<T>::Put(const T &item) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if(h - tailCache == items.size()) {
+        tailCache = tail.load(std::memory_order_acquire);
+        if(h - tailCache == items.size())
+            return false;
+    }
+    items[h & mask] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool RingBuffer<T>::Get(T &item) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if(t == headCache) {
+        headCache = head.load(std::memory_order_acquire);
+        if(t == headCache)
+            return false;
+    }
+    item = items[t & mask];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+#endif
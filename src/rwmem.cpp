@@ -36,6 +36,7 @@
 #include "avrdevice.h"
 #include "helper.h"
 #include "rwmem.h"
+#include "checkpoint.h"
 
 using namespace std;
 
@@ -91,6 +92,8 @@ RWMemoryMember::~RWMemoryMember() {
         delete tv;
 }
 
+void GPIORegister::CheckpointState(Checkpoint &cp) { cp.Value(value); }
+
 CLKPRRegister::CLKPRRegister(AvrDevice *core,
                              TraceValueRegister *registry):
         RWMemoryMember(registry, "CLKPR"),
@@ -101,9 +104,6 @@ CLKPRRegister::CLKPRRegister(AvrDevice *core,
     else
         value = 0;
     activate = 0;
-
-    // connect to core to get core cycles
-    core->AddToCycleList(this);
 }
 
 void CLKPRRegister::Reset(void) {
@@ -112,6 +112,7 @@ void CLKPRRegister::Reset(void) {
     else
         value = 0;
     activate = 0;
+    _core->RemoveFromCycleList(this);
 }
 
 unsigned int CLKPRRegister::CpuCycle(void) {
@@ -120,13 +121,20 @@ unsigned int CLKPRRegister::CpuCycle(void) {
         activate--;
         value &= 0x7f; // reset CLKPCE, if set
     }
+    // core cycles are only needed while activation period is running
+    if(activate == 0)
+        _core->RemoveFromCycleList(this);
     return 0;
 }
 
 void CLKPRRegister::set(unsigned char v) {
     if(v == 0x80) {
         // set activation period
-        if(activate == 0) activate = 4;
+        if(activate == 0) {
+            activate = 4;
+            // connect to core to get core cycles
+            _core->AddToCycleList(this);
+        }
     } else if((v & 0x80) == 0) {
         if(activate > 0) {
             string buf = "<invalid>";
@@ -140,6 +148,12 @@ void CLKPRRegister::set(unsigned char v) {
     value = v;
 }
 
+void CLKPRRegister::CheckpointState(Checkpoint &cp) {
+    // cycle list of core is saved by core
+    cp.Value(value);
+    cp.Value(activate);
+}
+
 XDIVRegister::XDIVRegister(AvrDevice *core,
                              TraceValueRegister *registry):
         RWMemoryMember(registry, "XDIV"), 
@@ -165,6 +179,8 @@ void XDIVRegister::set(unsigned char v) {
     }
 }
 
+void XDIVRegister::CheckpointState(Checkpoint &cp) { cp.Value(value); }
+
 OSCCALRegister::OSCCALRegister(AvrDevice *core,
                              TraceValueRegister *registry,
                              int cal):
@@ -192,6 +208,8 @@ void OSCCALRegister::set(unsigned char v) {
     value = v;
 }
 
+void OSCCALRegister::CheckpointState(Checkpoint &cp) { cp.Value(value); }
+
 RAM::RAM(TraceValueCoreRegister *_reg, const std::string &name, const size_t number, const size_t maxsize) {
     corereg = _reg;
     value = 0xaa;
@@ -210,6 +228,8 @@ unsigned char RAM::get() const { return value; }
 
 void RAM::set(unsigned char v) { value=v; }
 
+void RAM::CheckpointState(Checkpoint &cp) { cp.Value(value); }
+
 InvalidMem::InvalidMem(AvrDevice* _c, int _a):
     RWMemoryMember(),
     core(_c),
@@ -262,4 +282,31 @@ void IOSpecialReg::set(unsigned char val) {
     value = val;
 }
 
+void IOSpecialReg::CheckpointState(Checkpoint &cp) { cp.Value(value); }
+
+SleepControl::SleepControl(IOSpecialReg *reg, unsigned char se, unsigned char sm):
+    seMask(se),
+    smMask(sm),
+    enabled(false),
+    mode(0)
+{
+    reg->connectSRegClient(this);
+}
+
+unsigned char SleepControl::set_from_reg(const IOSpecialReg* reg, unsigned char nv) {
+    enabled = (nv & seMask) != 0;
+    mode = nv & smMask;
+    return nv;
+}
+
+unsigned long long SleepControl::GetWakeupVectors(void) const {
+    std::map<unsigned char, unsigned long long>::const_iterator i = wakeup.find(mode);
+    return (i == wakeup.end()) ? ~0ULL : i->second;
+}
+
+void SleepControl::CheckpointState(Checkpoint &cp) {
+    cp.Value(enabled);
+    cp.Value(mode);
+}
+
 // EOF
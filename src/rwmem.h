@@ -29,12 +29,14 @@
 
 #include <string>       // std::string
 #include <vector>
+#include <map>
 
 #include "traceval.h"
 #include "avrerror.h"
 #include "hardware.h"
 
 class TraceValue;
+class Checkpoint;
 
 //!Member of any memory area in an AVR device.
 /*! Allows to be read and written byte-wise.
@@ -66,6 +68,12 @@ class RWMemoryMember {
         virtual ~RWMemoryMember();
         const std::string &GetTraceName(void) { return tracename; }
         bool IsInvalid(void) const { return isInvalid; } 
+        //! Saves or restores the stored value for a checkpoint, see Checkpoint
+        /*! The default is for cells without own state, like IOReg. */
+        virtual void CheckpointState(Checkpoint &cp) {}
+        //! Reads the value without side effects on hardware and without tracing
+        /*! \return false, if reading could change hardware state, val isn't changed then */
+        virtual bool Peek(unsigned char &val) const { return false; }
 
     protected:
         /*! This function is the function which will
@@ -101,6 +109,7 @@ class GPIORegister: public RWMemoryMember, public Hardware {
         
         // from Hardware
         void Reset(void) { value = 0; }
+        void CheckpointState(Checkpoint &cp);
         
     protected:
         unsigned char get() const { return value; }
@@ -120,6 +129,8 @@ class CLKPRRegister: public RWMemoryMember, public Hardware {
         // from Hardware
         void Reset(void);
         unsigned int CpuCycle(void);
+        unsigned long long IdleCycles(void) { return (activate > 0) ? 0 : idleForever; }
+        void CheckpointState(Checkpoint &cp);
 
     protected:
         unsigned char get() const { return value; }
@@ -140,6 +151,7 @@ class XDIVRegister: public RWMemoryMember, public Hardware {
 
         // from Hardware
         void Reset(void) { value = 0; }
+        void CheckpointState(Checkpoint &cp);
 
     protected:
         unsigned char get() const { return value; }
@@ -166,6 +178,7 @@ class OSCCALRegister: public RWMemoryMember, public Hardware {
 
         // from Hardware
         void Reset(void);
+        void CheckpointState(Checkpoint &cp);
 
     protected:
         unsigned char get() const { return value; }
@@ -185,6 +198,10 @@ class RAM : public RWMemoryMember {
             const std::string &tracename,
             const size_t number,
             const size_t maxsize);
+
+        //! Address of the stored value, used by AvrJit to access core registers directly
+        unsigned char *GetValueAddress(void) { return &value; }
+        void CheckpointState(Checkpoint &cp);
         
     protected:
         unsigned char get() const;
@@ -245,7 +262,8 @@ class IOReg: public RWMemoryMember {
             RWMemoryMember(registry, tracename),
             p(_p),
             g(_g),
-            s(_s)
+            s(_s),
+            sideEffectFree(false)
         {
             // 'undefined state' doesn't really make sense for IO registers 
             if (tv)
@@ -255,6 +273,14 @@ class IOReg: public RWMemoryMember {
         /*! Reflects a value change from hardware (for example timer count occured)
           @param val the new register value */
         void hardwareChange(unsigned char val) { if(tv) tv->change(val); }
+        /*! Tells, that get method doesn't change hardware state, so Peek can use it */
+        void SetSideEffectFree(void) { sideEffectFree = true; }
+        bool Peek(unsigned char &val) const {
+            if(!sideEffectFree || !g)
+                return false;
+            val = (p->*g)();
+            return true;
+        }
         /*! Releases the TraceValue to hide this IOReg from registry */
         void releaseTraceValue(void) {
             if(tv) {
@@ -285,6 +311,7 @@ class IOReg: public RWMemoryMember {
         P *p;
         getter_t g;
         setter_t s;
+        bool sideEffectFree; //!< get method doesn't change hardware state, see SetSideEffectFree
 };
 
 class IOSpecialReg;
@@ -348,6 +375,10 @@ class IOSpecialReg: public RWMemoryMember {
           @param val the new register value
           @param mask the bitmask for val */
         void hardwareChangeMask(unsigned char val, unsigned char mask) { if(tv) tv->change(val, mask); }
+
+        void CheckpointState(Checkpoint &cp);
+        //! Clients only reflect their state on reads, so peeking is always possible
+        bool Peek(unsigned char &val) const { val = get(); return true; }
         
     protected:
         std::vector<IOSpecialRegClient*> clients; //!< clients-list with registered clients
@@ -359,4 +390,41 @@ class IOSpecialReg: public RWMemoryMember {
         unsigned char value; //!< Internal register value
 };
 
+//! Holds the sleep enable (SE) and sleep mode (SM) bits of MCUCR or SMCR register for AvrDevice
+/*! The sleep mode is the value of the SM bits, as they are in the register.
+  For each mode, the device tells the interrupt vectors, which wake up the
+  core. A mode without wakeup vectors is like Idle: every interrupt wakes
+  up. Clocks of peripherals aren't stopped in any mode. */
+class SleepControl: public IOSpecialRegClient {
+    
+    public:
+        //! Connects to register, seMask selects SE bit, smMask the SM bits
+        SleepControl(IOSpecialReg *reg, unsigned char seMask, unsigned char smMask);
+        
+        //! Returns true, if SLEEP instruction will put core to sleep
+        bool IsSet(void) const { return enabled; }
+        //! Sets the vectors (bit n for vector n), which wake up the core in sleep mode mode
+        void SetWakeupVectors(unsigned char mode, unsigned long long vectors) { wakeup[mode] = vectors; }
+        //! Returns the vectors, which wake up the core in the selected sleep mode
+        unsigned long long GetWakeupVectors(void) const;
+        //! Saves or restores state of SE and SM bits for a checkpoint
+        void CheckpointState(Checkpoint &cp);
+
+        //! Returns bit mask for vectors first till last, for SetWakeupVectors
+        static unsigned long long Vectors(unsigned int first, unsigned int last) {
+            return (~0ULL >> (63 - last)) & (~0ULL << first);
+        }
+        
+    protected:
+        unsigned char set_from_reg(const IOSpecialReg* reg, unsigned char nv);
+        unsigned char get_from_client(const IOSpecialReg* reg, unsigned char v) { return v; }
+        
+    private:
+        unsigned char seMask; //!< bit mask for SE bit
+        unsigned char smMask; //!< bit mask for SM bits
+        bool enabled; //!< state of SE bit
+        unsigned char mode; //!< state of SM bits
+        std::map<unsigned char, unsigned long long> wakeup; //!< wakeup vectors by mode
+};
+
 #endif
@@ -0,0 +1,100 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+
+#include "simulationcontext.h"
+#include "systemclock.h"
+#include "traceval.h"
+#include "avrerror.h"
+
+//! Current context of a thread, NULL means default context
+static thread_local SimulationContext *currentContext = NULL;
+
+SimulationContext::SimulationContext():
+    dumpManager(NULL),
+    console(new SystemConsoleHandler),
+    ownConsole(true),
+    stopFlag(false)
+{
+    clock = new SystemClock(this);
+}
+
+SimulationContext::SimulationContext(SystemConsoleHandler *c):
+    dumpManager(NULL),
+    console(c),
+    ownConsole(false),
+    stopFlag(false)
+{
+    clock = new SystemClock(this);
+}
+
+SimulationContext::~SimulationContext() {
+    ResetDumpManager();
+    delete clock;
+    if(ownConsole)
+        delete console;
+}
+
+DumpManager *SimulationContext::GetDumpManager(void) {
+    if(dumpManager == NULL)
+        dumpManager = new DumpManager();
+    return dumpManager;
+}
+
+void SimulationContext::ResetDumpManager(void) {
+    if(dumpManager != NULL) {
+        dumpManager->detachAvrDevices();
+        delete dumpManager;
+    }
+    dumpManager = NULL;
+}
+
+SimulationContext &SimulationContext::Default(void) {
+    // never deleted, like the singletons before, so that it's usable up to exit
+    static SimulationContext *context = new SimulationContext(&sysConHandler);
+    return *context;
+}
+
+SimulationContext &SimulationContext::Current(void) {
+    if(currentContext == NULL)
+        return Default();
+    return *currentContext;
+}
+
+SimulationContext::Scope::Scope(SimulationContext &c): last(currentContext) {
+    currentContext = &c;
+}
+
+SimulationContext::Scope::~Scope() {
+    currentContext = last;
+}
+
+SystemConsoleHandler &CurrentConsoleHandler(void) {
+    if(currentContext == NULL)
+        return sysConHandler;
+    return currentContext->GetConsole();
+}
+
+// EOF
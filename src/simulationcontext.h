@@ -0,0 +1,102 @@
+/*
+ ****************************************************************************
+ *
+ * simulavr - A simulator for the Atmel AVR family of microcontrollers.
+ * Copyright (C) 2001, 2002, 2003 Klaus Rudolph
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ ****************************************************************************
+ *
+ *  $Id$
+ */
+
+
+#ifndef SIMULATIONCONTEXT_H_INCLUDED
+#define SIMULATIONCONTEXT_H_INCLUDED
+
+#include <atomic>
+
+class SystemClock;
+class DumpManager;
+class SystemConsoleHandler;
+
+/** Holds everything, which belongs to one simulation: the time table
+    (SystemClock), the DumpManager, the console handler for messages and
+    trace and the stop flag.
+
+    A process can have several contexts, each of them runs its simulation
+    independent of the others, also on different threads. A context may be
+    used only by one thread at a time.
+
+    There is a default context, which uses the global sysConHandler. Each
+    thread has a current context, it's the default context, if not changed
+    by a Scope. SystemClock::Instance(), DumpManager::Instance() and the
+    messages and trace macros of avrerror.h work on the current context.
+    AvrDevice takes the current context on construction, see also
+    AvrFactory::makeDevice. Net, the serial RX/TX parts and Scope take the time
+    table explicitly, their constructors without it take the one of the
+    current context on construction. Run, Endless and Step of a SystemClock make its
+    context current while they are running. */
+class SimulationContext {
+
+    public:
+        //! Creates a context with a own clock, dump manager and console handler
+        SimulationContext();
+        ~SimulationContext();
+
+        //! Returns the time table of this context
+        SystemClock &GetClock(void) { return *clock; }
+        //! Returns the dump manager of this context, it's created on first call
+        DumpManager *GetDumpManager(void);
+        //! Deletes the dump manager, a new one is created on next GetDumpManager
+        void ResetDumpManager(void);
+        //! Returns the console handler of this context
+        SystemConsoleHandler &GetConsole(void) { return *console; }
+
+        //! Asks Run, Endless or Step of the clock to stop, can be called from any thread
+        void Stop(void) { stopFlag.store(true, std::memory_order_relaxed); }
+        //! Returns true, if Stop was called
+        bool IsStopped(void) const { return stopFlag.load(std::memory_order_relaxed); }
+        //! Clears the stop flag
+        void ClearStop(void) { stopFlag.store(false, std::memory_order_relaxed); }
+
+        //! Returns the default context
+        static SimulationContext &Default(void);
+        //! Returns the current context of the calling thread
+        static SimulationContext &Current(void);
+
+        //! Makes a context current for the calling thread, as long as it exists
+        class Scope {
+            public:
+                Scope(SimulationContext &c);
+                ~Scope();
+            private:
+                SimulationContext *last;
+        };
+
+    private:
+        SystemClock *clock;
+        DumpManager *dumpManager;
+        SystemConsoleHandler *console;
+        bool ownConsole; //!< false for default context, which uses sysConHandler
+        std::atomic<bool> stopFlag;
+
+        SimulationContext(SystemConsoleHandler *c);
+        SimulationContext(const SimulationContext &);
+        SimulationContext &operator=(const SimulationContext &);
+};
+
+#endif
@@ -36,9 +36,16 @@
 * will be called later. People, please avoid polling. */
 class SimulationMember : public BaseObj {
     public:
+        SimulationMember(): heapIndex(0), timeDecoupled(false) { }
+        SimulationMember(const SimulationMember &o): BaseObj(), heapIndex(0), timeDecoupled(o.timeDecoupled) { }
+        SimulationMember &operator=(const SimulationMember &) { return *this; }
         virtual ~SimulationMember() { }
         /// Return nonzero if a breakpoint was hit.
         virtual int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns=0)=0;
+        /// Position + 1 in time table of SystemClock, 0 if not scheduled, see MinHeap.
+        unsigned heapIndex;
+        /// Member may run ahead of other such members by the quantum of SystemClock, see SystemClock::SetQuantum.
+        bool timeDecoupled;
 };
 
 #endif 
@@ -79,13 +79,13 @@ RWExit::RWExit(TraceValueRegister *registry,
 void RWExit::set(unsigned char c) {
     avr_message("Exiting at simulated program request (write)");
     DumpManager::Instance()->stopApplication();
-    sysConHandler.ExitApplication(c); 
+    CurrentConsoleHandler().ExitApplication(c); 
 }
 
 unsigned char RWExit::get() const {
     avr_message("Exiting at simulated program request (read)");
     DumpManager::Instance()->stopApplication();
-    sysConHandler.ExitApplication(0); 
+    CurrentConsoleHandler().ExitApplication(0); 
     return 0;
 }
 
@@ -96,13 +96,13 @@ RWAbort::RWAbort(TraceValueRegister *registry,
 void RWAbort::set(unsigned char c) {
     avr_warning("Aborting at simulated program request (write)");
     DumpManager::Instance()->stopApplication();
-    sysConHandler.AbortApplication(c);
+    CurrentConsoleHandler().AbortApplication(c);
 }
 
 unsigned char RWAbort::get() const {
     avr_warning("Aborting at simulated program request (read)");
     DumpManager::Instance()->stopApplication();
-    sysConHandler.AbortApplication(0);
+    CurrentConsoleHandler().AbortApplication(0);
     return 0;
 }
 
@@ -25,6 +25,7 @@
 
 #include "systemclocktypes.h"
 #include "systemclock.h"
+#include "simulationcontext.h"
 #include "simulationmember.h"
 #include "helper.h"
 #include "application.h"
@@ -33,6 +34,8 @@
 
 #include "signal.h"
 #include <assert.h>
+#include <limits>
+#include <mutex>
 
 using namespace std;
 
@@ -43,77 +46,88 @@ MinHeap<Key, Value>::MinHeap()
 }
 
 template<typename Key, typename Value>
-void MinHeap<Key, Value>::RemoveMinimum()
+void MinHeap<Key, Value>::Insert(Key k, Value v)
 {
-    assert(!this->empty());
+    if(ContainsValue(v)) {
+        unsigned pos = v->heapIndex - 1;
+        if(pos > 0 && k < (*this)[(pos - 1) / 2].first)
+            SiftUp(k, v, pos);
+        else
+            SiftDown(k, v, pos);
+        return;
+    }
+    this->resize(this->size() + 1);
+    SiftUp(k, v, this->size() - 1);
+}
+
+template<typename Key, typename Value>
+void MinHeap<Key, Value>::RemoveAtPosition(unsigned pos)
+{
+    assert(pos < this->size());
+    (*this)[pos].second->heapIndex = 0;
     Key k = this->back().first;
     Value v = this->back().second;
-    RemoveMinimumAndInsert(k, v);
     this->pop_back();
+    if(pos == this->size())
+        return;
+    // fill the gap with the last element, it has to move up or down
+    if(pos > 0 && k < (*this)[(pos - 1) / 2].first)
+        SiftUp(k, v, pos);
+    else
+        SiftDown(k, v, pos);
 }
 
 template<typename Key, typename Value>
-bool MinHeap<Key, Value>::ContainsValue(Value v) const
+void MinHeap<Key, Value>::Clear()
 {
     for(unsigned i = 0; i < this->size(); i++)
-    {
-        std::pair<Key,Value> item = (*this)[i];
-        if(item.second == v)
-            return true;
-    }
-    return false;
+        (*this)[i].second->heapIndex = 0;
+    this->clear();
 }
 
 template<typename Key, typename Value>
-void MinHeap<Key, Value>::InsertInternal(Key k, Value v, unsigned pos)
+void MinHeap<Key, Value>::SiftUp(Key k, Value v, unsigned pos)
 {
-    for(unsigned i = pos;;) {
-        unsigned parent = i/2;
-        if(parent == 0 || (*this)[parent-1].first <= k) {
-            (*this)[i-1].first = k;
-            (*this)[i-1].second = v;
-            return;
-        }
-        Key k_temp = (*this)[parent-1].first;
-        Value v_temp = (*this)[parent-1].second;
-        (*this)[i-1].first = k_temp;
-        (*this)[i-1].second = v_temp;
-        i = parent;
+    while(pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+        if((*this)[parent].first <= k)
+            break;
+        Place((*this)[parent].first, (*this)[parent].second, pos);
+        pos = parent;
     }
+    Place(k, v, pos);
 }
 
 template<typename Key, typename Value>
-void MinHeap<Key, Value>::RemoveAtPositionAndInsertInternal(Key k, Value v, unsigned pos)
+void MinHeap<Key, Value>::SiftDown(Key k, Value v, unsigned pos)
 {
     assert(pos < this->size());
-    unsigned i = pos + 1;
     for(;;) {
-        unsigned left = 2*i;
-        unsigned right = 2*i + 1;
-        unsigned smallest = i;
-        if(left-1 < this->size() && (*this)[left-1].first < k)
+        unsigned left = 2 * pos + 1;
+        unsigned right = left + 1;
+        unsigned smallest = pos;
+        if(left < this->size() && (*this)[left].first < k)
             smallest = left;
-        if(right-1 < this->size() && (*this)[right-1].first < k && (*this)[right-1].first < (*this)[left-1].first)
+        if(right < this->size() && (*this)[right].first < k && (*this)[right].first < (*this)[left].first)
             smallest = right;
-        if(smallest == i) {
-            (*this)[smallest-1].first = k;
-            (*this)[smallest-1].second = v;
-            return;
-        }
-        Key k_temp = (*this)[smallest-1].first;
-        Value v_temp = (*this)[smallest-1].second;
-        (*this)[i-1].first = k_temp;
-        (*this)[i-1].second = v_temp;
-        i = smallest;
+        if(smallest == pos)
+            break;
+        Place((*this)[smallest].first, (*this)[smallest].second, pos);
+        pos = smallest;
     }
+    Place(k, v, pos);
 }
 
-SystemClock::SystemClock() { 
-    static int no = 0;
+SystemClock::SystemClock(SimulationContext *c): context(c) {
     currentTime = 0; 
-    no++;
-    if(no > 1)
-        avr_error("Crazy problem: Second instance of SystemClock created!");
+    runAhead = true;
+    stepCounter = 0;
+    runLimit = 0;
+    quantum = 0;
+    quantumEnd = 0;
+    syncRequested = false;
+    quantumSyncs = 0;
+    earlySyncs = 0;
 }
 
 void SystemClock::SetTraceModeForAllMembers(bool trace_on) {
@@ -124,11 +138,56 @@ void SystemClock::SetTraceModeForAllMembers(bool trace_on) {
         if(core != NULL)
             core->trace_on = trace_on;
     }
+    for(mi = decoupledMembers.begin(); mi != decoupledMembers.end(); mi++)
+    {
+        AvrDevice* core = dynamic_cast<AvrDevice*>( mi->second );
+        if(core != NULL)
+            core->trace_on = trace_on;
+    }
 } 
 
 void SystemClock::Add(SimulationMember *dev, SystemClockOffset delayNanos) {
     avr_debug("SystemClock::Add(dev=%s)", dev->FullId().c_str());
-    syncMembers.Insert(currentTime + delayNanos, dev);
+    TableOf(dev).Insert(currentTime + delayNanos, dev);
+}
+
+void SystemClock::Remove(SimulationMember *dev) {
+    syncMembers.RemoveValue(dev);
+    decoupledMembers.RemoveValue(dev);
+}
+
+SystemClockOffset SystemClock::GetScheduledTime(SimulationMember *dev) const {
+    if(syncMembers.ContainsValue(dev))
+        return syncMembers[dev->heapIndex - 1].first;
+    if(decoupledMembers.ContainsValue(dev))
+        return decoupledMembers[dev->heapIndex - 1].first;
+    return -1;
+}
+
+void SystemClock::SetQuantum(SystemClockOffset q) {
+    if(q < 0)
+        q = 0;
+    // move decoupled members to the time table for the new mode
+    MinHeap<SystemClockOffset, SimulationMember *> &from = (q > 0) ? syncMembers : decoupledMembers;
+    vector<pair<SystemClockOffset, SimulationMember *> > moved;
+    for(unsigned i = 0; i < from.size(); i++)
+        if(from[i].second->timeDecoupled)
+            moved.push_back(from[i]);
+    quantum = q;
+    for(unsigned i = 0; i < moved.size(); i++) {
+        from.RemoveValue(moved[i].second);
+        TableOf(moved[i].second).Insert(moved[i].first, moved[i].second);
+    }
+}
+
+SystemClockOffset SystemClock::NextDue(bool decoupled) const {
+    SystemClockOffset due = numeric_limits<SystemClockOffset>::max();
+    if(!syncMembers.IsEmpty())
+        due = syncMembers.GetMinimumKey();
+    // a decoupled member doesn't wait for the other decoupled members
+    if(!decoupled && !decoupledMembers.IsEmpty() && decoupledMembers.GetMinimumKey() < due)
+        due = decoupledMembers.GetMinimumKey();
+    return due;
 }
 
 void SystemClock::AddAsyncMember(SimulationMember *dev) {
@@ -136,39 +195,87 @@ void SystemClock::AddAsyncMember(SimulationMember *dev) {
     asyncMembers.push_back(dev);
 }
 
-volatile bool breakMessage = false;
+//! Set by SIGINT or SIGTERM, stops all contexts, never cleared
+static volatile sig_atomic_t breakSignal = 0;
+
+bool SystemClock::StopRequested(void) const {
+    return breakSignal || context->IsStopped();
+}
+
+void SystemClock::ClearStop(void) {
+    context->ClearStop();
+}
 
 int SystemClock::Step(bool &untilCoreStepFinished) {
+    SimulationContext::Scope scope(*context);
+    return Step(untilCoreStepFinished, 0);
+}
+
+int SystemClock::Step(bool &untilCoreStepFinished, SystemClockOffset limit) {
+    runLimit = limit;
     // 0-> return also if cpu in waitstate 
     // 1-> return if cpu is really finished
     int res = 0; // returns the state from a core step. Needed by gdb-server to
                  // watch for breakpoints
 
-    static vector<SimulationMember*>::iterator ami;
-    static vector<SimulationMember*>::iterator amiEnd;
+    vector<SimulationMember*>::iterator ami;
+    vector<SimulationMember*>::iterator amiEnd;
+
+    // take the earliest member of both time tables, without a quantum all
+    // members are in syncMembers
+    MinHeap<SystemClockOffset, SimulationMember *> *table = &syncMembers;
+    if(!decoupledMembers.IsEmpty() &&
+       (syncMembers.IsEmpty() || decoupledMembers.GetMinimumKey() < syncMembers.GetMinimumKey()))
+        table = &decoupledMembers;
 
-    if(syncMembers.begin() != syncMembers.end()) {
+    if(!table->IsEmpty()) {
         // take simulation member and current simulation time from time table
-        SimulationMember * core = syncMembers.begin()->second;
-        currentTime = syncMembers.begin()->first;
+        SimulationMember * core = table->GetMinimumValue();
+        currentTime = table->GetMinimumKey();
         SystemClockOffset nextStepIn_ns = -1;
+        bool decoupled = (table == &decoupledMembers);
         
-        syncMembers.RemoveMinimum();
-
-        // do a step on simulation member
-        int rc = core->Step(untilCoreStepFinished, &nextStepIn_ns);
-        if (rc)
-            res = rc;
-
-        if(nextStepIn_ns == 0) { // insert the next step behind the following!
-            nextStepIn_ns = 1 + (syncMembers.IsEmpty() ? currentTime : syncMembers.front().first);
-        } else if(nextStepIn_ns > 0)
-            nextStepIn_ns += currentTime;
-        // if nextStepIn_ns is < 0, it means, that this simulation member will not
-        // be called anymore!
+        table->RemoveMinimum();
+        // a decoupled member may run ahead of the others till end of quantum
+        quantumEnd = decoupled ? currentTime + quantum : 0;
+
+        for(;;) {
+            // do a step on simulation member
+            syncRequested = false;
+            int rc = core->Step(untilCoreStepFinished, &nextStepIn_ns);
+            stepCounter++;
+            if (rc)
+                res = rc;
+
+            SystemClockOffset due = NextDue(decoupled);
+            if(nextStepIn_ns == 0) { // insert the next step behind the following!
+                nextStepIn_ns = 1 + ((due == numeric_limits<SystemClockOffset>::max() || due < currentTime) ? currentTime : due);
+            } else if(nextStepIn_ns > 0)
+                nextStepIn_ns += currentTime;
+            // if nextStepIn_ns is < 0, it means, that this simulation member will not
+            // be called anymore!
+
+            // run ahead: step member again, if it's the next one in time table
+            // anyway and nobody else needs to be called in between
+            if(rc || StopRequested() || nextStepIn_ns < 0 || nextStepIn_ns >= limit ||
+               !asyncMembers.empty())
+                break;
+            if(due <= nextStepIn_ns || (decoupled && syncRequested)) {
+                if(decoupled)
+                    earlySyncs++;
+                break;
+            }
+            if(decoupled && nextStepIn_ns >= quantumEnd) {
+                quantumSyncs++;
+                break;
+            }
+            currentTime = nextStepIn_ns;
+            nextStepIn_ns = -1;
+        }
+        quantumEnd = 0;
         
         if(nextStepIn_ns > 0)
-            syncMembers.Insert(nextStepIn_ns, core);
+            table->Insert(nextStepIn_ns, core);
 
         // handle async simulation members
         amiEnd = asyncMembers.end();
@@ -179,69 +286,91 @@ int SystemClock::Step(bool &untilCoreStepFinished) {
     }
 
     // honour the stop command
-    if (breakMessage)
+    if (StopRequested())
         return 1;
 
     return res;
 }
 
 void SystemClock::Reschedule(SimulationMember *sm, SystemClockOffset newTime) {
+    TableOf(sm).Insert(newTime+currentTime+1, sm);
+}
 
-    for(unsigned i = 0; i < syncMembers.size(); i++) {
-        if(syncMembers[i].second == sm) {
-            syncMembers.RemoveAtPositionAndInsert(newTime+currentTime+1, sm, i);
-            return;
-        }
-    }
+SystemClockOffset SystemClock::GetSkipHorizon(void) {
+    if(!asyncMembers.empty() || runLimit <= currentTime)
+        return currentTime;
+    SystemClockOffset horizon = runLimit;
+    if(quantumEnd != 0 && quantumEnd < horizon)
+        horizon = quantumEnd;
+    SystemClockOffset due = NextDue(quantumEnd != 0);
+    if(due < horizon)
+        horizon = due;
+    return horizon;
+}
 
-    syncMembers.Insert(newTime+currentTime+1, sm);
+SystemClockOffset SystemClock::GetEventHorizon(void) const {
+    if(!asyncMembers.empty())
+        return currentTime;
+    return NextDue(quantumEnd != 0);
 }
 
 void OnBreak(int s) {
     signal(SIGINT, SIG_DFL);
     signal(SIGTERM, SIG_DFL);
-    breakMessage = true;
+    breakSignal = 1;
+}
+
+void SystemClock::CatchBreakSignals(void) {
+    // only once, a second signal after the first one terminates the process
+    static std::once_flag installed;
+    std::call_once(installed, []() {
+        signal(SIGINT, OnBreak);
+        signal(SIGTERM, OnBreak);
+    });
+}
+
+bool SystemClock::BreakSignalCaught(void) {
+    return breakSignal != 0;
 }
 
 void SystemClock::Stop() {
-    breakMessage = true;
+    context->Stop();
 }
 
 void SystemClock::ResetClock(void) {
-    breakMessage = false;
+    ClearStop();
     asyncMembers.clear();
-    syncMembers.clear();
+    syncMembers.Clear();
+    decoupledMembers.Clear();
     currentTime = 0;
 }
 
 long SystemClock::Endless() {
-    long steps = 0;
+    SimulationContext::Scope scope(*context);
+    long steps = stepCounter;
+    // only half of the range, so that a fast-forward can't overflow time
+    SystemClockOffset limit = runAhead ? std::numeric_limits<SystemClockOffset>::max() / 2 : 0;
 
-    breakMessage = false;        // if we run a second loop, clear break before entering loop
-    
-    signal(SIGINT, OnBreak);
-    signal(SIGTERM, OnBreak);
+    ClearStop();        // if we run a second loop, clear stop request before entering loop
+    CatchBreakSignals();
 
-    while(breakMessage == false) {
-        steps++;
+    while(!StopRequested()) {
         bool untilCoreStepFinished = false;
-        Step(untilCoreStepFinished);
+        Step(untilCoreStepFinished, limit);
     }
 
-    return steps;
+    return stepCounter - steps;
 }
 
 long SystemClock::Run(SystemClockOffset maxRunTime) {
-    long steps = 0;
-    
-    breakMessage = false;        // if we run a second loop, clear break before entering loop
+    SimulationContext::Scope scope(*context);
+    long steps = stepCounter;
+    SystemClockOffset limit = runAhead ? maxRunTime : 0;
     
-    signal(SIGINT, OnBreak);
-    signal(SIGTERM, OnBreak);
+    ClearStop();        // if we run a second loop, clear stop request before entering loop
+    CatchBreakSignals();
 
-    while((breakMessage== false) &&
-          (SystemClock::Instance().GetCurrentTime() < maxRunTime)) {
-        steps++;
+    while(!StopRequested() && (currentTime < maxRunTime)) {
         bool untilCoreStepFinished = false;
         // This breaks at least ATemga644, core->Step() in SystemClock::Step()
         // occasionally returns 1 in normal program flow even without the use
@@ -254,33 +383,45 @@ long SystemClock::Run(SystemClockOffset maxRunTime) {
         // "patch #7766 Make Step stoppable, print less when used as a library"
         //
         // Let's take the old code (this one line):
-        Step(untilCoreStepFinished);
+        Step(untilCoreStepFinished, limit);
     }
 
-    return steps;
+    return stepCounter - steps;
 }
 
 long SystemClock::RunTimeRange(SystemClockOffset timeRange) {
-    long steps = 0;
+    SimulationContext::Scope scope(*context);
+    long steps = stepCounter;
     bool untilCoreStepFinished;
     
-    breakMessage = false;        // if we run a second loop, clear break before entering loop
-    
-    signal(SIGINT, OnBreak);
-    signal(SIGTERM, OnBreak);
+    ClearStop();        // if we run a second loop, clear stop request before entering loop
+    CatchBreakSignals();
     
-    timeRange += SystemClock::Instance().GetCurrentTime();
-    while((breakMessage == false) && (SystemClock::Instance().GetCurrentTime() < timeRange)) {
+    timeRange += currentTime;
+    while(!StopRequested() && (currentTime < timeRange)) {
         untilCoreStepFinished = false;
-        if (Step(untilCoreStepFinished))
+        if (Step(untilCoreStepFinished, runAhead ? timeRange : 0))
             break;
-        steps++;
     }
     
-    return steps;
+    return stepCounter - steps;
+}
+
+long SystemClock::RunUntil(SystemClockOffset endTime) {
+    SimulationContext::Scope scope(*context);
+    long steps = stepCounter;
+    SystemClockOffset limit = runAhead ? endTime : 0;
+
+    while(!StopRequested() && NextDue(false) < endTime) {
+        bool untilCoreStepFinished = false;
+        Step(untilCoreStepFinished, limit);
+    }
+    if(!StopRequested() && currentTime < endTime)
+        currentTime = endTime;
+
+    return stepCounter - steps;
 }
 
 SystemClock& SystemClock::Instance() {
-    static SystemClock obj;
-    return obj;
+    return SimulationContext::Current().GetClock();
 }
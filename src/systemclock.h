@@ -30,11 +30,18 @@
 #include <vector>
 
 #include "systemclocktypes.h"
+#include "simulationmember.h"
 
-class SimulationMember;
+class SimulationContext;
 
 /** A heap data structure optimized for obtaining Value of the smallest Key.
-    Example MinHeap<SystemClockOffset, SimulationMember*>. */
+    Example MinHeap<SystemClockOffset, SimulationMember*>.
+
+    Value has to be a pointer to a class with a member unsigned heapIndex,
+    in which the heap keeps position + 1 of the item, 0 if it isn't in the
+    heap. So a value can be found, moved and removed in O(log n) without
+    searching it. A value can be only once in the heap (and only in one heap
+    at a time). */
 template<typename Key, typename Value>
 class MinHeap : public std::vector<std::pair<Key,Value> >
 {
@@ -43,25 +50,34 @@ public:
     bool IsEmpty() const { return this->empty(); }
     Key GetMinimumKey() const { return this->front().first; }
     Value GetMinimumValue() const { return this->front().second; };
-    void RemoveMinimum();
-    bool ContainsValue(Value v) const;
-    void Insert(Key k, Value v) {
-        this->resize(this->size()+1);
-        InsertInternal(k, v, this->size());
-    }
-    void RemoveMinimumAndInsert(Key k, Value v) {
-        RemoveAtPositionAndInsertInternal(k, v, 0);
+    void RemoveMinimum() { RemoveAtPosition(0); }
+    bool ContainsValue(Value v) const {
+        return v->heapIndex != 0 && v->heapIndex <= this->size() &&
+            (*this)[v->heapIndex - 1].second == v;
     }
-    void RemoveAtPositionAndInsert(Key k, Value v, unsigned pos) {
-        if(k < (*this)[pos-1].first)
-            InsertInternal(k, v, pos);
-        else
-            RemoveAtPositionAndInsertInternal(k, v, pos);
+    //! Inserts v with key k, if v is in heap already, it's moved to key k
+    void Insert(Key k, Value v);
+    //! Removes element on given position (0 is the minimum)
+    void RemoveAtPosition(unsigned pos);
+    //! Removes v, does nothing, if v isn't in heap
+    void RemoveValue(Value v) {
+        if(ContainsValue(v))
+            RemoveAtPosition(v->heapIndex - 1);
     }
+    //! Removes all elements
+    void Clear();
 protected:
     // These are internal because a bad value of `pos' could violate the binary heap invariant.
-    void InsertInternal(Key k, Value v, unsigned pos);
-    void RemoveAtPositionAndInsertInternal(Key k, Value v, unsigned pos);
+    //! Sets element on position pos and tells v its position
+    void Place(Key k, Value v, unsigned pos) {
+        (*this)[pos].first = k;
+        (*this)[pos].second = v;
+        v->heapIndex = pos + 1;
+    }
+    //! Moves a hole on pos up until k fits and places k, v there
+    void SiftUp(Key k, Value v, unsigned pos);
+    //! Moves a hole on pos down until k fits and places k, v there
+    void SiftDown(Key k, Value v, unsigned pos);
 };
 
 //! Class to store and manage the central simulation time
@@ -82,13 +98,35 @@ protected:
 class SystemClock
 {
     private:
-        SystemClock(); //!< Do not this constructor from application code!
+        friend class SimulationContext;
+        SystemClock(SimulationContext *c); //!< Created only by SimulationContext!
         SystemClock(const SystemClock &); //!< Do not this constructor from application code!
 
     protected:
+        SimulationContext *context; //!< context, which owns this clock
         SystemClockOffset currentTime;  //!< time in [ns] since start of simulation
         MinHeap<SystemClockOffset, SimulationMember *> syncMembers;  //!< earliest first
         std::vector<SimulationMember*> asyncMembers; //!< List of asynchron working simulation members, will be called every step!
+        bool runAhead; //!< Flag, if Run, RunTimeRange and Endless may step a member several times, see SetRunAhead
+        long stepCounter; //!< Count of steps done on simulation members
+        SystemClockOffset runLimit; //!< End of actual run, a member may not run ahead beyond
+        MinHeap<SystemClockOffset, SimulationMember *> decoupledMembers; //!< members with timeDecoupled set, if there is a quantum, earliest first
+        SystemClockOffset quantum; //!< Time, a decoupled member may run ahead of the others, 0 for exact interleaving
+        SystemClockOffset quantumEnd; //!< End of quantum of the member in actual step, 0 if it isn't decoupled
+        bool syncRequested; //!< Set by RequestSync, ends the quantum of the actual member
+        unsigned long long quantumSyncs; //!< Count of quanta, which are run out
+        unsigned long long earlySyncs; //!< Count of quanta, which are ended early
+
+        //! Process one simulation step, the member may run ahead till limit
+        int Step(bool &untilCoreStepFinished, SystemClockOffset limit);
+        //! Returns time table, in which member m has to be placed
+        MinHeap<SystemClockOffset, SimulationMember *> &TableOf(SimulationMember *m) {
+            return (quantum > 0 && m->timeDecoupled) ? decoupledMembers : syncMembers;
+        }
+        //! Returns time of the next member, a (decoupled) member has to wait for, max. value if none
+        SystemClockOffset NextDue(bool decoupled) const;
+        //! Clears stop request of the context
+        void ClearStop(void);
         
     public:
         //! Returns the current simulation time
@@ -100,20 +138,81 @@ class SystemClock
         /*! Attention! Use this method with care, if you don't want crazy results */
         void IncrTime(SystemClockOffset of) { currentTime += of; }
         //! Add a simulation member (normally a device) and schedule it after delayNanos ns
+        /*! If the member is in time table already, it's moved to the new time. */
         void Add(SimulationMember *dev, SystemClockOffset delayNanos = 0);
+        //! Removes a simulation member from time table, e.g. to cancel a scheduled event
+        /*! Does nothing, if the member isn't in time table. */
+        void Remove(SimulationMember *dev);
+        //! Returns the time, on which a simulation member is scheduled, -1 if it isn't in time table
+        SystemClockOffset GetScheduledTime(SimulationMember *dev) const;
         //! Add a async simulation member, this will be called every simulation step.
         void AddAsyncMember(SimulationMember *dev);
         //! Process one simulation step
         int Step(bool &untilCoreStepFinished);
+        //! Enables or disables run ahead mode for Run, RunTimeRange and Endless
+        /*! In run ahead mode a simulation member is stepped again without
+            returning to the time table, as long as no other simulation member
+            is due earlier and no async simulation member is registered. The
+            time table is checked after every step, so a member, which is
+            scheduled by a peripheral meanwhile, is called in time. This is
+            the default. */
+        void SetRunAhead(bool enable) { runAhead = enable; }
+        //! Sets the time quantum for temporal decoupling, 0 means exact interleaving (default)
+        /*! With a quantum, a simulation member with timeDecoupled set (every
+            AvrDevice) may run ahead of the other decoupled members by up to
+            quantum ns without returning to time table. All other members
+            (timers, UI parts, links) are still called exactly in time and
+            end the run ahead of a device, if they are due. The run ahead ends
+            early too, if the device changes a Net (see RequestSync), so
+            another device can react. So a device can see changes of another
+            device up to quantum ns too late or too early and time stamps of
+            traces and dumps of several devices aren't ordered anymore: this
+            trades exact interleaving of devices for speed, like temporal
+            decoupling of SystemC TLM. */
+        void SetQuantum(SystemClockOffset q);
+        //! Returns the time quantum for temporal decoupling
+        SystemClockOffset GetQuantum(void) const { return quantum; }
+        //! Ends the quantum of the actual member after its step, called on change of a Net
+        void RequestSync(void) { syncRequested = true; }
+        //! Returns count of quanta of decoupled members, which are run out
+        unsigned long long GetQuantumSyncCount(void) const { return quantumSyncs; }
+        //! Returns count of quanta of decoupled members, which are ended early by a sync
+        /*! A sync is caused by a change of a Net or by another member, which
+          is due. The ratio to GetQuantumSyncCount shows, how much the quantum
+          is used. */
+        unsigned long long GetEarlySyncCount(void) const { return earlySyncs; }
+        //! Returns time, till a member can fast-forward without missing an event
+        /*! This is the next scheduled time of another simulation member, but
+          not beyond end of actual run or quantum. If there are async members
+          or run ahead isn't possible, it's the current time. Used by a
+          sleeping AvrDevice. */
+        SystemClockOffset GetSkipHorizon(void);
+        //! Returns time of the next step of another simulation member
+        /*! Unlike GetSkipHorizon, it doesn't depend on run ahead, because
+          the caller doesn't move in time. If there are async members, it's
+          the current time. Used by AvrDevice to check, that no other member
+          acts while a block of instructions is executed. */
+        SystemClockOffset GetEventHorizon(void) const;
         //! Run simulation endless till SIGINT or SIGTERM signal, return the number of CPU cycles
         long Endless();
         //! Run simulation till given time is arrived or signal is cached
         long Run(SystemClockOffset maxRunTime);
         //! Like Run method, but stops on breakpoint or after given time offset
         long RunTimeRange(SystemClockOffset timeRange);
-        //! Returns the central SystemClock instance for the application
-        /*! There will be only one instance on a application! */
+        //! Steps all members, which are due before endTime, then sets current time to endTime
+        /*! Unlike Run, a member due at or after endTime isn't stepped, so
+          members can be added for endTime or later after return. Doesn't clear
+          a stop request, on stop current time stays on the last step. Used to
+          run a partition of a CoSimulation window by window. */
+        long RunUntil(SystemClockOffset endTime);
+        //! Returns true, if Stop was called or a SIGINT or SIGTERM signal was caught
+        bool StopRequested(void) const;
+        //! Returns the SystemClock of the current simulation context
+        /*! In a application with only one simulation, this is the central
+          SystemClock instance, see SimulationContext. */
         static SystemClock& Instance();
+        //! Returns the simulation context, which owns this clock
+        SimulationContext *GetContext(void) { return context; }
         //! Moves the given simulation member to a new place in time table
         /*! The next time, simulation member will be called, is calculated as a
             given offset to current simulation time + 1.
@@ -124,8 +223,68 @@ class SystemClock
         void SetTraceModeForAllMembers(bool trace_on);
         //! Stop Run/Endless or Step asynchronously
         void Stop();
+        //! Installs handler for SIGINT and SIGTERM, which stops all contexts
+        /*! The handler is installed once per process, Run, RunTimeRange and
+            Endless call this too. A caught signal isn't cleared, so that every
+            context, also one started later, stops. */
+        static void CatchBreakSignals(void);
+        //! Returns true, if SIGINT or SIGTERM was caught
+        static bool BreakSignalCaught(void);
         //! Resets the simulation time and clears table for simulation members and async simulation members
         void ResetClock(void);
 };
 
+//! A cancellable timer, which calls a method of a hardware part at a given time
+/*! Instead of comparing current time with a deadline on every cpu cycle, a
+    hardware part starts this timer and gets a call from SystemClock, when
+    the time is over. Starting the timer again moves it in time table.
+    The template parameter class P specifies the class to be called. */
+template<class P>
+class SystemClockTimer: public SimulationMember {
+
+    public:
+        typedef void (P::*handler_t)(void);
+        /*! Creates a stopped timer
+          \param _sc: time table, on which the timer runs
+          \param _p: pointer to object to be called
+          \param _h: pointer to method called on timeout */
+        SystemClockTimer(SystemClock &_sc, P *_p, handler_t _h): sc(_sc), p(_p), h(_h), scheduled(false) {}
+        ~SystemClockTimer() { Cancel(); }
+
+        //! Schedules a call after delay ns, a running timer is restarted
+        void Start(SystemClockOffset delay) {
+            if(scheduled)
+                sc.Remove(this);
+            sc.Add(this, (delay < 0) ? 0 : delay);
+            scheduled = true;
+        }
+        //! Stops the timer, if running
+        void Cancel(void) {
+            if(scheduled)
+                sc.Remove(this);
+            scheduled = false;
+        }
+        //! Returns true, if timer is running
+        bool IsScheduled(void) const { return scheduled; }
+        //! Schedules a call at the given time, a running timer is restarted
+        void StartAt(SystemClockOffset time) { Start(time - sc.GetCurrentTime()); }
+        //! Returns time of the scheduled call, -1 if timer isn't running
+        SystemClockOffset GetDueTime(void) { return scheduled ? sc.GetScheduledTime(this) : -1; }
+
+        int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns = 0) {
+            // timer is removed from time table, but handler could start it again
+            scheduled = false;
+            if(timeToNextStepIn_ns != 0)
+                *timeToNextStepIn_ns = -1;
+            (p->*h)();
+            return 0;
+        }
+
+    private:
+        SystemClock &sc;
+        P *p;
+        handler_t h;
+        bool scheduled;
+};
+
 #endif
@@ -26,11 +26,22 @@
 #include <fstream>
 #include <sstream>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+#include <chrono>
 #include "helper.h"
 #include "traceval.h"
 #include "avrdevice.h"
 #include "avrerror.h"
 #include "systemclock.h"
+#include "simulationcontext.h"
+#include "ringbuffer.h"
+#include "config.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 using namespace std;
 
@@ -45,7 +56,14 @@ TraceValue::TraceValue(size_t bits,
     v(0xaffeaffe),
     f(0),
     _written(false),
-    _enabled(false) {}
+    _enabled(false),
+    _manager(NULL),
+    _activeIndex(0) {}
+
+TraceValue::~TraceValue() {
+    if(_manager != NULL)
+        _manager->removeActiveValue(this);
+}
 
 size_t TraceValue::bits() const { return b; }
 
@@ -68,7 +86,7 @@ void TraceValue::enable() { _enabled=true; }
 void TraceValue::change(unsigned val) {
     // this is mostly the same as write, but dosn't set WRITE nor _written flag!
     if ((v != val) || !_written) {
-        f |= CHANGE;
+        mark(CHANGE);
         v = val;
     }
 }
@@ -76,22 +94,22 @@ void TraceValue::change(unsigned val) {
 void TraceValue::change(unsigned val, unsigned mask) {
     // this is mostly the same as write, but dosn't set WRITE nor _written flag!
     if (((v & mask) != (val & mask)) || !_written) {
-        f |= CHANGE;
+        mark(CHANGE);
         v = (v & ~mask) | (val & mask);
     }
 }
 
 void TraceValue::write(unsigned val) {
     if ((v != val) || !_written) {
-        f |= CHANGE;
+        mark(CHANGE);
         v = val;
     }
-    f |= WRITE;
+    mark(WRITE);
     _written = true;
 }
 
 void TraceValue::read() {
-    f |= READ;
+    mark(READ);
 }
 
 bool TraceValue::written() const { return _written;  }
@@ -124,13 +142,15 @@ void TraceValue::cycle() {
             break;
         }
         if (v!=nv) {
-            f|=CHANGE;
+            mark(CHANGE);
             _written=true; // FIXME: This detection can fail!
             v=nv;
         }
     }
 }
 
+bool TraceValue::polled() const { return shadow != NULL; }
+
 void TraceValue::dump(Dumper &d) {
     if (f&READ) {
         d.markRead(this);
@@ -379,11 +399,64 @@ bool WarnUnknown::enabled(const TraceValue *t) const {
     return true;
 }
 
-void DumpVCD::valout(const TraceValue *v) {
-    osbuffer << 'b';
-    for (int i = v->bits()-1; i >= 0; i--)
-        osbuffer << v->VcdBit(i);
+//! Change record, which is sent from simulation to writer thread
+struct VcdRecord {
+    enum { CYCLE, READ, WRITE, CHANGE, STOP };
+    unsigned type;
+    unsigned id; //!< signal number
+    unsigned long long data; //!< time for CYCLE and STOP, packed value for CHANGE
+};
+
+class DumpVCD::AsyncWriter {
+    
+    public:
+        AsyncWriter(void):
+            buffer(1 << 16),
+            records(0),
+            stalls(0),
+            maxFill(0) {}
+        
+        //! Put a record into ring buffer, wait for writer thread, if buffer is full
+        void Put(unsigned type, unsigned id, unsigned long long data) {
+            VcdRecord r;
+            r.type = type;
+            r.id = id;
+            r.data = data;
+            records++;
+            if(!buffer.Put(r)) {
+                stalls++;
+                maxFill = buffer.Capacity();
+                while(!buffer.Put(r))
+                    std::this_thread::yield();
+            } else if((records & 0xff) == 0) {
+                size_t fill = buffer.Fill();
+                if(fill > maxFill)
+                    maxFill = fill;
+            }
+        }
+        
+        RingBuffer<VcdRecord> buffer;
+        std::thread thread;
+        unsigned long long records; //!< count of records
+        unsigned long long stalls; //!< how often the simulation had to wait for writer thread
+        size_t maxFill; //!< max. seen fill level of buffer (sampled)
+};
+
+static const char vcdBitChars[4] = { '0', '1', 'x', 'z' };
+
+unsigned long long DumpVCD::packValue(const TraceValue *v) {
+    unsigned long long bits = 0;
+    for (int i = v->bits()-1; i >= 0; i--) {
+        char c = v->VcdBit(i);
+        bits = (bits << 2) | ((c == '1') ? 1 : (c == 'x') ? 2 : (c == 'z') ? 3 : 0);
+    }
+    return bits;
+}
 
+void DumpVCD::valout(size_t n, unsigned long long bits) {
+    osbuffer << 'b';
+    for (int i = tv[n]->bits()-1; i >= 0; i--)
+        osbuffer << vcdBitChars[(bits >> (2 * i)) & 3];
 }
 
 void DumpVCD::flushbuffer(void) {
@@ -397,24 +470,36 @@ void DumpVCD::flushbuffer(void) {
 DumpVCD::DumpVCD(ostream *_os,
                  const std::string &_tscale,
                  const bool rstrobes,
-                 const bool wstrobes) :
+                 const bool wstrobes,
+                 const bool _async) :
     tscale(_tscale),
     rs(rstrobes),
     ws(wstrobes),
+    async(_async),
     changesWritten(false),
-    os(_os)
+    os(_os),
+    writer(NULL)
 {}
 
 DumpVCD::DumpVCD(const std::string &_name,
                  const std::string &_tscale,
                  const bool rstrobes,
-                 const bool wstrobes) :
+                 const bool wstrobes,
+                 const bool _async) :
     tscale(_tscale),
     rs(rstrobes),
     ws(wstrobes),
+    async(_async),
     changesWritten(false),
-    os(new ofstream(_name.c_str()))
-{}
+    iobuffer(1 << 20),
+    writer(NULL)
+{
+    // use a big buffer, stream buffer has to be set before opening the file
+    ofstream *f = new ofstream;
+    f->rdbuf()->pubsetbuf(&iobuffer[0], iobuffer.size());
+    f->open(_name.c_str());
+    os = f;
+}
 
 void DumpVCD::setActiveSignals(const TraceSet &act) {
     tv=act;
@@ -463,7 +548,7 @@ void DumpVCD::start() {
     n=0;
     for (iter i=tv.begin();
          i!=tv.end(); i++) {
-        valout(*i);
+        valout(n, packValue(*i));
         osbuffer << ' ' << n*(1+rs+ws) << '\n';
         // reset RS, WS
         if (rs) {
@@ -479,14 +564,55 @@ void DumpVCD::start() {
     }
     osbuffer << "$end\n";
     flushbuffer();
+
+    // from now on output is done by writer thread
+    if (async && writer == NULL) {
+        writer = new AsyncWriter;
+        writer->thread = std::thread(&DumpVCD::writerLoop, this);
+    }
+}
+
+void DumpVCD::writerLoop(void) {
+    VcdRecord r;
+    for (;;) {
+        if (!writer->buffer.Get(r)) {
+            // nothing to do, give simulation time to produce some records
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        switch (r.type) {
+            case VcdRecord::CYCLE:
+                writeCycle(r.data);
+                break;
+            case VcdRecord::READ:
+                writeRead(r.id);
+                break;
+            case VcdRecord::WRITE:
+                writeWrite(r.id);
+                break;
+            case VcdRecord::CHANGE:
+                writeChange(r.id, r.data);
+                break;
+            case VcdRecord::STOP:
+                writeStop(r.data);
+                return;
+        }
+    }
 }
 
 void DumpVCD::cycle() {
+    SystemClockOffset clock=SystemClock::Instance().GetCurrentTime();
+    if (writer)
+        writer->Put(VcdRecord::CYCLE, 0, clock);
+    else
+        writeCycle(clock);
+}
+
+void DumpVCD::writeCycle(SystemClockOffset clock) {
     // flush the buffer
     flushbuffer();
     
     // write new time marker to buffer
-    SystemClockOffset clock=SystemClock::Instance().GetCurrentTime();
     osbuffer << "#" << clock << '\n';
 
     // reset RS, WS states
@@ -498,11 +624,24 @@ void DumpVCD::cycle() {
 }
 
 void DumpVCD::stop() {
+    SystemClockOffset clock=SystemClock::Instance().GetCurrentTime();
+    if (writer) {
+        writer->Put(VcdRecord::STOP, 0, clock);
+        writer->thread.join();
+        avr_message("VCD writer: %llu records, %llu waits on full buffer, max. fill %lu of %lu records",
+                    writer->records, writer->stalls,
+                    (unsigned long)writer->maxFill, (unsigned long)writer->buffer.Capacity());
+        delete writer;
+        writer = NULL;
+    } else
+        writeStop(clock);
+}
+
+void DumpVCD::writeStop(SystemClockOffset clock) {
     // flush the buffer
     flushbuffer();
     
     // write a last time marker to report end of dump
-    SystemClockOffset clock=SystemClock::Instance().GetCurrentTime();
     *os << "#" << clock << '\n';
     
     os->flush(); // flush stream
@@ -510,25 +649,46 @@ void DumpVCD::stop() {
 
 void DumpVCD::markRead(const TraceValue *t) {
     if (rs) {
-        // mark read cycle
-        osbuffer << "1" << id2num[t]*(1+rs+ws)+1 << "\n";
-        changesWritten = true;
-        // mark to disable @ next cycle
-        marked.push_back(id2num[t]*(1+rs+ws)+1);
+        if (writer)
+            writer->Put(VcdRecord::READ, id2num[t], 0);
+        else
+            writeRead(id2num[t]);
     }
 }
 
+void DumpVCD::writeRead(size_t n) {
+    // mark read cycle
+    osbuffer << "1" << n*(1+rs+ws)+1 << "\n";
+    changesWritten = true;
+    // mark to disable @ next cycle
+    marked.push_back(n*(1+rs+ws)+1);
+}
+
 void DumpVCD::markWrite(const TraceValue *t) {
     if (ws) {
-        osbuffer << "1" << id2num[t]*(1+rs+ws)+1+rs << "\n";
-        changesWritten = true;
-        marked.push_back(id2num[t]*(1+rs+ws)+1+rs);
+        if (writer)
+            writer->Put(VcdRecord::WRITE, id2num[t], 0);
+        else
+            writeWrite(id2num[t]);
     }
 }
 
+void DumpVCD::writeWrite(size_t n) {
+    osbuffer << "1" << n*(1+rs+ws)+1+rs << "\n";
+    changesWritten = true;
+    marked.push_back(n*(1+rs+ws)+1+rs);
+}
+
 void DumpVCD::markChange(const TraceValue *t) {
-    valout(t);
-    osbuffer << " " << id2num[t]*(1+rs+ws) << "\n";
+    if (writer)
+        writer->Put(VcdRecord::CHANGE, id2num[t], packValue(t));
+    else
+        writeChange(id2num[t], packValue(t));
+}
+
+void DumpVCD::writeChange(size_t n, unsigned long long bits) {
+    valout(n, bits);
+    osbuffer << " " << n*(1+rs+ws) << "\n";
     changesWritten = true;
 }
 
@@ -536,36 +696,469 @@ bool DumpVCD::enabled(const TraceValue *t) const {
     return id2num.find(t)!=id2num.end();
 }
 
-DumpVCD::~DumpVCD() { delete os; }
+DumpVCD::~DumpVCD() {
+    // stop writer thread, if stop() wasn't called
+    if (writer)
+        stop();
+    delete os;
+}
+
+#ifdef HAVE_ZLIB
+
+// FST block types and codes, see fstapi.h of GTKWave
+#define FST_BL_HDR                  0
+#define FST_BL_VCDATA               1
+#define FST_BL_GEOM                 3
+#define FST_BL_HIER                 4
+#define FST_ST_VCD_MODULE           0
+#define FST_ST_VCD_SCOPE            254
+#define FST_ST_VCD_UPSCOPE          255
+#define FST_VT_VCD_WIRE             16
+#define FST_VD_IMPLICIT             0
+#define FST_FT_VERILOG              0
+#define FST_HDR_SIM_VERSION_SIZE    128
+#define FST_HDR_DATE_SIZE           119
+#define FST_HDR_SIZE                330
+
+//! a new block is written, if collected changes are bigger than this
+static const size_t fstBlockLimit = 8 << 20;
+
+//! append a variable length integer, 7 bits per byte, lowest bits first
+static void fstVarint(vector<unsigned char> &b, uint64_t v) {
+    while(v >= 0x80) {
+        b.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    b.push_back((unsigned char)v);
+}
+
+//! append a 64 bit integer, big endian
+static void fstUint64(vector<unsigned char> &b, uint64_t v) {
+    for(int i = 56; i >= 0; i -= 8)
+        b.push_back((unsigned char)(v >> i));
+}
+
+//! zlib compression, gives false, if data doesn't get smaller
+static bool fstCompress(const unsigned char *data, size_t len, int level, vector<unsigned char> &out) {
+    if(len == 0)
+        return false;
+    uLongf destlen = compressBound(len);
+    out.resize(destlen);
+    if(compress2(&out[0], &destlen, data, len, level) != Z_OK || destlen >= len)
+        return false;
+    out.resize(destlen);
+    return true;
+}
+
+static void fstVar(vector<unsigned char> &h, const string &name, size_t bits) {
+    h.push_back(FST_VT_VCD_WIRE);
+    h.push_back(FST_VD_IMPLICIT);
+    h.insert(h.end(), name.begin(), name.end());
+    h.push_back(0);
+    fstVarint(h, bits);
+    fstVarint(h, 0); // no alias
+}
+
+DumpFST::DumpFST(const std::string &name,
+                 const bool rstrobes,
+                 const bool wstrobes) :
+    rs(rstrobes),
+    ws(wstrobes),
+    curTime(0),
+    blockBytes(0),
+    blockCount(0),
+    running(false)
+{
+    os = new ofstream(name.c_str(), ios::out | ios::binary | ios::trunc);
+    if(!os->is_open())
+        avr_error("Can't open '%s'", name.c_str());
+}
+
+void DumpFST::setActiveSignals(const TraceSet &act) {
+    tv=act;
+    size_t n=0;
+    for (TraceSet::const_iterator i=act.begin();
+         i!=act.end(); i++) {
+        if (id2num.find(*i)!=id2num.end())
+            avr_error("Trace value would be twice in FST list.");
+        id2num[*i]=n++;
+        // value, R-strobe, W-strobe, same numbering as in DumpVCD
+        for (size_t k=0; k<(size_t)(1+rs+ws); k++) {
+            Signal s;
+            s.bits = k ? 1 : (*i)->bits();
+            s.offset = curval.size();
+            s.hasLast = false;
+            s.lastIndex = s.lastPos = s.prevIndex = 0;
+            signals.push_back(s);
+            curval.append(s.bits, 'x');
+        }
+    }
+    strobeHigh.assign(signals.size(), 0);
+    strobeHit.assign(signals.size(), 0);
+}
 
-int DumpManager::_devidx = 0;
-DumpManager *::DumpManager::_instance = NULL;
+void DumpFST::start() {
+    writeHeader();
+    
+    // initial state at time 0
+    curTime = 0;
+    for (size_t n=0; n<tv.size(); n++) {
+        markChange(tv[n]);
+        if (rs)
+            change(n*(1+rs+ws)+1, "0");
+        if (ws)
+            change(n*(1+rs+ws)+1+rs, "0");
+    }
+    frame = curval;
+    running = true;
+}
+
+size_t DumpFST::timeIndex(void) {
+    if(times.empty() || times.back() != curTime)
+        times.push_back(curTime);
+    return times.size() - 1;
+}
+
+void DumpFST::change(size_t n, const char *val) {
+    Signal &s = signals[n];
+    size_t idx = timeIndex();
+    size_t from;
+    if(s.hasLast && s.lastIndex == idx) {
+        // second change in same time step, replace the first one
+        blockBytes -= s.chain.size() - s.lastPos;
+        s.chain.resize(s.lastPos);
+        from = s.prevIndex;
+    } else {
+        from = s.prevIndex = s.hasLast ? s.lastIndex : 0;
+        s.lastIndex = idx;
+        s.lastPos = s.chain.size();
+        s.hasLast = true;
+    }
+    
+    // time is coded as difference of time table index to last change
+    size_t oldSize = s.chain.size();
+    uint64_t delta = idx - from;
+    if(s.bits == 1) {
+        if(val[0] == '0' || val[0] == '1')
+            fstVarint(s.chain, (delta << 2) | ((val[0] & 1) << 1));
+        else
+            fstVarint(s.chain, (delta << 4) | ((val[0] == 'z') ? 3 : 1));
+    } else {
+        bool binary = true;
+        for(size_t b = 0; b < s.bits; b++) {
+            if(val[b] != '0' && val[b] != '1') {
+                binary = false;
+                break;
+            }
+        }
+        if(binary) {
+            // 8 bits in a byte, first bit is msb
+            fstVarint(s.chain, delta << 1);
+            unsigned char acc = 0;
+            for(size_t b = 0; b < s.bits; b++) {
+                acc |= (val[b] & 1) << (7 - (b & 7));
+                if((b & 7) == 7 || b == s.bits - 1) {
+                    s.chain.push_back(acc);
+                    acc = 0;
+                }
+            }
+        } else {
+            fstVarint(s.chain, (delta << 1) | 1);
+            s.chain.insert(s.chain.end(), val, val + s.bits);
+        }
+    }
+    blockBytes += s.chain.size() - oldSize;
+    curval.replace(s.offset, s.bits, val, s.bits);
+}
+
+void DumpFST::updateStrobes(void) {
+    // strobes, which are not accessed again, go low
+    for (size_t i=0; i<highList.size(); ) {
+        size_t s = highList[i];
+        if (!strobeHit[s]) {
+            change(s, "0");
+            strobeHigh[s] = 0;
+            highList[i] = highList.back();
+            highList.pop_back();
+        } else
+            i++;
+    }
+    for (size_t i=0; i<hitList.size(); i++) {
+        size_t s = hitList[i];
+        if (!strobeHigh[s]) {
+            change(s, "1");
+            strobeHigh[s] = 1;
+            highList.push_back(s);
+        }
+        strobeHit[s] = 0;
+    }
+    hitList.clear();
+}
+
+void DumpFST::cycle() {
+    updateStrobes();
+    if (blockBytes >= fstBlockLimit)
+        writeBlock();
+    curTime = SystemClock::Instance().GetCurrentTime();
+}
+
+void DumpFST::markRead(const TraceValue *t) {
+    if (rs) {
+        size_t s = id2num[t]*(1+rs+ws)+1;
+        if (!strobeHit[s]) {
+            strobeHit[s] = 1;
+            hitList.push_back(s);
+        }
+    }
+}
+
+void DumpFST::markWrite(const TraceValue *t) {
+    if (ws) {
+        size_t s = id2num[t]*(1+rs+ws)+1+rs;
+        if (!strobeHit[s]) {
+            strobeHit[s] = 1;
+            hitList.push_back(s);
+        }
+    }
+}
+
+void DumpFST::markChange(const TraceValue *t) {
+    char val[32];
+    size_t bits = t->bits();
+    for (size_t b=0; b<bits; b++)
+        val[b] = t->VcdBit(bits-1-b);
+    change(id2num[t]*(1+rs+ws), val);
+}
+
+bool DumpFST::enabled(const TraceValue *t) const {
+    return id2num.find(t)!=id2num.end();
+}
+
+void DumpFST::writeBlock(void) {
+    vector<unsigned char> b, tmp;
+    
+    b.push_back(FST_BL_VCDATA);
+    fstUint64(b, 0); // section length, set below
+    fstUint64(b, times.front());
+    fstUint64(b, times.back());
+    fstUint64(b, blockBytes); // memory needed to read all changes
+    
+    // values at begin of block
+    fstVarint(b, frame.size());
+    const unsigned char *fp = (const unsigned char *)frame.data();
+    if(fstCompress(fp, frame.size(), 4, tmp)) {
+        fstVarint(b, tmp.size());
+        fstVarint(b, signals.size());
+        b.insert(b.end(), tmp.begin(), tmp.end());
+    } else {
+        fstVarint(b, frame.size());
+        fstVarint(b, signals.size());
+        b.insert(b.end(), fp, fp + frame.size());
+    }
+    
+    // changes for each signal and table of positions
+    fstVarint(b, signals.size());
+    size_t vcStart = b.size();
+    b.push_back('Z'); // zlib compression
+    vector<unsigned char> pos;
+    size_t lastPos = 0, unchanged = 0;
+    for(size_t i = 0; i < signals.size(); i++) {
+        Signal &s = signals[i];
+        if(s.chain.empty()) {
+            unchanged++;
+            continue;
+        }
+        if(unchanged) {
+            fstVarint(pos, unchanged << 1);
+            unchanged = 0;
+        }
+        fstVarint(pos, ((b.size() - vcStart - lastPos) << 1) | 1);
+        lastPos = b.size() - vcStart;
+        if(s.chain.size() > 32 && fstCompress(&s.chain[0], s.chain.size(), 4, tmp)) {
+            fstVarint(b, s.chain.size());
+            b.insert(b.end(), tmp.begin(), tmp.end());
+        } else {
+            fstVarint(b, 0);
+            b.insert(b.end(), s.chain.begin(), s.chain.end());
+        }
+        s.chain.clear();
+        s.hasLast = false;
+    }
+    if(unchanged)
+        fstVarint(pos, unchanged << 1);
+    b.insert(b.end(), pos.begin(), pos.end());
+    fstUint64(b, pos.size());
+    
+    // time table, differences to last time
+    vector<unsigned char> t;
+    SystemClockOffset last = 0;
+    for(size_t i = 0; i < times.size(); i++) {
+        fstVarint(t, times[i] - last);
+        last = times[i];
+    }
+    if(fstCompress(&t[0], t.size(), 9, tmp)) {
+        b.insert(b.end(), tmp.begin(), tmp.end());
+        fstUint64(b, t.size());
+        fstUint64(b, tmp.size());
+    } else {
+        b.insert(b.end(), t.begin(), t.end());
+        fstUint64(b, t.size());
+        fstUint64(b, t.size());
+    }
+    fstUint64(b, times.size());
+    
+    // section length without block type
+    vector<unsigned char> len;
+    fstUint64(len, b.size() - 1);
+    copy(len.begin(), len.end(), b.begin() + 1);
+    os->write((const char *)&b[0], b.size());
+    blockCount++;
+    
+    // next block starts with time and values at end of this block
+    frame = curval;
+    times.erase(times.begin(), times.end() - 1);
+    blockBytes = 0;
+}
+
+void DumpFST::writeHeader(void) {
+    vector<unsigned char> b;
+    b.push_back(FST_BL_HDR);
+    fstUint64(b, FST_HDR_SIZE - 1);
+    fstUint64(b, 0); // start time
+    fstUint64(b, curTime); // end time
+    double endtest = 2.7182818284590452354; // to detect byte order of doubles
+    const unsigned char *e = (const unsigned char *)&endtest;
+    b.insert(b.end(), e, e + sizeof(double));
+    fstUint64(b, fstBlockLimit); // memory used by writer
+    fstUint64(b, tv.size()); // count of scopes
+    fstUint64(b, signals.size()); // count of variables
+    fstUint64(b, signals.size()); // max. handle
+    fstUint64(b, blockCount); // count of value change blocks
+    b.push_back((unsigned char)-9); // time scale 1ns
+    string version("Simulavr FST dump file generator");
+    version.resize(FST_HDR_SIM_VERSION_SIZE, '\0');
+    b.insert(b.end(), version.begin(), version.end());
+    time_t now = time(NULL);
+    string date(asctime(localtime(&now)));
+    date.resize(FST_HDR_DATE_SIZE, '\0');
+    b.insert(b.end(), date.begin(), date.end());
+    b.push_back(FST_FT_VERILOG);
+    fstUint64(b, 0); // time zero
+    
+    os->seekp(0);
+    os->write((const char *)&b[0], b.size());
+}
+
+void DumpFST::writeGeometry(void) {
+    vector<unsigned char> g, tmp, b;
+    for(size_t i = 0; i < signals.size(); i++)
+        fstVarint(g, signals[i].bits);
+    const vector<unsigned char> &d = fstCompress(&g[0], g.size(), 9, tmp) ? tmp : g;
+    b.push_back(FST_BL_GEOM);
+    fstUint64(b, d.size() + 24);
+    fstUint64(b, g.size());
+    fstUint64(b, signals.size());
+    b.insert(b.end(), d.begin(), d.end());
+    os->write((const char *)&b[0], b.size());
+}
+
+void DumpFST::writeHierarchy(void) {
+    vector<unsigned char> h, b;
+    for(size_t n = 0; n < tv.size(); n++) {
+        string s = tv[n]->name();
+        
+        /* find last dot in string as divider
+           between name of the variable and the module string. */
+        int ld;
+        for (ld=s.size()-1; ld>0; ld--)
+            if (s[ld]=='.') break;
+        string scope = s.substr(0, ld), var = s.substr(ld+1, s.size()-1);
+        
+        h.push_back(FST_ST_VCD_SCOPE);
+        h.push_back(FST_ST_VCD_MODULE);
+        h.insert(h.end(), scope.begin(), scope.end());
+        h.push_back(0);
+        h.push_back(0); // no component name
+        fstVar(h, var, tv[n]->bits());
+        if (rs)
+            fstVar(h, var + "_R", 1);
+        if (ws)
+            fstVar(h, var + "_W", 1);
+        h.push_back(FST_ST_VCD_UPSCOPE);
+    }
+    
+    // hierarchy is stored in gzip format
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if(deflateInit2(&z, 4, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        avr_error("FST: can't initialize compression");
+    vector<unsigned char> gz(deflateBound(&z, h.size()) + 64);
+    z.next_in = h.empty() ? NULL : &h[0];
+    z.avail_in = h.size();
+    z.next_out = &gz[0];
+    z.avail_out = gz.size();
+    if(deflate(&z, Z_FINISH) != Z_STREAM_END)
+        avr_error("FST: can't compress hierarchy");
+    gz.resize(z.total_out);
+    deflateEnd(&z);
+    
+    b.push_back(FST_BL_HIER);
+    fstUint64(b, gz.size() + 16);
+    fstUint64(b, h.size());
+    b.insert(b.end(), gz.begin(), gz.end());
+    os->write((const char *)&b[0], b.size());
+}
+
+void DumpFST::stop() {
+    if (!running)
+        return;
+    updateStrobes();
+    
+    // a last time marker to report end of dump
+    curTime = SystemClock::Instance().GetCurrentTime();
+    timeIndex();
+    
+    writeBlock();
+    writeGeometry();
+    writeHierarchy();
+    writeHeader();
+    os->flush();
+    running = false;
+}
+
+DumpFST::~DumpFST() {
+    if (running)
+        stop();
+    delete os;
+}
+
+#endif // HAVE_ZLIB
 
 DumpManager* DumpManager::Instance(void) {
-    if(_instance == NULL)
-        _instance = new DumpManager();
-    return _instance;
+    return SimulationContext::Current().GetDumpManager();
 }
 
 void DumpManager::Reset(void) {
-    if(_instance) {
-        _instance->detachAvrDevices();
-        delete _instance;
-    }
-    _instance = NULL;
-    _devidx = 0;
+    SimulationContext::Current().ResetDumpManager();
 }
 
 DumpManager::DumpManager() {
     singleDeviceApp = false;
+    devidx = 0;
+}
+
+DumpManager::~DumpManager() {
+    stopApplication();
+    for(size_t i = 0; i < active.size(); i++)
+        active[i]->_manager = NULL;
 }
 
 void DumpManager::appendDeviceName(std::string &s) {
-    _devidx++;
-    if(singleDeviceApp && _devidx > 1)
+    devidx++;
+    if(singleDeviceApp && devidx > 1)
         avr_error("Can't create device name twice, because it's a single device application");
     if(!singleDeviceApp)
-        s += "Dev" + int2str(_devidx);
+        s += "Dev" + int2str(devidx);
 }
 
 void DumpManager::registerAvrDevice(AvrDevice* dev) {
@@ -618,9 +1211,19 @@ void DumpManager::SetSingleDeviceApp(void) {
 void DumpManager::addDumper(Dumper *dump, const TraceSet &vals) {
     // enable values and insert into active list, if not there
     for(TraceSet::const_iterator i = vals.begin(); i != vals.end(); i++) {
-        (*i)->enable();
-        if(find(active.begin(), active.end(), *i) == active.end())
-            active.push_back(*i);
+        TraceValue *t = *i;
+        t->enable();
+        if(t->_manager != NULL)
+            continue;
+        t->_activeIndex = active.size();
+        t->_manager = this;
+        active.push_back(t);
+        activeDumpers.push_back(vector<Dumper*>());
+        if(t->polled())
+            polled.push_back(t);
+        // accessed before, dump it on next cycle
+        if(t->flags() != 0)
+            changed.push_back(t);
     }
     
     // check, if dumper exists in dumps list
@@ -630,6 +1233,11 @@ void DumpManager::addDumper(Dumper *dump, const TraceSet &vals) {
     dump->setActiveSignals(vals);
     // and insert dumper in dumps list
     dumps.push_back(dump);
+
+    // cache enabled state for all values
+    for(size_t i = 0; i < active.size(); i++)
+        if(dump->enabled(active[i]))
+            activeDumpers[i].push_back(dump);
 }
 
 const TraceSet& DumpManager::all() {
@@ -660,19 +1268,41 @@ void DumpManager::start() {
 
 }
 
+bool DumpManager::activeOrder(const TraceValue *a, const TraceValue *b) {
+    return a->_activeIndex < b->_activeIndex;
+}
+
+void DumpManager::removeActiveValue(TraceValue *t) {
+    size_t idx = t->_activeIndex;
+    active.erase(active.begin() + idx);
+    activeDumpers.erase(activeDumpers.begin() + idx);
+    for(size_t i = idx; i < active.size(); i++)
+        active[i]->_activeIndex = i;
+    polled.erase(remove(polled.begin(), polled.end(), t), polled.end());
+    changed.erase(remove(changed.begin(), changed.end(), t), changed.end());
+    t->_manager = NULL;
+}
+
 void DumpManager::cycle() {
     // First, call the Dumpers
     for (size_t i=0; i<dumps.size(); i++)
         dumps[i]->cycle();
 
-    // And then, update the TraceValues and dump them
-    for (TraceSet::iterator i=active.begin();
-         i!=active.end(); i++) {
+    // And then, update the polled TraceValues, they register itself as changed
+    for (TraceSet::iterator i=polled.begin();
+         i!=polled.end(); i++)
         (*i)->cycle();
-        for (size_t j=0; j<dumps.size(); j++)
-            if (dumps[j]->enabled(*i))
-                (*i)->dump(*dumps[j]);
+
+    // dump all accessed or changed values in order of active list
+    if (changed.size() > 1)
+        sort(changed.begin(), changed.end(), activeOrder);
+    for (TraceSet::iterator i=changed.begin();
+         i!=changed.end(); i++) {
+        const vector<Dumper*> &d = activeDumpers[(*i)->_activeIndex];
+        for (size_t j=0; j<d.size(); j++)
+            (*i)->dump(*d[j]);
     }
+    changed.clear();
 }
 
 void DumpManager::stopApplication(void) {
@@ -27,10 +27,13 @@
 
 #include <stdint.h>
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <map>
 #include <vector>
 
+#include "systemclocktypes.h"
+
 /* TODO, notes:
 
    ===========================================================   
@@ -83,6 +86,7 @@
    per-line profiling statistics. */
 
 class Dumper;
+class DumpManager;
 
 /*! Abstract interface for traceable values.
   Traced values can be written (marking it with a WRITE flag
@@ -107,7 +111,7 @@ class TraceValue {
                    const std::string &_name,
                    const int __index=-1,
                    const void* shadow=0);
-        virtual ~TraceValue() {}
+        virtual ~TraceValue();
 
         //! Give number of bits for this value. Max 32.
         size_t bits() const;
@@ -171,8 +175,13 @@ class TraceValue {
         
         //! Called at least once for each cycle if this trace value is activated
         /*! This may check for updates to an underlying referenced value etc.
-          and update the flags accordingly. */
+          and update the flags accordingly. Only called, if polled() is true. */
         virtual void cycle();
+
+        /*! Gives true, if cycle() has to be called on each cycle to detect
+          changes. Other values are only dumped, if they are accessed. A
+          derived class, which implements cycle(), has to return true here. */
+        virtual bool polled() const;
         
         /*! Dump the state or state change somewhere. This also resets the current
           flags. */
@@ -185,8 +194,12 @@ class TraceValue {
         //! Clear all access flags
         void clear_flags();
         friend class TraceKeeper;
+        friend class DumpManager;
         
     private:
+        //! Set access flags, register value in changed list of DumpManager on first access
+        inline void mark(int flags);
+        
         std::string _name;
     
         int _index;
@@ -209,6 +222,11 @@ class TraceValue {
         /*! Note that it must additionally be enabled in the particular
           Dumper. */
         bool _enabled;
+
+        //! DumpManager, which holds this value in active list, or NULL
+        DumpManager *_manager;
+        //! Position in active list of DumpManager
+        size_t _activeIndex;
 };
 
 class TraceValueOutput: public TraceValue {
@@ -262,9 +280,8 @@ class Dumper {
         virtual ~Dumper() {}
     
         //! Returns true iff tracing a particular value is enabled
-        /*! FIXME: For a lot of values to trace,
-          checking enabled() each time by doing find on a map()
-          could be slow. Here is potential for more optimization! */
+        /*! DumpManager asks this only once for each value, when dumper is
+          added, and not on each cycle. */
         virtual bool enabled(const TraceValue *t) const=0;
 };
 
@@ -281,24 +298,32 @@ class WarnUnknown : public Dumper {
         AvrDevice *core;
 };
 
-/*! Produces value change dump files. */
+/*! Produces value change dump files.
+
+  If async is set, the simulation thread only puts a small binary record
+  for each change into a ring buffer. Formatting of the VCD text and
+  writing to the output stream is done by a separate writer thread, which
+  is started by start() and finished by stop(). The output is the same as
+  in synchronous mode. */
 class DumpVCD : public Dumper {
     
     public:
         //! Create tracer with time scale tscale and output os
         DumpVCD(std::ostream *os, const std::string &tscale = "ns",
-            const bool rstrobes = false, const bool wstrobes = false);
+            const bool rstrobes = false, const bool wstrobes = false,
+            const bool async = false);
         
         //! Create tracer with time scale tscale for output file name
         DumpVCD(const std::string &name, const std::string &tscale = "ns",
-            const bool rstrobes = false, const bool wstrobes = false);
+            const bool rstrobes = false, const bool wstrobes = false,
+            const bool async = true);
         
         void setActiveSignals(const TraceSet &act);
     
         //! Writes header stuff and the initial state
         void start();
     
-        //! Writes a last time marker
+        //! Writes a last time marker, waits for the writer thread in async mode
         void stop();
     
         //! Writes next clock cycle and resets all RS and WS states
@@ -319,23 +344,134 @@ class DumpVCD : public Dumper {
         ~DumpVCD();
         
     private:
+        class AsyncWriter;
+
         TraceSet tv;
         std::map<const TraceValue*, size_t> id2num;
         const std::string tscale;
         const bool rs, ws;
+        const bool async;
         bool changesWritten;
         
         // list of signals marked last cycle
         std::vector<int> marked;
         std::ostream *os;
+        // stream buffer for output file
+        std::vector<char> iobuffer;
     
         // buffer for change data
         std::stringstream osbuffer;
+
+        // ring buffer and writer thread, only while running in async mode
+        AsyncWriter *writer;
         
-        void valout(const TraceValue *v);
+        //! packs VCD state of all bits of a value, 2 bits for each bit
+        static unsigned long long packValue(const TraceValue *v);
+
+        //! writes a packed value for signal n to osbuffer
+        void valout(size_t n, unsigned long long bits);
         
         //! writes content of osbuffer to os and empty osbuffer afterwards
         void flushbuffer(void);
+
+        //! output functions, called by writer thread in async mode
+        void writeCycle(SystemClockOffset clock);
+        void writeRead(size_t n);
+        void writeWrite(size_t n);
+        void writeChange(size_t n, unsigned long long bits);
+        void writeStop(SystemClockOffset clock);
+
+        //! main loop of writer thread
+        void writerLoop(void);
+};
+
+/*! Produces FST files, the compressed and indexed waveform format of GTKWave.
+
+  Value changes are collected for each signal and written in blocks, when
+  the collected data reaches a limit, so memory usage is bounded. Each
+  block holds the values at block begin, the changes for each signal
+  (compressed separately) and a table of the used time stamps. Signal
+  sizes and names are written at the end of the file. Only available, if
+  simulavr is built with zlib (HAVE_ZLIB). */
+class DumpFST : public Dumper {
+    
+    public:
+        //! Create tracer for output file name
+        DumpFST(const std::string &name,
+            const bool rstrobes = false, const bool wstrobes = false);
+        
+        void setActiveSignals(const TraceSet &act);
+    
+        //! Writes the file header and the initial state
+        void start();
+    
+        //! Writes last block, signal sizes and names, completes the header
+        void stop();
+    
+        //! Starts next clock cycle, sets back RS and WS signals
+        void cycle();
+    
+        //! Iff rstrobes is true, this will mark reads on a R-strobe signal
+        void markRead(const TraceValue *t);
+    
+        //! Iff wstrobes is true, this will mark writes on a W-strobe signal
+        void markWrite(const TraceValue *t);
+        
+        //! Record a value change
+        void markChange(const TraceValue *t);
+    
+        bool enabled(const TraceValue *t) const;
+        ~DumpFST();
+        
+    private:
+        //! State of one FST signal (a value or a strobe)
+        struct Signal {
+            size_t bits;
+            size_t offset; //!< position of value in curval
+            std::vector<unsigned char> chain; //!< changes in actual block
+            bool hasLast; //!< chain contains a change
+            size_t lastIndex; //!< time index of last change in chain
+            size_t lastPos; //!< position of last change in chain
+            size_t prevIndex; //!< time index of change before last change
+        };
+        
+        TraceSet tv;
+        std::map<const TraceValue*, size_t> id2num;
+        const bool rs, ws;
+        std::ofstream *os;
+        
+        std::vector<Signal> signals;
+        std::string curval; //!< actual values of all signals, one char for each bit
+        std::vector<unsigned char> strobeHigh; //!< actual state of strobe signals
+        std::vector<unsigned char> strobeHit; //!< strobes accessed in actual cycle
+        std::vector<size_t> highList; //!< strobes, which are high
+        std::vector<size_t> hitList; //!< strobes accessed in actual cycle
+        
+        SystemClockOffset curTime; //!< time of actual cycle
+        std::vector<SystemClockOffset> times; //!< time table of actual block
+        std::string frame; //!< values at begin of actual block
+        size_t blockBytes; //!< size of collected changes in actual block
+        unsigned long long blockCount;
+        bool running;
+        
+        //! index of actual time in time table, adds the time if necessary
+        size_t timeIndex(void);
+        
+        //! record a value change of signal n with new value val (bits chars)
+        void change(size_t n, const char *val);
+        
+        //! set strobe signals according to accesses in last cycle
+        void updateStrobes(void);
+        
+        //! write collected changes as value change block and start a new block
+        void writeBlock(void);
+        
+        //! write file header, first with placeholders, at end with final values
+        void writeHeader(void);
+        
+        //! write signal sizes and hierarchy with signal names
+        void writeGeometry(void);
+        void writeHierarchy(void);
 };
 
 /*! Manages all active Dumper instances for a given AvrDevice.
@@ -344,10 +480,10 @@ class DumpVCD : public Dumper {
 class DumpManager {
     
     public:
-        //! Singleton class access.
+        //! Returns the DumpManager of the current SimulationContext
         static DumpManager* Instance(void);
         
-        //! Reset DumpManager instance (e.g. delete available instance)
+        //! Reset DumpManager instance of the current SimulationContext (e.g. delete available instance)
         static void Reset(void);
 
         //! Tell DumpManager, that we have only one device
@@ -374,9 +510,12 @@ class DumpManager {
         /*! Process one AVR clock cycle. Must be done after the AVR did all
           processing so that changed values etc. can be collected. */
         void cycle();
+
+        //! Returns true, if at least one dumper is registered
+        bool IsDumping(void) const { return dumps.size() != 0; }
     
         //! Destroys the DumpManager instance and shut down all dumpers
-        ~DumpManager() { stopApplication(); }
+        ~DumpManager();
     
         /*! Write a list of all tracing value names into the given
           output stream. */
@@ -400,6 +539,7 @@ class DumpManager {
     private:
         friend class TraceValueRegister;
         friend class AvrDevice;
+        friend class SimulationContext;
         
         //! Private instance constructor
         DumpManager();
@@ -418,12 +558,24 @@ class DumpManager {
 
         //! Seek value by name in all devices
         TraceValue* seekValueByName(const std::string &name);
+
+        //! Remove a deleted value from active list
+        void removeActiveValue(TraceValue *t);
+
+        //! Sort order for changed values, same order as in active list
+        static bool activeOrder(const TraceValue *a, const TraceValue *b);
         
         //! Flag, if we use only one device, e.g. assign no device name
         bool singleDeviceApp;
         
         //! Set of active tracing values
         TraceSet active;
+        //! Active values, which have to be polled on each cycle, see TraceValue::polled
+        TraceSet polled;
+        //! Active values, which are accessed or changed in actual cycle
+        TraceSet changed;
+        //! Dumpers, which are enabled for a active value, same order as active
+        std::vector<std::vector<Dumper*> > activeDumpers;
         //! Set of all traceable values (placeholder instance for all() method)
         TraceSet _all;
         
@@ -433,10 +585,18 @@ class DumpManager {
         //! Device list
         std::vector<AvrDevice*> devices;
 
-        static int _devidx;
-        static DumpManager *_instance;
+        //! Count of devices, which got a name by appendDeviceName
+        int devidx;
+
+        friend class TraceValue;
 };
 
+void TraceValue::mark(int flags) {
+    if(f == 0 && _manager != NULL)
+        _manager->changed.push_back(this);
+    f |= flags;
+}
+
 //! Build a register for TraceValue's
 /*! This is used by DumpManager to find TraceValues by name */
 class TraceValueRegister {
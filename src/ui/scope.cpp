@@ -42,7 +42,10 @@ class ScopePin : public Pin {
 };
 
 Scope::Scope( UserInterface *u, const string & n, unsigned int cnt, const char *baseWindow)
-	: ui(u), name(n), vecPin(cnt), lastVal(cnt), noOfChannels(cnt)
+	: Scope(SystemClock::Instance(), u, n, cnt, baseWindow) {}
+
+Scope::Scope(SystemClock &c, UserInterface *u, const string & n, unsigned int cnt, const char *baseWindow)
+	: clock(c), ui(u), name(n), vecPin(cnt), lastVal(cnt), noOfChannels(cnt)
 {
     for (unsigned int tt=0; tt< cnt; tt++) {
         vecPin[tt]=new ScopePin(this, tt);
@@ -64,7 +67,7 @@ Pin *Scope::GetPin(unsigned int n) {
 void Scope::SetInStateForChannel(unsigned int channel, Pin& p) {
     if ( lastVal[channel]!= p.GetAnalog() ) {
         ostringstream os;
-        os << name << " ChangeValue " << SystemClock::Instance().GetCurrentTime() << " " << channel << " " << p.GetAnalog()<<endl;
+        os << name << " ChangeValue " << clock.GetCurrentTime() << " " << channel << " " << p.GetAnalog()<<endl;
 
         ui->Write(os.str());
         //cout << "Set last val for channel " << channel << " value " << p.GetAnalog() << endl;
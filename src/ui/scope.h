@@ -37,8 +37,11 @@
 #include "../pin.h"
 
 
+class SystemClock;
+
 class Scope : public SimulationMember {
     protected:
+        SystemClock &clock; //!< time table, which gives the time of a change
         UserInterface *ui;
 	std::string name;
         unsigned char myPortValue;
@@ -50,7 +53,10 @@ class Scope : public SimulationMember {
 
 
     public:
+        //! Creates a scope, which takes the time of the current SimulationContext
         Scope(UserInterface *ui, const std::string &name, unsigned int noOfChannels, const char *baseWindow);
+        //! Creates a scope, which takes the time of time table c
+        Scope(SystemClock &c, UserInterface *ui, const std::string &name, unsigned int noOfChannels, const char *baseWindow);
         virtual ~Scope();
         Pin *GetPin(unsigned int no); 
         virtual int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns){return 0;} //what we should step here?
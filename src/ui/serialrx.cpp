@@ -30,7 +30,9 @@
 
 using namespace std;
 
-SerialRxBasic::SerialRxBasic(){
+SerialRxBasic::SerialRxBasic(): SerialRxBasic(SystemClock::Instance()) {}
+
+SerialRxBasic::SerialRxBasic(SystemClock &c): clock(c) {
     rx.RegisterCallback(this);
     allPins["rx"]= &rx;
     sendInHex = false;
@@ -41,7 +43,7 @@ void SerialRxBasic::PinStateHasChanged(Pin* p){
     if (!*p) { //Low
         if (rxState== RX_WAIT_LOWEDGE) {
             rxState=RX_READ_STARTBIT;
-            SystemClock::Instance().Add(this); //as next Step() is called
+            clock.Add(this); //as next Step() is called
         }
     }
 }
@@ -154,7 +156,9 @@ long SerialRxBuffered::Size(){
 // ===========================================================================
 
 
-SerialRxFile::SerialRxFile(const char *filename) {
+SerialRxFile::SerialRxFile(const char *filename): SerialRxFile(SystemClock::Instance(), filename) {}
+
+SerialRxFile::SerialRxFile(SystemClock &c, const char *filename): SerialRxBasic(c) {
     if (std::string(filename) == "-")
         stream.std::ostream::rdbuf(std::cout.rdbuf());
     else
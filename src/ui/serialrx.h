@@ -32,8 +32,11 @@
 #include "pinnotify.h"
 
 
+class SystemClock;
+
 class SerialRxBasic: public SimulationMember, public HasPinNotifyFunction {
     protected:
+        SystemClock &clock; //!< time table, on which the receiver runs
         Pin rx;
         std::map < std::string, Pin *> allPins;
         unsigned long long baudrate;
@@ -63,7 +66,10 @@ class SerialRxBasic: public SimulationMember, public HasPinNotifyFunction {
     public:
         void SetBaudRate(SystemClockOffset baud);
         void SetHexOutput(bool newValue);
+        //! Creates a receiver on the time table of the current SimulationContext
         SerialRxBasic();
+        //! Creates a receiver on time table c
+        SerialRxBasic(SystemClock &c);
         void Reset();
         virtual Pin* GetPin(const char *name) ;
         virtual ~SerialRxBasic(){};
@@ -91,6 +97,7 @@ class SerialRxFile: public SerialRxBasic {
         virtual void CharReceived(unsigned char c);
     public:
         SerialRxFile(const char *filename);
+        SerialRxFile(SystemClock &c, const char *filename);
         ~SerialRxFile();
 
         virtual std::string getType() { return std::string("SerialRxFile"); }
@@ -30,7 +30,9 @@
 
 using namespace std;
 
-SerialTxBuffered::SerialTxBuffered()
+SerialTxBuffered::SerialTxBuffered(): SerialTxBuffered(SystemClock::Instance()) {}
+
+SerialTxBuffered::SerialTxBuffered(SystemClock &c): clock(c)
 {
     allPins["tx"] = &tx;
     Reset();
@@ -111,7 +113,7 @@ void SerialTxBuffered::Send(unsigned char data)
     //if we not active, activate tx machine now
     if (txState==TX_DISABLED) {
         txState=TX_SEND_STARTBIT;
-        SystemClock::Instance().Add(this);
+        clock.Add(this);
     }
 }
 
@@ -138,7 +140,11 @@ void SerialTxBuffered::SetHexInput(bool newValue){
 #include <poll.h>
 
 //SerialTxFile::SerialTxFile(const char *filename) : SerialTxBuffered() {
-SerialTxFile::SerialTxFile(const char *filename, SystemClockOffset delayNanos) {
+SerialTxFile::SerialTxFile(const char *filename, SystemClockOffset delayNanos):
+    SerialTxFile(SystemClock::Instance(), filename, delayNanos) {}
+
+SerialTxFile::SerialTxFile(SystemClock &c, const char *filename, SystemClockOffset delayNanos):
+    SerialTxBuffered(c) {
     avr_debug("SerialTxFile::SerialTxFile()");
     if (std::string(filename) == "-")
         fd = fileno(stdin);
@@ -148,7 +154,7 @@ SerialTxFile::SerialTxFile(const char *filename, SystemClockOffset delayNanos) {
         avr_error("open input file failed");
     Reset();
 
-    SystemClock::Instance().Add(this, delayNanos);
+    clock.Add(this, delayNanos);
 }
 
 SerialTxFile::~SerialTxFile() {
@@ -183,6 +189,7 @@ int SerialTxFile::Step(bool &trueHwStep,
         // more than one byte waiting, they're accepted at every serial clock
         // tick, which means, ten times faster than they can be sent.
         *timeToNextStepIn_ns = (SystemClockOffset)1000000;
+    return 0;
 }
 
 // ===========================================================================
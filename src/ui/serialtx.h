@@ -29,8 +29,11 @@
 #include "systemclocktypes.h"
 #include "ui.h"
 
+class SystemClock;
+
 class SerialTxBuffered: public SimulationMember {
     protected:
+        SystemClock &clock; //!< time table, on which the sender runs
         Pin tx;
 
         std::map < std::string, Pin *> allPins;
@@ -54,7 +57,10 @@ class SerialTxBuffered: public SimulationMember {
         bool receiveInHex;
 
     public:
+        //! Creates a sender on the time table of the current SimulationContext
         SerialTxBuffered();
+        //! Creates a sender on time table c
+        SerialTxBuffered(SystemClock &c);
         void Reset();
         virtual ~SerialTxBuffered(){};
         void SetHexInput(bool newValue);
@@ -78,6 +84,7 @@ class SerialTxFile: public SerialTxBuffered {
         int fd;
     public:
         SerialTxFile(const char *filename, SystemClockOffset delayNanos);
+        SerialTxFile(SystemClock &c, const char *filename, SystemClockOffset delayNanos);
         ~SerialTxFile();
         virtual int Step(bool &trueHwStep, SystemClockOffset *timeToNextStepIn_ns=0);
 